@@ -0,0 +1,226 @@
+//
+// Created by jim on 3/9/19.
+//
+
+#ifndef brick_bricker_h
+#define brick_bricker_h
+
+#include <bd/io/bufferedreader.h>
+#include <bd/io/fileblock.h>
+#include <bd/log/logger.h>
+#include <bd/util/util.h>
+#include <bd/volume/volume.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace brick
+{
+
+/// \brief Rewrites a row-major raw file so that the voxels of each block are
+///        stored contiguously (a brick), in x, y, z order within the brick.
+///
+/// Bricks are written in block index order, or in Morton (Z) order of the
+/// block ijk index so that neighbouring blocks are close together on disk.
+/// Voxels outside the blocks extent are never loaded and are not written.
+///
+/// The raw file is read front to back exactly once. The read buffers hold
+/// whole xy slices, so the part of a brick that is in a buffer is always a
+/// contiguous range of the output file and is written with one write.
+template<class Ty>
+class Bricker
+{
+public:
+
+  /// \param volume Volume of the row-major raw file.
+  /// \param blocks The file blocks of the row-major raw file.
+  Bricker(bd::Volume const &volume, std::vector<bd::FileBlock> const &blocks)
+    : m_volume{ volume }
+    , m_blocks{ blocks }
+    , m_morton{ false }
+    , m_bufferBytes{ 64 * 1024 * 1024 }
+    , m_readers{ 1 }
+  {
+  }
+
+
+  /// \brief Store bricks in Morton order (default is block index order).
+  void
+  setMorton(bool morton)
+  {
+    m_morton = morton;
+  }
+
+
+  void
+  setBufferBytes(uint64_t bytes)
+  {
+    m_bufferBytes = bytes;
+  }
+
+
+  void
+  setReaders(int readers)
+  {
+    m_readers = readers < 1 ? 1 : readers;
+  }
+
+
+  /// \brief Read the row-major \c rawPath and write the bricked \c outPath.
+  /// The data offsets of blocks() are the brick offsets in \c outPath.
+  bool
+  write(std::string const &rawPath, std::string const &outPath)
+  {
+    assignBrickOffsets();
+
+    glm::u64vec3 const vd{ m_volume.voxelDims() };
+    glm::u64vec3 const bdims{ m_volume.block_dims() };
+    glm::u64vec3 const nb{ m_volume.block_count() };
+    uint64_t const sliceElems{ vd.x * vd.y };
+    uint64_t const brickElems{ bdims.x * bdims.y * bdims.z };
+    uint64_t const outBytes{ m_blocks.size() * brickElems * sizeof(Ty) };
+    uint64_t const lastSlice{ bdims.z * nb.z };
+
+    if (outBytes == 0) {
+      bd::Err() << "Blocks are empty, nothing to write.";
+      return false;
+    }
+
+    // brick lookup by ijk.
+    std::vector<uint64_t> brickOffset(m_blocks.size());
+    for (bd::FileBlock const &b : m_blocks) {
+      brickOffset[bd::to1D(b.ijk_index[0], b.ijk_index[1], b.ijk_index[2],
+                           nb.x, nb.y)] = b.data_offset;
+    }
+
+    // Buffers hold whole slices.
+    int const numBuffers{ 4 };
+    uint64_t slicesPerBuffer{ m_bufferBytes / numBuffers / ( sliceElems * sizeof(Ty) ) };
+    slicesPerBuffer = std::max<uint64_t>(slicesPerBuffer, 1);
+    bd::BufferedReader<Ty> r{ numBuffers * slicesPerBuffer * sliceElems * sizeof(Ty) };
+    r.setNumBuffers(numBuffers);
+    r.setNumReaders(m_readers);
+    if (!r.open(rawPath)) {
+      return false;
+    }
+
+    std::ofstream out;
+    out.open(outPath, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+      bd::Err() << "Could not open: " << outPath;
+      return false;
+    }
+    // size the file up front so bricks can be written in any order.
+    char const zero{ 0 };
+    out.seekp(outBytes - 1);
+    out.write(&zero, 1);
+
+    std::vector<Ty> scratch(slicesPerBuffer * bdims.x * bdims.y);
+
+    r.start();
+    uint64_t slicesRead{ 0 };
+    bd::Buffer<Ty> *buf{ nullptr };
+    while (( buf = r.waitNextFullUntilNone()) != nullptr) {
+      Ty const *data{ buf->getPtr() };
+      uint64_t const z0{ buf->getIndexOffset() / sliceElems };
+      uint64_t const z1{ std::min(z0 + buf->getNumElements() / sliceElems, lastSlice) };
+      slicesRead += buf->getNumElements() / sliceElems;
+
+      // the slices in this buffer may span more than one layer of blocks.
+      for (uint64_t zs = z0; zs < z1; zs = ( zs / bdims.z + 1 ) * bdims.z) {
+        uint64_t const k{ zs / bdims.z };
+        uint64_t const ze{ std::min(z1, ( k + 1 ) * bdims.z) };
+
+        for (uint64_t j = 0; j < nb.y; ++j) {
+          for (uint64_t i = 0; i < nb.x; ++i) {
+
+            Ty *dest{ scratch.data() };
+            for (uint64_t z = zs; z < ze; ++z) {
+              for (uint64_t y = j * bdims.y; y < ( j + 1 ) * bdims.y; ++y) {
+                Ty const *row{ data + ( z - z0 ) * sliceElems + y * vd.x + i * bdims.x };
+                dest = std::copy(row, row + bdims.x, dest);
+              }
+            }
+
+            uint64_t const brickSliceOffset{ ( zs - k * bdims.z ) * bdims.x * bdims.y * sizeof(Ty) };
+            out.seekp(brickOffset[bd::to1D(i, j, k, nb.x, nb.y)] + brickSliceOffset);
+            out.write(reinterpret_cast<char const *>(scratch.data()),
+                      ( dest - scratch.data() ) * sizeof(Ty));
+          }
+        }
+      } // for zs
+
+      r.waitReturnEmpty(buf);
+      if (!out.good()) {
+        bd::Err() << "Error writing " << outPath;
+        break;
+      }
+    }
+    r.reset();
+
+    bool const ok{ out.good() };
+    out.close();
+
+    if (slicesRead < lastSlice) {
+      bd::Err() << rawPath << " ended after " << slicesRead << " of "
+                << lastSlice << " slices.";
+      return false;
+    }
+    return ok;
+  }
+
+
+  /// \brief The file blocks, with data offsets into the bricked file after
+  ///        write() has been called.
+  std::vector<bd::FileBlock> const &
+  blocks() const
+  {
+    return m_blocks;
+  }
+
+
+private:
+
+  /// \brief Lay out the bricks back to back, in the order given by m_morton.
+  void
+  assignBrickOffsets()
+  {
+    std::vector<size_t> order(m_blocks.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (m_morton) {
+      std::vector<unsigned long long> codes(m_blocks.size());
+      for (size_t i = 0; i < m_blocks.size(); ++i) {
+        uint64_t const *ijk{ m_blocks[i].ijk_index };
+        codes[i] = bd::mortonEncode(ijk[0], ijk[1], ijk[2]);
+      }
+      std::sort(order.begin(), order.end(),
+                [&codes](size_t a, size_t b) { return codes[a] < codes[b]; });
+    }
+
+    glm::u64vec3 const bdims{ m_volume.block_dims() };
+    uint64_t const brickBytes{ bdims.x * bdims.y * bdims.z * sizeof(Ty) };
+    uint64_t offset{ 0 };
+    for (size_t idx : order) {
+      m_blocks[idx].data_offset = offset;
+      m_blocks[idx].data_bytes = brickBytes;
+      offset += brickBytes;
+    }
+  }
+
+
+  bd::Volume m_volume;
+  std::vector<bd::FileBlock> m_blocks;
+  bool m_morton;
+  uint64_t m_bufferBytes;
+  int m_readers;
+
+}; // class Bricker
+
+} // namespace brick
+
+#endif // ! brick_bricker_h
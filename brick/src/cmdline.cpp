@@ -0,0 +1,139 @@
+//
+// Created by jim on 3/9/19.
+//
+
+#include "cmdline.h"
+
+#include <tclap/CmdLine.h>
+
+#include <iostream>
+
+namespace brick
+{
+
+int
+parseThem(int argc, const char *argv[], CommandLineOptions &opts)
+try
+{
+  TCLAP::CmdLine cmd("Rewrite a raw volume so that each block is stored "
+                     "contiguously (brick-major order).", ' ');
+
+  TCLAP::ValueArg<std::string> indexArg("i", "index",
+                                        "Index file of the row-major raw file.",
+                                        true, "", "string");
+  cmd.add(indexArg);
+
+  TCLAP::ValueArg<std::string> rawArg("r", "raw",
+                                      "Path to row-major raw data file (default: "
+                                      "vol_path/vol_name from the index file).",
+                                      false, "", "string");
+  cmd.add(rawArg);
+
+  TCLAP::ValueArg<std::string> outArg("o", "out", "Bricked raw file to write.",
+                                      true, "", "string");
+  cmd.add(outArg);
+
+  TCLAP::ValueArg<std::string> outIndexArg("", "out-index",
+                                           "Index file to write for the bricked raw "
+                                           "file (default: <out>.json).",
+                                           false, "", "string");
+  cmd.add(outIndexArg);
+
+  std::vector<std::string> orders{ "linear", "morton" };
+  TCLAP::ValuesConstraint<std::string> orderConstraint(orders);
+  TCLAP::ValueArg<std::string> orderArg("", "order",
+                                        "Order of the bricks in the output file. "
+                                        "linear: block index order, morton: "
+                                        "Z-order of the block ijk index.",
+                                        false, "linear", &orderConstraint);
+  cmd.add(orderArg);
+
+  // buffer size
+  std::string const sixty_four_megs = "64M";
+  TCLAP::ValueArg<std::string> bufferSizeArg("b", "buffer-size",
+                                             "Buffer size bytes. Format is a numeric value followed by "
+                                             "K, M, or G.\n"
+                                             "Values: [0-9]+[KMG].\n"
+                                             "Default: 64M",
+                                             false, sixty_four_megs, "string");
+  cmd.add(bufferSizeArg);
+
+  TCLAP::ValueArg<int> readersArg("", "readers", "Threads reading the raw file.",
+                                  false, 1, "int");
+  cmd.add(readersArg);
+
+  cmd.parse(argc, argv);
+
+  opts.indexFilePath = indexArg.getValue();
+  opts.rawFilePath = rawArg.getValue();
+  opts.outRawFilePath = outArg.getValue();
+  opts.outIndexFilePath = outIndexArg.getValue();
+  if (opts.outIndexFilePath.empty()) {
+    opts.outIndexFilePath = opts.outRawFilePath + ".json";
+  }
+  opts.order = orderArg.getValue();
+  opts.bufferSize = convertToBytes(bufferSizeArg.getValue());
+  opts.readers = readersArg.getValue();
+
+  return static_cast<int>(cmd.getArgList().size());
+
+} catch (TCLAP::ArgException &e) {
+
+  std::cerr << "Error parsing command line args: " << e.error() << " for argument "
+            << e.argId() << std::endl;
+  return 0;
+}
+
+
+size_t
+convertToBytes(std::string s)
+{
+  size_t multiplier{ 1 };
+  std::string last{ *( s.end() - 1 ) };
+
+  if (last == "K") {
+    multiplier = 1024;
+  } else if (last == "M") {
+    multiplier = 1024 * 1024;
+  } else if (last == "G") {
+    multiplier = 1024 * 1024 * 1024;
+  } else {
+    return stoull(s);
+  }
+
+  std::string numPart(s.begin(), s.end() - 1);
+  auto num = stoull(numPart);
+
+  return num * multiplier;
+}
+
+
+void
+printThem(const CommandLineOptions &opts)
+{
+  std::cout << opts << std::endl;
+}
+
+
+std::ostream &
+operator<<(std::ostream &os, const CommandLineOptions &opts)
+{
+  os << "\n" "Index file path: "
+     << opts.indexFilePath
+     << "\n" "Raw file path: "
+     << opts.rawFilePath
+     << "\n" "Output raw file path: "
+     << opts.outRawFilePath
+     << "\n" "Output index file path: "
+     << opts.outIndexFilePath
+     << "\n" "Brick order: "
+     << opts.order
+     << "\n" "Buffer Size: "
+     << opts.bufferSize << " bytes."
+     << "\n" "Readers: "
+     << opts.readers;
+
+  return os;
+}
+
+} // namespace brick
@@ -0,0 +1,60 @@
+//
+// Created by jim on 3/9/19.
+//
+
+#ifndef brick_cmdline_h
+#define brick_cmdline_h
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace brick
+{
+
+struct CommandLineOptions
+{
+  // row-major index file (written by preproc)
+  std::string indexFilePath;
+  // row-major raw file (default: vol_path/vol_name from the index file)
+  std::string rawFilePath;
+  // bricked raw file to write
+  std::string outRawFilePath;
+  // index file to write for the bricked raw file
+  std::string outIndexFilePath;
+  // brick order, "linear" or "morton"
+  std::string order;
+  // total size of the read buffers in bytes
+  uint64_t bufferSize;
+  // reader threads
+  int readers;
+};
+
+
+size_t
+convertToBytes(std::string s);
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Parses command line args and populates \c opts.
+///
+/// If non-zero arg was returned, then the parse was successful, but it does
+/// not mean that valid or all of the required args were provided on the
+/// command line.
+///
+/// \returns 0 on parse failure, non-zero if the parse was successful.
+///////////////////////////////////////////////////////////////////////////////
+int
+parseThem(int argc, const char *argv[], CommandLineOptions &opts);
+
+
+void
+printThem(const CommandLineOptions &);
+
+
+std::ostream &
+operator<<(std::ostream &, const CommandLineOptions &);
+
+} // namespace brick
+
+#endif // ! brick_cmdline_h
@@ -0,0 +1,129 @@
+//
+// Created by jim on 3/9/19.
+//
+
+#include "bricker.h"
+#include "cmdline.h"
+
+#include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/log/logger.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+/// \brief Split \c path into its directory and file name.
+void
+splitPath(std::string const &path, std::string &dir, std::string &name)
+{
+  size_t const slash{ path.find_last_of("/\\") };
+  if (slash == std::string::npos) {
+    dir = "";
+    name = path;
+  } else {
+    dir = path.substr(0, slash);
+    name = path.substr(slash + 1);
+  }
+}
+
+
+template<class Ty>
+bool
+go(brick::CommandLineOptions const &opts,
+   bd::indexfile::v2::JsonIndexFile &index)
+{
+  brick::Bricker<Ty> bricker{ index.getVolume(), index.getFileBlocks() };
+  bricker.setMorton(opts.order == "morton");
+  bricker.setBufferBytes(opts.bufferSize);
+  bricker.setReaders(opts.readers);
+
+  auto start = std::chrono::steady_clock::now();
+  if (!bricker.write(opts.rawFilePath, opts.outRawFilePath)) {
+    return false;
+  }
+  bd::Info() << "Wrote " << opts.outRawFilePath << " in "
+             << std::chrono::duration<double>(
+                 std::chrono::steady_clock::now() - start).count() << " seconds";
+
+  std::string outDir, outName;
+  splitPath(opts.outRawFilePath, outDir, outName);
+  index.setRawFilePath(outDir);
+  index.setRawFileName(outName);
+  index.setFileBlocks(bricker.blocks());
+  index.setBrickOrder(opts.order);
+  if (!index.write(opts.outIndexFilePath)) {
+    return false;
+  }
+  bd::Info() << "Wrote " << opts.outIndexFilePath;
+
+  return true;
+}
+
+} // namespace
+
+
+int
+main(int argc, char const *argv[])
+{
+  brick::CommandLineOptions opts;
+  if (brick::parseThem(argc, argv, opts) == 0) {
+    std::cerr << "Please use -h for usage." << std::endl;
+    return 1;
+  }
+
+  bd::indexfile::v2::JsonIndexFile index;
+  if (!index.open(opts.indexFilePath)) {
+    return 1;
+  }
+  if (index.isBricked()) {
+    bd::Err() << opts.indexFilePath << " is already bricked.";
+    return 1;
+  }
+  if (opts.rawFilePath.empty()) {
+    opts.rawFilePath = index.getRawFilePath().empty()
+                       ? index.getRawFileName()
+                       : index.getRawFilePath() + '/' + index.getRawFileName();
+  }
+  brick::printThem(opts);
+
+  bool ok{ false };
+  switch (index.getDatType()) {
+    case bd::DataType::Character:
+      ok = go<int8_t>(opts, index);
+      break;
+    case bd::DataType::UnsignedCharacter:
+      ok = go<uint8_t>(opts, index);
+      break;
+    case bd::DataType::Short:
+      ok = go<int16_t>(opts, index);
+      break;
+    case bd::DataType::UnsignedShort:
+      ok = go<uint16_t>(opts, index);
+      break;
+    case bd::DataType::Integer:
+      ok = go<int32_t>(opts, index);
+      break;
+    case bd::DataType::UnsignedInteger:
+      ok = go<uint32_t>(opts, index);
+      break;
+    case bd::DataType::Float:
+      ok = go<float>(opts, index);
+      break;
+    case bd::DataType::Double:
+      ok = go<double>(opts, index);
+      break;
+    default:
+      bd::Err() << "Unsupported data type.";
+      break;
+  }
+
+  if (!ok) {
+    bd::Err() << "Bricking failed.";
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,65 @@
+//
+// Created by jim on 3/14/19.
+//
+
+#include "cmdline.h"
+
+#include <tclap/CmdLine.h>
+
+#include <iostream>
+
+namespace indexconv
+{
+
+int
+parseThem(int argc, const char *argv[], CommandLineOptions &opts)
+try
+{
+  TCLAP::CmdLine cmd("Convert a json (v2) index file to a binary (v3) index "
+                     "file, or a binary index file back to json.", ' ');
+
+  TCLAP::ValueArg<std::string> inArg("i", "index", "Index file to convert.",
+                                     true, "", "string");
+  cmd.add(inArg);
+
+  TCLAP::ValueArg<std::string> outArg("o", "out",
+                                      "Index file to write (default: <index>.idx "
+                                      "for json input, <index>.json for binary "
+                                      "input).",
+                                      false, "", "string");
+  cmd.add(outArg);
+
+  cmd.parse(argc, argv);
+
+  opts.inFilePath = inArg.getValue();
+  opts.outFilePath = outArg.getValue();
+
+  return static_cast<int>(cmd.getArgList().size());
+
+} catch (TCLAP::ArgException &e) {
+
+  std::cerr << "Error parsing command line args: " << e.error() << " for argument "
+            << e.argId() << std::endl;
+  return 0;
+}
+
+
+void
+printThem(const CommandLineOptions &opts)
+{
+  std::cout << opts << std::endl;
+}
+
+
+std::ostream &
+operator<<(std::ostream &os, const CommandLineOptions &opts)
+{
+  os << "\n" "Input index file path: "
+     << opts.inFilePath
+     << "\n" "Output index file path: "
+     << opts.outFilePath;
+
+  return os;
+}
+
+} // namespace indexconv
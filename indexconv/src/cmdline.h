@@ -0,0 +1,45 @@
+//
+// Created by jim on 3/14/19.
+//
+
+#ifndef indexconv_cmdline_h
+#define indexconv_cmdline_h
+
+#include <ostream>
+#include <string>
+
+namespace indexconv
+{
+
+struct CommandLineOptions
+{
+  // index file to read, json (v2) or binary (v3)
+  std::string inFilePath;
+  // index file to write, the other format from the input
+  std::string outFilePath;
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Parses command line args and populates \c opts.
+///
+/// If non-zero arg was returned, then the parse was successful, but it does
+/// not mean that valid or all of the required args were provided on the
+/// command line.
+///
+/// \returns 0 on parse failure, non-zero if the parse was successful.
+///////////////////////////////////////////////////////////////////////////////
+int
+parseThem(int argc, const char *argv[], CommandLineOptions &opts);
+
+
+void
+printThem(const CommandLineOptions &);
+
+
+std::ostream &
+operator<<(std::ostream &, const CommandLineOptions &);
+
+} // namespace indexconv
+
+#endif // ! indexconv_cmdline_h
@@ -0,0 +1,69 @@
+//
+// Created by jim on 3/14/19.
+//
+
+#include "cmdline.h"
+
+#include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/io/indexfile/v3/binaryindexfile.h>
+#include <bd/log/logger.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+double
+secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+
+int
+main(int argc, char const *argv[])
+{
+  indexconv::CommandLineOptions opts;
+  if (indexconv::parseThem(argc, argv, opts) == 0) {
+    std::cerr << "Please use -h for usage." << std::endl;
+    return 1;
+  }
+
+  bool const toJson{
+      bd::indexfile::v3::BinaryIndexFile::isBinaryIndexFile(opts.inFilePath) };
+  if (opts.outFilePath.empty()) {
+    opts.outFilePath = opts.inFilePath + ( toJson ? ".json" : ".idx" );
+  }
+  indexconv::printThem(opts);
+
+  bd::indexfile::v2::JsonIndexFile json;
+  auto start = std::chrono::steady_clock::now();
+  if (toJson) {
+    bd::indexfile::v3::BinaryIndexFile bin;
+    if (!bin.open(opts.inFilePath)) {
+      return 1;
+    }
+    bin.copyTo(json);
+  } else if (!json.open(opts.inFilePath)) {
+    return 1;
+  }
+  bd::Info() << "Read " << json.getFileBlocks().size() << " blocks from "
+             << opts.inFilePath << " in " << secondsSince(start) << " seconds";
+
+  start = std::chrono::steady_clock::now();
+  bool const ok{ toJson
+                 ? json.write(opts.outFilePath)
+                 : bd::indexfile::v3::BinaryIndexFile::write(opts.outFilePath, json) };
+  if (!ok) {
+    return 1;
+  }
+  bd::Info() << "Wrote " << opts.outFilePath << " in " << secondsSince(start)
+             << " seconds";
+
+  return 0;
+}
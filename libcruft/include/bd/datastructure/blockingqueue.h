@@ -1,4 +1,3 @@
-
 #ifndef bd_blockingqueue_h
 #define bd_blockingqueue_h
 
@@ -9,12 +8,21 @@
 namespace bd
 {
 
+/// \brief A FIFO queue for any number of producer and consumer threads.
+///
+/// If the queue has a capacity push() waits for room, so the queue can be
+/// used to bound the work in flight between two groups of threads. After
+/// close() is called pushes fail and pops return the items that are left,
+/// then fail.
 template<class T>
 class BlockingQueue
 {
 public:
 
-  BlockingQueue()
+  /// \param capacity Most items the queue holds, 0 for no limit.
+  explicit BlockingQueue(size_t capacity = 0)
+    : m_capacity{ capacity }
+    , m_closed{ false }
   {
   }
 
@@ -24,24 +32,40 @@ public:
   }
 
 
-  /// Pushes item and returns immediately
-  void
-  push(T &item)
+  /// Pushes item, waiting for room if the queue is full.
+  /// \return false if the queue was closed.
+  bool
+  push(T const &item)
   {
     std::unique_lock<std::mutex> lock(m_lock);
+    while (isFull() && !m_closed) {
+      m_notFull.wait(lock);
+    }
+    if (m_closed) {
+      return false;
+    }
     m_queue.push(item);
     lock.unlock();
     m_wait.notify_one();
+    return true;
   }
 
-  /// Pushes item and returns immediately.
-  void
+  /// Pushes item, waiting for room if the queue is full.
+  /// \return false if the queue was closed.
+  bool
   push(T &&item)
   {
     std::unique_lock<std::mutex> lock(m_lock);
+    while (isFull() && !m_closed) {
+      m_notFull.wait(lock);
+    }
+    if (m_closed) {
+      return false;
+    }
     m_queue.push(std::move(item));
     lock.unlock();
     m_wait.notify_one();
+    return true;
   }
 
   /// Blocks until there is something to return.
@@ -50,18 +74,89 @@ public:
   {
     std::unique_lock<std::mutex> lock(m_lock);
     while(m_queue.empty()) {
-      m_wait.wait(m_lock);
+      m_wait.wait(lock);
     }
-    auto item = m_queue.front();
+    return take(lock);
+  }
+
+
+  /// Blocks until there is something to return or the queue is closed.
+  /// \return false if the queue is closed and empty.
+  bool
+  pop(T &item)
+  {
+    std::unique_lock<std::mutex> lock(m_lock);
+    while (m_queue.empty() && !m_closed) {
+      m_wait.wait(lock);
+    }
+    if (m_queue.empty()) {
+      return false;
+    }
+    item = take(lock);
+    return true;
+  }
+
+
+  /// \return false if the queue was empty.
+  bool
+  tryPop(T &item)
+  {
+    std::unique_lock<std::mutex> lock(m_lock);
+    if (m_queue.empty()) {
+      return false;
+    }
+    item = take(lock);
+    return true;
+  }
+
+
+  /// \brief Wake all waiting threads and refuse any more items.
+  void
+  close()
+  {
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_closed = true;
+    lock.unlock();
+    m_wait.notify_all();
+    m_notFull.notify_all();
+  }
+
+
+  size_t
+  size() const
+  {
+    std::unique_lock<std::mutex> lock(m_lock);
+    return m_queue.size();
+  }
+
+
+private:
+
+  bool
+  isFull() const
+  {
+    return m_capacity > 0 && m_queue.size() >= m_capacity;
+  }
+
+
+  /// Pop the front item and wake a producer waiting for room.
+  T
+  take(std::unique_lock<std::mutex> &lock)
+  {
+    T item = std::move(m_queue.front());
     m_queue.pop();
+    lock.unlock();
+    m_notFull.notify_one();
     return item;
   }
 
 
-private:
   std::queue <T> m_queue;
-  std::mutex m_lock;
-  std::condition_variable_any m_wait;
+  mutable std::mutex m_lock;
+  std::condition_variable m_wait;
+  std::condition_variable m_notFull;
+  size_t m_capacity;
+  bool m_closed;
 
 
 };
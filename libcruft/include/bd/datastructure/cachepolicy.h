@@ -0,0 +1,588 @@
+#ifndef bd_cachepolicy_h
+#define bd_cachepolicy_h
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bd
+{
+
+enum class CachePolicyType
+{
+  Lru,    ///< Evict the least recently used key.
+  Clock,  ///< Second chance approximation of LRU.
+  Cost    ///< Evict the key with the smallest weight (e.g. relevance * reload cost).
+};
+
+
+/// \brief Parse "lru", "clock" or "cost".
+/// \return false if \c s is not a policy name.
+inline bool
+to_cachePolicyType(std::string const &s, CachePolicyType &t)
+{
+  if (s == "lru") {
+    t = CachePolicyType::Lru;
+  } else if (s == "clock") {
+    t = CachePolicyType::Clock;
+  } else if (s == "cost") {
+    t = CachePolicyType::Cost;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+
+inline std::string
+to_string(CachePolicyType t)
+{
+  switch (t) {
+    case CachePolicyType::Clock:
+      return "clock";
+    case CachePolicyType::Cost:
+      return "cost";
+    case CachePolicyType::Lru:
+    default:
+      return "lru";
+  }
+}
+
+
+/// \brief Decides which key of a cache is evicted next.
+///
+/// A policy only orders the keys, the cache that owns the policy decides
+/// when to evict and keeps track of its own capacity. Every operation is
+/// O(1) (amortized for CLOCK). Policies are not thread safe.
+///
+/// The weight of a key is only used by the cost policy, the other policies
+/// ignore it.
+template<class Key>
+class CachePolicy
+{
+public:
+  virtual ~CachePolicy()
+  {
+  }
+
+
+  /// \brief Start tracking \c key, or touch it if it is already tracked.
+  virtual void
+  insert(Key const &key, double weight) = 0;
+
+
+  /// \brief Record an access to \c key and update its weight.
+  /// \return false if \c key is not tracked.
+  virtual bool
+  touch(Key const &key, double weight) = 0;
+
+
+  /// \brief Change the weight of \c key without recording an access.
+  /// \return false if \c key is not tracked.
+  virtual bool
+  setWeight(Key const &key, double weight) = 0;
+
+
+  /// \brief Stop tracking \c key.
+  /// \return false if \c key is not tracked.
+  virtual bool
+  erase(Key const &key) = 0;
+
+
+  /// \brief Choose the next key to evict and stop tracking it.
+  /// \return false if no keys are tracked.
+  virtual bool
+  evict(Key &key) = 0;
+
+
+  virtual bool
+  contains(Key const &key) const = 0;
+
+
+  virtual size_t
+  size() const = 0;
+
+
+  virtual void
+  clear() = 0;
+
+};
+
+
+/// \brief Least recently used.
+template<class Key>
+class LruCachePolicy
+    : public CachePolicy<Key>
+{
+public:
+
+  void
+  insert(Key const &key, double weight) override
+  {
+    if (!touch(key, weight)) {
+      m_order.push_front(key);
+      m_where[key] = m_order.begin();
+    }
+  }
+
+
+  bool
+  touch(Key const &key, double) override
+  {
+    auto it = m_where.find(key);
+    if (it == m_where.end()) {
+      return false;
+    }
+    m_order.splice(m_order.begin(), m_order, it->second);
+    return true;
+  }
+
+
+  bool
+  setWeight(Key const &key, double) override
+  {
+    return contains(key);
+  }
+
+
+  bool
+  erase(Key const &key) override
+  {
+    auto it = m_where.find(key);
+    if (it == m_where.end()) {
+      return false;
+    }
+    m_order.erase(it->second);
+    m_where.erase(it);
+    return true;
+  }
+
+
+  bool
+  evict(Key &key) override
+  {
+    if (m_order.empty()) {
+      return false;
+    }
+    key = m_order.back();
+    m_order.pop_back();
+    m_where.erase(key);
+    return true;
+  }
+
+
+  bool
+  contains(Key const &key) const override
+  {
+    return m_where.find(key) != m_where.end();
+  }
+
+
+  size_t
+  size() const override
+  {
+    return m_where.size();
+  }
+
+
+  void
+  clear() override
+  {
+    m_order.clear();
+    m_where.clear();
+  }
+
+
+private:
+  std::list<Key> m_order;   ///< Most recently used at the front.
+  std::unordered_map<Key, typename std::list<Key>::iterator> m_where;
+
+};
+
+
+/// \brief CLOCK (second chance).
+///
+/// Keys sit in a ring of slots with a reference bit that is set on access.
+/// The hand sweeps the ring clearing reference bits and evicts the first key
+/// whose bit is already clear. Slots of erased keys are reused.
+template<class Key>
+class ClockCachePolicy
+    : public CachePolicy<Key>
+{
+public:
+  ClockCachePolicy()
+    : m_hand{ 0 }
+  {
+  }
+
+
+  void
+  insert(Key const &key, double weight) override
+  {
+    if (touch(key, weight)) {
+      return;
+    }
+
+    size_t slot;
+    if (!m_free.empty()) {
+      slot = m_free.back();
+      m_free.pop_back();
+    } else {
+      slot = m_slots.size();
+      m_slots.push_back(Slot{ });
+    }
+    // new keys start without their reference bit so that a key that is
+    // never used again goes on the first sweep.
+    m_slots[slot] = Slot{ key, false, true };
+    m_where[key] = slot;
+  }
+
+
+  bool
+  touch(Key const &key, double) override
+  {
+    auto it = m_where.find(key);
+    if (it == m_where.end()) {
+      return false;
+    }
+    m_slots[it->second].referenced = true;
+    return true;
+  }
+
+
+  bool
+  setWeight(Key const &key, double) override
+  {
+    return contains(key);
+  }
+
+
+  bool
+  erase(Key const &key) override
+  {
+    auto it = m_where.find(key);
+    if (it == m_where.end()) {
+      return false;
+    }
+    release(it->second);
+    m_where.erase(it);
+    return true;
+  }
+
+
+  bool
+  evict(Key &key) override
+  {
+    if (m_where.empty()) {
+      return false;
+    }
+
+    // at most two turns: the first may only clear reference bits.
+    while (true) {
+      if (m_hand >= m_slots.size()) {
+        m_hand = 0;
+      }
+      Slot &s = m_slots[m_hand];
+      size_t const slot{ m_hand++ };
+      if (!s.used) {
+        continue;
+      }
+      if (s.referenced) {
+        s.referenced = false;
+        continue;
+      }
+      key = s.key;
+      release(slot);
+      m_where.erase(key);
+      return true;
+    }
+  }
+
+
+  bool
+  contains(Key const &key) const override
+  {
+    return m_where.find(key) != m_where.end();
+  }
+
+
+  size_t
+  size() const override
+  {
+    return m_where.size();
+  }
+
+
+  void
+  clear() override
+  {
+    m_slots.clear();
+    m_free.clear();
+    m_where.clear();
+    m_hand = 0;
+  }
+
+
+private:
+
+  struct Slot
+  {
+    Key key;
+    bool referenced;
+    bool used;
+  };
+
+
+  void
+  release(size_t slot)
+  {
+    m_slots[slot].used = false;
+    m_slots[slot].referenced = false;
+    m_free.push_back(slot);
+  }
+
+
+  std::vector<Slot> m_slots;
+  std::vector<size_t> m_free;
+  std::unordered_map<Key, size_t> m_where;
+  size_t m_hand;
+
+};
+
+
+/// \brief Evict the key with the smallest weight, least recently used first.
+///
+/// Weights are bucketed on a log scale (four buckets per power of two), each
+/// bucket is an LRU list, and a bit mask of non-empty buckets finds the
+/// lowest bucket without a search. Keys with a weight of zero or less are
+/// always evicted first.
+template<class Key>
+class CostCachePolicy
+    : public CachePolicy<Key>
+{
+public:
+  CostCachePolicy()
+    : m_buckets(NumBuckets)
+    , m_nonEmpty{ }
+  {
+  }
+
+
+  void
+  insert(Key const &key, double weight) override
+  {
+    if (touch(key, weight)) {
+      return;
+    }
+    size_t const b{ bucketOf(weight) };
+    m_buckets[b].push_front(key);
+    m_where[key] = Where{ b, m_buckets[b].begin() };
+    mark(b);
+  }
+
+
+  bool
+  touch(Key const &key, double weight) override
+  {
+    auto it = m_where.find(key);
+    if (it == m_where.end()) {
+      return false;
+    }
+    move(it->second, bucketOf(weight));
+    return true;
+  }
+
+
+  bool
+  setWeight(Key const &key, double weight) override
+  {
+    auto it = m_where.find(key);
+    if (it == m_where.end()) {
+      return false;
+    }
+    // keep the key's place in the LRU order if the bucket doesn't change.
+    size_t const b{ bucketOf(weight) };
+    if (b != it->second.bucket) {
+      move(it->second, b);
+    }
+    return true;
+  }
+
+
+  bool
+  erase(Key const &key) override
+  {
+    auto it = m_where.find(key);
+    if (it == m_where.end()) {
+      return false;
+    }
+    unlink(it->second);
+    m_where.erase(it);
+    return true;
+  }
+
+
+  bool
+  evict(Key &key) override
+  {
+    for (size_t w = 0; w < NumWords; ++w) {
+      if (m_nonEmpty[w] == 0) {
+        continue;
+      }
+      size_t const b{ w * 64 + lowestBit(m_nonEmpty[w]) };
+      key = m_buckets[b].back();
+      m_buckets[b].pop_back();
+      if (m_buckets[b].empty()) {
+        unmark(b);
+      }
+      m_where.erase(key);
+      return true;
+    }
+    return false;
+  }
+
+
+  bool
+  contains(Key const &key) const override
+  {
+    return m_where.find(key) != m_where.end();
+  }
+
+
+  size_t
+  size() const override
+  {
+    return m_where.size();
+  }
+
+
+  void
+  clear() override
+  {
+    for (auto &b : m_buckets) {
+      b.clear();
+    }
+    for (auto &w : m_nonEmpty) {
+      w = 0;
+    }
+    m_where.clear();
+  }
+
+
+  /// \brief The bucket that a key of \c weight goes into.
+  static size_t
+  bucketOf(double weight)
+  {
+    if (!( weight > 0.0 )) {
+      return 0;
+    }
+    // weight = m * 2^e, m in [0.5, 1)
+    int e;
+    double const m{ std::frexp(weight, &e) };
+    long long b{ ( e + 64LL ) * 4 + static_cast<long long>(( m - 0.5 ) * 8.0) };
+    // 0 is reserved for weights <= 0.
+    b = b < 1 ? 1 : b;
+    return static_cast<size_t>(b) >= NumBuckets ? NumBuckets - 1 : static_cast<size_t>(b);
+  }
+
+
+private:
+
+  static size_t const NumWords = 8;
+  static size_t const NumBuckets = NumWords * 64;
+
+  struct Where
+  {
+    size_t bucket;
+    typename std::list<Key>::iterator it;
+  };
+
+
+  /// Move the key at \c w to the front of bucket \c b.
+  void
+  move(Where &w, size_t b)
+  {
+    std::list<Key> &from = m_buckets[w.bucket];
+    m_buckets[b].splice(m_buckets[b].begin(), from, w.it);
+    if (from.empty()) {
+      unmark(w.bucket);
+    }
+    w.bucket = b;
+    mark(b);
+  }
+
+
+  void
+  unlink(Where &w)
+  {
+    m_buckets[w.bucket].erase(w.it);
+    if (m_buckets[w.bucket].empty()) {
+      unmark(w.bucket);
+    }
+  }
+
+
+  void
+  mark(size_t b)
+  {
+    m_nonEmpty[b / 64] |= uint64_t(1) << ( b % 64 );
+  }
+
+
+  void
+  unmark(size_t b)
+  {
+    m_nonEmpty[b / 64] &= ~( uint64_t(1) << ( b % 64 ));
+  }
+
+
+  static size_t
+  lowestBit(uint64_t v)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_ctzll(v));
+#else
+    size_t n{ 0 };
+    while (( v & 1 ) == 0) {
+      v >>= 1;
+      ++n;
+    }
+    return n;
+#endif
+  }
+
+
+  std::vector<std::list<Key>> m_buckets;  ///< Most recently used at the front.
+  uint64_t m_nonEmpty[NumWords];
+  std::unordered_map<Key, Where> m_where;
+
+};
+
+
+template<class Key>
+class CachePolicyFactory
+{
+public:
+  static
+  CachePolicy<Key> *
+  New(CachePolicyType t)
+  {
+    switch (t) {
+      case CachePolicyType::Clock:
+        return new ClockCachePolicy<Key>();
+      case CachePolicyType::Cost:
+        return new CostCachePolicy<Key>();
+      case CachePolicyType::Lru:
+      default:
+        return new LruCachePolicy<Key>();
+    }
+  }
+};
+
+} // namespace bd
+
+#endif // ! bd_cachepolicy_h
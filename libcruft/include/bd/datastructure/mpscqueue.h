@@ -0,0 +1,317 @@
+#ifndef bd_mpscqueue_h
+#define bd_mpscqueue_h
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace bd
+{
+
+/// \brief Bounded lock-free multi-producer/single-consumer ring.
+///
+/// Any number of threads may push, exactly one thread may pop. Each slot
+/// carries a sequence number that tells a producer whether the slot is free
+/// for its ticket and the consumer whether the slot has been written, so a
+/// push is one compare-and-swap on the tail plus a store, and a pop is a
+/// couple of stores.
+///
+/// Like SpscQueue, the blocking push() and pop() spin for a short while and
+/// then park on a condition variable, and the other side only takes the
+/// park mutex if somebody is parked.
+template<class T>
+class MpscQueue
+{
+public:
+
+  /// \brief Create a ring that holds at least \c capacity items.
+  /// The capacity is rounded up to a power of two, and is at least two (with
+  /// one slot a written slot's sequence would look free to the next ticket).
+  explicit MpscQueue(size_t capacity)
+    : m_head{ 0 }
+    , m_tail{ 0 }
+    , m_slots{ }
+    , m_mask{ 0 }
+    , m_producersParked{ 0 }
+    , m_consumerParked{ false }
+    , m_pushStalls{ 0 }
+    , m_popStalls{ 0 }
+  {
+    size_t cap{ 2 };
+    while (cap < capacity) {
+      cap <<= 1;
+    }
+    m_slots.reset(new Slot[cap]);
+    m_mask = cap - 1;
+    for (size_t i = 0; i < cap; ++i) {
+      m_slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+
+  MpscQueue(MpscQueue const &) = delete;
+  MpscQueue &operator=(MpscQueue const &) = delete;
+
+
+  /// \brief Push item if there is room (any thread).
+  /// \return false if the ring was full.
+  bool
+  tryPush(T const &item)
+  {
+    if (!pushNoWake(item)) {
+      return false;
+    }
+    wakeConsumer();
+    return true;
+  }
+
+
+  /// \brief Pop into item if the ring is not empty (consumer only).
+  /// \return false if the ring was empty.
+  bool
+  tryPop(T &item)
+  {
+    if (!popNoWake(item)) {
+      return false;
+    }
+    wakeProducers();
+    return true;
+  }
+
+
+  /// \brief Push item, waiting for room if the ring is full.
+  /// \return false if \c stop was set before there was room.
+  bool
+  push(T const &item, std::atomic_bool const &stop)
+  {
+    if (tryPush(item)) {
+      return true;
+    }
+    ++m_pushStalls;
+
+    for (int i = 0; i < SPIN_COUNT; ++i) {
+      if (pushNoWake(item)) {
+        wakeConsumer();
+        return true;
+      }
+      if (stop) {
+        return false;
+      }
+      std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(m_parkMutex);
+    ++m_producersParked;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!pushNoWake(item)) {
+      if (stop) {
+        --m_producersParked;
+        return false;
+      }
+      m_parkCond.wait(lock);
+    }
+    --m_producersParked;
+    lock.unlock();
+    wakeConsumer();
+    return true;
+  }
+
+
+  /// \brief Pop into item, waiting for an item if the ring is empty.
+  /// Items that are already in the ring are still returned after \c stop is
+  /// set, so the consumer can drain the ring.
+  /// \return false if the ring is empty and \c stop was set.
+  bool
+  pop(T &item, std::atomic_bool const &stop)
+  {
+    if (tryPop(item)) {
+      return true;
+    }
+    ++m_popStalls;
+
+    for (int i = 0; i < SPIN_COUNT; ++i) {
+      if (popNoWake(item)) {
+        wakeProducers();
+        return true;
+      }
+      if (stop) {
+        return tryPop(item);
+      }
+      if (i > SPIN_COUNT / 2) {
+        std::this_thread::yield();
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(m_parkMutex);
+    while (true) {
+      m_consumerParked.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (popNoWake(item)) {
+        break;
+      }
+      if (stop) {
+        m_consumerParked = false;
+        return false;
+      }
+      m_parkCond.wait(lock);
+    }
+    m_consumerParked = false;
+    lock.unlock();
+    wakeProducers();
+    return true;
+  }
+
+
+  /// \brief Wake any parked thread so it can notice a stop request.
+  void
+  wake()
+  {
+    unpark();
+  }
+
+
+  /// \brief Number of items in the ring (a snapshot, it may be stale).
+  size_t
+  size() const
+  {
+    size_t const tail{ m_tail.load(std::memory_order_acquire) };
+    size_t const head{ m_head.load(std::memory_order_acquire) };
+    return tail > head ? tail - head : 0;
+  }
+
+
+  size_t
+  capacity() const
+  {
+    return m_mask + 1;
+  }
+
+
+  /// \brief Number of times push() found the ring full.
+  uint64_t
+  pushStalls() const
+  {
+    return m_pushStalls;
+  }
+
+
+  /// \brief Number of times pop() found the ring empty.
+  uint64_t
+  popStalls() const
+  {
+    return m_popStalls;
+  }
+
+
+private:
+
+  /// \brief Number of times to retry before parking.
+  static int const SPIN_COUNT = 256;
+
+
+  struct Slot
+  {
+    /// == ticket: free for the producer holding that ticket.
+    /// == ticket + 1: written, ready for the consumer.
+    std::atomic<size_t> seq;
+    T item;
+  };
+
+
+  bool
+  pushNoWake(T const &item)
+  {
+    size_t pos{ m_tail.load(std::memory_order_relaxed) };
+    Slot *slot;
+    while (true) {
+      slot = &m_slots[pos & m_mask];
+      size_t const seq{ slot->seq.load(std::memory_order_acquire) };
+      intptr_t const dif{ static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) };
+      if (dif == 0) {
+        if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (dif < 0) {
+        return false;  // the consumer has not freed the slot yet: full.
+      } else {
+        pos = m_tail.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->item = item;
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+
+  bool
+  popNoWake(T &item)
+  {
+    size_t const pos{ m_head.load(std::memory_order_relaxed) };
+    Slot &slot = m_slots[pos & m_mask];
+    if (slot.seq.load(std::memory_order_acquire) != pos + 1) {
+      return false;
+    }
+
+    item = slot.item;
+    slot.seq.store(pos + m_mask + 1, std::memory_order_release);
+    m_head.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+
+  void
+  wakeConsumer()
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_consumerParked.load(std::memory_order_relaxed)) {
+      unpark();
+    }
+  }
+
+
+  void
+  wakeProducers()
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_producersParked.load(std::memory_order_relaxed) > 0) {
+      unpark();
+    }
+  }
+
+
+  void
+  unpark()
+  {
+    std::lock_guard<std::mutex> lock(m_parkMutex);
+    m_parkCond.notify_all();
+  }
+
+
+  // head and tail are written by different threads, keep them on
+  // separate cache lines.
+  std::atomic<size_t> m_head;   ///< Next slot to pop (written by consumer).
+  char m_pad0[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> m_tail;   ///< Next ticket (taken by producers).
+  char m_pad1[64 - sizeof(std::atomic<size_t>)];
+
+  std::unique_ptr<Slot[]> m_slots;
+  size_t m_mask;
+
+  std::atomic<int> m_producersParked;
+  std::atomic_bool m_consumerParked;
+  std::mutex m_parkMutex;
+  std::condition_variable m_parkCond;
+
+  std::atomic<uint64_t> m_pushStalls;
+  std::atomic<uint64_t> m_popStalls;
+
+}; // class MpscQueue
+
+} // namespace bd
+
+#endif // ! bd_mpscqueue_h
@@ -0,0 +1,279 @@
+#ifndef bd_spscqueue_h
+#define bd_spscqueue_h
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief Bounded lock-free single-producer/single-consumer ring.
+///
+/// Exactly one thread may push and exactly one thread may pop. The blocking
+/// push() and pop() spin for a short while and then park the calling thread
+/// on a condition variable. The other side only takes the park mutex when it
+/// sees that somebody is actually parked, so the uncontended hand off is just
+/// a pair of atomic loads/stores.
+///
+/// The number of times push() found the ring full and pop() found it empty
+/// is recorded in pushStalls() and popStalls().
+template<class T>
+class SpscQueue
+{
+public:
+
+  /// \brief Create a ring that holds at least \c capacity items.
+  /// The capacity is rounded up to a power of two.
+  explicit SpscQueue(size_t capacity)
+    : m_head{ 0 }
+    , m_tail{ 0 }
+    , m_producerParked{ false }
+    , m_consumerParked{ false }
+    , m_pushStalls{ 0 }
+    , m_popStalls{ 0 }
+  {
+    size_t cap{ 1 };
+    while (cap < capacity) {
+      cap <<= 1;
+    }
+    m_slots.resize(cap);
+    m_mask = cap - 1;
+  }
+
+
+  ~SpscQueue()
+  {
+  }
+
+
+  SpscQueue(SpscQueue const &) = delete;
+  SpscQueue &operator=(SpscQueue const &) = delete;
+
+
+  /// \brief Push item if there is room.
+  /// \return false if the ring was full.
+  bool
+  tryPush(T const &item)
+  {
+    if (!pushNoWake(item)) {
+      return false;
+    }
+    wakeParked(m_consumerParked);
+    return true;
+  }
+
+
+  /// \brief Pop into item if the ring is not empty.
+  /// \return false if the ring was empty.
+  bool
+  tryPop(T &item)
+  {
+    if (!popNoWake(item)) {
+      return false;
+    }
+    wakeParked(m_producerParked);
+    return true;
+  }
+
+
+  /// \brief Push item, waiting for room if the ring is full.
+  /// \return false if \c stop was set before there was room.
+  bool
+  push(T const &item, std::atomic_bool const &stop)
+  {
+    if (tryPush(item)) {
+      return true;
+    }
+    ++m_pushStalls;
+    if (!waitFor([&]() { return pushNoWake(item); }, m_producerParked, stop)) {
+      return false;
+    }
+    wakeParked(m_consumerParked);
+    return true;
+  }
+
+
+  /// \brief Pop into item, waiting for an item if the ring is empty.
+  /// Items that are already in the ring are still returned after \c stop is
+  /// set, so the consumer can drain the ring.
+  /// \return false if the ring is empty and \c stop was set.
+  bool
+  pop(T &item, std::atomic_bool const &stop)
+  {
+    if (tryPop(item)) {
+      return true;
+    }
+    ++m_popStalls;
+    if (!waitFor([&]() { return popNoWake(item); }, m_consumerParked, stop)) {
+      return false;
+    }
+    wakeParked(m_producerParked);
+    return true;
+  }
+
+
+  /// \brief Wake any parked thread so it can notice a stop request.
+  void
+  wake()
+  {
+    unpark();
+  }
+
+
+  /// \brief Number of items in the ring (a snapshot, it may be stale).
+  size_t
+  size() const
+  {
+    return m_tail.load(std::memory_order_acquire) -
+           m_head.load(std::memory_order_acquire);
+  }
+
+
+  size_t
+  capacity() const
+  {
+    return m_slots.size();
+  }
+
+
+  /// \brief Number of times push() found the ring full.
+  uint64_t
+  pushStalls() const
+  {
+    return m_pushStalls;
+  }
+
+
+  /// \brief Number of times pop() found the ring empty.
+  uint64_t
+  popStalls() const
+  {
+    return m_popStalls;
+  }
+
+
+  /// \brief Empty the ring.
+  /// \note Not thread safe, neither side may be using the ring.
+  void
+  clear()
+  {
+    m_head = 0;
+    m_tail = 0;
+  }
+
+
+private:
+
+  /// \brief Number of times to retry before parking.
+  static int const SPIN_COUNT = 256;
+
+
+  bool
+  pushNoWake(T const &item)
+  {
+    size_t const tail{ m_tail.load(std::memory_order_relaxed) };
+    if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+      return false;
+    }
+
+    m_slots[tail & m_mask] = item;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+
+  bool
+  popNoWake(T &item)
+  {
+    size_t const head{ m_head.load(std::memory_order_relaxed) };
+    if (head == m_tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    item = m_slots[head & m_mask];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+
+  /// \brief Unpark the other side if it is (or is about to be) parked.
+  void
+  wakeParked(std::atomic_bool const &parked)
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed)) {
+      unpark();
+    }
+  }
+
+
+  template<class TryOp>
+  bool
+  waitFor(TryOp op, std::atomic_bool &parked, std::atomic_bool const &stop)
+  {
+    for (int i = 0; i < SPIN_COUNT; ++i) {
+      if (op()) {
+        return true;
+      }
+      if (stop) {
+        return op();
+      }
+      if (i > SPIN_COUNT / 2) {
+        std::this_thread::yield();
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(m_parkMutex);
+    while (true) {
+      parked.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (op()) {
+        break;
+      }
+      if (stop) {
+        parked = false;
+        return false;
+      }
+      m_parkCond.wait(lock);
+    }
+    parked = false;
+    return true;
+  }
+
+
+  void
+  unpark()
+  {
+    std::lock_guard<std::mutex> lock(m_parkMutex);
+    m_parkCond.notify_all();
+  }
+
+
+  // head and tail are written by different threads, keep them on
+  // separate cache lines.
+  std::atomic<size_t> m_head;   ///< Next slot to pop (written by consumer).
+  char m_pad0[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> m_tail;   ///< Next slot to push (written by producer).
+  char m_pad1[64 - sizeof(std::atomic<size_t>)];
+
+  std::vector<T> m_slots;
+  size_t m_mask;
+
+  std::atomic_bool m_producerParked;
+  std::atomic_bool m_consumerParked;
+  std::mutex m_parkMutex;
+  std::condition_variable m_parkCond;
+
+  std::atomic<uint64_t> m_pushStalls;
+  std::atomic<uint64_t> m_popStalls;
+
+}; // class SpscQueue
+
+} // namespace bd
+
+#endif // ! bd_spscqueue_h
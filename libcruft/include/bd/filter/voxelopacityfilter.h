@@ -5,6 +5,7 @@
 #ifndef bd_voxelopacityfilter_h
 #define bd_voxelopacityfilter_h
 
+#include <bd/volume/opacitylut.h>
 #include <bd/volume/transferfunction.h>
 
 #include <limits>
@@ -30,6 +31,7 @@ public:
       , m_max{ knotMax }
       , m_dataMin{ dataMin }
       , m_diff{ static_cast<Ty>(dataMax-dataMin) }
+      , m_lut{ function, static_cast<double>(dataMin), static_cast<double>(dataMax) }
   {
 
   }
@@ -40,12 +42,20 @@ public:
   }
 
 
+  /// \brief True if the opacity of \c val is in [knotMin, knotMax).
+  /// \note The opacity is looked up in an OpacityLut of the function.
   bool operator()(Ty const& val) const
   {
-    double val_norm{ ( val-m_dataMin )/static_cast<double>(m_diff) };
-    double a{ alpha(val_norm) };
+    float a{ m_lut(val) };
     return a>=m_min && a<m_max;
+  }
+
 
+  /// \brief Classify \c n voxels, out[i] is 1 if v[i] passes the filter.
+  /// \return The number of voxels that passed.
+  uint64_t classify(Ty const *v, size_t n, uint8_t *out) const
+  {
+    return m_lut.classify(v, n, m_min, m_max, out);
   }
 
 
@@ -80,6 +90,7 @@ private:
   double const m_max;
   Ty const m_dataMin;
   Ty const m_diff;
+  OpacityLut<Ty> const m_lut;
 
 
 }; // class VoxelOpacityFilter
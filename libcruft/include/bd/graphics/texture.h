@@ -40,6 +40,7 @@ public:
     R8UI,
     R16,
     R32F,
+    R16F,
     RG,
     RGB,
     RGBA
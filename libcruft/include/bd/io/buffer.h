@@ -31,6 +31,11 @@ public:
   /// \brief Get a pointer-to-const to the start of this buffer's memory.
   ElementType const * getPtr() const { return m_data; }
 
+  /// \brief Point this buffer at different memory.
+  /// Used for buffers that are views into memory owned by something else
+  /// (for example, a memory mapped file).
+  void setPtr(ElementType *data) { m_data = data; }
+
   /// \brief Get the size in elements of this buffer.
   /// \note The byte size of this buffer's memory can be larger than
   ///       the number of bytes consumed by the elements in the buffer.
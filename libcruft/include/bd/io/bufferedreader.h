@@ -2,13 +2,18 @@
 #define bd_buffered_reader
 
 #include "bufferpool.h"
+#include "spscbufferpool.h"
 #include "buffer.h"
+#include "mappedfile.h"
+#include "mappedreaderworker.h"
 #include "readerworker.h"
 
+#include <algorithm>
 #include <fstream>
 #include <thread>
 #include <mutex>
 #include <future>
+#include <vector>
 
 namespace bd
 {
@@ -18,12 +23,27 @@ namespace bd
 ///        pushed back to a buffer pool.
 /// Template parameter \c Ty is the data type contained in the raw file, and is thus
 /// the element type contained in each Buffer.
-template<class Ty>
+///
+/// If \c memoryMapped is true the file is mmap'd and the Buffers handed out by
+/// waitNextFullUntilNone() are views directly into the mapping (no copying).
+/// In that case \c bufSize is the total size of the windows in flight, and
+/// the buffers must be treated as read only.
+///
+/// Template parameter \c Pool selects how buffers are handed between the
+/// reader thread and the consumer. The default BufferPool is safe for any
+/// number of consumer threads; SpscBufferPool<Ty> is lock free but there
+/// must be exactly one consumer thread.
+///
+/// setNumReaders() starts several reader threads. The file is cut into
+/// buffer sized chunks and reader \c i reads chunks \c i, \c i+N, \c i+2N...
+/// into its own pool, so buffers are still handed out in file order (by
+/// Buffer::getIndexOffset()).
+template<class Ty, class Pool = BufferPool<Ty>>
 class BufferedReader
 {
 
 public:
-  BufferedReader(size_t bufSize);
+  BufferedReader(size_t bufSize, bool memoryMapped = false);
 
 
   ~BufferedReader();
@@ -45,8 +65,8 @@ public:
   stop();
 
 
-  /// \brief Stop reading and wait for the read thread to exit.
-  /// \return The number of bytes read so far by the thread.
+  /// \brief Stop reading and wait for the read threads to exit.
+  /// \return The number of bytes read so far by the threads.
   long long int
   reset();
 
@@ -57,6 +77,7 @@ public:
 
 
   /// \brief Grab the next buffer data from the pool as soon as it is ready.
+  /// Buffers are returned in file order.
   /// \note Blocks until a full buffer is ready.
   Buffer<Ty> *
   waitNextFullUntilNone();
@@ -73,94 +94,213 @@ public:
   size_t
   totalBufferBytes() const;
 
+
+  /// \brief True if buffers are views into a memory mapping of the file.
+  bool
+  isMemoryMapped() const;
+
+
+  /// \brief Set the number of buffer sized windows the kernel is asked to
+  ///        read ahead of the consumers when memory mapped (default 4).
+  void
+  setReadAheadBuffers(int n);
+
+
+  /// \brief Set the number of buffers \c bufSize is split into (default 4).
+  /// \note Must be called before open().
+  void
+  setNumBuffers(int n);
+
+
+  /// \brief Set the number of threads reading the file (default 1).
+  /// Each reader gets \c numBuffers/n buffers, but never less than two, so
+  /// the memory used may be more than \c bufSize.
+  /// Ignored when memory mapped.
+  /// \note Must be called before open().
+  void
+  setNumReaders(int n);
+
+
+  /// \brief Number of times the reader threads waited for an empty buffer.
+  uint64_t
+  producerStalls() const;
+
+
+  /// \brief Number of times a consumer waited for a full buffer.
+  uint64_t
+  consumerStalls() const;
+
 private:
+
+  /// \brief The pool that the buffer starting at element \c offset came from.
+  Pool *
+  poolFor(size_t offset) const;
+
+
   std::string m_path;
 
   size_t m_bufSizeBytes;
   int m_numBuffers;
+  bool m_memoryMapped;
+  int m_readAheadBuffers;
+  int m_numReaders;
 
-  BufferPool<Ty> *m_pool;
-  std::future<long long int> m_future;
+  MappedFile m_mappedFile;
+  std::vector<Pool *> m_pools;                    ///< One pool per reader.
+  std::vector<std::future<long long int>> m_futures;
   std::atomic_bool m_stopReaderThread;
 
+  std::mutex m_nextLock;
+  size_t m_nextPool;     ///< Pool holding the next buffer in file order.
+  bool m_readersDone;
+
 };
 
 
 ///////////////////////////////////////////////////////////////////////////////
-template<class Ty>
-BufferedReader<Ty>::BufferedReader(size_t bufSize)
+template<class Ty, class Pool>
+BufferedReader<Ty, Pool>::BufferedReader(size_t bufSize, bool memoryMapped)
     : m_path{ }
     , m_bufSizeBytes{ bufSize }
     , m_numBuffers{ 4 }
-    , m_pool{ nullptr }
-    , m_future{ }
+    , m_memoryMapped{ memoryMapped }
+    , m_readAheadBuffers{ 4 }
+    , m_numReaders{ 1 }
+    , m_mappedFile{ }
+    , m_pools{ }
+    , m_futures{ }
+    , m_stopReaderThread{ false }
+    , m_nextPool{ 0 }
+    , m_readersDone{ false }
 {
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
-template<class Ty>
-BufferedReader<Ty>::~BufferedReader()
+template<class Ty, class Pool>
+BufferedReader<Ty, Pool>::~BufferedReader()
 {
-  if (m_pool) {
-    delete m_pool;
+  if (! m_futures.empty()) {
+    reset();
+  }
+  for (Pool *pool : m_pools) {
+    delete pool;
   }
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
-template<class Ty>
+template<class Ty, class Pool>
 bool
-BufferedReader<Ty>::open(std::string const &path)
+BufferedReader<Ty, Pool>::open(std::string const &path)
 {
   m_path = path;
+
+  if (m_memoryMapped) {
+    if (! m_mappedFile.open(m_path)) {
+      Err() << "Unable to map file: " + m_path;
+      return false;
+    }
+    m_pools.push_back(new Pool(m_bufSizeBytes, m_numBuffers));
+    m_pools[0]->allocateViews();
+    return true;
+  }
+
   std::ifstream test(m_path);
   if (! test.is_open()) {
     Err() << "Unable to open file: " + m_path;
     return false;
   }
   test.close();
-  m_pool = new BufferPool<Ty>(m_bufSizeBytes, 4);
-  m_pool->allocate();
+
+  if (m_numReaders == 1) {
+    m_pools.push_back(new Pool(m_bufSizeBytes, m_numBuffers));
+  } else {
+    // keep the single buffer size the same, so that a buffer's index offset
+    // tells which reader (and pool) it belongs to.
+    int const bufs{ std::max(2, m_numBuffers / m_numReaders) };
+    size_t const bytes{ ( m_bufSizeBytes / m_numBuffers ) * bufs };
+    for (int i = 0; i < m_numReaders; ++i) {
+      m_pools.push_back(new Pool(bytes, bufs));
+    }
+  }
+
+  for (Pool *pool : m_pools) {
+    pool->allocate();
+  }
   return true;
 
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
-template<class Ty>
+template<class Ty, class Pool>
 void
-BufferedReader<Ty>::start()
+BufferedReader<Ty, Pool>::start()
 {
   m_stopReaderThread = false;
-  m_future =
-      std::async(std::launch::async,
-                 [&]() -> long long int {
-                   ReaderWorker<Ty> worker(*m_pool);
-                   worker.setPath(m_path);
-                   return worker(std::ref(m_stopReaderThread));
-                 });
+  m_nextPool = 0;
+  m_readersDone = false;
+
+  if (m_memoryMapped) {
+    m_futures.push_back(
+        std::async(std::launch::async,
+                   [&]() -> long long int {
+                     MappedReaderWorker<Ty, Pool> worker(*m_pools[0], m_mappedFile,
+                                                   m_readAheadBuffers);
+                     return worker(std::ref(m_stopReaderThread));
+                   }));
+    return;
+  }
+
+  int const stripes{ static_cast<int>(m_pools.size()) };
+  for (int i = 0; i < stripes; ++i) {
+    m_futures.push_back(
+        std::async(std::launch::async,
+                   [this, i, stripes]() -> long long int {
+                     ReaderWorker<Ty, Pool> worker(*m_pools[i]);
+                     worker.setPath(m_path);
+                     worker.setStripe(i, stripes);
+                     return worker(std::ref(m_stopReaderThread));
+                   }));
+  }
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
-template<class Ty>
+template<class Ty, class Pool>
 void
-BufferedReader<Ty>::stop()
+BufferedReader<Ty, Pool>::stop()
 {
   m_stopReaderThread = true;
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
-template<class Ty>
+template<class Ty, class Pool>
 long long int
-BufferedReader<Ty>::reset()
+BufferedReader<Ty, Pool>::reset()
 {
   m_stopReaderThread = true;
-  m_future.wait();
-  m_pool->reset();
-  return m_future.get();
+
+  // wake readers that are waiting for an empty buffer.
+  for (Pool *pool : m_pools) {
+    pool->requestStop();
+  }
+
+  long long int total{ 0 };
+  for (auto &f : m_futures) {
+    long long int bytes{ f.get() };
+    if (bytes > 0) {
+      total += bytes;
+    }
+  }
+  m_futures.clear();
+
+  for (Pool *pool : m_pools) {
+    pool->reset();
+  }
+  return total;
 }
 
 
@@ -174,38 +314,133 @@ BufferedReader<Ty>::reset()
 //}
 
 
-template<class Ty>
+template<class Ty, class Pool>
 Buffer<Ty> *
-BufferedReader<Ty>::waitNextFullUntilNone()
+BufferedReader<Ty, Pool>::waitNextFullUntilNone()
 {
-  return m_pool->nextFullUntilNone();
+  if (m_pools.size() == 1) {
+    return m_pools[0]->nextFullUntilNone();
+  }
+
+  // Chunks are dealt to the readers round robin, so the next chunk in file
+  // order is always at the front of the next pool. Once one reader runs out
+  // the file has ended (or we were stopped).
+  std::lock_guard<std::mutex> lck(m_nextLock);
+  if (m_readersDone) {
+    return nullptr;
+  }
+
+  Buffer<Ty> *buf{ m_pools[m_nextPool]->nextFullUntilNone() };
+  if (buf == nullptr) {
+    m_readersDone = true;
+    return nullptr;
+  }
+
+  m_nextPool = ( m_nextPool + 1 ) % m_pools.size();
+  return buf;
 }
 
 
-template<class Ty>
+template<class Ty, class Pool>
 void
-BufferedReader<Ty>::waitReturnEmpty(Buffer<Ty> *buf)
+BufferedReader<Ty, Pool>::waitReturnEmpty(Buffer<Ty> *buf)
 {
-  return m_pool->returnEmpty(buf);
+  return poolFor(buf->getIndexOffset())->returnEmpty(buf);
 }
 
 
-template<class Ty>
+template<class Ty, class Pool>
 size_t
-BufferedReader<Ty>::singleBufferElements() const
+BufferedReader<Ty, Pool>::singleBufferElements() const
 {
-  return m_pool->bufferSizeElements();
+  return m_pools[0]->bufferSizeElements();
 }
 
 
-template<class Ty>
+template<class Ty, class Pool>
 size_t
-BufferedReader<Ty>::totalBufferBytes() const 
+BufferedReader<Ty, Pool>::totalBufferBytes() const 
 {
   return m_bufSizeBytes;
 }
 
 
+template<class Ty, class Pool>
+bool
+BufferedReader<Ty, Pool>::isMemoryMapped() const
+{
+  return m_memoryMapped;
+}
+
+
+template<class Ty, class Pool>
+void
+BufferedReader<Ty, Pool>::setReadAheadBuffers(int n)
+{
+  m_readAheadBuffers = n < 1 ? 1 : n;
+}
+
+
+template<class Ty, class Pool>
+void
+BufferedReader<Ty, Pool>::setNumBuffers(int n)
+{
+  if (! m_pools.empty()) {
+    Err() << "Number of buffers must be set before the file is opened.";
+    return;
+  }
+  m_numBuffers = n < 1 ? 1 : n;
+}
+
+
+template<class Ty, class Pool>
+void
+BufferedReader<Ty, Pool>::setNumReaders(int n)
+{
+  if (! m_pools.empty()) {
+    Err() << "Number of readers must be set before the file is opened.";
+    return;
+  }
+  m_numReaders = n < 1 ? 1 : n;
+}
+
+
+template<class Ty, class Pool>
+uint64_t
+BufferedReader<Ty, Pool>::producerStalls() const
+{
+  uint64_t stalls{ 0 };
+  for (Pool *pool : m_pools) {
+    stalls += pool->producerStalls();
+  }
+  return stalls;
+}
+
+
+template<class Ty, class Pool>
+uint64_t
+BufferedReader<Ty, Pool>::consumerStalls() const
+{
+  uint64_t stalls{ 0 };
+  for (Pool *pool : m_pools) {
+    stalls += pool->consumerStalls();
+  }
+  return stalls;
+}
+
+
+template<class Ty, class Pool>
+Pool *
+BufferedReader<Ty, Pool>::poolFor(size_t offset) const
+{
+  if (m_pools.size() == 1) {
+    return m_pools[0];
+  }
+  size_t const chunk{ offset / m_pools[0]->bufferSizeElements() };
+  return m_pools[chunk % m_pools.size()];
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 //template<class Ty>
 //bool
@@ -14,6 +14,7 @@
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 
 namespace bd
 {
@@ -35,6 +36,14 @@ public:
   allocate();
 
 
+  /// \brief Create the buffers for this BufferPool without allocating any
+  ///        memory for them.
+  /// The producer is responsible for pointing each buffer at valid memory
+  /// (see Buffer::setPtr()) before returning it as full.
+  void
+  allocateViews();
+
+
   /// \brief Wait for a full buffer to be placed in the queue and return it.
   /// If a stop was requested this method will keep returning full buffers
   /// until there are no more.
@@ -79,6 +88,16 @@ public:
   reset();
 
 
+  /// \brief Number of times a producer had to wait for an empty buffer.
+  uint64_t
+  producerStalls() const;
+
+
+  /// \brief Number of times a consumer had to wait for a full buffer.
+  uint64_t
+  consumerStalls() const;
+
+
 private:
 
   Ty *m_mem;
@@ -91,6 +110,9 @@ private:
 
   std::atomic_bool m_stopRequested;
 
+  std::atomic<uint64_t> m_producerStalls;
+  std::atomic<uint64_t> m_consumerStalls;
+
   std::mutex m_emptyBuffersLock;
   std::mutex m_fullBuffersLock;
   std::condition_variable_any m_emptyBuffersAvailable;
@@ -107,6 +129,8 @@ BufferPool<Ty>::BufferPool(size_t bufSize, int nbuf)
     , m_nBufs{ nbuf }
     , m_szBytesTotal{ bufSize }
     , m_stopRequested{ false }
+    , m_producerStalls{ 0 }
+    , m_consumerStalls{ 0 }
 {
 }
 
@@ -149,12 +173,33 @@ BufferPool<Ty>::allocate()
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferPool<Ty>::allocateViews()
+{
+  size_t buffer_size_elems{ bufferSizeElements() };
+
+  for (int i = 0; i < m_nBufs; ++i) {
+    Buffer<Ty> *buf{ new Buffer<Ty>{ nullptr, buffer_size_elems }};
+    m_allBuffers.push_back(buf);
+    m_emptyBuffers.push(buf);
+  }
+
+  Info() << "Generated " << m_allBuffers.size() << " view buffers of size " <<
+         buffer_size_elems;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 template<class Ty>
 Buffer<Ty> *
 BufferPool<Ty>::nextFullUntilNone()
 {
   std::lock_guard<std::mutex> lck(m_fullBuffersLock);
+  if (m_fullBuffers.size() == 0 && !m_stopRequested) {
+    ++m_consumerStalls;
+  }
   while (m_fullBuffers.size() == 0 && !m_stopRequested) {
     m_fullBuffersAvailable.wait(m_fullBuffersLock);
   }
@@ -189,6 +234,9 @@ Buffer<Ty> *
 BufferPool<Ty>::nextEmpty()
 {
   std::lock_guard<std::mutex> lck(m_emptyBuffersLock);
+  if (m_emptyBuffers.size() == 0 && !m_stopRequested) {
+    ++m_producerStalls;
+  }
   while (m_emptyBuffers.size() == 0 && !m_stopRequested) {
     // all the buffers are in the full queue.
     m_emptyBuffersAvailable.wait(m_emptyBuffersLock);
@@ -259,7 +307,11 @@ template<class Ty>
 void
 BufferPool<Ty>::reset()
 {
-  // put the buffers into the full buffers queue
+  // put the buffers back into the empty buffers queue, dropping whatever
+  // was left in there so no buffer is queued twice.
+  while (!m_emptyBuffers.empty()) {
+    m_emptyBuffers.pop();
+  }
   for (Buffer<Ty> *b : m_allBuffers) {
     b->setNumElements(bufferSizeElements());
     b->setIndexOffset(0);
@@ -272,6 +324,24 @@ BufferPool<Ty>::reset()
   m_stopRequested = false;
 }
 
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+uint64_t
+BufferPool<Ty>::producerStalls() const
+{
+  return m_producerStalls;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+uint64_t
+BufferPool<Ty>::consumerStalls() const
+{
+  return m_consumerStalls;
+}
+
 } // namespace preproc
 
 #endif // ! bufferpool_h__ 
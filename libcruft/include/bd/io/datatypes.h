@@ -21,6 +21,8 @@ enum class DataType
   Float,
   Double,
 
+  HalfFloat,
+
   Unknown
 };
 
@@ -59,6 +59,12 @@ operator<<(std::ostream&, const DatFileData&);
 bool
 parseDat(const std::string& datfile, DatFileData& data);
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Write \c data to the .dat file \c datfile.
+/// \return false if the file could not be written.
+bool
+writeDat(const std::string& datfile, const DatFileData& data);
+
 } // namespace bd
 
 
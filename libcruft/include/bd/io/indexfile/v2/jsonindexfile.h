@@ -9,6 +9,8 @@
 #include <bd/io/fileblock.h>
 #include <bd/volume/volume.h>
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
 namespace bd { namespace indexfile { namespace v2 {
@@ -18,13 +20,13 @@ namespace bd { namespace indexfile { namespace v2 {
         open(std::string const & fname);
 
         std::string const &
-        getRawFileName();
+        getRawFileName() const;
 
         std::string const &
-        getRawFilePath();
+        getRawFilePath() const;
 
         std::string const &
-        getTFFileName();
+        getTFFileName() const;
 
         bd::DataType
         getDatType() const;
@@ -35,13 +37,76 @@ namespace bd { namespace indexfile { namespace v2 {
         bd::Volume const&
         getVolume() const;
 
+        /// \brief True if the raw file is brick-major: each block's voxels
+        /// are stored contiguously at the block's data offset.
+        bool
+        isBricked() const;
+
+        /// \brief Order the bricks are stored in ("linear" or "morton").
+        /// Empty if the raw file is not bricked.
+        std::string const &
+        getBrickOrder() const;
+
+        /// \brief Number of bins in each block's value histogram, 0 if the
+        /// index has no histograms.
+        uint32_t
+        getHistogramBins() const;
+
+        /// \brief The block value histograms, getHistogramBins() counts per
+        /// block, in the same order as the blocks.
+        /// \see bd/volume/blockhistogram.h
+        std::vector<uint32_t> const &
+        getHistograms() const;
+
+        /// \brief Write this index file as json to \c fname.
+        /// Per-block min/max/avg/total and empty voxel counts are written
+        /// along with the fields read by open().
+        bool
+        write(std::string const & fname) const;
+
+        void
+        setRawFileName(std::string const & name);
+
+        void
+        setRawFilePath(std::string const & path);
+
+        void
+        setTFFileName(std::string const & name);
+
+        void
+        setDatType(bd::DataType type);
+
+        void
+        setFileBlocks(std::vector<bd::FileBlock> const & blocks);
+
+        void
+        setFileBlocks(std::vector<bd::FileBlock> && blocks);
+
+        /// \brief Set the block histograms, \c bins counts per block.
+        void
+        setHistograms(uint32_t bins, std::vector<uint32_t> const & histograms);
+
+        void
+        setHistograms(uint32_t bins, std::vector<uint32_t> && histograms);
+
+        void
+        setVolume(bd::Volume const & volume);
+
+        /// \brief Mark the raw file as brick-major, with bricks stored in
+        /// \c order. An empty \c order marks the file as row-major.
+        void
+        setBrickOrder(std::string const & order);
+
     private:
         bd::Volume m_volume;
         std::vector<bd::FileBlock> m_blocks;
+        std::vector<uint32_t> m_histograms;
+        uint32_t m_histBins{ 0 };
         std::string m_fname;
         std::string m_fpath;
         std::string m_tffname;
         std::string m_dataType;
+        std::string m_brickOrder;
     };
 
 
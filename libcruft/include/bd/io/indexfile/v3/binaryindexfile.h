@@ -0,0 +1,291 @@
+//
+// Created by jim on 3/14/19.
+//
+
+#ifndef bd_binaryindexfile_h__
+#define bd_binaryindexfile_h__
+
+#include <bd/io/datatypes.h>
+#include <bd/io/fileblock.h>
+#include <bd/io/mappedfile.h>
+#include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/volume/volume.h>
+
+#include <cstdint>
+#include <string>
+
+namespace bd { namespace indexfile { namespace v3 {
+
+///////////////////////////////////////////////////////////////////////////////
+// File layout
+//
+//   FileHeader
+//   SectionEntry[num_sections]
+//   sections, each starting on a SECTION_ALIGN byte boundary
+//
+// Per-block values are stored as columns (one section per field, num_blocks
+// values long, or 3 * num_blocks for vector fields), so the file can be
+// mapped and the columns used in place. The Histogram section is optional,
+// every other section must be present.
+//
+// Everything is written in the byte order of the machine that wrote the
+// file. The endian field holds ENDIAN_TAG in that byte order, files from a
+// machine with the other byte order are rejected.
+///////////////////////////////////////////////////////////////////////////////
+
+/// \brief "BDINDEX" followed by a NUL.
+char const MAGIC[8]{ 'B', 'D', 'I', 'N', 'D', 'E', 'X', '\0' };
+uint32_t const VERSION{ 3 };
+uint32_t const ENDIAN_TAG{ 0x01020304 };
+uint64_t const SECTION_ALIGN{ 64 };
+
+
+/// \brief Section identifiers. Readers skip sections they do not know.
+enum class Section : uint32_t
+{
+  Volume = 1,   ///< One VolumeSection.
+  Strings,      ///< NUL terminated: vol_name, vol_path, tr_func, dtype, brick_order.
+  Rov,          ///< double per block.
+  Avg,          ///< double per block.
+  Min,          ///< double per block.
+  Max,          ///< double per block.
+  Total,        ///< double per block.
+  EmptyVoxels,  ///< uint64_t per block.
+  DataOffset,   ///< uint64_t per block.
+  DataBytes,    ///< uint64_t per block.
+  Ijk,          ///< 3 uint64_t per block.
+  VoxelDims,    ///< 3 uint64_t per block.
+  WorldDims,    ///< 3 double per block.
+  Origin,       ///< 3 double per block.
+  Histogram,    ///< uint32_t bins per block, elem_bytes is 4 * bins (optional).
+  Count
+};
+
+
+struct FileHeader
+{
+  char magic[8];
+  uint32_t endian;
+  uint32_t version;
+  uint32_t header_bytes;  ///< sizeof(FileHeader), the section table follows.
+  uint32_t num_sections;
+  uint64_t num_blocks;
+};
+
+
+struct SectionEntry
+{
+  uint32_t id;          ///< A Section value.
+  uint32_t elem_bytes;  ///< Size of one element.
+  uint64_t offset;      ///< From the start of the file.
+  uint64_t count;       ///< Number of elements.
+};
+
+
+struct VolumeSection
+{
+  uint64_t block_count[3];
+  uint64_t voxel_dims[3];
+  uint64_t empty_voxels;
+  double world_dims[3];
+  double min;
+  double max;
+  double avg;
+  double total;
+  double rov_min;
+  double rov_max;
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief A memory mapped, version 3 binary index file.
+///
+/// open() maps the file and checks the header and section table, the block
+/// columns are then used straight out of the mapping. Pointers returned by
+/// the column getters are valid until close() or the BinaryIndexFile is
+/// destroyed.
+///////////////////////////////////////////////////////////////////////////////
+class BinaryIndexFile
+{
+public:
+  BinaryIndexFile();
+
+
+  ~BinaryIndexFile();
+
+
+  BinaryIndexFile(BinaryIndexFile const &) = delete;
+  BinaryIndexFile &operator=(BinaryIndexFile const &) = delete;
+
+
+  /// \brief True if \c fname starts with the v3 magic number.
+  static bool
+  isBinaryIndexFile(std::string const &fname);
+
+
+  /// \brief Write the contents of \c index as a v3 binary index file.
+  static bool
+  write(std::string const &fname, v2::JsonIndexFile const &index);
+
+
+  /// \brief Map \c fname and check that it is a readable v3 index file.
+  bool
+  open(std::string const &fname);
+
+
+  void
+  close();
+
+
+  /// \brief Copy the volume, file names and blocks into \c index.
+  void
+  copyTo(v2::JsonIndexFile &index) const;
+
+
+  /// \brief Copy the volume, file names, data type and brick order into
+  ///        \c index, but not the blocks or histograms, which stay in the
+  ///        mapped columns.
+  void
+  copyHeaderTo(v2::JsonIndexFile &index) const;
+
+
+  /// \brief Build the FileBlock for block \c i from the columns.
+  bd::FileBlock
+  getFileBlock(uint64_t i) const;
+
+
+  uint64_t
+  getNumBlocks() const;
+
+
+  double const *
+  getRov() const;
+
+
+  double const *
+  getAvg() const;
+
+
+  double const *
+  getMin() const;
+
+
+  double const *
+  getMax() const;
+
+
+  double const *
+  getTotal() const;
+
+
+  uint64_t const *
+  getEmptyVoxels() const;
+
+
+  uint64_t const *
+  getDataOffsets() const;
+
+
+  uint64_t const *
+  getDataBytes() const;
+
+
+  /// \brief Block ijk indexes, 3 per block.
+  uint64_t const *
+  getIjk() const;
+
+
+  /// \brief Block voxel dimensions, 3 per block.
+  uint64_t const *
+  getVoxelDims() const;
+
+
+  /// \brief Block world dimensions, 3 per block.
+  double const *
+  getWorldDims() const;
+
+
+  /// \brief Block centres, 3 per block.
+  double const *
+  getOrigins() const;
+
+
+  /// \brief Number of bins in each block's histogram, 0 if the file has none.
+  uint32_t
+  getHistogramBins() const;
+
+
+  /// \brief Block value histograms, getHistogramBins() per block, or nullptr
+  ///        if the file has none.
+  uint32_t const *
+  getHistograms() const;
+
+
+  bd::Volume const &
+  getVolume() const;
+
+
+  std::string const &
+  getRawFileName() const;
+
+
+  std::string const &
+  getRawFilePath() const;
+
+
+  std::string const &
+  getTFFileName() const;
+
+
+  bd::DataType
+  getDatType() const;
+
+
+  bool
+  isBricked() const;
+
+
+  std::string const &
+  getBrickOrder() const;
+
+
+private:
+
+  /// \brief Point m_sections at the entries in the section table.
+  bool
+  readSectionTable(std::string const &fname);
+
+
+  /// \brief Read the Volume and Strings sections.
+  bool
+  readMetadata(std::string const &fname);
+
+
+  void
+  fillFileBlock(uint64_t i, bd::FileBlock &b) const;
+
+
+  template<class T>
+  T const *
+  column(Section s) const
+  {
+    SectionEntry const *e{ m_sections[static_cast<uint32_t>(s)] };
+    return reinterpret_cast<T const *>(m_file.data() + e->offset);
+  }
+
+
+  bd::MappedFile m_file;
+  uint64_t m_numBlocks;
+  SectionEntry const *m_sections[static_cast<uint32_t>(Section::Count)];
+  bd::Volume m_volume;
+  std::string m_fname;
+  std::string m_fpath;
+  std::string m_tffname;
+  std::string m_dataType;
+  std::string m_brickOrder;
+
+}; // class BinaryIndexFile
+
+}}} // namespace bd::indexfile::v3
+
+#endif // ! bd_binaryindexfile_h__
@@ -0,0 +1,88 @@
+//
+// Created by jim on 3/2/19.
+//
+
+#ifndef bd_mappedfile_h
+#define bd_mappedfile_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bd
+{
+
+/// \brief A read-only memory mapping of an entire file.
+///
+/// The mapping stays valid until close() is called or the MappedFile is
+/// destroyed, so any pointers handed out by data() must not outlive it.
+class MappedFile
+{
+public:
+  MappedFile();
+
+
+  ~MappedFile();
+
+
+  MappedFile(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile const &) = delete;
+
+
+  /// \brief Map the file at \c path into memory.
+  /// \return True if the file was mapped, false otherwise.
+  bool
+  open(std::string const &path);
+
+
+  /// \brief Unmap the file.
+  void
+  close();
+
+
+  bool
+  isOpen() const;
+
+
+  /// \brief Get a pointer to the first byte of the mapping.
+  char const *
+  data() const;
+
+
+  /// \brief Get the size of the mapped file in bytes.
+  uint64_t
+  size() const;
+
+
+  /// \brief Hint to the kernel that the file will be read front to back.
+  void
+  adviseSequential() const;
+
+
+  /// \brief Ask the kernel to start reading [offset, offset+length) in now.
+  void
+  adviseWillNeed(uint64_t offset, uint64_t length) const;
+
+
+  /// \brief Tell the kernel [offset, offset+length) is not going to be
+  ///        touched again so its pages can be dropped.
+  void
+  adviseDontNeed(uint64_t offset, uint64_t length) const;
+
+
+private:
+  /// \brief Clamp [offset, offset+length) to the mapping and round offset
+  ///        down to a page boundary (as madvise requires).
+  bool
+  pageRange(uint64_t offset, uint64_t length,
+            char **start, size_t *bytes) const;
+
+  char *m_data;
+  uint64_t m_size;
+  int m_fd;
+
+}; // class MappedFile
+
+} // namespace bd
+
+#endif // ! bd_mappedfile_h
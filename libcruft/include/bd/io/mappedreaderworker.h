@@ -0,0 +1,110 @@
+//
+// Created by jim on 3/2/19.
+//
+
+#ifndef bd_mappedreaderworker_h
+#define bd_mappedreaderworker_h
+
+#include <bd/io/bufferpool.h>
+#include <bd/io/buffer.h>
+#include <bd/io/mappedfile.h>
+#include <bd/log/logger.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace bd
+{
+
+/// \brief Hands out Buffers that point directly into a memory mapped file.
+///
+/// Nothing is copied: each buffer popped from the pool's empty queue is
+/// pointed at the next window of the mapping and pushed to the full queue.
+/// The kernel is asked to read ahead \c readAheadBuffers windows in front of
+/// the window being handed out, and windows that consumers give back are
+/// dropped from the page cache.
+///
+/// \note The mapping is read only, consumers must not write into the buffers.
+template<class Ty, class Pool = BufferPool<Ty>>
+class MappedReaderWorker
+{
+public:
+
+  MappedReaderWorker(Pool &p, MappedFile const &f, int readAheadBuffers)
+    : m_pool{ &p }
+    , m_file{ &f }
+    , m_readAhead{ readAheadBuffers }
+  { }
+
+
+  ~MappedReaderWorker()
+  { }
+
+
+  /// \brief Pop buffers and point them into the mapping.
+  /// \returns -1 if the file is not mapped, or the total bytes handed out.
+  long long
+  operator()(std::atomic_bool const &quit)
+  {
+    if (!m_file->isOpen()) {
+      Err() << "File is not mapped. Exiting mapped readerworker loop.";
+      m_pool->requestStop();
+      return -1;
+    }
+
+    uint64_t const fileElements{ m_file->size() / sizeof(Ty) };
+    uint64_t const windowElements{ m_pool->bufferSizeElements() };
+    uint64_t const windowBytes{ windowElements * sizeof(Ty) };
+    Ty *const base{ reinterpret_cast<Ty *>(const_cast<char *>(m_file->data())) };
+
+    m_file->adviseSequential();
+    m_file->adviseWillNeed(0, windowBytes * m_readAhead);
+
+    uint64_t element{ 0 };
+    Dbg() << "Starting mapped reader loop.";
+    while (element < fileElements && !quit) {
+
+      // wait for the next empty buffer in the pool.
+      Buffer<Ty> *buf = m_pool->nextEmpty();
+      if (buf == nullptr) {
+        break;
+      }
+
+      // If this buffer has been handed out before, the window it pointed at
+      // has been consumed.
+      if (buf->getPtr() != nullptr) {
+        m_file->adviseDontNeed(buf->getIndexOffset() * sizeof(Ty),
+                               buf->getNumElements() * sizeof(Ty));
+      }
+
+      uint64_t const count{ std::min(windowElements, fileElements - element) };
+      buf->setPtr(base + element);
+      buf->setIndexOffset(element);
+      buf->setNumElements(count);
+
+      element += count;
+      m_file->adviseWillNeed(element * sizeof(Ty) + windowBytes * ( m_readAhead - 1 ),
+                             windowBytes);
+
+      m_pool->returnFull(buf);
+
+    } // while
+
+    m_pool->requestStop();
+
+    uint64_t const total_bytes{ element * sizeof(Ty) };
+    Dbg() << "Mapped reader done after mapping " << total_bytes << " bytes";
+    return static_cast<long long>(total_bytes);
+  }
+
+
+private:
+  Pool *m_pool;
+  MappedFile const *m_file;
+  int m_readAhead;
+
+}; // MappedReaderWorker
+
+} // namespace bd
+
+#endif // ! bd_mappedreaderworker_h
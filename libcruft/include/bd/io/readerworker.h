@@ -10,44 +10,62 @@
 #include <atomic>
 #include <string>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace bd
 {
 
 
-template<class Ty>
+/// \brief Fills empty buffers from a file and hands them back to the pool.
+/// \c Pool is BufferPool<Ty> or any pool with the same interface
+/// (e.g. SpscBufferPool<Ty>).
+///
+/// The file is split into buffer sized chunks. A worker reads every
+/// \c stripeCount'th chunk starting at chunk \c stripeIndex (see setStripe()),
+/// so several workers with the same stripe count and different stripe
+/// indexes read disjoint parts of the file. By default one worker reads
+/// every chunk. Each worker pushes its chunks to its pool in file order.
+template<class Ty, class Pool = BufferPool<Ty>>
 class ReaderWorker
 {
 public:
 
-  ReaderWorker(BufferPool<Ty> &p)
+  ReaderWorker(Pool &p)
     //: m_reader{ &r }
     : m_pool{ &p }
+    , m_fd{ -1 }
     , m_is{ nullptr }
+    , m_stripeIndex{ 0 }
+    , m_stripeCount{ 1 }
   { }
 
   ~ReaderWorker()
   {
-    if (m_is)
-      delete m_is;
+    close();
   }
 
-  /// \brief Pop buffers and fill them from the ifstream.
+  /// \brief Pop buffers and fill them from the file.
   /// \returns -1 if file could not be opened, or the total bytes read.
   long long
   operator()(std::atomic_bool const &quit)
   {
     if (! open()) {
         Err() << "Could not open file " << m_path << ". Exiting readerworker loop.";
+        m_pool->requestStop();
         return -1;
     }
 
-    // bytes to attempt to read from file.
-//    long long const buffer_size_bytes{ static_cast<long long>(m_pool->bufferSizeElements() * sizeof(Ty)) };
+    uint64_t const chunk_bytes{ m_pool->bufferSizeElements() * sizeof(Ty) };
+    uint64_t chunk{ m_stripeIndex };
     size_t total_read_bytes{ 0 };
 
-    Dbg() << "Starting reader loop.";
+    Dbg() << "Starting reader loop (stripe " << m_stripeIndex << " of "
+          << m_stripeCount << ").";
     std::cout << std::endl;
-    while(!m_is->eof() && !quit) {
+    while(!quit) {
 
       // wait for the next empty buffer in the pool.
       Buffer<Ty> *buf = m_pool->nextEmpty();
@@ -55,27 +73,31 @@ public:
         break;
       }
 
-
       // set the element index this buffer starts at.
-      buf->setIndexOffset(total_read_bytes/sizeof(Ty));
+      uint64_t const offset{ chunk * chunk_bytes };
+      buf->setIndexOffset(offset / sizeof(Ty));
       Ty *data = buf->getPtr();
 
-      m_is->read(reinterpret_cast<char*>(data), buf->getMaxNumElements());
-      std::streamsize amount{ m_is->gcount() };
-      buf->setNumElements(amount / sizeof(Ty));
-      
+      long long amount{ readAt(reinterpret_cast<char*>(data),
+                               buf->getMaxNumElements() * sizeof(Ty), offset) };
+
       // the last buffer filled may not be a full buffer, so resize!
-      if (amount == 0) {
-      //Dbg() << "Reader read 0 bytes.";
+      if (amount <= 0) {
+        if (amount < 0) {
+          Err() << "Error reading " << m_path << " at offset " << offset;
+        }
         m_pool->returnEmpty(buf);
         break;
       }
-
+      buf->setNumElements(amount / sizeof(Ty));
 
       total_read_bytes += amount;
-      std::cout << "\rRead " << total_read_bytes << " bytes." << std::flush;
+      if (m_stripeCount == 1) {
+        std::cout << "\rRead " << total_read_bytes << " bytes." << std::flush;
+      }
 
       m_pool->returnFull(buf);
+      chunk += m_stripeCount;
 
     } // while
 
@@ -83,13 +105,13 @@ public:
 
     m_pool->requestStop();
 
-    m_is->close();
+    close();
     Dbg() << "Reader done after reading " << total_read_bytes << " bytes";
 //    m_pool->kickThreads();
     return static_cast<long long int>(total_read_bytes);
   }
 
-    
+
   void
   setPath(std::string const &path)
   {
@@ -97,7 +119,58 @@ public:
   }
 
 
+  /// \brief Read only every \c count'th chunk starting at chunk \c index.
+  void
+  setStripe(int index, int count)
+  {
+    m_stripeIndex = index < 0 ? 0 : index;
+    m_stripeCount = count < 1 ? 1 : count;
+  }
+
+
 private:
+
+#ifndef _WIN32
+
+  bool
+  open()
+  {
+    m_fd = ::open(m_path.c_str(), O_RDONLY);
+    return m_fd >= 0;
+  }
+
+
+  void
+  close()
+  {
+    if (m_fd >= 0) {
+      ::close(m_fd);
+      m_fd = -1;
+    }
+  }
+
+
+  /// \brief Read up to \c bytes at \c offset, retrying short reads.
+  /// \return bytes read (less than \c bytes only at EOF), or -1 on error.
+  long long
+  readAt(char *dest, uint64_t bytes, uint64_t offset)
+  {
+    uint64_t total{ 0 };
+    while (total < bytes) {
+      ssize_t r{ ::pread(m_fd, dest + total, bytes - total, offset + total) };
+      if (r < 0) {
+        return -1;
+      }
+      if (r == 0) {
+        break;
+      }
+      total += static_cast<uint64_t>(r);
+    }
+    return static_cast<long long>(total);
+  }
+
+#else // _WIN32
+
   bool
   open()
   {
@@ -106,9 +179,34 @@ private:
     return m_is->is_open();
   }
 
-  BufferPool<Ty> *m_pool;
+
+  void
+  close()
+  {
+    if (m_is) {
+      delete m_is;
+      m_is = nullptr;
+    }
+  }
+
+
+  long long
+  readAt(char *dest, uint64_t bytes, uint64_t offset)
+  {
+    m_is->clear();
+    m_is->seekg(offset);
+    m_is->read(dest, bytes);
+    return static_cast<long long>(m_is->gcount());
+  }
+
+#endif // ! _WIN32
+
+  Pool *m_pool;
+  int m_fd;
   std::ifstream *m_is;
   std::string m_path;
+  uint64_t m_stripeIndex;
+  uint64_t m_stripeCount;
 
 }; // ReaderWorker
 
@@ -0,0 +1,301 @@
+//
+// Created by jim on 3/4/19.
+//
+
+#ifndef bd_spscbufferpool_h
+#define bd_spscbufferpool_h
+
+#include <bd/log/logger.h>
+#include <bd/io/buffer.h>
+#include <bd/datastructure/spscqueue.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief A BufferPool that hands buffers between exactly one producer thread
+///        and exactly one consumer thread through lock-free rings.
+///
+/// SpscBufferPool has the same interface as BufferPool and can be used
+/// anywhere BufferPool is used as long as there is a single consumer. Waiting
+/// threads spin briefly before they park, so small buffers can be used without
+/// the mutex/condition variable hand off dominating.
+template<class Ty>
+class SpscBufferPool
+{
+public:
+
+  SpscBufferPool(size_t bufSize, int numBuffers);
+
+
+  ~SpscBufferPool();
+
+
+  /// \brief Allocate the memory for this pool.
+  void
+  allocate();
+
+
+  /// \brief Create the buffers for this pool without allocating any
+  ///        memory for them (see BufferPool::allocateViews()).
+  void
+  allocateViews();
+
+
+  /// \brief Wait for a full buffer and return it.
+  /// If a stop was requested this method will keep returning full buffers
+  /// until there are no more.
+  Buffer<Ty> *
+  nextFullUntilNone();
+
+
+  /// \brief Return an empty buffer to the pool to be filled again.
+  void
+  returnEmpty(Buffer<Ty> *);
+
+
+  /// \brief Wait for an empty buffer and return it.
+  Buffer<Ty> *
+  nextEmpty();
+
+
+  /// \brief Return a full buffer to the pool.
+  void
+  returnFull(Buffer<Ty> *);
+
+
+  /// \brief Return the maximum number of elements that the buffers may contain.
+  size_t
+  bufferSizeElements() const;
+
+
+  void
+  kickThreads();
+
+
+  void
+  requestStop();
+
+
+  /// \brief Return all buffers to empty pool.
+  /// \note Function not thread safe.
+  void
+  reset();
+
+
+  /// \brief Number of times the producer had to wait for an empty buffer.
+  uint64_t
+  producerStalls() const;
+
+
+  /// \brief Number of times the consumer had to wait for a full buffer.
+  uint64_t
+  consumerStalls() const;
+
+
+private:
+
+  void
+  createBuffers(Ty *mem);
+
+  Ty *m_mem;
+  std::vector<Buffer<Ty> *> m_allBuffers;
+  SpscQueue<Buffer<Ty> *> m_emptyBuffers;
+  SpscQueue<Buffer<Ty> *> m_fullBuffers;
+
+  int m_nBufs;
+  size_t m_szBytesTotal;
+
+  std::atomic_bool m_stopRequested;
+
+}; // class SpscBufferPool
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+SpscBufferPool<Ty>::SpscBufferPool(size_t bufSize, int nbuf)
+    : m_mem{ nullptr }
+    , m_emptyBuffers{ static_cast<size_t>(nbuf) }
+    , m_fullBuffers{ static_cast<size_t>(nbuf) }
+    , m_nBufs{ nbuf }
+    , m_szBytesTotal{ bufSize }
+    , m_stopRequested{ false }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+SpscBufferPool<Ty>::~SpscBufferPool()
+{
+  for (auto buf : m_allBuffers) {
+    delete buf;
+  }
+
+  if (m_mem) {
+    delete[] m_mem;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+SpscBufferPool<Ty>::allocate()
+{
+  size_t buffer_size_elems{ bufferSizeElements() };
+
+  m_mem = new Ty[buffer_size_elems * m_nBufs];
+  Info() << "Allocated " << buffer_size_elems * m_nBufs << " elements ( " <<
+         m_szBytesTotal << " bytes).";
+
+  createBuffers(m_mem);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+SpscBufferPool<Ty>::allocateViews()
+{
+  createBuffers(nullptr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+SpscBufferPool<Ty>::createBuffers(Ty *mem)
+{
+  size_t buffer_size_elems{ bufferSizeElements() };
+
+  for (int i = 0; i < m_nBufs; ++i) {
+    Ty *start{ mem ? mem + i * buffer_size_elems : nullptr };
+    Buffer<Ty> *buf{ new Buffer<Ty>{ start, buffer_size_elems }};
+    m_allBuffers.push_back(buf);
+    m_emptyBuffers.tryPush(buf);
+  }
+
+  Info() << "Generated " << m_allBuffers.size() << " buffers of size " <<
+         buffer_size_elems << " (lock-free)";
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+Buffer<Ty> *
+SpscBufferPool<Ty>::nextFullUntilNone()
+{
+  Buffer<Ty> *buf{ nullptr };
+  if (!m_fullBuffers.pop(buf, m_stopRequested)) {
+    return nullptr;
+  }
+  return buf;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+SpscBufferPool<Ty>::returnEmpty(Buffer<Ty> *buf)
+{
+  // The ring is as large as the number of buffers, so it is never full.
+  m_emptyBuffers.tryPush(buf);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+Buffer<Ty> *
+SpscBufferPool<Ty>::nextEmpty()
+{
+  if (m_stopRequested) {
+    return nullptr;
+  }
+
+  Buffer<Ty> *buf{ nullptr };
+  if (!m_emptyBuffers.pop(buf, m_stopRequested) || m_stopRequested) {
+    return nullptr;
+  }
+  return buf;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+SpscBufferPool<Ty>::returnFull(Buffer<Ty> *buf)
+{
+  m_fullBuffers.tryPush(buf);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+size_t
+SpscBufferPool<Ty>::bufferSizeElements() const
+{
+  return ( m_szBytesTotal / m_nBufs ) / sizeof(Ty);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+SpscBufferPool<Ty>::kickThreads()
+{
+  m_emptyBuffers.wake();
+  m_fullBuffers.wake();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+SpscBufferPool<Ty>::requestStop()
+{
+  m_stopRequested = true;
+  kickThreads();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+SpscBufferPool<Ty>::reset()
+{
+  m_emptyBuffers.clear();
+  m_fullBuffers.clear();
+  for (Buffer<Ty> *b : m_allBuffers) {
+    b->setNumElements(bufferSizeElements());
+    b->setIndexOffset(0);
+    m_emptyBuffers.tryPush(b);
+  }
+
+  m_stopRequested = false;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+uint64_t
+SpscBufferPool<Ty>::producerStalls() const
+{
+  return m_emptyBuffers.popStalls();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+uint64_t
+SpscBufferPool<Ty>::consumerStalls() const
+{
+  return m_fullBuffers.popStalls();
+}
+
+} // namespace bd
+
+#endif // ! bd_spscbufferpool_h
@@ -0,0 +1,161 @@
+#ifndef bd_trace_h__
+#define bd_trace_h__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Timeline tracing in the Chrome trace event format.
+///
+/// Each thread records spans into its own fixed size ring buffer (the oldest
+/// events are overwritten when it fills), and writeJson() merges the buffers
+/// into a file that chrome://tracing or ui.perfetto.dev can open, with one
+/// row per thread. A thread gets its ring when it first records while
+/// tracing is enabled. When it exits, its events are kept and its ring is
+/// reused by the next thread.
+///
+/// Tracing is off until enable(true) is called. While it is off a traced
+/// scope costs one relaxed atomic load. Define BD_NO_TRACE to compile the
+/// macros away entirely.
+///
+/// Event names, categories and argument names are not copied: pass string
+/// literals (or strings that outlive the trace).
+///////////////////////////////////////////////////////////////////////////////
+
+namespace bd
+{
+namespace trace
+{
+
+namespace detail
+{
+extern std::atomic_bool s_enabled;
+}
+
+
+/// \brief Turn recording on or off (for all threads).
+void
+enable(bool on);
+
+
+inline bool
+enabled()
+{
+  return detail::s_enabled.load(std::memory_order_relaxed);
+}
+
+
+/// \brief Events kept per thread before the oldest are overwritten.
+/// Only affects threads that record their first event after the call.
+void
+setBufferCapacity(size_t events);
+
+
+/// \brief Name the calling thread's row in the timeline.
+void
+setThreadName(char const *name);
+
+
+/// \brief Nanoseconds on the trace clock (steady, from the first use).
+uint64_t
+now();
+
+
+/// \brief Record a span that started at \c start (from now()) and ends now.
+/// \c argName may be null, otherwise \c arg is shown with the span.
+void
+complete(char const *name, char const *cat, uint64_t start,
+         char const *argName = nullptr, int64_t arg = 0);
+
+
+/// \brief Record a counter sample, shown as a graph in the timeline.
+void
+counter(char const *name, int64_t value);
+
+
+/// \brief Write every thread's events to \c path as trace event JSON.
+/// \return false if the file could not be written.
+bool
+writeJson(std::string const &path);
+
+
+/// \brief Drop all recorded events (thread names are kept).
+void
+clear();
+
+
+/// \brief Records a span from construction to destruction.
+class Scope
+{
+public:
+  Scope(char const *name, char const *cat,
+        char const *argName = nullptr, int64_t arg = 0)
+      : m_name{ name }
+      , m_cat{ cat }
+      , m_argName{ argName }
+      , m_arg{ arg }
+      , m_on{ enabled() }
+      , m_start{ m_on ? now() : 0 }
+  {
+  }
+
+
+  ~Scope()
+  {
+    if (m_on) {
+      complete(m_name, m_cat, m_start, m_argName, m_arg);
+    }
+  }
+
+
+  Scope(Scope const &) = delete;
+  Scope &operator=(Scope const &) = delete;
+
+private:
+  char const *m_name;
+  char const *m_cat;
+  char const *m_argName;
+  int64_t m_arg;
+  bool m_on;
+  uint64_t m_start;
+};
+
+} // namespace trace
+} // namespace bd
+
+
+#define BD_TRACE_CONCAT_(a, b) a##b
+#define BD_TRACE_CONCAT(a, b) BD_TRACE_CONCAT_(a, b)
+
+#ifndef BD_NO_TRACE
+
+/// \brief Trace the rest of the enclosing scope as \c name in \c cat.
+#define BD_TRACE_SCOPE(name, cat) \
+  ::bd::trace::Scope BD_TRACE_CONCAT(bd_trace_scope_, __LINE__){ name, cat }
+
+/// \brief BD_TRACE_SCOPE with one integer argument shown on the span.
+#define BD_TRACE_SCOPE_ARG(name, cat, argName, arg) \
+  ::bd::trace::Scope BD_TRACE_CONCAT(bd_trace_scope_, __LINE__){ \
+      name, cat, argName, static_cast<int64_t>(arg) }
+
+#define BD_TRACE_COUNTER(name, value) \
+  do { \
+    if (::bd::trace::enabled()) { \
+      ::bd::trace::counter(name, static_cast<int64_t>(value)); \
+    } \
+  } while (0)
+
+#define BD_TRACE_THREAD_NAME(name) ::bd::trace::setThreadName(name)
+
+#else
+
+#define BD_TRACE_SCOPE(name, cat) do { } while (0)
+#define BD_TRACE_SCOPE_ARG(name, cat, argName, arg) do { } while (0)
+#define BD_TRACE_COUNTER(name, value) do { } while (0)
+#define BD_TRACE_THREAD_NAME(name) do { } while (0)
+
+#endif // ! BD_NO_TRACE
+
+#endif // ! bd_trace_h__
@@ -0,0 +1,86 @@
+//
+// Created by jim on 3/24/19.
+//
+
+#ifndef bd_parallelfor_h
+#define bd_parallelfor_h
+
+#ifdef BD_USE_TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief Run fn(begin, end) over [0, n) in parallel.
+///
+/// With TBB the range is handed to tbb::parallel_for (in an arena of
+/// \c threads threads if threads > 0), so fn may be called for many small
+/// ranges. Otherwise the range is split evenly between \c threads
+/// std::threads (hardware_concurrency if threads <= 0), the calling thread
+/// taking the last part. Either way fn must accept any sub-range, and
+/// sub-range boundaries are multiples of \c align, except for the end of
+/// the range.
+template<class Fn>
+void
+parallelFor(size_t n, int threads, Fn fn, size_t align = 1)
+{
+  if (n == 0) {
+    return;
+  }
+  align = std::max<size_t>(align, 1);
+  size_t const blocks{ ( n + align - 1 ) / align };
+
+#ifdef BD_USE_TBB
+  auto run = [&]() {
+    // aligned blocks of elements, so tbb can only split on a boundary.
+    tbb::parallel_for(tbb::blocked_range<size_t>{ 0, blocks },
+                      [&](tbb::blocked_range<size_t> const &r) {
+                        fn(r.begin() * align, std::min(n, r.end() * align));
+                      });
+  };
+  if (threads > 0) {
+    tbb::task_arena arena{ threads };
+    arena.execute(run);
+  } else {
+    run();
+  }
+#else
+  size_t nt{ threads > 0 ? static_cast<size_t>(threads)
+                         : std::max(1u, std::thread::hardware_concurrency()) };
+  nt = std::min(nt, blocks);
+  if (nt <= 1) {
+    fn(size_t{ 0 }, n);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  size_t const per{ blocks / nt };
+  size_t const extra{ blocks % nt };
+  size_t begin{ 0 };
+  for (size_t t = 0; t < nt; ++t) {
+    size_t const end{ std::min(n, begin + ( per + ( t < extra ? 1 : 0 )) * align) };
+    if (t == nt - 1) {
+      fn(begin, end);
+    } else {
+      workers.emplace_back(fn, begin, end);
+    }
+    begin = end;
+  }
+
+  for (auto &w : workers) {
+    w.join();
+  }
+#endif
+}
+
+} // namespace bd
+
+#endif // ! bd_parallelfor_h
@@ -0,0 +1,182 @@
+//
+// Created by Jim Pelton on 9/4/16.
+//
+
+#ifndef bd_parallelfor_voxelrelevance_h
+#define bd_parallelfor_voxelrelevance_h
+
+#include <bd/io/buffer.h>
+#include <bd/tbb/parallelfor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace bd
+{
+
+namespace detail
+{
+
+/// \brief True for maps whose elements share storage (std::vector<bool>),
+///        so that writes to neighbouring indices from two threads race.
+template<class Map>
+struct IsPackedMap : std::false_type { };
+
+template<class Alloc>
+struct IsPackedMap<std::vector<bool, Alloc>> : std::true_type { };
+
+} // namespace detail
+
+
+/// \brief Parallel-for body that classifies the voxels of a Buffer.
+///
+/// For each index i in the range given to operator(), map[i] is set to
+/// f(buf->getPtr()[i]). Indexes are relative to the start of the buffer.
+/// The body is cheap to copy and can be given straight to
+/// tbb::parallel_for with a tbb::blocked_range<size_t>, or to anything else
+/// that calls it with a range having begin() and end().
+///
+/// If the map is a std::vector<bool>, each range is classified into a
+/// temporary and copied into the map while holding a lock shared by all
+/// copies of the body, because neighbouring bits can not be written
+/// concurrently.
+template<class Ty, class Function, class Map>
+class ParallelForVoxelRelevance
+{
+public:
+  ParallelForVoxelRelevance(Map &map, Buffer<Ty> const *buf, Function f)
+      : m_map{ &map }
+      , m_buf{ buf }
+      , m_f{ f }
+      , m_mapMutex{ std::make_shared<std::mutex>() }
+  { }
+
+
+  template<class Range>
+  void
+  operator()(Range const &r) const
+  {
+    classify(r.begin(), r.end(), detail::IsPackedMap<Map>{ });
+  }
+
+
+private:
+
+  void
+  classify(size_t begin, size_t end, std::false_type) const
+  {
+    Ty const *data{ m_buf->getPtr() };
+    for (size_t i = begin; i < end; ++i) {
+      (*m_map)[i] = m_f(data[i]);
+    }
+  }
+
+
+  void
+  classify(size_t begin, size_t end, std::true_type) const
+  {
+    Ty const *data{ m_buf->getPtr() };
+    std::vector<char> rel(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+      rel[i - begin] = m_f(data[i]) ? 1 : 0;
+    }
+
+    std::lock_guard<std::mutex> lock(*m_mapMutex);
+    for (size_t i = begin; i < end; ++i) {
+      (*m_map)[i] = rel[i - begin] != 0;
+    }
+  }
+
+
+  Map *m_map;
+  Buffer<Ty> const *m_buf;
+  Function m_f;
+  std::shared_ptr<std::mutex> m_mapMutex;
+
+}; // class ParallelForVoxelRelevance
+
+
+/// \brief Set map[i] = f(buf.getPtr()[i]) for the buf.getNumElements()
+///        elements of \c buf, in parallel.
+///
+/// \c map must already hold at least buf.getNumElements() elements.
+/// \param threads Number of threads to use, or <= 0 for the default.
+template<class Ty, class Function, class Map>
+void
+parallelForVoxelRelevance(Buffer<Ty> const &buf, Function f, Map &map,
+                          int threads = 0)
+{
+  ParallelForVoxelRelevance<Ty, Function, Map> body{ map, &buf, f };
+
+  struct Range
+  {
+    size_t b, e;
+    size_t begin() const { return b; }
+    size_t end() const { return e; }
+  };
+
+  // Chunks are whole 64-bit words of a bitmap, so the body's lock is
+  // never contended.
+  parallelFor(buf.getNumElements(), threads,
+              [&body](size_t begin, size_t end) {
+                body(Range{ begin, end });
+              }, 64);
+}
+
+
+/// \brief Count the relevant voxels of each block in \c buf, in parallel.
+///
+/// The voxel at index i of the buffer belongs to block blockOf(i), which
+/// must be less than \c numBlocks; a voxel is relevant if f(value) is true.
+/// Indexes are relative to the start of the buffer, so to count voxels
+/// of a volume streamed through several buffers, blockOf should add
+/// buf.getIndexOffset() and the counts of each buffer should be summed.
+///
+/// \param threads Number of threads to use, or <= 0 for the default.
+/// \return a vector of numBlocks counts.
+template<class Ty, class Function, class BlockOf>
+std::vector<uint64_t>
+parallelForRelevantCounts(Buffer<Ty> const &buf, Function f, BlockOf blockOf,
+                          size_t numBlocks, int threads = 0)
+{
+  std::vector<std::atomic<uint64_t>> counts(numBlocks);
+  for (auto &c : counts) {
+    c = 0;
+  }
+
+  Ty const *data{ buf.getPtr() };
+  parallelFor(buf.getNumElements(), threads, [&](size_t begin, size_t end) {
+    // neighbouring voxels are mostly in the same block, so count runs
+    // locally and only touch the shared counts when the block changes.
+    size_t block{ numBlocks };
+    uint64_t run{ 0 };
+    for (size_t i = begin; i < end; ++i) {
+      size_t const b{ blockOf(i) };
+      if (b != block) {
+        if (run > 0) {
+          counts[block].fetch_add(run, std::memory_order_relaxed);
+        }
+        block = b;
+        run = 0;
+      }
+      if (f(data[i])) {
+        ++run;
+      }
+    }
+    if (run > 0) {
+      counts[block].fetch_add(run, std::memory_order_relaxed);
+    }
+  });
+
+  return std::vector<uint64_t>(counts.begin(), counts.end());
+}
+
+} // namespace bd
+
+#endif // ! bd_parallelfor_voxelrelevance_h
@@ -0,0 +1,49 @@
+#ifndef bd_half_h__
+#define bd_half_h__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bd
+{
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Convert \c f to an IEEE 754 half (binary16), rounding to nearest
+///        even. Values too large for a half become infinity.
+///////////////////////////////////////////////////////////////////////////////
+uint16_t
+floatToHalf(float f);
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Convert the half \c h to a float (exact).
+///////////////////////////////////////////////////////////////////////////////
+float
+halfToFloat(uint16_t h);
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Convert \c n floats to halves.
+/// Uses the F16C instructions, 8 values at a time, if the cpu has them and
+/// the scalar conversion otherwise. Both give the same results.
+///////////////////////////////////////////////////////////////////////////////
+void
+floatToHalf(float const *src, uint16_t *dst, size_t n);
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Convert \c n halves to floats (F16C if the cpu has it).
+///////////////////////////////////////////////////////////////////////////////
+void
+halfToFloat(uint16_t const *src, float *dst, size_t n);
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief True if the array conversions use the F16C instructions.
+///////////////////////////////////////////////////////////////////////////////
+bool
+hasF16C();
+
+} // namespace bd
+
+#endif // ! bd_half_h__
@@ -30,6 +30,14 @@ size_t to1D(size_t col, size_t row, size_t slab, size_t maxCols, size_t maxRows)
 unsigned long long vecCompMult(const glm::u64vec3 &v);
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Interleave the bits of \c x,y,z into a Morton (Z-order) code.
+/// \note Only the low 21 bits of each coordinate are used.
+///////////////////////////////////////////////////////////////////////////////
+unsigned long long mortonEncode(unsigned long long x, unsigned long long y,
+                                unsigned long long z);
+
+
 //template<class VecType, class NumberType,
 //         typename =
 //         typename std::enable_if<
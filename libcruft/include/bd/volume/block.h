@@ -3,6 +3,7 @@
 
 #include <bd/graphics/texture.h>
 #include <bd/io/fileblock.h>
+#include <bd/volume/occupancymask.h>
 
 #include <glm/glm.hpp>
 
@@ -43,6 +44,18 @@ public:
   sendToGpu();
 
 
+  /// \brief Upload \c pixels, instead of this block's pixel data, to its
+  ///        texture. For pixel data that is converted before upload.
+  void
+  sendToGpu(void const *pixels);
+
+
+  /// \brief Mark the block as resident on the gpu without touching its
+  ///        texture, for when the pixels were uploaded some other way.
+  void
+  setGpuResident();
+
+
 //  bool
 //  visible() const;
 
@@ -56,6 +69,12 @@ public:
   fileBlock() const;
 
 
+  /// \brief Set the ROV in this block's FileBlock (after reclassifying it
+  ///        for a new transfer function).
+  void
+  rov(double);
+
+
   uint64_t
   index() const;
 
@@ -131,6 +150,16 @@ public:
   char*
   removePixelData();
 
+
+  /// \brief Get the occupancy of this block's macrocells, computed when
+  ///        its pixel data was loaded.
+  OccupancyMask const &
+  occupancy() const;
+
+
+  OccupancyMask &
+  occupancy();
+
   /// \brief String rep. of this blockeroo.
   std::string
   to_string() const;
@@ -163,6 +192,7 @@ private:
 
   Texture *m_tex ; ///< Texture assoc'd with this block.
   char *m_pixelData; ///< CPU resident texture data (nullptr if non-resident).
+  OccupancyMask m_occupancy; ///< Occupied macrocells of m_pixelData.
 
   ///
   /// 0x01 -- visible.
@@ -0,0 +1,57 @@
+#ifndef bd_blockhistogram_h__
+#define bd_blockhistogram_h__
+
+#include <bd/volume/transferfunction.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace bd
+{
+
+//////////////////////////////////////////////////////////////////////////
+// Per-block value histograms.
+//
+// Each block's voxels are counted into \c bins equal width bins over the
+// normalized value range [0, 1] (normalized by the volume min/max, like
+// the values given to an OpacityTransferFunction). A block's ROV for any
+// opacity transfer function is then approximately the dot product of its
+// histogram with the mean opacity of each bin, divided by the number of
+// voxels, without looking at the voxels again.
+//////////////////////////////////////////////////////////////////////////
+
+/// \brief The bin that normalized value \c v falls in. Values outside of
+///        [0, 1] go in the first or last bin.
+inline uint32_t
+histogramBin(double v, uint32_t bins)
+{
+  if (!( v > 0.0 )) {
+    return 0;
+  }
+  uint32_t const b{ v >= 1.0 ? bins : static_cast<uint32_t>(v * bins) };
+  return b < bins ? b : bins - 1;
+}
+
+
+/// \brief The mean opacity of \c otf over each of \c bins bins, found by
+///        evaluating \c otf (see opacityAt()) at \c samplesPerBin evenly
+///        spaced points per bin.
+std::vector<double>
+binOpacities(OpacityTransferFunction const &otf, uint32_t bins,
+             uint32_t samplesPerBin = 8);
+
+
+/// \brief The ROV of a block with histogram \c hist, given the opacity of
+///        each bin from binOpacities(). 0 for an empty histogram.
+double
+histogramRov(uint32_t const *hist, std::vector<double> const &binOpacity);
+
+
+/// \brief The number of voxels of a block with histogram \c hist that fall
+///        in bins with no opacity.
+uint64_t
+histogramEmptyVoxels(uint32_t const *hist, std::vector<double> const &binOpacity);
+
+} // namespace bd
+
+#endif // ! bd_blockhistogram_h__
@@ -0,0 +1,168 @@
+#ifndef bd_gridorder_h__
+#define bd_gridorder_h__
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace bd
+{
+
+//////////////////////////////////////////////////////////////////////////
+/// \brief Back to front order of the cells of a regular grid, as seen
+/// from an eye point.
+///
+/// A ray from the eye that passes through cell B and then cell A moves
+/// away from the eye's cell along every axis, so each of B's indices lies
+/// between the eye's cell and A's index. Walking each axis from both ends
+/// in towards the eye's cell, and nesting the three walks (z, y, x),
+/// therefore puts every cell before all of the cells that can hide it.
+///
+/// The order depends only on the cell the eye is in, so it only has to be
+/// recomputed when the eye crosses a cell boundary, and sorting n cells
+/// is a counting sort in O(n + nx + ny + nz).
+//////////////////////////////////////////////////////////////////////////
+class GridOrder
+{
+public:
+
+  /// \brief An order for a grid of \c dims cells. The eye starts in cell
+  ///        (0, 0, 0) of a grid of unit cells with its corner at the origin.
+  explicit GridOrder(glm::u64vec3 const &dims);
+
+
+  /// \brief Set the world position of the grid's min corner and the world
+  ///        size of one cell (used by setEye()).
+  void
+  setWorldBox(glm::vec3 const &min, glm::vec3 const &cellSize);
+
+
+  /// \brief Move the eye to world position \c eye.
+  /// \return true if the eye moved to a different cell (the order changed).
+  bool
+  setEye(glm::vec3 const &eye);
+
+
+  /// \brief Move the eye to \c cell, which is clamped to the grid.
+  /// \return true if the eye moved to a different cell (the order changed).
+  bool
+  setEyeCell(glm::i64vec3 const &cell);
+
+
+  glm::i64vec3 const &
+  eyeCell() const;
+
+
+  glm::u64vec3 const &
+  dims() const;
+
+
+  /// \brief Position of cell \c ijk in the back to front order, in
+  ///        [0, dims.x * dims.y * dims.z).
+  uint64_t
+  rank(glm::u64vec3 const &ijk) const;
+
+
+  /// \brief Sort \c items back to front.
+  /// \param ijkOf Returns the glm::u64vec3 cell index of an item.
+  template<class T, class IjkFn>
+  void
+  sort(std::vector<T> &items, IjkFn ijkOf) const;
+
+
+  /// \brief True if \c items are in back to front order.
+  template<class T, class IjkFn>
+  bool
+  isSorted(std::vector<T> const &items, IjkFn ijkOf) const;
+
+
+private:
+
+  /// Rank the indices of one axis: low end up to the eye, then high end
+  /// down to the eye, then the eye's index.
+  void
+  rankAxis(int axis);
+
+
+  /// Stable counting sort of \c in into \c out by the rank of one axis.
+  template<class T, class IjkFn>
+  void
+  countingPass(std::vector<T> const &in, std::vector<T> &out, int axis,
+               IjkFn &ijkOf) const;
+
+
+  glm::u64vec3 m_dims;
+  glm::vec3 m_worldMin;
+  glm::vec3 m_cellSize;
+  glm::i64vec3 m_eyeCell;
+  std::vector<uint64_t> m_axisRank[3];
+
+}; // class GridOrder
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class T, class IjkFn>
+void
+GridOrder::sort(std::vector<T> &items, IjkFn ijkOf) const
+{
+  if (items.size() < 2) {
+    return;
+  }
+
+  // least significant axis first.
+  std::vector<T> tmp(items.size());
+  std::vector<T> *in{ &items };
+  std::vector<T> *out{ &tmp };
+  for (int axis = 0; axis < 3; ++axis) {
+    if (m_dims[axis] < 2) {
+      continue;
+    }
+    countingPass(*in, *out, axis, ijkOf);
+    std::swap(in, out);
+  }
+  if (in != &items) {
+    items.swap(tmp);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class T, class IjkFn>
+bool
+GridOrder::isSorted(std::vector<T> const &items, IjkFn ijkOf) const
+{
+  uint64_t last{ 0 };
+  for (T const &item : items) {
+    uint64_t const r{ rank(ijkOf(item)) };
+    if (r < last) {
+      return false;
+    }
+    last = r;
+  }
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class T, class IjkFn>
+void
+GridOrder::countingPass(std::vector<T> const &in, std::vector<T> &out, int axis,
+                        IjkFn &ijkOf) const
+{
+  std::vector<uint64_t> const &ranks = m_axisRank[axis];
+  std::vector<size_t> start(ranks.size() + 1, 0);
+  for (T const &item : in) {
+    start[ranks[ijkOf(item)[axis]] + 1] += 1;
+  }
+  for (size_t i = 1; i < start.size(); ++i) {
+    start[i] += start[i - 1];
+  }
+  for (T const &item : in) {
+    out[start[ranks[ijkOf(item)[axis]]]++] = item;
+  }
+}
+
+} // namespace bd
+
+#endif // ! bd_gridorder_h__
@@ -0,0 +1,89 @@
+#ifndef bd_occupancymask_h__
+#define bd_occupancymask_h__
+
+#include <bd/volume/opacityrangetable.h>
+
+#include <array>
+#include <cstdint>
+
+namespace bd
+{
+
+/// \brief Coarse map of the parts of a block that are visible under an
+///        opacity transfer function.
+///
+/// A block is split into 8x8x8 macrocells, each covering ceil(dim / 8)
+/// voxels along each axis (when a block is less than 8 voxels wide, the
+/// cells past its edge are empty). A cell is occupied if the opacity is
+/// non-zero anywhere in the range of values of its voxels and of the voxels
+/// one step outside of it, so that samples interpolated near the cell's
+/// faces are covered too. The mask is conservative: a cell holding a
+/// visible voxel is never empty.
+///
+/// The mask is tagged with the generation of the transfer function it was
+/// computed for, so users can tell when it has become stale. A mask that
+/// was never computed has every cell occupied and generation 0.
+class OccupancyMask
+{
+public:
+  static constexpr uint32_t CellsPerSide = 8;
+  static constexpr uint32_t Cells = CellsPerSide * CellsPerSide * CellsPerSide;
+
+
+  /// \brief A mask with every cell occupied.
+  OccupancyMask();
+
+
+  /// \brief Compute the mask of a block of normalized voxels.
+  /// \param voxels The block's voxels, x fastest, in [0, 1].
+  /// \param dims The block's size in voxels.
+  /// \param table The opacity ranges of the transfer function.
+  /// \param generation Tag for the transfer function.
+  void
+  compute(float const *voxels, uint64_t const dims[3],
+          OpacityRangeTable const &table, uint32_t generation);
+
+
+  /// \brief Mark every cell occupied and reset the generation to 0.
+  void
+  fill();
+
+
+  /// \brief True if cell (i, j, k) is occupied.
+  bool
+  occupied(uint32_t i, uint32_t j, uint32_t k) const;
+
+
+  /// \brief True if the cell holding voxel (x, y, z) is occupied.
+  bool
+  occupiedVoxel(uint64_t x, uint64_t y, uint64_t z) const;
+
+
+  /// \brief Number of occupied cells.
+  uint32_t
+  count() const;
+
+
+  /// \brief Voxels covered by each cell along each axis.
+  uint64_t const *
+  cellExtent() const;
+
+
+  uint32_t
+  generation() const;
+
+
+private:
+  static uint32_t
+  cellIndex(uint32_t i, uint32_t j, uint32_t k);
+
+
+  std::array<uint64_t, Cells / 64> m_bits;
+  uint64_t m_cellExtent[3];
+  uint32_t m_generation;
+
+}; // class OccupancyMask
+
+} // namespace bd
+
+#endif // ! bd_occupancymask_h__
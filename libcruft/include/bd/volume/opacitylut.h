@@ -0,0 +1,189 @@
+#ifndef bd_opacitylut_h__
+#define bd_opacitylut_h__
+
+#include <bd/volume/transferfunction.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief The opacity at normalized value \c v of the function that is linear
+///        between \c knots (sorted by scalar value) and constant past the end
+///        knots. 0 if there are no knots.
+double
+opacityAt(std::vector<OpacityKnot> const &knots, double v);
+
+
+/// \brief An opacity transfer function baked into a table of opacities
+///        indexed by raw voxel value.
+///
+/// For 8 and 16 bit integer voxels the table has an entry for every raw
+/// value (256 or 65536 entries), so the normalization of the voxel by the
+/// data min/max is folded into the table and a lookup is exact. Other voxel
+/// types (float, 32 bit integers) use a table of \c fineEntries evenly spaced
+/// values between the data min and max, and a voxel gets the entry nearest to
+/// it. Entries hold the opacity of the function linear between the knots.
+template<class Ty>
+class OpacityLut
+{
+public:
+  /// \brief True if every raw value of Ty has its own table entry.
+  static constexpr bool Exact{ std::is_integral<Ty>::value && sizeof(Ty) <= 2 };
+
+
+  OpacityLut()
+      : m_alpha{ }
+      , m_dataMin{ 0 }
+      , m_scale{ 0 }
+  {
+  }
+
+
+  /// \param knots The transfer function's knots (scalars are normalized).
+  /// \param dataMin The raw value that is normalized to 0.
+  /// \param dataMax The raw value that is normalized to 1.
+  /// \param fineEntries The table size for types that are not Exact.
+  OpacityLut(std::vector<OpacityKnot> const &knots,
+             double dataMin, double dataMax,
+             size_t fineEntries = 65536)
+      : OpacityLut()
+  {
+    build(knots, dataMin, dataMax, fineEntries);
+  }
+
+
+  OpacityLut(OpacityTransferFunction const &otf,
+             double dataMin, double dataMax,
+             size_t fineEntries = 65536)
+      : OpacityLut(otf.getKnotsVector(), dataMin, dataMax, fineEntries)
+  {
+  }
+
+
+  void
+  build(std::vector<OpacityKnot> const &knots,
+        double dataMin, double dataMax,
+        size_t fineEntries = 65536)
+  {
+    std::vector<OpacityKnot> sorted{ knots };
+    std::sort(sorted.begin(), sorted.end());
+
+    double const diff{ dataMax - dataMin };
+    auto normalize = [dataMin, diff](double v) {
+      double const n{ diff > 0 ? ( v - dataMin ) / diff : 0.0 };
+      return std::min(1.0, std::max(0.0, n));
+    };
+
+    m_dataMin = dataMin;
+    if (Exact) {
+      size_t const entries{ size_t{ 1 } << ( 8 * std::min<size_t>(sizeof(Ty), 2) ) };
+      m_alpha.resize(entries);
+      double const lowest{ static_cast<double>(std::numeric_limits<Ty>::lowest()) };
+      for (size_t i = 0; i < entries; ++i) {
+        m_alpha[i] = static_cast<float>(opacityAt(sorted, normalize(lowest + i)));
+      }
+    } else {
+      size_t const entries{ std::max<size_t>(2, fineEntries) };
+      m_alpha.resize(entries);
+      m_scale = diff > 0 ? ( entries - 1 ) / diff : 0.0;
+      for (size_t i = 0; i < entries; ++i) {
+        m_alpha[i] = static_cast<float>(
+            opacityAt(sorted, static_cast<double>(i) / ( entries - 1 )));
+      }
+    }
+  }
+
+
+  /// \brief The number of table entries (0 if the table was not built).
+  size_t
+  size() const
+  {
+    return m_alpha.size();
+  }
+
+
+  /// \brief The opacity of raw value \c v.
+  float
+  operator()(Ty v) const
+  {
+    return m_alpha[index(v, std::integral_constant<bool, Exact>{ })];
+  }
+
+
+  /// \brief The sum of the opacities of the \c n voxels in \c v.
+  double
+  relevance(Ty const *v, size_t n) const
+  {
+    double sum{ 0.0 };
+    for (size_t i = 0; i < n; ++i) {
+      sum += ( *this )(v[i]);
+    }
+    return sum;
+  }
+
+
+  /// \brief The number of the \c n voxels in \c v that have zero opacity.
+  uint64_t
+  emptyVoxels(Ty const *v, size_t n) const
+  {
+    uint64_t empty{ 0 };
+    for (size_t i = 0; i < n; ++i) {
+      empty += ( *this )(v[i]) <= 0.0f ? 1 : 0;
+    }
+    return empty;
+  }
+
+
+  /// \brief Set out[i] to 1 if the opacity of v[i] is in [lo, hi), else to 0.
+  /// \return The number of voxels set to 1.
+  uint64_t
+  classify(Ty const *v, size_t n, double lo, double hi, uint8_t *out) const
+  {
+    uint64_t count{ 0 };
+    for (size_t i = 0; i < n; ++i) {
+      float const a{ ( *this )(v[i]) };
+      out[i] = a >= lo && a < hi ? 1 : 0;
+      count += out[i];
+    }
+    return count;
+  }
+
+
+private:
+  size_t
+  index(Ty v, std::true_type) const
+  {
+    return static_cast<size_t>(static_cast<int64_t>(v) -
+                               static_cast<int64_t>(std::numeric_limits<Ty>::lowest()));
+  }
+
+
+  size_t
+  index(Ty v, std::false_type) const
+  {
+    double const i{ ( static_cast<double>(v) - m_dataMin ) * m_scale + 0.5 };
+    if (!( i > 0.0 )) {
+      return 0;
+    }
+    return std::min(static_cast<size_t>(i), m_alpha.size() - 1);
+  }
+
+
+  std::vector<float> m_alpha;
+  double m_dataMin;
+  double m_scale;   ///< entries per unit of raw value (only if not Exact).
+
+}; // class OpacityLut
+
+
+template<class Ty>
+constexpr bool OpacityLut<Ty>::Exact;
+
+} // namespace bd
+
+#endif // ! bd_opacitylut_h__
@@ -0,0 +1,62 @@
+#ifndef bd_opacityrangetable_h__
+#define bd_opacityrangetable_h__
+
+#include <bd/volume/transferfunction.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief Finds, in constant time, whether an opacity transfer function is
+///        zero for every normalized value in a range.
+///
+/// The value range [0, 1] is split into equal width entries, and an entry
+/// is opaque if the opacity, linear between the transfer function's knots,
+/// is non-zero anywhere in it (at either end, or at a knot inside it). The
+/// table holds the number of opaque entries before each entry, so a range of
+/// entries is transparent if the counts at its ends are equal. The test is
+/// conservative: a range that holds opacity is never reported transparent.
+class OpacityRangeTable
+{
+public:
+  /// \brief A table with no transfer function, every range is opaque.
+  OpacityRangeTable();
+
+
+  explicit OpacityRangeTable(OpacityTransferFunction const &otf,
+                             uint32_t entries = 4096);
+
+
+  /// \brief Rebuild the table for \c otf.
+  void
+  build(OpacityTransferFunction const &otf, uint32_t entries = 4096);
+
+
+  /// \brief True if the table was built for a transfer function.
+  bool
+  valid() const;
+
+
+  /// \brief True if the opacity is zero for all normalized values in
+  ///        [lo, hi]. Values outside of [0, 1] are clamped.
+  bool
+  isTransparent(double lo, double hi) const;
+
+
+private:
+  /// \brief The one of \c entries entries that normalized value \c v
+  ///        falls in.
+  static uint32_t
+  entry(double v, uint32_t entries);
+
+
+  /// m_opaqueBefore[i] is the number of opaque entries in [0, i).
+  std::vector<uint32_t> m_opaqueBefore;
+
+}; // class OpacityRangeTable
+
+} // namespace bd
+
+#endif // ! bd_opacityrangetable_h__
@@ -0,0 +1,191 @@
+#ifndef bd_synthvolume_h__
+#define bd_synthvolume_h__
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief The procedural patterns a SynthVolume can make.
+enum class SynthPattern
+{
+  Shells,   ///< concentric spherical shells around the volume's centre.
+  Noise,    ///< fractal value noise.
+  Blobs,    ///< round blobs scattered on a jittered grid.
+  Slabs     ///< z slabs of constant value.
+};
+
+
+/// \brief Parse "shells", "noise", "blobs" or "slabs".
+/// \return false if \c s is not a pattern.
+bool
+to_synthPattern(std::string const &s, SynthPattern &p);
+
+
+//////////////////////////////////////////////////////////////////////////
+/// \brief A procedural volume of any size, for benchmarks and tests.
+///
+/// Each voxel is a value in [0, 1] computed from its position alone, so
+/// any slab can be generated on any thread, in any order, without the rest
+/// of the volume. Zero is empty space. The pattern's field is thresholded
+/// so that about the requested fraction of the voxels are empty; the
+/// threshold is estimated from a sample of voxels when the volume is made.
+/// Blobs can only be as dense as the blobs are large, so they may be emptier
+/// than asked for at small empty fractions.
+///
+/// The same dimensions, pattern, empty fraction and seed always give the
+/// same voxels.
+//////////////////////////////////////////////////////////////////////////
+class SynthVolume
+{
+public:
+
+  SynthVolume(glm::u64vec3 const &dims, SynthPattern pattern,
+              double emptyFraction, uint32_t seed = 1);
+
+
+  /// \brief The value of voxel (x, y, z), in [0, 1] (0 is empty).
+  double
+  sample(uint64_t x, uint64_t y, uint64_t z) const;
+
+
+  /// \brief The values of the dims().x voxels of row (y, z).
+  void
+  sampleRow(uint64_t y, uint64_t z, double *row) const;
+
+
+  /// \brief Write the \c nz xy slices starting at slice \c z0 to \c out in
+  ///        row-major order, scaled to the range of Ty (see toVoxel()).
+  /// \return The number of empty voxels written.
+  template<class Ty>
+  uint64_t
+  fill(uint64_t z0, uint64_t nz, Ty *out) const;
+
+
+  /// \brief Scale \c v in [0, 1] to Ty: floating point types are unchanged,
+  ///        integer types are scaled to [0, max] and only 0 maps to 0.
+  template<class Ty>
+  static Ty
+  toVoxel(double v);
+
+
+  glm::u64vec3 const &
+  dims() const;
+
+
+  /// \brief Field values at or below the threshold are empty.
+  double
+  threshold() const;
+
+
+private:
+
+  /// \brief The pattern's field, in [0, 1], for the \c n voxels of row
+  ///        (y, z) starting at \c x0.
+  void
+  field(uint64_t x0, uint64_t n, uint64_t y, uint64_t z, double *f) const;
+
+
+  void
+  shells(uint64_t x0, uint64_t n, uint64_t y, uint64_t z, double *f) const;
+
+
+  void
+  noise(uint64_t x0, uint64_t n, uint64_t y, uint64_t z, double *f) const;
+
+
+  void
+  blobs(uint64_t x0, uint64_t n, uint64_t y, uint64_t z, double *f) const;
+
+
+  void
+  slabs(uint64_t x0, uint64_t n, uint64_t y, uint64_t z, double *f) const;
+
+
+  /// \brief Threshold and rescale field values in place.
+  void
+  applyThreshold(double *f, uint64_t n) const;
+
+
+  /// \brief Voxel coordinate scaled by the largest dimension, so features
+  ///        are round in non-cubic volumes.
+  double
+  normalized(uint64_t v) const;
+
+
+  void
+  initNoise();
+
+
+  void
+  initBlobs();
+
+
+  void
+  calibrate(double emptyFraction);
+
+
+  glm::u64vec3 m_dims;
+  SynthPattern m_pattern;
+  uint32_t m_seed;
+  double m_scale;           ///< 1 / largest dimension.
+  glm::dvec3 m_centre;      ///< normalized centre of the volume.
+  double m_blobRadius;      ///< in blob cells.
+  double m_threshold;
+  double m_invRange;        ///< 1 / (1 - m_threshold).
+
+  std::vector<uint8_t> m_perm;          ///< noise lattice hash, 256 twice.
+  std::vector<double> m_latticeValues;  ///< 256 noise lattice values.
+
+  glm::i64vec3 m_blobCells;             ///< blob cells, with a border of one.
+  std::vector<glm::dvec3> m_blobCentres;
+
+}; // class SynthVolume
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+uint64_t
+SynthVolume::fill(uint64_t z0, uint64_t nz, Ty *out) const
+{
+  std::vector<double> row(m_dims.x);
+  uint64_t empty{ 0 };
+  for (uint64_t z = z0; z < z0 + nz; ++z) {
+    for (uint64_t y = 0; y < m_dims.y; ++y) {
+      sampleRow(y, z, row.data());
+      for (double v : row) {
+        empty += v == 0.0 ? 1 : 0;
+        *out++ = toVoxel<Ty>(v);
+      }
+    }
+  }
+  return empty;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+Ty
+SynthVolume::toVoxel(double v)
+{
+  if (std::is_floating_point<Ty>::value) {
+    return static_cast<Ty>(v);
+  }
+  if (v <= 0.0) {
+    return Ty(0);
+  }
+  double const max{ static_cast<double>(std::numeric_limits<Ty>::max()) };
+  return static_cast<Ty>(std::max(1.0, std::round(std::min(v, 1.0) * max)));
+}
+
+} // namespace bd
+
+#endif // ! bd_synthvolume_h__
@@ -13,8 +13,8 @@ namespace bd
 
 namespace
 {
-static const std::array<GLenum, 8> gl_format{
-    GL_RED, GL_R8, GL_R8UI, GL_R16, GL_R32F, GL_RG, GL_RGB, GL_RGBA
+static const std::array<GLenum, 9> gl_format{
+    GL_RED, GL_R8, GL_R8UI, GL_R16, GL_R32F, GL_R16F, GL_RG, GL_RGB, GL_RGBA
 };
 
 static const std::array<GLenum, 3> gl_target{
@@ -45,6 +45,9 @@ pixelType(DataType dt)
     case DataType::UnsignedShort:
       rval = GL_UNSIGNED_SHORT;
       break;
+    case DataType::HalfFloat:
+      rval = GL_HALF_FLOAT;
+      break;
     case DataType::Float:
     case DataType::Unknown:
     default:
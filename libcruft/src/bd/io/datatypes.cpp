@@ -47,6 +47,10 @@ namespace
     { "float64", DataType::Double },
     { "f8", DataType::Double },
 
+    { "half", DataType::HalfFloat },
+    { "float16", DataType::HalfFloat },
+    { "f2", DataType::HalfFloat },
+
     { "unknown", DataType::Unknown }
   };
 } // namespace
@@ -116,6 +120,9 @@ to_sizeType(DataType type)
   case DataType::Double:
     return sizeof(double);
 
+  case DataType::HalfFloat:
+    return sizeof(uint16_t);
+
   case DataType::Unknown:
   default:
     Err() << "Unknown data type, returning size 0 from to_sizeType";
@@ -173,6 +173,42 @@ parseDat(const std::string& datfile, DatFileData& data)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+bool
+writeDat(const std::string& datfile, const DatFileData& data)
+{
+  std::string format;
+  switch (data.dataType) {
+  case DataType::Character:         format = "CHAR"; break;
+  case DataType::UnsignedCharacter: format = "UCHAR"; break;
+  case DataType::Short:             format = "SHORT"; break;
+  case DataType::UnsignedShort:     format = "USHORT"; break;
+  case DataType::Integer:           format = "INT"; break;
+  case DataType::UnsignedInteger:   format = "UINT"; break;
+  case DataType::Float:             format = "FLOAT"; break;
+  case DataType::Double:            format = "DOUBLE"; break;
+  case DataType::HalfFloat:         format = "HALF"; break;
+  default:
+    std::cerr << "Can not write a dat file for an unknown data type." << std::endl;
+    return false;
+  }
+
+  std::ofstream f(datfile);
+  if (!f.is_open()) {
+    std::cerr << "Could not open dat file " << datfile << " for writing." << std::endl;
+    return false;
+  }
+
+  f << "ObjectFileName : " << data.volumeFileName << "\n"
+       "Resolution : " << data.rX << " " << data.rY << " " << data.rZ << "\n"
+       "SliceThickness : 1 1 1\n"
+       "Format : " << format << "\n"
+       "ObjectModel : I\n";
+
+  return static_cast<bool>(f);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 std::ostream&
 operator<<(std::ostream& os, const DatFileData& d)
@@ -3,10 +3,12 @@
 //
 
 #include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/log/logger.h>
 
 #include <glm/glm.hpp>
 #include <nlohmann/json.hpp>
 
+#include <cstring>
 #include <fstream>
 #include <string>
 
@@ -15,28 +17,23 @@ using json = nlohmann::json;
 namespace bd
 {
 void
-from_json(const json &j, FileBlock &b)
-{
-  auto dims = j.at("dims").get<std::vector<double>>();
-  b.world_dims[0] = dims[0];
-  b.world_dims[1] = dims[1];
-  b.world_dims[2] = dims[2];
-  auto origin = j.at("origin").get<std::vector<double>>();
-  b.world_oigin[0] = origin[0];
-  b.world_oigin[1] = origin[1];
-  b.world_oigin[2] = origin[2];
-  auto voxDims = j.at("vox_dims").get<std::vector<uint64_t>>();
-  b.voxel_dims[0] = voxDims[0];
-  b.voxel_dims[1] = voxDims[1];
-  b.voxel_dims[2] = voxDims[2];
-  j.at("index").get_to(b.block_index);
-  auto ijk = j.at("ijk").get<std::vector<uint64_t>>();
-  b.ijk_index[0] = ijk[0];
-  b.ijk_index[1] = ijk[1];
-  b.ijk_index[2] = ijk[2];
-  j.at("offset").get_to(b.data_offset);
-  j.at("data_bytes").get_to(b.data_bytes);
-  j.at("rel").get_to(b.rov);
+to_json(json &j, FileBlock const &b)
+{
+  j = json{
+      { "dims", { b.world_dims[0], b.world_dims[1], b.world_dims[2] }},
+      { "origin", { b.world_oigin[0], b.world_oigin[1], b.world_oigin[2] }},
+      { "vox_dims", { b.voxel_dims[0], b.voxel_dims[1], b.voxel_dims[2] }},
+      { "index", b.block_index },
+      { "ijk", { b.ijk_index[0], b.ijk_index[1], b.ijk_index[2] }},
+      { "offset", b.data_offset },
+      { "data_bytes", b.data_bytes },
+      { "rel", b.rov },
+      { "min", b.min_val },
+      { "max", b.max_val },
+      { "avg", b.avg_val },
+      { "tot", b.total_val },
+      { "empty_voxels", b.empty_voxels }
+  };
 }
 }
 
@@ -49,78 +46,620 @@ namespace v2
 
 namespace
 {
-glm::u64vec3
-toU64Vec3(json const &js, std::string const &key)
+
+/// \brief The keys the parser knows about. Anything else is skipped.
+enum class Key : uint32_t
+{
+  Unknown,
+  // top level
+  DType, TrFunc, VolName, VolPath, Layout, BrickOrder, NumBlocks, Volume,
+  VolStats, Blocks, HistBins,
+  // volume and vol_stats
+  WorldDims, VoxDims, RovMin, RovMax, Min, Max, Avg, Tot, EmptyVoxels,
+  // blocks (also VoxDims, Min, Max, Avg, Tot, EmptyVoxels)
+  Dims, Origin, Index, Ijk, Offset, DataBytes, Rel, Hist
+};
+
+
+struct KeyName
+{
+  KeyName(char const *n, Key k)
+    : name{ n }
+    , size{ std::strlen(n) }
+    , key{ k }
+  {
+  }
+
+  char const *name;
+  size_t size;
+  Key key;
+};
+
+
+KeyName const TOP_KEYS[]{
+    { "dtype", Key::DType }, { "tr_func", Key::TrFunc },
+    { "vol_name", Key::VolName }, { "vol_path", Key::VolPath },
+    { "layout", Key::Layout }, { "brick_order", Key::BrickOrder },
+    { "num_blocks", Key::NumBlocks }, { "volume", Key::Volume },
+    { "vol_stats", Key::VolStats }, { "blocks", Key::Blocks },
+    { "hist_bins", Key::HistBins }
+};
+
+KeyName const VOLUME_KEYS[]{
+    { "world_dims", Key::WorldDims }, { "vox_dims", Key::VoxDims },
+    { "rov_min", Key::RovMin }, { "rov_max", Key::RovMax },
+    { "min", Key::Min }, { "max", Key::Max }, { "avg", Key::Avg },
+    { "tot", Key::Tot }, { "empty_voxels", Key::EmptyVoxels }
+};
+
+KeyName const BLOCK_KEYS[]{
+    { "dims", Key::Dims }, { "origin", Key::Origin },
+    { "vox_dims", Key::VoxDims }, { "index", Key::Index }, { "ijk", Key::Ijk },
+    { "offset", Key::Offset }, { "data_bytes", Key::DataBytes },
+    { "rel", Key::Rel }, { "min", Key::Min }, { "max", Key::Max },
+    { "avg", Key::Avg }, { "tot", Key::Tot },
+    { "empty_voxels", Key::EmptyVoxels }, { "hist", Key::Hist }
+};
+
+
+template<size_t N>
+Key
+lookup(KeyName const (&keys)[N], std::string const &name)
 {
-  auto jsvec = js.at(key).get<std::vector<uint64_t>>();
-  glm::u64vec3 vec{ jsvec[0], jsvec[1], jsvec[2], };
-  return vec;
+  for (KeyName const &k : keys) {
+    if (name.size() == k.size && std::memcmp(name.data(), k.name, k.size) == 0) {
+      return k.key;
+    }
+  }
+  return Key::Unknown;
 }
 
-glm::vec3
-toVec3(json const &js, std::string const &key)
+
+uint64_t
+bit(Key k)
 {
-  auto jsvec = js.at(key).get<std::vector<float>>();
-  glm::vec3 vec{ jsvec[0], jsvec[1], jsvec[2], };
-  return vec;
+  return uint64_t(1) << static_cast<uint32_t>(k);
 }
-} //namespace
+
+
+/// Keys every block must have.
+uint64_t const BLOCK_REQUIRED{
+    bit(Key::Dims) | bit(Key::Origin) | bit(Key::VoxDims) | bit(Key::Index) |
+    bit(Key::Ijk) | bit(Key::Offset) | bit(Key::DataBytes) | bit(Key::Rel) };
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Fills a JsonIndexFile's fields as the index file is parsed,
+///        without building a DOM.
+///
+/// The handler keeps a stack of the open objects and arrays with the
+/// current key (or array position) of each, which is enough to tell where
+/// each value goes. Blocks are appended to \c blocks as they are parsed,
+/// and their histograms (if they have them) to \c histograms.
+///////////////////////////////////////////////////////////////////////////////
+class IndexSaxHandler : public json::json_sax_t
+{
+public:
+  IndexSaxHandler(std::istream &is, uint64_t fileBytes,
+                  std::vector<bd::FileBlock> &blocks)
+    : m_is{ is }
+    , m_fileBytes{ fileBytes }
+    , m_blocks{ blocks }
+    , m_frames()
+    , m_seen{ 0 }
+    , m_blockSeen{ 0 }
+    , m_blockHist{ 0 }
+    , m_histBins{ 0 }
+    , m_histBinsKey{ 0 }
+    , m_firstBlockStart{ -1 }
+    , m_reserved{ false }
+    , m_numBlocks{ 0 }
+    , m_voxDims{ 0 }
+    , m_worldDims{ 0.0f }
+    , m_error()
+  {
+  }
+
+
+  bool
+  null() override
+  {
+    return scalar(0.0, 0);
+  }
+
+
+  bool
+  boolean(bool val) override
+  {
+    return scalar(val ? 1.0 : 0.0, val ? 1 : 0);
+  }
+
+
+  bool
+  number_integer(number_integer_t val) override
+  {
+    return scalar(static_cast<double>(val),
+                  val < 0 ? 0 : static_cast<uint64_t>(val));
+  }
+
+
+  bool
+  number_unsigned(number_unsigned_t val) override
+  {
+    return scalar(static_cast<double>(val), val);
+  }
+
+
+  bool
+  number_float(number_float_t val, string_t const &) override
+  {
+    return scalar(val, val < 0 ? 0 : static_cast<uint64_t>(val));
+  }
+
+
+  bool
+  string(string_t &val) override
+  {
+    if (m_frames.size() == 1) {
+      Key const k{ m_frames[0].key };
+      std::string *dest{ nullptr };
+      switch (k) {
+        case Key::DType: dest = &dataType; break;
+        case Key::TrFunc: dest = &tffname; break;
+        case Key::VolName: dest = &fname; break;
+        case Key::VolPath: dest = &fpath; break;
+        case Key::Layout: dest = &layout; break;
+        case Key::BrickOrder: dest = &brickOrder; break;
+        default: break;
+      }
+      if (dest) {
+        *dest = std::move(val);
+        m_seen |= bit(k);
+      }
+    }
+    next();
+    return true;
+  }
+
+
+  bool
+  start_object(std::size_t) override
+  {
+    if (inBlocksArray()) {
+      if (m_blocks.empty()) {
+        m_firstBlockStart = m_is.tellg();
+      }
+      m_blocks.emplace_back();
+      m_blockSeen = 0;
+      m_blockHist = 0;
+    }
+    m_frames.push_back({ Key::Unknown, 0, false });
+    return true;
+  }
+
+
+  bool
+  key(string_t &val) override
+  {
+    Frame &f = m_frames.back();
+    switch (m_frames.size()) {
+      case 1:
+        f.key = lookup(TOP_KEYS, val);
+        break;
+      case 2:
+        f.key = m_frames[0].key == Key::Volume || m_frames[0].key == Key::VolStats
+                ? lookup(VOLUME_KEYS, val) : Key::Unknown;
+        break;
+      case 3:
+        f.key = inBlock() ? lookup(BLOCK_KEYS, val) : Key::Unknown;
+        break;
+      default:
+        f.key = Key::Unknown;
+        break;
+    }
+    return true;
+  }
+
+
+  bool
+  end_object() override
+  {
+    m_frames.pop_back();
+    if (inBlocksArray()) {
+      if (!finishBlock()) {
+        return false;
+      }
+    }
+    next();
+    return true;
+  }
+
+
+  bool
+  start_array(std::size_t) override
+  {
+    if (m_frames.size() == 1 && m_frames[0].key == Key::Blocks &&
+        m_numBlocks.x * m_numBlocks.y * m_numBlocks.z > 0) {
+      m_blocks.reserve(m_numBlocks.x * m_numBlocks.y * m_numBlocks.z);
+      m_reserved = true;
+    }
+    m_frames.push_back({ Key::Unknown, 0, true });
+    return true;
+  }
+
+
+  bool
+  end_array() override
+  {
+    m_frames.pop_back();
+    next();
+    return true;
+  }
+
+
+  bool
+  parse_error(std::size_t, std::string const &,
+              nlohmann::detail::exception const &ex) override
+  {
+    m_error = ex.what();
+    return false;
+  }
+
+
+  /// \brief Check that everything open() needs was in the file.
+  bool
+  finish()
+  {
+    for (Key k : { Key::DType, Key::TrFunc, Key::VolName, Key::VolPath,
+                   Key::NumBlocks, Key::VoxDims, Key::WorldDims, Key::Min,
+                   Key::Max, Key::Avg, Key::Tot, Key::Blocks }) {
+      if (!( m_seen & bit(k) )) {
+        m_error = std::string("missing key: ") + name(k);
+        return false;
+      }
+    }
+    if (( m_seen & bit(Key::HistBins) ) && m_histBinsKey != m_histBins) {
+      m_error = "hist_bins is " + std::to_string(m_histBinsKey) +
+                " but the blocks have " + std::to_string(m_histBins) +
+                " histogram bins";
+      return false;
+    }
+    return true;
+  }
+
+
+  std::string const &
+  error() const
+  {
+    return m_error;
+  }
+
+
+  glm::u64vec3 const &
+  numBlocks() const
+  {
+    return m_numBlocks;
+  }
+
+
+  glm::u64vec3 const &
+  voxDims() const
+  {
+    return m_voxDims;
+  }
+
+
+  glm::vec3 const &
+  worldDims() const
+  {
+    return m_worldDims;
+  }
+
+
+  uint32_t
+  histBins() const
+  {
+    return m_histBins;
+  }
+
+
+  std::string dataType;
+  std::string tffname;
+  std::string fname;
+  std::string fpath;
+  std::string layout;
+  std::string brickOrder;
+  Volume volume;  ///< only the stats and rov range are filled in.
+  std::vector<uint32_t> histograms;
+
+private:
+
+  struct Frame
+  {
+    Key key;         ///< current key, if an object.
+    uint64_t index;  ///< current element, if an array.
+    bool array;
+  };
+
+
+  /// \brief The top of the stack is the blocks array.
+  bool
+  inBlocksArray() const
+  {
+    return m_frames.size() == 2 && m_frames[0].key == Key::Blocks &&
+           m_frames[1].array;
+  }
+
+
+  /// \brief The top of the stack is a block object.
+  bool
+  inBlock() const
+  {
+    return m_frames.size() == 3 && m_frames[0].key == Key::Blocks &&
+           m_frames[1].array && !m_frames[2].array;
+  }
+
+
+  /// \brief Move to the next element if the top of the stack is an array.
+  void
+  next()
+  {
+    if (!m_frames.empty() && m_frames.back().array) {
+      m_frames.back().index += 1;
+    }
+  }
+
+
+  bool
+  scalar(double d, uint64_t u)
+  {
+    size_t const n{ m_frames.size() };
+    if (n >= 3 && m_frames[0].key == Key::Blocks && m_frames[1].array &&
+        !m_frames[2].array) {
+      blockScalar(d, u);
+    } else if (n == 1 && m_frames[0].key == Key::HistBins) {
+      m_histBinsKey = u;
+      m_seen |= bit(Key::HistBins);
+    } else if (n == 2 && m_frames[0].key == Key::NumBlocks) {
+      set3(m_numBlocks, u, Key::NumBlocks);
+    } else if (n == 2 && !m_frames[1].array) {
+      volumeScalar(m_frames[1].key, d, u);
+    } else if (n == 3 && m_frames[0].key == Key::Volume) {
+      if (m_frames[1].key == Key::VoxDims) {
+        set3(m_voxDims, u, Key::VoxDims);
+      } else if (m_frames[1].key == Key::WorldDims) {
+        set3(m_worldDims, static_cast<float>(d), Key::WorldDims);
+      }
+    }
+    next();
+    return true;
+  }
+
+
+  template<class V, class T>
+  void
+  set3(V &v, T val, Key k)
+  {
+    uint64_t const i{ m_frames.back().index };
+    if (i < 3) {
+      v[i] = val;
+      m_seen |= bit(k);
+    }
+  }
+
+
+  void
+  volumeScalar(Key k, double d, uint64_t u)
+  {
+    if (m_frames[0].key == Key::Volume) {
+      switch (k) {
+        case Key::RovMin: volume.rovMin(d); break;
+        case Key::RovMax: volume.rovMax(d); break;
+        default: return;
+      }
+    } else if (m_frames[0].key == Key::VolStats) {
+      switch (k) {
+        case Key::Min: volume.min(d); break;
+        case Key::Max: volume.max(d); break;
+        case Key::Avg: volume.avg(d); break;
+        case Key::Tot: volume.total(d); break;
+        case Key::EmptyVoxels: volume.numEmptyVoxels(u); break;
+        default: return;
+      }
+    } else {
+      return;
+    }
+    m_seen |= bit(k);
+  }
+
+
+  void
+  blockScalar(double d, uint64_t u)
+  {
+    bd::FileBlock &b = m_blocks.back();
+    Key const k{ m_frames[2].key };
+    if (m_frames.size() == 3) {
+      switch (k) {
+        case Key::Index: b.block_index = u; break;
+        case Key::Offset: b.data_offset = u; break;
+        case Key::DataBytes: b.data_bytes = u; break;
+        case Key::Rel: b.rov = d; break;
+        case Key::Min: b.min_val = d; break;
+        case Key::Max: b.max_val = d; break;
+        case Key::Avg: b.avg_val = d; break;
+        case Key::Tot: b.total_val = d; break;
+        case Key::EmptyVoxels: b.empty_voxels = u; break;
+        default: return;
+      }
+    } else if (m_frames.size() == 4 && m_frames[3].array && k == Key::Hist) {
+      histograms.push_back(static_cast<uint32_t>(u));
+      m_blockHist += 1;
+    } else if (m_frames.size() == 4 && m_frames[3].array && m_frames[3].index < 3) {
+      uint64_t const i{ m_frames[3].index };
+      switch (k) {
+        case Key::Dims: b.world_dims[i] = d; break;
+        case Key::Origin: b.world_oigin[i] = d; break;
+        case Key::VoxDims: b.voxel_dims[i] = u; break;
+        case Key::Ijk: b.ijk_index[i] = u; break;
+        default: return;
+      }
+    } else {
+      return;
+    }
+    m_blockSeen |= bit(k);
+  }
+
+
+  /// \brief Check the block just parsed, and once the first block is done
+  ///        reserve room for the rest (if num_blocks was not seen yet).
+  bool
+  finishBlock()
+  {
+    if (( m_blockSeen & BLOCK_REQUIRED ) != BLOCK_REQUIRED) {
+      for (KeyName const &k : BLOCK_KEYS) {
+        if (( BLOCK_REQUIRED & bit(k.key) ) && !( m_blockSeen & bit(k.key) )) {
+          m_error = "block " + std::to_string(m_blocks.size() - 1) +
+                    " is missing key: " + k.name;
+          break;
+        }
+      }
+      return false;
+    }
+
+    // The first block decides the number of bins, every block after it
+    // must have the same number.
+    if (m_blocks.size() == 1) {
+      m_histBins = m_blockHist;
+    }
+    if (m_blockHist != m_histBins) {
+      m_error = "block " + std::to_string(m_blocks.size() - 1) + " has " +
+                std::to_string(m_blockHist) + " histogram bins, expected " +
+                std::to_string(m_histBins);
+      return false;
+    }
+
+    bd::FileBlock &b = m_blocks.back();
+    if (m_blockSeen & bit(Key::EmptyVoxels)) {
+      b.is_empty = b.empty_voxels ==
+          b.voxel_dims[0] * b.voxel_dims[1] * b.voxel_dims[2] ? 1 : 0;
+    }
+
+    if (m_blocks.size() == 1 && !m_reserved && m_firstBlockStart >= 0) {
+      // num_blocks comes after blocks in files written by write(), so
+      // estimate the count from the size of the first block. Its numbers
+      // are the shortest (its indexes and offset are 0), so this errs high.
+      std::streamoff const end{ m_is.tellg() };
+      if (end > m_firstBlockStart) {
+        m_blocks.reserve(1 + ( m_fileBytes - end ) / ( end - m_firstBlockStart ));
+      }
+    }
+    if (m_blocks.size() == 1 && m_histBins > 0) {
+      histograms.reserve(m_blocks.capacity() * m_histBins);
+    }
+    m_seen |= bit(Key::Blocks);
+    return true;
+  }
+
+
+  static char const *
+  name(Key k)
+  {
+    for (KeyName const &n : TOP_KEYS) {
+      if (n.key == k) {
+        return n.name;
+      }
+    }
+    for (KeyName const &n : VOLUME_KEYS) {
+      if (n.key == k) {
+        return n.name;
+      }
+    }
+    return "?";
+  }
+
+
+  std::istream &m_is;
+  uint64_t m_fileBytes;
+  std::vector<bd::FileBlock> &m_blocks;
+  std::vector<Frame> m_frames;
+  uint64_t m_seen;       ///< bit(Key) of keys outside of the blocks seen so far.
+  uint64_t m_blockSeen;  ///< bit(Key) of the keys seen in the current block.
+  uint64_t m_blockHist;  ///< histogram bins seen in the current block.
+  uint64_t m_histBins;   ///< histogram bins of the first block.
+  uint64_t m_histBinsKey;
+  std::streamoff m_firstBlockStart;
+  bool m_reserved;       ///< blocks was reserved from num_blocks.
+  glm::u64vec3 m_numBlocks;
+  glm::u64vec3 m_voxDims;
+  glm::vec3 m_worldDims;
+  std::string m_error;
+
+}; // class IndexSaxHandler
+
+} // namespace
+
 
 bool
 JsonIndexFile::open(std::string const &fname)
 {
-  std::fstream f;
-  f.open(fname, std::fstream::in);
+  std::ifstream f;
+  f.open(fname, std::ios::in | std::ios::binary | std::ios::ate);
   if (!f.is_open()) {
     bd::Err() << "Could not open: " << fname;
     return false;
   }
-  json js;
-  f >> js;
-  f.close();
+  uint64_t const fileBytes{ static_cast<uint64_t>(f.tellg()) };
+  f.seekg(0);
 
-  m_dataType = js.at("dtype").get<std::string>();
-  m_tffname = js.at("tr_func").get<std::string>();
-  m_fname = js.at("vol_name").get<std::string>();
-  m_fpath = js.at("vol_path").get<std::string>();
+  // Parse straight into the blocks, the file is never held as a DOM.
+  std::vector<bd::FileBlock> blocks;
+  IndexSaxHandler handler{ f, fileBytes, blocks };
+  if (!json::sax_parse(f, &handler) || !handler.finish()) {
+    bd::Err() << "Could not read index file " << fname << ": " << handler.error();
+    return false;
+  }
 
-  auto jsVol = js.at("volume");
-  auto jsStats = js.at("vol_stats");
+  m_dataType = std::move(handler.dataType);
+  m_tffname = std::move(handler.tffname);
+  m_fname = std::move(handler.fname);
+  m_fpath = std::move(handler.fpath);
 
-  Volume v;
-  v.avg(jsStats.at("avg").get<double>());
-  v.min(jsStats.at("min").get<double>());
-  v.max(jsStats.at("max").get<double>());
-  v.total(jsStats.at("tot").get<double>());
-  v.block_count(toU64Vec3(js, "num_blocks"));
-  v.voxelDims(toU64Vec3(jsVol, "vox_dims"));
-  v.worldDims(toVec3(jsVol, "world_dims"));
+  // Written by the brick tool, older index files are always row-major.
+  m_brickOrder.clear();
+  if (handler.layout == "bricks") {
+    m_brickOrder = std::move(handler.brickOrder);
+  }
 
-  auto blocks = js.at("blocks").get<std::vector<bd::FileBlock>>();
+  Volume v{ handler.volume };
+  v.block_count(handler.numBlocks());
+  v.voxelDims(handler.voxDims());
+  v.worldDims(handler.worldDims());
 
   m_volume = v;
-  m_blocks = blocks;
+  m_blocks = std::move(blocks);
+  m_histBins = handler.histBins();
+  m_histograms = std::move(handler.histograms);
 
   return true;
 }
 
 
 std::string const &
-JsonIndexFile::getRawFileName()
+JsonIndexFile::getRawFileName() const
 {
   return m_fname;
 }
 
 
 std::string const &
-JsonIndexFile::getRawFilePath()
+JsonIndexFile::getRawFilePath() const
 {
   return m_fpath;
 }
 
 
 std::string const &
-JsonIndexFile::getTFFileName()
+JsonIndexFile::getTFFileName() const
 {
   return m_tffname;
 }
@@ -146,6 +685,168 @@ JsonIndexFile::getVolume() const
   return m_volume;
 }
 
+
+bool
+JsonIndexFile::isBricked() const
+{
+  return !m_brickOrder.empty();
+}
+
+
+std::string const &
+JsonIndexFile::getBrickOrder() const
+{
+  return m_brickOrder;
+}
+
+
+uint32_t
+JsonIndexFile::getHistogramBins() const
+{
+  return m_histBins;
+}
+
+
+std::vector<uint32_t> const &
+JsonIndexFile::getHistograms() const
+{
+  return m_histograms;
+}
+
+
+bool
+JsonIndexFile::write(std::string const &fname) const
+{
+  if (m_histograms.size() != m_blocks.size() * m_histBins) {
+    bd::Err() << "Expected " << m_histBins << " histogram bins for each of "
+              << m_blocks.size() << " blocks, but have " << m_histograms.size()
+              << " bins.";
+    return false;
+  }
+
+  glm::u64vec3 const nb{ m_volume.block_count() };
+  glm::u64vec3 const ext{ m_volume.blocksExtent() };
+  glm::u64vec3 const vd{ m_volume.voxelDims() };
+  glm::vec3 const wd{ m_volume.worldDims() };
+
+  json js;
+  js["version"] = 2;
+  js["vol_name"] = m_fname;
+  js["vol_path"] = m_fpath;
+  js["tr_func"] = m_tffname;
+  js["dtype"] = m_dataType;
+  js["layout"] = isBricked() ? "bricks" : "rows";
+  if (isBricked()) {
+    js["brick_order"] = m_brickOrder;
+  }
+  js["num_blocks"] = { nb.x, nb.y, nb.z };
+  js["blocks_extent"] = { ext.x, ext.y, ext.z };
+  js["volume"] = {
+      { "world_dims", { wd.x, wd.y, wd.z }},
+      { "vox_dims", { vd.x, vd.y, vd.z }},
+      { "rov_min", m_volume.rovMin() },
+      { "rov_max", m_volume.rovMax() }
+  };
+  js["vol_stats"] = {
+      { "min", m_volume.min() },
+      { "max", m_volume.max() },
+      { "avg", m_volume.avg() },
+      { "tot", m_volume.total() },
+      { "empty_voxels", m_volume.numEmptyVoxels() }
+  };
+  js["blocks"] = m_blocks;
+  if (m_histBins > 0) {
+    js["hist_bins"] = m_histBins;
+    for (size_t i = 0; i < m_blocks.size(); ++i) {
+      auto first = m_histograms.begin() + i * m_histBins;
+      js["blocks"][i]["hist"] = std::vector<uint32_t>(first, first + m_histBins);
+    }
+  }
+
+  std::ofstream f;
+  f.open(fname, std::ofstream::out);
+  if (!f.is_open()) {
+    bd::Err() << "Could not open: " << fname;
+    return false;
+  }
+  f << js.dump(2);
+  f.close();
+
+  return true;
+}
+
+
+void
+JsonIndexFile::setRawFileName(std::string const &name)
+{
+  m_fname = name;
+}
+
+
+void
+JsonIndexFile::setRawFilePath(std::string const &path)
+{
+  m_fpath = path;
+}
+
+
+void
+JsonIndexFile::setTFFileName(std::string const &name)
+{
+  m_tffname = name;
+}
+
+
+void
+JsonIndexFile::setDatType(bd::DataType type)
+{
+  m_dataType = bd::to_string(type);
+}
+
+
+void
+JsonIndexFile::setFileBlocks(std::vector<bd::FileBlock> const &blocks)
+{
+  m_blocks = blocks;
+}
+
+
+void
+JsonIndexFile::setFileBlocks(std::vector<bd::FileBlock> &&blocks)
+{
+  m_blocks = std::move(blocks);
+}
+
+
+void
+JsonIndexFile::setHistograms(uint32_t bins, std::vector<uint32_t> const &histograms)
+{
+  m_histBins = bins;
+  m_histograms = histograms;
+}
+
+
+void
+JsonIndexFile::setHistograms(uint32_t bins, std::vector<uint32_t> &&histograms)
+{
+  m_histBins = bins;
+  m_histograms = std::move(histograms);
+}
+
+
+void
+JsonIndexFile::setVolume(bd::Volume const &volume)
+{
+  m_volume = volume;
+}
+
+
+void
+JsonIndexFile::setBrickOrder(std::string const &order)
+{
+  m_brickOrder = order;
+}
+
 }
 }
 }
\ No newline at end of file
@@ -0,0 +1,706 @@
+//
+// Created by jim on 3/14/19.
+//
+
+#include <bd/io/indexfile/v3/binaryindexfile.h>
+#include <bd/log/logger.h>
+
+#include <glm/glm.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace bd { namespace indexfile { namespace v3 {
+
+namespace
+{
+
+uint32_t const NUM_STRINGS{ 5 };
+
+
+/// \brief The element size and count section \c s must have in an index of
+///        \c numBlocks blocks. The Strings section can have any count, and
+///        the Histogram section any element size (elemBytes is 0 for it).
+void
+expectedShape(Section s, uint64_t numBlocks, uint32_t &elemBytes, uint64_t &count)
+{
+  switch (s) {
+    case Section::Volume:
+      elemBytes = sizeof(VolumeSection);
+      count = 1;
+      break;
+    case Section::Strings:
+      elemBytes = 1;
+      count = 0;
+      break;
+    case Section::Rov:
+    case Section::Avg:
+    case Section::Min:
+    case Section::Max:
+    case Section::Total:
+      elemBytes = sizeof(double);
+      count = numBlocks;
+      break;
+    case Section::EmptyVoxels:
+    case Section::DataOffset:
+    case Section::DataBytes:
+      elemBytes = sizeof(uint64_t);
+      count = numBlocks;
+      break;
+    case Section::Ijk:
+    case Section::VoxelDims:
+      elemBytes = sizeof(uint64_t);
+      count = 3 * numBlocks;
+      break;
+    case Section::WorldDims:
+    case Section::Origin:
+      elemBytes = sizeof(double);
+      count = 3 * numBlocks;
+      break;
+    case Section::Histogram:
+      elemBytes = 0;
+      count = numBlocks;
+      break;
+    default:
+      elemBytes = 0;
+      count = 0;
+      break;
+  }
+}
+
+
+uint64_t
+alignUp(uint64_t offset)
+{
+  return ( offset + SECTION_ALIGN - 1 ) / SECTION_ALIGN * SECTION_ALIGN;
+}
+
+
+/// \brief Write one value per block, \c fn(block) gives the value.
+template<class T, class Fn>
+void
+writeColumn(std::ostream &os, std::vector<FileBlock> const &blocks, Fn fn)
+{
+  std::vector<T> col;
+  col.reserve(blocks.size());
+  for (FileBlock const &b : blocks) {
+    col.push_back(fn(b));
+  }
+  os.write(reinterpret_cast<char const *>(col.data()), col.size() * sizeof(T));
+}
+
+
+/// \brief Write three values per block, \c fn(block) gives the array.
+template<class T, class Fn>
+void
+writeColumn3(std::ostream &os, std::vector<FileBlock> const &blocks, Fn fn)
+{
+  std::vector<T> col;
+  col.reserve(3 * blocks.size());
+  for (FileBlock const &b : blocks) {
+    T const *v{ fn(b) };
+    col.insert(col.end(), v, v + 3);
+  }
+  os.write(reinterpret_cast<char const *>(col.data()), col.size() * sizeof(T));
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+BinaryIndexFile::BinaryIndexFile()
+  : m_file{ }
+  , m_numBlocks{ 0 }
+  , m_sections{ }
+  , m_volume{ }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+BinaryIndexFile::~BinaryIndexFile()
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BinaryIndexFile::isBinaryIndexFile(std::string const &fname)
+{
+  std::ifstream is{ fname, std::ios::binary };
+  char magic[sizeof(MAGIC)];
+  if (!is.read(magic, sizeof(magic))) {
+    return false;
+  }
+  return std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BinaryIndexFile::write(std::string const &fname, v2::JsonIndexFile const &index)
+{
+  std::vector<FileBlock> const &blocks{ index.getFileBlocks() };
+  uint64_t const numBlocks{ blocks.size() };
+  uint32_t const histBins{ index.getHistogramBins() };
+  if (index.getHistograms().size() != numBlocks * histBins) {
+    Err() << "Expected " << histBins << " histogram bins for each of "
+          << numBlocks << " blocks, but have " << index.getHistograms().size();
+    return false;
+  }
+  for (uint64_t i = 0; i < numBlocks; ++i) {
+    if (blocks[i].block_index != i) {
+      // block_index is not stored, it is the position in the columns.
+      Err() << "Blocks are not in block index order (block " << i
+            << " has index " << blocks[i].block_index << ")";
+      return false;
+    }
+  }
+
+  Volume const &vol{ index.getVolume() };
+  VolumeSection vs;
+  std::memset(&vs, 0, sizeof(vs));
+  for (int i = 0; i < 3; ++i) {
+    vs.block_count[i] = vol.block_count()[i];
+    vs.voxel_dims[i] = vol.voxelDims()[i];
+    vs.world_dims[i] = vol.worldDims()[i];
+  }
+  vs.empty_voxels = vol.numEmptyVoxels();
+  vs.min = vol.min();
+  vs.max = vol.max();
+  vs.avg = vol.avg();
+  vs.total = vol.total();
+  vs.rov_min = vol.rovMin();
+  vs.rov_max = vol.rovMax();
+
+  std::string strings;
+  for (std::string const &s : { index.getRawFileName(), index.getRawFilePath(),
+                                index.getTFFileName(),
+                                bd::to_string(index.getDatType()),
+                                index.getBrickOrder() }) {
+    strings += s;
+    strings += '\0';
+  }
+
+  // Lay out the sections in Section order after the table. Histogram is
+  // the last section and is left out if there are no histograms.
+  uint32_t const numSections{ static_cast<uint32_t>(Section::Count) -
+                              ( histBins > 0 ? 1 : 2 ) };
+  std::vector<SectionEntry> table(numSections);
+  uint64_t offset{ sizeof(FileHeader) + numSections * sizeof(SectionEntry) };
+  for (uint32_t i = 0; i < numSections; ++i) {
+    SectionEntry &e = table[i];
+    e.id = i + 1;
+    expectedShape(static_cast<Section>(e.id), numBlocks, e.elem_bytes, e.count);
+    if (e.id == static_cast<uint32_t>(Section::Strings)) {
+      e.count = strings.size();
+    } else if (e.id == static_cast<uint32_t>(Section::Histogram)) {
+      e.elem_bytes = histBins * sizeof(uint32_t);
+    }
+    offset = alignUp(offset);
+    e.offset = offset;
+    offset += e.elem_bytes * e.count;
+  }
+
+  std::ofstream os{ fname, std::ios::binary };
+  if (!os.is_open()) {
+    Err() << "Could not open: " << fname;
+    return false;
+  }
+
+  FileHeader h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.endian = ENDIAN_TAG;
+  h.version = VERSION;
+  h.header_bytes = sizeof(FileHeader);
+  h.num_sections = numSections;
+  h.num_blocks = numBlocks;
+  os.write(reinterpret_cast<char const *>(&h), sizeof(h));
+  os.write(reinterpret_cast<char const *>(table.data()),
+           table.size() * sizeof(SectionEntry));
+
+  char const zeros[SECTION_ALIGN]{ };
+  for (SectionEntry const &e : table) {
+    os.write(zeros, e.offset - static_cast<uint64_t>(os.tellp()));
+
+    switch (static_cast<Section>(e.id)) {
+      case Section::Volume:
+        os.write(reinterpret_cast<char const *>(&vs), sizeof(vs));
+        break;
+      case Section::Strings:
+        os.write(strings.data(), strings.size());
+        break;
+      case Section::Rov:
+        writeColumn<double>(os, blocks, [](FileBlock const &b) { return b.rov; });
+        break;
+      case Section::Avg:
+        writeColumn<double>(os, blocks, [](FileBlock const &b) { return b.avg_val; });
+        break;
+      case Section::Min:
+        writeColumn<double>(os, blocks, [](FileBlock const &b) { return b.min_val; });
+        break;
+      case Section::Max:
+        writeColumn<double>(os, blocks, [](FileBlock const &b) { return b.max_val; });
+        break;
+      case Section::Total:
+        writeColumn<double>(os, blocks, [](FileBlock const &b) { return b.total_val; });
+        break;
+      case Section::EmptyVoxels:
+        writeColumn<uint64_t>(os, blocks,
+                              [](FileBlock const &b) { return b.empty_voxels; });
+        break;
+      case Section::DataOffset:
+        writeColumn<uint64_t>(os, blocks,
+                              [](FileBlock const &b) { return b.data_offset; });
+        break;
+      case Section::DataBytes:
+        writeColumn<uint64_t>(os, blocks,
+                              [](FileBlock const &b) { return b.data_bytes; });
+        break;
+      case Section::Ijk:
+        writeColumn3<uint64_t>(os, blocks,
+                               [](FileBlock const &b) { return b.ijk_index; });
+        break;
+      case Section::VoxelDims:
+        writeColumn3<uint64_t>(os, blocks,
+                               [](FileBlock const &b) { return b.voxel_dims; });
+        break;
+      case Section::WorldDims:
+        writeColumn3<double>(os, blocks,
+                             [](FileBlock const &b) { return b.world_dims; });
+        break;
+      case Section::Origin:
+        writeColumn3<double>(os, blocks,
+                             [](FileBlock const &b) { return b.world_oigin; });
+        break;
+      case Section::Histogram:
+        os.write(reinterpret_cast<char const *>(index.getHistograms().data()),
+                 index.getHistograms().size() * sizeof(uint32_t));
+        break;
+      default:
+        break;
+    }
+  }
+
+  if (!os) {
+    Err() << "Error writing: " << fname;
+    return false;
+  }
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BinaryIndexFile::open(std::string const &fname)
+{
+  close();
+
+  if (!m_file.open(fname)) {
+    return false;
+  }
+
+  if (m_file.size() < sizeof(FileHeader)) {
+    Err() << fname << " is too small to be an index file.";
+    close();
+    return false;
+  }
+
+  FileHeader const *h{ reinterpret_cast<FileHeader const *>(m_file.data()) };
+  if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0) {
+    Err() << fname << " is not a binary index file.";
+    close();
+    return false;
+  }
+  if (h->endian != ENDIAN_TAG) {
+    Err() << fname << " was written on a machine with a different byte order.";
+    close();
+    return false;
+  }
+  if (h->version != VERSION) {
+    Err() << fname << " is index file version " << h->version
+          << ", expected version " << VERSION;
+    close();
+    return false;
+  }
+  if (h->num_blocks > UINT64_MAX / 3) {
+    // the xyz columns hold 3 * num_blocks elements.
+    Err() << fname << " has a bad block count.";
+    close();
+    return false;
+  }
+  m_numBlocks = h->num_blocks;
+
+  if (!readSectionTable(fname) || !readMetadata(fname)) {
+    close();
+    return false;
+  }
+
+  Dbg() << "Opened " << fname << " with " << m_numBlocks << " blocks.";
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BinaryIndexFile::close()
+{
+  m_file.close();
+  m_numBlocks = 0;
+  for (SectionEntry const *&s : m_sections) {
+    s = nullptr;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BinaryIndexFile::readSectionTable(std::string const &fname)
+{
+  FileHeader const *h{ reinterpret_cast<FileHeader const *>(m_file.data()) };
+  uint64_t const size{ m_file.size() };
+
+  if (h->header_bytes < sizeof(FileHeader) || h->header_bytes > size ||
+      h->header_bytes % alignof(SectionEntry) != 0 ||
+      h->num_sections > ( size - h->header_bytes ) / sizeof(SectionEntry)) {
+    Err() << fname << " has a bad section table.";
+    return false;
+  }
+
+  SectionEntry const *table{
+      reinterpret_cast<SectionEntry const *>(m_file.data() + h->header_bytes) };
+
+  for (uint32_t i = 0; i < h->num_sections; ++i) {
+    SectionEntry const &e = table[i];
+    if (e.id == 0 || e.id >= static_cast<uint32_t>(Section::Count)) {
+      // from a newer writer.
+      continue;
+    }
+
+    uint32_t elemBytes;
+    uint64_t count;
+    expectedShape(static_cast<Section>(e.id), m_numBlocks, elemBytes, count);
+    if (e.id == static_cast<uint32_t>(Section::Strings)) {
+      count = e.count;
+    } else if (e.id == static_cast<uint32_t>(Section::Histogram)) {
+      elemBytes = e.elem_bytes % sizeof(uint32_t) == 0 ? e.elem_bytes : 0;
+    }
+
+    if (elemBytes == 0 || e.elem_bytes != elemBytes || e.count != count ||
+        e.offset % SECTION_ALIGN != 0 || e.offset > size ||
+        count > ( size - e.offset ) / elemBytes) {
+      Err() << fname << ": section " << e.id << " is the wrong size or out of bounds.";
+      return false;
+    }
+    if (m_sections[e.id]) {
+      Err() << fname << ": section " << e.id << " appears more than once.";
+      return false;
+    }
+    m_sections[e.id] = &e;
+  }
+
+  for (uint32_t id = 1; id < static_cast<uint32_t>(Section::Count); ++id) {
+    if (!m_sections[id] && id != static_cast<uint32_t>(Section::Histogram)) {
+      Err() << fname << " is missing section " << id;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BinaryIndexFile::readMetadata(std::string const &fname)
+{
+  VolumeSection const &vs{ *column<VolumeSection>(Section::Volume) };
+  Volume v;
+  v.avg(vs.avg);
+  v.min(vs.min);
+  v.max(vs.max);
+  v.total(vs.total);
+  v.block_count({ vs.block_count[0], vs.block_count[1], vs.block_count[2] });
+  v.voxelDims({ vs.voxel_dims[0], vs.voxel_dims[1], vs.voxel_dims[2] });
+  v.worldDims(glm::f32vec3(vs.world_dims[0], vs.world_dims[1], vs.world_dims[2]));
+  v.rovMin(vs.rov_min);
+  v.rovMax(vs.rov_max);
+  v.numEmptyVoxels(vs.empty_voxels);
+
+  if (v.total_block_count() != m_numBlocks) {
+    Err() << fname << " has " << m_numBlocks << " blocks, but its volume has "
+          << v.total_block_count();
+    return false;
+  }
+  m_volume = v;
+
+  char const *s{ column<char>(Section::Strings) };
+  char const *end{ s + m_sections[static_cast<uint32_t>(Section::Strings)]->count };
+  std::string *dest[NUM_STRINGS]{ &m_fname, &m_fpath, &m_tffname, &m_dataType,
+                                  &m_brickOrder };
+  for (std::string *d : dest) {
+    char const *nul{ static_cast<char const *>(std::memchr(s, '\0', end - s)) };
+    if (!nul) {
+      Err() << fname << " has a truncated strings section.";
+      return false;
+    }
+    d->assign(s, nul);
+    s = nul + 1;
+  }
+
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BinaryIndexFile::copyTo(v2::JsonIndexFile &index) const
+{
+  std::vector<FileBlock> blocks(m_numBlocks);
+  for (uint64_t i = 0; i < m_numBlocks; ++i) {
+    fillFileBlock(i, blocks[i]);
+  }
+
+  copyHeaderTo(index);
+  index.setFileBlocks(std::move(blocks));
+
+  uint32_t const *hist{ getHistograms() };
+  uint32_t const bins{ getHistogramBins() };
+  index.setHistograms(bins, hist ? std::vector<uint32_t>(hist, hist + m_numBlocks * bins)
+                                 : std::vector<uint32_t>());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BinaryIndexFile::copyHeaderTo(v2::JsonIndexFile &index) const
+{
+  index.setVolume(m_volume);
+  index.setRawFileName(m_fname);
+  index.setRawFilePath(m_fpath);
+  index.setTFFileName(m_tffname);
+  index.setDatType(getDatType());
+  index.setBrickOrder(m_brickOrder);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bd::FileBlock
+BinaryIndexFile::getFileBlock(uint64_t i) const
+{
+  FileBlock b;
+  fillFileBlock(i, b);
+  return b;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BinaryIndexFile::fillFileBlock(uint64_t i, FileBlock &b) const
+{
+  uint64_t const *ijk{ getIjk() + 3 * i };
+  uint64_t const *vd{ getVoxelDims() + 3 * i };
+  double const *wd{ getWorldDims() + 3 * i };
+  double const *o{ getOrigins() + 3 * i };
+
+  b.block_index = i;
+  for (int c = 0; c < 3; ++c) {
+    b.ijk_index[c] = ijk[c];
+    b.voxel_dims[c] = vd[c];
+    b.world_dims[c] = wd[c];
+    b.world_oigin[c] = o[c];
+  }
+  b.data_offset = getDataOffsets()[i];
+  b.data_bytes = getDataBytes()[i];
+  b.min_val = getMin()[i];
+  b.max_val = getMax()[i];
+  b.avg_val = getAvg()[i];
+  b.total_val = getTotal()[i];
+  b.rov = getRov()[i];
+  b.empty_voxels = getEmptyVoxels()[i];
+  b.is_empty = b.empty_voxels == vd[0] * vd[1] * vd[2] ? 1 : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t
+BinaryIndexFile::getNumBlocks() const
+{
+  return m_numBlocks;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double const *
+BinaryIndexFile::getRov() const
+{
+  return column<double>(Section::Rov);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double const *
+BinaryIndexFile::getAvg() const
+{
+  return column<double>(Section::Avg);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double const *
+BinaryIndexFile::getMin() const
+{
+  return column<double>(Section::Min);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double const *
+BinaryIndexFile::getMax() const
+{
+  return column<double>(Section::Max);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double const *
+BinaryIndexFile::getTotal() const
+{
+  return column<double>(Section::Total);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t const *
+BinaryIndexFile::getEmptyVoxels() const
+{
+  return column<uint64_t>(Section::EmptyVoxels);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t const *
+BinaryIndexFile::getDataOffsets() const
+{
+  return column<uint64_t>(Section::DataOffset);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t const *
+BinaryIndexFile::getDataBytes() const
+{
+  return column<uint64_t>(Section::DataBytes);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t const *
+BinaryIndexFile::getIjk() const
+{
+  return column<uint64_t>(Section::Ijk);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t const *
+BinaryIndexFile::getVoxelDims() const
+{
+  return column<uint64_t>(Section::VoxelDims);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double const *
+BinaryIndexFile::getWorldDims() const
+{
+  return column<double>(Section::WorldDims);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double const *
+BinaryIndexFile::getOrigins() const
+{
+  return column<double>(Section::Origin);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint32_t
+BinaryIndexFile::getHistogramBins() const
+{
+  SectionEntry const *e{ m_sections[static_cast<uint32_t>(Section::Histogram)] };
+  return e ? e->elem_bytes / sizeof(uint32_t) : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint32_t const *
+BinaryIndexFile::getHistograms() const
+{
+  if (!m_sections[static_cast<uint32_t>(Section::Histogram)]) {
+    return nullptr;
+  }
+  return column<uint32_t>(Section::Histogram);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bd::Volume const &
+BinaryIndexFile::getVolume() const
+{
+  return m_volume;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::string const &
+BinaryIndexFile::getRawFileName() const
+{
+  return m_fname;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::string const &
+BinaryIndexFile::getRawFilePath() const
+{
+  return m_fpath;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::string const &
+BinaryIndexFile::getTFFileName() const
+{
+  return m_tffname;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bd::DataType
+BinaryIndexFile::getDatType() const
+{
+  return bd::to_dataType(m_dataType);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BinaryIndexFile::isBricked() const
+{
+  return !m_brickOrder.empty();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::string const &
+BinaryIndexFile::getBrickOrder() const
+{
+  return m_brickOrder;
+}
+
+}}} // namespace bd::indexfile::v3
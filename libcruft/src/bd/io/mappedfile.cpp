@@ -0,0 +1,215 @@
+//
+// Created by jim on 3/2/19.
+//
+
+#include <bd/io/mappedfile.h>
+#include <bd/log/logger.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace bd
+{
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile()
+  : m_data{ nullptr }
+  , m_size{ 0 }
+  , m_fd{ -1 }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+
+#ifndef _WIN32
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+MappedFile::open(std::string const &path)
+{
+  close();
+
+  m_fd = ::open(path.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    Err() << "Unable to open file for mapping: " << path;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(m_fd, &st) != 0) {
+    Err() << "Unable to stat file: " << path;
+    close();
+    return false;
+  }
+  m_size = static_cast<uint64_t>(st.st_size);
+
+  if (m_size == 0) {
+    // mmap() refuses zero length mappings, but an empty file is still
+    // a valid (if boring) file to read.
+    return true;
+  }
+
+  void *p{ mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0) };
+  if (p == MAP_FAILED) {
+    Err() << "Unable to mmap file: " << path;
+    close();
+    return false;
+  }
+  m_data = static_cast<char *>(p);
+
+  Dbg() << "Mapped " << m_size << " bytes of " << path;
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+MappedFile::close()
+{
+  if (m_data) {
+    munmap(m_data, m_size);
+    m_data = nullptr;
+  }
+
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+
+  m_size = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+MappedFile::adviseSequential() const
+{
+  if (m_data) {
+    madvise(m_data, m_size, MADV_SEQUENTIAL);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+MappedFile::adviseWillNeed(uint64_t offset, uint64_t length) const
+{
+  char *start{ nullptr };
+  size_t bytes{ 0 };
+  if (pageRange(offset, length, &start, &bytes)) {
+    madvise(start, bytes, MADV_WILLNEED);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+MappedFile::adviseDontNeed(uint64_t offset, uint64_t length) const
+{
+  char *start{ nullptr };
+  size_t bytes{ 0 };
+  if (pageRange(offset, length, &start, &bytes)) {
+    madvise(start, bytes, MADV_DONTNEED);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+MappedFile::pageRange(uint64_t offset, uint64_t length,
+                      char **start, size_t *bytes) const
+{
+  if (!m_data || offset >= m_size || length == 0) {
+    return false;
+  }
+
+  if (length > m_size - offset) {
+    length = m_size - offset;
+  }
+
+  static uint64_t const page{ static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) };
+  uint64_t const aligned{ offset - ( offset % page ) };
+
+  *start = m_data + aligned;
+  *bytes = static_cast<size_t>(length + ( offset - aligned ));
+  return true;
+}
+
+#else // _WIN32
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+MappedFile::open(std::string const &path)
+{
+  Err() << "Memory mapped files are not supported on this platform: " << path;
+  return false;
+}
+
+
+void
+MappedFile::close()
+{
+}
+
+
+void
+MappedFile::adviseSequential() const
+{
+}
+
+
+void
+MappedFile::adviseWillNeed(uint64_t, uint64_t) const
+{
+}
+
+
+void
+MappedFile::adviseDontNeed(uint64_t, uint64_t) const
+{
+}
+
+
+bool
+MappedFile::pageRange(uint64_t, uint64_t, char **, size_t *) const
+{
+  return false;
+}
+
+#endif // ! _WIN32
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+MappedFile::isOpen() const
+{
+  return m_fd >= 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+char const *
+MappedFile::data() const
+{
+  return m_data;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t
+MappedFile::size() const
+{
+  return m_size;
+}
+
+} // namespace bd
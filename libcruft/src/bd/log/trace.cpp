@@ -0,0 +1,382 @@
+#include <bd/log/trace.h>
+#include <bd/log/logger.h>
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace bd
+{
+namespace trace
+{
+
+namespace detail
+{
+std::atomic_bool s_enabled{ false };
+}
+
+
+namespace
+{
+
+struct Event
+{
+  char const *name;
+  char const *cat;
+  char const *argName;
+  uint64_t ts;
+  uint64_t dur;
+  int64_t arg;
+  char phase;       ///< 'X' complete span, 'C' counter.
+};
+
+
+/// \brief One thread's ring of events.
+/// The mutex is only contended while writeJson() or clear() runs. A ring is
+/// only made for a thread that records while tracing is enabled, and goes
+/// back to the registry for the next such thread when its thread exits.
+struct ThreadBuffer
+{
+  std::mutex mutex;
+  std::vector<Event> events;
+  size_t next{ 0 };
+  bool wrapped{ false };
+  bool inUse{ false };
+  uint32_t tid{ 0 };
+  std::string name;
+};
+
+
+/// \brief The events an exited thread recorded, oldest first.
+struct ExitedThread
+{
+  uint32_t tid;
+  std::string name;
+  std::vector<Event> events;
+};
+
+
+struct Registry
+{
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::vector<ExitedThread> exited;
+  size_t capacity{ 1 << 15 };
+  uint32_t nextTid{ 1 };
+};
+
+
+/// Never destroyed, threads may still record while static destructors run.
+Registry &
+registry()
+{
+  static Registry *r{ new Registry };
+  return *r;
+}
+
+
+std::chrono::steady_clock::time_point const s_epoch{
+    std::chrono::steady_clock::now() };
+
+
+/// Set once the calling thread's ThreadSlot is destroyed, events recorded
+/// after that (from other thread_local destructors) are dropped.
+thread_local bool t_slotDestroyed{ false };
+
+
+/// \brief The calling thread's name and ring (null until it records).
+/// Copies the ring's events out and gives the ring back when the thread
+/// exits.
+struct ThreadSlot
+{
+  ~ThreadSlot()
+  {
+    t_slotDestroyed = true;
+    if (buffer == nullptr) {
+      return;
+    }
+
+    Registry &r = registry();
+    std::lock_guard<std::mutex> rlock(r.mutex);
+    ThreadBuffer &b = *buffer;
+    std::lock_guard<std::mutex> lock(b.mutex);
+
+    size_t const n{ b.wrapped ? b.events.size() : b.next };
+    if (n > 0) {
+      size_t const begin{ b.wrapped ? b.next : 0 };
+      ExitedThread e{ b.tid, b.name, { } };
+      e.events.reserve(n);
+      for (size_t i = 0; i < n; ++i) {
+        e.events.push_back(b.events[( begin + i ) % b.events.size()]);
+      }
+      r.exited.push_back(std::move(e));
+    }
+
+    b.next = 0;
+    b.wrapped = false;
+    b.name.clear();
+    b.inUse = false;
+  }
+
+  ThreadBuffer *buffer{ nullptr };
+  std::string name;
+};
+
+thread_local ThreadSlot t_slot;
+
+
+ThreadBuffer &
+threadBuffer()
+{
+  if (t_slot.buffer == nullptr) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    ThreadBuffer *b{ nullptr };
+    for (auto &bp : r.buffers) {
+      if (!bp->inUse) {
+        b = bp.get();
+        break;
+      }
+    }
+    if (b == nullptr) {
+      r.buffers.emplace_back(new ThreadBuffer);
+      b = r.buffers.back().get();
+    }
+
+    // not in use, so no other thread holds b's mutex.
+    b->events.resize(r.capacity);
+    b->next = 0;
+    b->wrapped = false;
+    b->inUse = true;
+    b->tid = r.nextTid++;
+    b->name = t_slot.name;
+    t_slot.buffer = b;
+  }
+  return *t_slot.buffer;
+}
+
+
+void
+record(Event const &e)
+{
+  if (t_slotDestroyed) {
+    return;
+  }
+  ThreadBuffer &b = threadBuffer();
+  std::lock_guard<std::mutex> lock(b.mutex);
+  b.events[b.next] = e;
+  if (++b.next == b.events.size()) {
+    b.next = 0;
+    b.wrapped = true;
+  }
+}
+
+
+void
+writeString(std::ostream &os, char const *s)
+{
+  os << '"';
+  for (; *s; ++s) {
+    char const c{ *s };
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      os << ' ';
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+
+/// Trace event timestamps are in microseconds.
+void
+writeMicros(std::ostream &os, uint64_t ns)
+{
+  os << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000;
+}
+
+
+void
+writeEvent(std::ostream &os, Event const &e, uint32_t tid)
+{
+  os << "{\"name\":";
+  writeString(os, e.name);
+  os << ",\"ph\":\"" << e.phase << "\",\"pid\":1,\"tid\":" << tid << ",\"ts\":";
+  writeMicros(os, e.ts);
+
+  if (e.phase == 'C') {
+    os << ",\"args\":{\"value\":" << e.arg << "}}";
+    return;
+  }
+
+  os << ",\"dur\":";
+  writeMicros(os, e.dur);
+  os << ",\"cat\":";
+  writeString(os, e.cat ? e.cat : "");
+  if (e.argName) {
+    os << ",\"args\":{";
+    writeString(os, e.argName);
+    os << ':' << e.arg << '}';
+  }
+  os << '}';
+}
+
+
+void
+writeThreadName(std::ostream &os, std::string const &name, uint32_t tid,
+                bool &first)
+{
+  if (name.empty()) {
+    return;
+  }
+  os << ( first ? "" : ",\n" )
+     << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+     << ",\"args\":{\"name\":";
+  writeString(os, name.c_str());
+  os << "}}";
+  first = false;
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+enable(bool on)
+{
+  detail::s_enabled.store(on);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+setBufferCapacity(size_t events)
+{
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.capacity = events > 0 ? events : 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+setThreadName(char const *name)
+{
+  if (t_slotDestroyed) {
+    return;
+  }
+  t_slot.name = name;
+  if (t_slot.buffer != nullptr) {
+    std::lock_guard<std::mutex> lock(t_slot.buffer->mutex);
+    t_slot.buffer->name = name;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t
+now()
+{
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - s_epoch).count());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+complete(char const *name, char const *cat, uint64_t start,
+         char const *argName, int64_t arg)
+{
+  uint64_t const end{ now() };
+  record(Event{ name, cat, argName, start, end - start, arg, 'X' });
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+counter(char const *name, int64_t value)
+{
+  record(Event{ name, nullptr, nullptr, now(), 0, value, 'C' });
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+writeJson(std::string const &path)
+{
+  std::ofstream os(path);
+  if (!os.is_open()) {
+    Err() << "Could not open trace file " << path;
+    return false;
+  }
+
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first{ true };
+  size_t count{ 0 };
+
+  Registry &r = registry();
+  std::lock_guard<std::mutex> rlock(r.mutex);
+  for (ExitedThread const &t : r.exited) {
+    writeThreadName(os, t.name, t.tid, first);
+    for (Event const &e : t.events) {
+      os << ( first ? "" : ",\n" );
+      writeEvent(os, e, t.tid);
+      first = false;
+    }
+    count += t.events.size();
+  }
+
+  for (auto &bp : r.buffers) {
+    ThreadBuffer &b = *bp;
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (!b.inUse) {
+      continue;
+    }
+
+    writeThreadName(os, b.name, b.tid, first);
+
+    // oldest first.
+    size_t const n{ b.wrapped ? b.events.size() : b.next };
+    size_t const begin{ b.wrapped ? b.next : 0 };
+    for (size_t i = 0; i < n; ++i) {
+      os << ( first ? "" : ",\n" );
+      writeEvent(os, b.events[( begin + i ) % b.events.size()], b.tid);
+      first = false;
+    }
+    count += n;
+  }
+
+  os << "\n]}\n";
+  if (!os) {
+    Err() << "Could not write trace file " << path;
+    return false;
+  }
+
+  Info() << "Wrote " << count << " trace events to " << path;
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+clear()
+{
+  Registry &r = registry();
+  std::lock_guard<std::mutex> rlock(r.mutex);
+  r.exited.clear();
+  for (auto &bp : r.buffers) {
+    std::lock_guard<std::mutex> lock(bp->mutex);
+    bp->next = 0;
+    bp->wrapped = false;
+  }
+}
+
+} // namespace trace
+} // namespace bd
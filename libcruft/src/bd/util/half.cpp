@@ -0,0 +1,168 @@
+#include <bd/util/half.h>
+
+#include <cstring>
+
+#if ( defined(__GNUC__) || defined(__clang__) ) && \
+    ( defined(__x86_64__) || defined(__i386__) )
+#define BD_F16C_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace bd
+{
+
+namespace
+{
+
+uint32_t
+bitsOf(float f)
+{
+  uint32_t u;
+  std::memcpy(&u, &f, sizeof(u));
+  return u;
+}
+
+
+float
+floatOf(uint32_t u)
+{
+  float f;
+  std::memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+
+#ifdef BD_F16C_DISPATCH
+
+__attribute__((target("avx,f16c")))
+void
+floatToHalfF16C(float const *src, uint16_t *dst, size_t n)
+{
+  size_t i{ 0 };
+  for (; i + 8 <= n; i += 8) {
+    __m256 const f{ _mm256_loadu_ps(src + i) };
+    __m128i const h{ _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT) };
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), h);
+  }
+  for (; i < n; ++i) {
+    dst[i] = floatToHalf(src[i]);
+  }
+}
+
+
+__attribute__((target("avx,f16c")))
+void
+halfToFloatF16C(uint16_t const *src, float *dst, size_t n)
+{
+  size_t i{ 0 };
+  for (; i + 8 <= n; i += 8) {
+    __m128i const h{ _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i)) };
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+  for (; i < n; ++i) {
+    dst[i] = halfToFloat(src[i]);
+  }
+}
+
+#endif // BD_F16C_DISPATCH
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint16_t
+floatToHalf(float f)
+{
+  uint32_t const x{ bitsOf(f) };
+  uint16_t const sign{ static_cast<uint16_t>(( x >> 16 ) & 0x8000) };
+  uint32_t ax{ x & 0x7fffffff };
+
+  if (ax >= 0x7f800000) {
+    // inf stays inf, nan stays a (quiet) nan.
+    return static_cast<uint16_t>(
+        sign | 0x7c00 | ( ax > 0x7f800000 ? 0x0200 | ( ax >> 13 & 0x03ff ) : 0 ));
+  }
+  if (ax >= 0x477ff000) {
+    // rounds to 65536 or more.
+    return static_cast<uint16_t>(sign | 0x7c00);
+  }
+  if (ax < 0x38800000) {
+    // subnormal half (or zero): adding 0.5 lines the half's ulp up with the
+    // float's last mantissa bit, and the fpu rounds to nearest even.
+    float const t{ floatOf(ax) + 0.5f };
+    return static_cast<uint16_t>(sign | ( bitsOf(t) - 0x3f000000 ));
+  }
+
+  // normal: rebias the exponent and round the 13 dropped bits to nearest
+  // even (a carry out of the mantissa correctly bumps the exponent).
+  uint32_t const odd{ ( ax >> 13 ) & 1 };
+  ax += 0xc8000fff + odd;
+  return static_cast<uint16_t>(sign | ( ax >> 13 ));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+float
+halfToFloat(uint16_t h)
+{
+  uint32_t const sign{ static_cast<uint32_t>(h & 0x8000) << 16 };
+  uint32_t const e{ ( h >> 10 ) & 0x1fu };
+  uint32_t const m{ h & 0x03ffu };
+
+  if (e == 0) {
+    float const v{ m * ( 1.0f / 16777216.0f ) };  // m * 2^-24
+    return sign ? -v : v;
+  }
+  if (e == 31) {
+    return floatOf(sign | 0x7f800000 | ( m << 13 ));
+  }
+  return floatOf(sign | ( ( e + 112 ) << 23 ) | ( m << 13 ));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+floatToHalf(float const *src, uint16_t *dst, size_t n)
+{
+#ifdef BD_F16C_DISPATCH
+  if (hasF16C()) {
+    floatToHalfF16C(src, dst, n);
+    return;
+  }
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] = floatToHalf(src[i]);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+halfToFloat(uint16_t const *src, float *dst, size_t n)
+{
+#ifdef BD_F16C_DISPATCH
+  if (hasF16C()) {
+    halfToFloatF16C(src, dst, n);
+    return;
+  }
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] = halfToFloat(src[i]);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+hasF16C()
+{
+#ifdef BD_F16C_DISPATCH
+  static bool const has{ __builtin_cpu_supports("avx") &&
+                         __builtin_cpu_supports("f16c") };
+  return has;
+#else
+  return false;
+#endif
+}
+
+} // namespace bd
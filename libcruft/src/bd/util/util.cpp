@@ -105,6 +105,31 @@ vecCompMult(const glm::u64vec3 &v)
   return v.x * v.y * v.z;
 }
 
+
+namespace
+{
+/// Spread the low 21 bits of v so there are two zero bits between each bit.
+unsigned long long
+spreadBits3(unsigned long long v)
+{
+  v &= 0x1fffffULL;
+  v = ( v | v << 32 ) & 0x1f00000000ffffULL;
+  v = ( v | v << 16 ) & 0x1f0000ff0000ffULL;
+  v = ( v | v << 8 ) & 0x100f00f00f00f00fULL;
+  v = ( v | v << 4 ) & 0x10c30c30c30c30c3ULL;
+  v = ( v | v << 2 ) & 0x1249249249249249ULL;
+  return v;
+}
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+unsigned long long
+mortonEncode(unsigned long long x, unsigned long long y, unsigned long long z)
+{
+  return spreadBits3(x) | spreadBits3(y) << 1 | spreadBits3(z) << 2;
+}
+
 //std::unique_ptr<float []>
 //readVolumeData(const std::string& dtype, const std::string& fpath,
 //    size_t volx, size_t voly, size_t volz)
@@ -1,6 +1,7 @@
 #include <bd/volume/block.h>
 
 #include <bd/log/gl_log.h>
+#include <bd/log/trace.h>
 #include <bd/util/util.h>
 
 #define GLM_ENABLE_EXPERIMENTAL
@@ -25,6 +26,7 @@ Block::Block(const glm::u64vec3& ijk, const FileBlock &fb)
   , m_transform{ 1.0f }  // identity matrix
   , m_tex{ nullptr }
   , m_pixelData{ nullptr }
+  , m_occupancy{ }
   , m_status{ 0x0 }
   , m_isVisible{ false }
 {
@@ -56,9 +58,26 @@ Block::~Block()
 void
 Block::sendToGpu()
 {
+  sendToGpu(m_pixelData);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+Block::sendToGpu(void const *pixels)
+{
+  BD_TRACE_SCOPE_ARG("Block::sendToGpu", "render", "block", index());
   if (m_status & GPU_WAIT)
-    m_tex->subImage3D(m_pixelData);
+    m_tex->subImage3D(pixels);
+
+  setGpuResident();
+}
+
 
+///////////////////////////////////////////////////////////////////////////////
+void
+Block::setGpuResident()
+{
   m_status |= GPU_RES;
   m_status &= ~GPU_WAIT;
 }
@@ -93,6 +112,14 @@ Block::fileBlock() const
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+void
+Block::rov(double r)
+{
+  m_fb.rov = r;
+}
+
+
 uint64_t
 Block::index() const
 {
@@ -252,11 +279,28 @@ Block::removePixelData()
 {
   char *p{ pixelData() };
   pixelData(nullptr);
+  m_occupancy.fill();
 
   return p;
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+OccupancyMask const &
+Block::occupancy() const
+{
+  return m_occupancy;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+OccupancyMask &
+Block::occupancy()
+{
+  return m_occupancy;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 std::string
 Block::to_string() const
@@ -0,0 +1,56 @@
+#include <bd/volume/blockhistogram.h>
+#include <bd/volume/opacitylut.h>
+
+#include <algorithm>
+
+namespace bd
+{
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<double>
+binOpacities(OpacityTransferFunction const &otf, uint32_t bins,
+             uint32_t samplesPerBin)
+{
+  samplesPerBin = std::max<uint32_t>(1, samplesPerBin);
+  std::vector<OpacityKnot> knots{ otf.getKnotsVector() };
+  std::sort(knots.begin(), knots.end());
+
+  std::vector<double> op(bins, 0.0);
+  for (uint32_t b = 0; b < bins; ++b) {
+    double sum{ 0.0 };
+    for (uint32_t s = 0; s < samplesPerBin; ++s) {
+      double const v{ ( b + ( s + 0.5 ) / samplesPerBin ) / bins };
+      sum += opacityAt(knots, std::min(1.0, v));
+    }
+    op[b] = sum / samplesPerBin;
+  }
+  return op;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double
+histogramRov(uint32_t const *hist, std::vector<double> const &binOpacity)
+{
+  double rel{ 0.0 };
+  uint64_t voxels{ 0 };
+  for (size_t b = 0; b < binOpacity.size(); ++b) {
+    rel += hist[b] * binOpacity[b];
+    voxels += hist[b];
+  }
+  return voxels > 0 ? rel / static_cast<double>(voxels) : 0.0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t
+histogramEmptyVoxels(uint32_t const *hist, std::vector<double> const &binOpacity)
+{
+  uint64_t empty{ 0 };
+  for (size_t b = 0; b < binOpacity.size(); ++b) {
+    empty += binOpacity[b] <= 0.0 ? hist[b] : 0;
+  }
+  return empty;
+}
+
+} // namespace bd
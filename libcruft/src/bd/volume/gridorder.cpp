@@ -0,0 +1,108 @@
+#include <bd/volume/gridorder.h>
+
+#include <cmath>
+
+namespace bd
+{
+
+///////////////////////////////////////////////////////////////////////////////
+GridOrder::GridOrder(glm::u64vec3 const &dims)
+  : m_dims{ dims }
+  , m_worldMin{ 0.0f }
+  , m_cellSize{ 1.0f }
+  , m_eyeCell{ 0, 0, 0 }
+{
+  for (int axis = 0; axis < 3; ++axis) {
+    m_axisRank[axis].resize(m_dims[axis]);
+    rankAxis(axis);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+GridOrder::setWorldBox(glm::vec3 const &min, glm::vec3 const &cellSize)
+{
+  m_worldMin = min;
+  m_cellSize = cellSize;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+GridOrder::setEye(glm::vec3 const &eye)
+{
+  glm::vec3 const c{ ( eye - m_worldMin ) / m_cellSize };
+  return setEyeCell({ static_cast<int64_t>(std::floor(c.x)),
+                      static_cast<int64_t>(std::floor(c.y)),
+                      static_cast<int64_t>(std::floor(c.z)) });
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+GridOrder::setEyeCell(glm::i64vec3 const &cell)
+{
+  bool changed{ false };
+  for (int axis = 0; axis < 3; ++axis) {
+    int64_t const last{ static_cast<int64_t>(m_dims[axis]) - 1 };
+    int64_t c{ cell[axis] };
+    c = c < 0 ? 0 : c;
+    c = c > last ? last : c;
+    if (c != m_eyeCell[axis]) {
+      m_eyeCell[axis] = c;
+      rankAxis(axis);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+glm::i64vec3 const &
+GridOrder::eyeCell() const
+{
+  return m_eyeCell;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+glm::u64vec3 const &
+GridOrder::dims() const
+{
+  return m_dims;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t
+GridOrder::rank(glm::u64vec3 const &ijk) const
+{
+  return ( m_axisRank[2][ijk.z] * m_dims.y + m_axisRank[1][ijk.y] ) * m_dims.x +
+         m_axisRank[0][ijk.x];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+GridOrder::rankAxis(int axis)
+{
+  std::vector<uint64_t> &ranks = m_axisRank[axis];
+  uint64_t const n{ m_dims[axis] };
+  if (n == 0) {
+    return;
+  }
+  uint64_t const eye{ static_cast<uint64_t>(m_eyeCell[axis]) };
+
+  uint64_t r{ 0 };
+  for (uint64_t i = 0; i < eye; ++i) {
+    ranks[i] = r++;
+  }
+  for (uint64_t i = n - 1; i > eye; --i) {
+    ranks[i] = r++;
+  }
+  ranks[eye] = r;
+}
+
+} // namespace bd
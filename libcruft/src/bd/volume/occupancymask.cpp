@@ -0,0 +1,135 @@
+#include <bd/volume/occupancymask.h>
+
+#include <algorithm>
+
+namespace bd
+{
+
+constexpr uint32_t OccupancyMask::CellsPerSide;
+constexpr uint32_t OccupancyMask::Cells;
+
+
+///////////////////////////////////////////////////////////////////////////////
+OccupancyMask::OccupancyMask()
+    : m_bits{ }
+    , m_cellExtent{ 1, 1, 1 }
+    , m_generation{ 0 }
+{
+  fill();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+OccupancyMask::compute(float const *voxels, uint64_t const dims[3],
+                       OpacityRangeTable const &table, uint32_t generation)
+{
+  m_bits.fill(0);
+  m_generation = generation;
+  for (int a = 0; a < 3; ++a) {
+    m_cellExtent[a] = std::max<uint64_t>(1, ( dims[a] + CellsPerSide - 1 ) / CellsPerSide);
+  }
+
+  uint64_t const *ext{ m_cellExtent };
+  for (uint32_t k = 0; k < CellsPerSide && k * ext[2] < dims[2]; ++k) {
+    // the cell's voxels plus one voxel on each side, clamped to the block.
+    uint64_t const z0{ k * ext[2] > 0 ? k * ext[2] - 1 : 0 };
+    uint64_t const z1{ std::min(dims[2], ( k + 1 ) * ext[2] + 1) };
+
+    for (uint32_t j = 0; j < CellsPerSide && j * ext[1] < dims[1]; ++j) {
+      uint64_t const y0{ j * ext[1] > 0 ? j * ext[1] - 1 : 0 };
+      uint64_t const y1{ std::min(dims[1], ( j + 1 ) * ext[1] + 1) };
+
+      for (uint32_t i = 0; i < CellsPerSide && i * ext[0] < dims[0]; ++i) {
+        uint64_t const x0{ i * ext[0] > 0 ? i * ext[0] - 1 : 0 };
+        uint64_t const x1{ std::min(dims[0], ( i + 1 ) * ext[0] + 1) };
+
+        float lo{ voxels[( z0 * dims[1] + y0 ) * dims[0] + x0] };
+        float hi{ lo };
+        for (uint64_t z = z0; z < z1; ++z) {
+          for (uint64_t y = y0; y < y1; ++y) {
+            float const *row{ voxels + ( z * dims[1] + y ) * dims[0] };
+            for (uint64_t x = x0; x < x1; ++x) {
+              lo = std::min(lo, row[x]);
+              hi = std::max(hi, row[x]);
+            }
+          }
+        }
+
+        if (!table.isTransparent(lo, hi)) {
+          uint32_t const c{ cellIndex(i, j, k) };
+          m_bits[c / 64] |= uint64_t{ 1 } << ( c % 64 );
+        }
+      }
+    }
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+OccupancyMask::fill()
+{
+  m_bits.fill(~uint64_t{ 0 });
+  m_generation = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+OccupancyMask::occupied(uint32_t i, uint32_t j, uint32_t k) const
+{
+  uint32_t const c{ cellIndex(i, j, k) };
+  return ( m_bits[c / 64] >> ( c % 64 ) & 1 ) != 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+OccupancyMask::occupiedVoxel(uint64_t x, uint64_t y, uint64_t z) const
+{
+  uint64_t const last{ CellsPerSide - 1 };
+  return occupied(static_cast<uint32_t>(std::min(last, x / m_cellExtent[0])),
+                  static_cast<uint32_t>(std::min(last, y / m_cellExtent[1])),
+                  static_cast<uint32_t>(std::min(last, z / m_cellExtent[2])));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint32_t
+OccupancyMask::count() const
+{
+  uint32_t n{ 0 };
+  for (uint64_t w : m_bits) {
+    for (; w != 0; w &= w - 1) {
+      ++n;
+    }
+  }
+  return n;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t const *
+OccupancyMask::cellExtent() const
+{
+  return m_cellExtent;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint32_t
+OccupancyMask::generation() const
+{
+  return m_generation;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint32_t
+OccupancyMask::cellIndex(uint32_t i, uint32_t j, uint32_t k)
+{
+  return ( k * CellsPerSide + j ) * CellsPerSide + i;
+}
+
+} // namespace bd
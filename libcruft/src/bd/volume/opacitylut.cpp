@@ -0,0 +1,27 @@
+#include <bd/volume/opacitylut.h>
+
+namespace bd
+{
+
+///////////////////////////////////////////////////////////////////////////////
+double
+opacityAt(std::vector<OpacityKnot> const &knots, double v)
+{
+  if (knots.empty()) {
+    return 0.0;
+  }
+  if (v <= knots.front().s) {
+    return knots.front().alpha;
+  }
+  if (v >= knots.back().s) {
+    return knots.back().alpha;
+  }
+
+  auto k1 = std::upper_bound(knots.begin(), knots.end(), v,
+                             [](double s, OpacityKnot const &k) { return s < k.s; });
+  auto k0 = k1 - 1;
+  double const d{ ( v - k0->s ) / ( k1->s - k0->s ) };
+  return k0->alpha * ( 1.0 - d ) + k1->alpha * d;
+}
+
+} // namespace bd
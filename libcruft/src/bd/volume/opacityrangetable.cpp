@@ -0,0 +1,91 @@
+#include <bd/volume/opacityrangetable.h>
+#include <bd/volume/opacitylut.h>
+
+#include <algorithm>
+
+namespace bd
+{
+
+///////////////////////////////////////////////////////////////////////////////
+OpacityRangeTable::OpacityRangeTable()
+    : m_opaqueBefore{ }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+OpacityRangeTable::OpacityRangeTable(OpacityTransferFunction const &otf,
+                                     uint32_t entries)
+    : m_opaqueBefore{ }
+{
+  build(otf, entries);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+OpacityRangeTable::build(OpacityTransferFunction const &otf, uint32_t entries)
+{
+  entries = std::max<uint32_t>(1, entries);
+  std::vector<OpacityKnot> knots{ otf.getKnotsVector() };
+  std::sort(knots.begin(), knots.end());
+
+  // The opacity is linear between the knots (and constant past the end
+  // knots), so its largest value over an entry is at one of the entry's
+  // ends or at a knot inside it.
+  std::vector<bool> opaque(entries, false);
+  double prev{ opacityAt(knots, 0.0) };
+  for (uint32_t i = 0; i < entries; ++i) {
+    double const next{ opacityAt(knots, double(i + 1) / entries) };
+    opaque[i] = prev > 0.0 || next > 0.0;
+    prev = next;
+  }
+  for (OpacityKnot const &k : knots) {
+    if (k.alpha > 0.0) {
+      opaque[entry(k.s, entries)] = true;
+    }
+  }
+
+  m_opaqueBefore.assign(entries + 1, 0);
+  for (uint32_t i = 0; i < entries; ++i) {
+    m_opaqueBefore[i + 1] = m_opaqueBefore[i] + ( opaque[i] ? 1 : 0 );
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+OpacityRangeTable::valid() const
+{
+  return !m_opaqueBefore.empty();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+OpacityRangeTable::isTransparent(double lo, double hi) const
+{
+  if (!valid()) {
+    return false;
+  }
+  if (hi < lo) {
+    std::swap(lo, hi);
+  }
+  uint32_t const entries{ static_cast<uint32_t>(m_opaqueBefore.size() - 1) };
+  return m_opaqueBefore[entry(hi, entries) + 1] ==
+         m_opaqueBefore[entry(lo, entries)];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint32_t
+OpacityRangeTable::entry(double v, uint32_t entries)
+{
+  if (!( v > 0.0 )) {
+    return 0;
+  }
+  uint32_t const e{ v >= 1.0 ? entries : static_cast<uint32_t>(v * entries) };
+  return e < entries ? e : entries - 1;
+}
+
+} // namespace bd
@@ -0,0 +1,403 @@
+#include <bd/volume/synthvolume.h>
+
+#include <random>
+
+namespace bd
+{
+
+namespace
+{
+
+double const PI{ 3.14159265358979323846 };
+
+/// Shells between the centre and a corner.
+double const SHELLS{ 8.0 };
+/// Noise features across the largest dimension, and octaves summed.
+double const NOISE_FREQUENCY{ 8.0 };
+uint32_t const NOISE_OCTAVES{ 5 };
+/// Blob cells across the largest dimension, one blob per cell.
+double const BLOB_CELLS{ 16.0 };
+/// Thickness of a constant slab in voxels.
+uint64_t const SLAB_VOXELS{ 16 };
+/// Voxels sampled to find the threshold for the empty fraction.
+size_t const CALIBRATION_SAMPLES{ 1 << 14 };
+
+
+/// splitmix64 finalizer.
+uint64_t
+mix(uint64_t z)
+{
+  z = ( z ^ ( z >> 30 )) * 0xbf58476d1ce4e5b9ull;
+  z = ( z ^ ( z >> 27 )) * 0x94d049bb133111ebull;
+  return z ^ ( z >> 31 );
+}
+
+
+/// A value in [0, 1) for lattice point (i, j, k).
+double
+unit(int64_t i, int64_t j, int64_t k, uint64_t seed)
+{
+  uint64_t h{ mix(seed ^ static_cast<uint64_t>(i)) };
+  h = mix(h ^ static_cast<uint64_t>(j));
+  h = mix(h ^ static_cast<uint64_t>(k));
+  return ( h >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+
+double
+smooth(double t)
+{
+  return t * t * ( 3.0 - 2.0 * t );
+}
+
+
+double
+lerp(double a, double b, double t)
+{
+  return a + ( b - a ) * t;
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+to_synthPattern(std::string const &s, SynthPattern &p)
+{
+  if (s == "shells") {
+    p = SynthPattern::Shells;
+  } else if (s == "noise") {
+    p = SynthPattern::Noise;
+  } else if (s == "blobs") {
+    p = SynthPattern::Blobs;
+  } else if (s == "slabs") {
+    p = SynthPattern::Slabs;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SynthVolume::SynthVolume(glm::u64vec3 const &dims, SynthPattern pattern,
+                         double emptyFraction, uint32_t seed)
+  : m_dims{ dims }
+  , m_pattern{ pattern }
+  , m_seed{ seed }
+  , m_scale{ 1.0 / std::max<uint64_t>({ dims.x, dims.y, dims.z, 1 }) }
+  , m_centre{ glm::dvec3{ dims } * m_scale * 0.5 }
+  , m_blobRadius{ 0.0 }
+  , m_threshold{ 0.0 }
+  , m_invRange{ 1.0 }
+  , m_perm{ }
+  , m_latticeValues{ }
+  , m_blobCells{ 0, 0, 0 }
+  , m_blobCentres{ }
+{
+  // big enough that the blobs cover a little more than the non-empty
+  // fraction (if they were scattered at random), the threshold trims the
+  // rest. A blob only reaches into the neighbouring cells.
+  double const e{ std::max(emptyFraction, 1e-6) };
+  m_blobRadius = std::min(1.0, 1.25 * std::cbrt(-std::log(e) * 3.0 / ( 4.0 * PI )));
+
+  if (m_pattern == SynthPattern::Noise) {
+    initNoise();
+  } else if (m_pattern == SynthPattern::Blobs) {
+    initBlobs();
+  }
+  calibrate(emptyFraction);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double
+SynthVolume::sample(uint64_t x, uint64_t y, uint64_t z) const
+{
+  double f;
+  field(x, 1, y, z, &f);
+  applyThreshold(&f, 1);
+  return f;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SynthVolume::sampleRow(uint64_t y, uint64_t z, double *row) const
+{
+  field(0, m_dims.x, y, z, row);
+  applyThreshold(row, m_dims.x);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+glm::u64vec3 const &
+SynthVolume::dims() const
+{
+  return m_dims;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double
+SynthVolume::threshold() const
+{
+  return m_threshold;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SynthVolume::field(uint64_t x0, uint64_t n, uint64_t y, uint64_t z,
+                   double *f) const
+{
+  switch (m_pattern) {
+    case SynthPattern::Shells:
+      shells(x0, n, y, z, f);
+      break;
+    case SynthPattern::Noise:
+      noise(x0, n, y, z, f);
+      break;
+    case SynthPattern::Blobs:
+      blobs(x0, n, y, z, f);
+      break;
+    case SynthPattern::Slabs:
+    default:
+      slabs(x0, n, y, z, f);
+      break;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SynthVolume::shells(uint64_t x0, uint64_t n, uint64_t y, uint64_t z,
+                    double *f) const
+{
+  // distance from the centre, 1 at the corners.
+  double const toShell{ SHELLS / glm::length(m_centre) };
+  double const dy{ normalized(y) - m_centre.y };
+  double const dz{ normalized(z) - m_centre.z };
+  double const yz{ dy * dy + dz * dz };
+  for (uint64_t i = 0; i < n; ++i) {
+    double const dx{ normalized(x0 + i) - m_centre.x };
+    double const s{ std::sqrt(dx * dx + yz) * toShell };
+    f[i] = s - std::floor(s);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SynthVolume::noise(uint64_t x0, uint64_t n, uint64_t y, uint64_t z,
+                   double *f) const
+{
+  std::fill(f, f + n, 0.0);
+  uint8_t const *perm{ m_perm.data() };
+  double const *values{ m_latticeValues.data() };
+
+  double amplitude{ 1.0 };
+  double total{ 0.0 };
+  double frequency{ NOISE_FREQUENCY };
+  for (uint32_t o = 0; o < NOISE_OCTAVES; ++o) {
+    // offset each octave so their lattices are unrelated.
+    int64_t const off{ static_cast<int64_t>(o) * 67 };
+
+    double const qy{ normalized(y) * frequency };
+    double const qz{ normalized(z) * frequency };
+    int64_t const j{ static_cast<int64_t>(qy) };
+    int64_t const k{ static_cast<int64_t>(qz) };
+    double const v{ smooth(qy - j) };
+    double const w{ smooth(qz - k) };
+
+    // q is positive, so casts are floors. The lattice is hashed z, then y,
+    // then x, so the y and z part is the same along the row.
+    int const b00{ perm[perm[( k + off ) & 255] + (( j + off ) & 255 )] };
+    int const b01{ perm[perm[( k + off ) & 255] + (( j + 1 + off ) & 255 )] };
+    int const b10{ perm[perm[( k + 1 + off ) & 255] + (( j + off ) & 255 )] };
+    int const b11{ perm[perm[( k + 1 + off ) & 255] + (( j + 1 + off ) & 255 )] };
+
+    for (uint64_t x = 0; x < n; ++x) {
+      double const qx{ normalized(x0 + x) * frequency };
+      int64_t const i{ static_cast<int64_t>(qx) };
+      double const u{ smooth(qx - i) };
+      int const a{ static_cast<int>(( i + off ) & 255) };
+      int const b{ static_cast<int>(( i + 1 + off ) & 255) };
+
+      // trilinear between the lattice values around q.
+      double const c00{ lerp(values[perm[b00 + a]], values[perm[b00 + b]], u) };
+      double const c01{ lerp(values[perm[b01 + a]], values[perm[b01 + b]], u) };
+      double const c10{ lerp(values[perm[b10 + a]], values[perm[b10 + b]], u) };
+      double const c11{ lerp(values[perm[b11 + a]], values[perm[b11 + b]], u) };
+      f[x] += amplitude * lerp(lerp(c00, c01, v), lerp(c10, c11, v), w);
+    }
+
+    total += amplitude;
+    amplitude *= 0.5;
+    frequency *= 2.0;
+  }
+
+  for (uint64_t x = 0; x < n; ++x) {
+    f[x] /= total;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SynthVolume::blobs(uint64_t x0, uint64_t n, uint64_t y, uint64_t z,
+                   double *f) const
+{
+  if (m_blobRadius <= 0.0) {
+    std::fill(f, f + n, 0.0);
+    return;
+  }
+
+  // voxels are inside the grid, so their neighbour cells are in the border
+  // at worst.
+  double const qy{ normalized(y) * BLOB_CELLS };
+  double const qz{ normalized(z) * BLOB_CELLS };
+  int64_t const cj{ static_cast<int64_t>(qy) + 1 };
+  int64_t const ck{ static_cast<int64_t>(qz) + 1 };
+  double const r2{ m_blobRadius * m_blobRadius };
+
+  // the y and z part of the squared distance to the blobs in the 3x3 rows
+  // of cells around the row is the same along the row.
+  int64_t const cx{ m_blobCells.x };
+  std::vector<double> yz(9 * cx);
+  std::vector<glm::dvec3 const *> rows(9);
+  for (int64_t r = 0; r < 9; ++r) {
+    int64_t const k{ ck - 1 + r / 3 };
+    int64_t const j{ cj - 1 + r % 3 };
+    rows[r] = &m_blobCentres[( k * m_blobCells.y + j ) * cx];
+    for (int64_t i = 0; i < cx; ++i) {
+      double const dy{ qy - rows[r][i].y };
+      double const dz{ qz - rows[r][i].z };
+      yz[r * cx + i] = dy * dy + dz * dz;
+    }
+  }
+
+  for (uint64_t x = 0; x < n; ++x) {
+    double const qx{ normalized(x0 + x) * BLOB_CELLS };
+    int64_t const ci{ static_cast<int64_t>(qx) + 1 };
+    double nearest2{ r2 };
+    for (int64_t r = 0; r < 9; ++r) {
+      for (int64_t i = ci - 1; i <= ci + 1; ++i) {
+        double const dx{ qx - rows[r][i].x };
+        nearest2 = std::min(nearest2, dx * dx + yz[r * cx + i]);
+      }
+    }
+    f[x] = nearest2 < r2 ? 1.0 - std::sqrt(nearest2) / m_blobRadius : 0.0;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SynthVolume::slabs(uint64_t, uint64_t n, uint64_t, uint64_t z, double *f) const
+{
+  int64_t const slab{ static_cast<int64_t>(z / SLAB_VOXELS) };
+  std::fill(f, f + n, unit(slab, 0, 0, m_seed * 0x9e3779b97f4a7c15ull));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SynthVolume::applyThreshold(double *f, uint64_t n) const
+{
+  for (uint64_t i = 0; i < n; ++i) {
+    f[i] = f[i] <= m_threshold ? 0.0 : ( f[i] - m_threshold ) * m_invRange;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double
+SynthVolume::normalized(uint64_t v) const
+{
+  return ( v + 0.5 ) * m_scale;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SynthVolume::initNoise()
+{
+  // a hashed lattice that repeats every 256 cells, more than the finest
+  // octave has across the volume.
+  std::mt19937_64 rng{ mix(m_seed) };
+  m_perm.resize(512);
+  for (int i = 0; i < 256; ++i) {
+    m_perm[i] = static_cast<uint8_t>(i);
+  }
+  std::shuffle(m_perm.begin(), m_perm.begin() + 256, rng);
+  std::copy(m_perm.begin(), m_perm.begin() + 256, m_perm.begin() + 256);
+
+  std::uniform_real_distribution<double> value{ 0.0, 1.0 };
+  m_latticeValues.resize(256);
+  for (double &v : m_latticeValues) {
+    v = value(rng);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SynthVolume::initBlobs()
+{
+  // one blob per cell, its centre jittered inside the middle of the cell.
+  m_blobCells = glm::i64vec3{
+      static_cast<int64_t>(std::ceil(m_dims.x * m_scale * BLOB_CELLS)) + 2,
+      static_cast<int64_t>(std::ceil(m_dims.y * m_scale * BLOB_CELLS)) + 2,
+      static_cast<int64_t>(std::ceil(m_dims.z * m_scale * BLOB_CELLS)) + 2 };
+  m_blobCentres.resize(m_blobCells.x * m_blobCells.y * m_blobCells.z);
+
+  uint64_t const seed{ m_seed * 0x9e3779b97f4a7c15ull };
+  size_t idx{ 0 };
+  for (int64_t k = -1; k < m_blobCells.z - 1; ++k) {
+    for (int64_t j = -1; j < m_blobCells.y - 1; ++j) {
+      for (int64_t i = -1; i < m_blobCells.x - 1; ++i) {
+        m_blobCentres[idx++] = glm::dvec3{ i + 0.25 + 0.5 * unit(i, j, k, seed),
+                                           j + 0.25 + 0.5 * unit(i, j, k, seed + 1),
+                                           k + 0.25 + 0.5 * unit(i, j, k, seed + 2) };
+      }
+    }
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SynthVolume::calibrate(double emptyFraction)
+{
+  m_invRange = 1.0;
+  if (emptyFraction <= 0.0) {
+    // every field value, even 0, is above it.
+    m_threshold = -std::numeric_limits<double>::min();
+    return;
+  }
+  if (emptyFraction >= 1.0 || m_dims.x * m_dims.y * m_dims.z == 0) {
+    m_threshold = 1.0;
+    return;
+  }
+
+  std::mt19937_64 rng{ m_seed };
+  std::uniform_int_distribution<uint64_t> rx{ 0, m_dims.x - 1 };
+  std::uniform_int_distribution<uint64_t> ry{ 0, m_dims.y - 1 };
+  std::uniform_int_distribution<uint64_t> rz{ 0, m_dims.z - 1 };
+
+  std::vector<double> f(CALIBRATION_SAMPLES);
+  for (double &v : f) {
+    field(rx(rng), 1, ry(rng), rz(rng), &v);
+  }
+
+  size_t const rank{ static_cast<size_t>(std::ceil(emptyFraction * f.size())) };
+  auto nth = f.begin() + ( std::max<size_t>(rank, 1) - 1 );
+  std::nth_element(f.begin(), nth, f.end());
+  m_threshold = std::min(*nth, 1.0);
+  if (m_threshold < 1.0) {
+    m_invRange = 1.0 / ( 1.0 - m_threshold );
+  }
+}
+
+} // namespace bd
@@ -0,0 +1,79 @@
+//
+// Created by jim on 3/11/19.
+//
+
+#include <bd/datastructure/blockingqueue.h>
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("BlockingQueue pops items that are left after close", "[blockingqueue]")
+{
+  bd::BlockingQueue<int> q{ 2 };
+  REQUIRE(q.push(1));
+  REQUIRE(q.push(2));
+  REQUIRE(q.size() == 2);
+
+  q.close();
+  REQUIRE_FALSE(q.push(3));
+
+  int v{ 0 };
+  REQUIRE(q.pop(v));
+  REQUIRE(v == 1);
+  REQUIRE(q.pop(v));
+  REQUIRE(v == 2);
+  REQUIRE_FALSE(q.pop(v));
+  REQUIRE_FALSE(q.tryPop(v));
+}
+
+
+TEST_CASE("BlockingQueue with capacity bounds many producers and consumers",
+          "[blockingqueue]")
+{
+  bd::BlockingQueue<int> q{ 3 };
+  int const producers{ 4 };
+  int const consumers{ 3 };
+  int const count{ 20000 };
+
+  std::atomic<long long> sum{ 0 };
+  std::atomic<int> popped{ 0 };
+  std::atomic<size_t> maxSize{ 0 };
+
+  std::vector<std::thread> cons;
+  for (int c = 0; c < consumers; ++c) {
+    cons.emplace_back([&]() {
+      int v;
+      while (q.pop(v)) {
+        size_t const sz{ q.size() };
+        size_t m{ maxSize };
+        while (sz > m && !maxSize.compare_exchange_weak(m, sz)) { }
+        sum += v;
+        ++popped;
+      }
+    });
+  }
+
+  std::vector<std::thread> prods;
+  for (int p = 0; p < producers; ++p) {
+    prods.emplace_back([&]() {
+      for (int i = 1; i <= count; ++i) {
+        q.push(i);
+      }
+    });
+  }
+
+  for (auto &t : prods) {
+    t.join();
+  }
+  q.close();
+  for (auto &t : cons) {
+    t.join();
+  }
+
+  REQUIRE(maxSize <= 3);
+  REQUIRE(popped == producers * count);
+  REQUIRE(sum == producers * ( static_cast<long long>(count) * ( count + 1 ) / 2 ));
+}
@@ -0,0 +1,155 @@
+//
+// Created by jim on 3/12/19.
+//
+
+#include <bd/datastructure/cachepolicy.h>
+
+#include <catch.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace
+{
+
+/// Evict everything, in eviction order.
+std::vector<int>
+drain(bd::CachePolicy<int> &p)
+{
+  std::vector<int> order;
+  int k;
+  while (p.evict(k)) {
+    order.push_back(k);
+  }
+  return order;
+}
+
+} // namespace
+
+
+TEST_CASE("Cache policies track and erase keys", "[cachepolicy]")
+{
+  for (auto t : { bd::CachePolicyType::Lru, bd::CachePolicyType::Clock,
+                  bd::CachePolicyType::Cost }) {
+    std::unique_ptr<bd::CachePolicy<int>> p{ bd::CachePolicyFactory<int>::New(t) };
+
+    int k{ -1 };
+    REQUIRE_FALSE(p->evict(k));
+    REQUIRE_FALSE(p->touch(1, 1.0));
+    REQUIRE_FALSE(p->erase(1));
+
+    p->insert(1, 1.0);
+    p->insert(2, 1.0);
+    p->insert(3, 1.0);
+    p->insert(2, 1.0);
+    REQUIRE(p->size() == 3);
+    REQUIRE(p->contains(2));
+
+    REQUIRE(p->erase(2));
+    REQUIRE_FALSE(p->contains(2));
+    REQUIRE(p->size() == 2);
+
+    std::vector<int> order{ drain(*p) };
+    REQUIRE(order.size() == 2);
+    REQUIRE(p->size() == 0);
+
+    p->insert(4, 1.0);
+    p->clear();
+    REQUIRE_FALSE(p->evict(k));
+  }
+}
+
+
+TEST_CASE("LRU evicts the least recently used key", "[cachepolicy]")
+{
+  bd::LruCachePolicy<int> p;
+  for (int i = 0; i < 5; ++i) {
+    p.insert(i, 0.0);
+  }
+  p.touch(0, 0.0);
+  p.touch(2, 0.0);
+
+  REQUIRE(drain(p) == std::vector<int>({ 1, 3, 4, 0, 2 }));
+}
+
+
+TEST_CASE("CLOCK gives referenced keys a second chance", "[cachepolicy]")
+{
+  bd::ClockCachePolicy<int> p;
+  for (int i = 0; i < 5; ++i) {
+    p.insert(i, 0.0);
+  }
+  p.touch(0, 0.0);
+  p.touch(3, 0.0);
+
+  int k{ -1 };
+  REQUIRE(p.evict(k));
+  REQUIRE(k == 1);
+
+  // the erased slot is reused by the next insert.
+  p.insert(5, 0.0);
+  REQUIRE(p.evict(k));
+  REQUIRE(k == 2);
+  REQUIRE(p.evict(k));
+  REQUIRE(k == 4);
+
+  // 0 and 3 lost their reference bits on the first sweep, 5 was inserted
+  // into slot 1 behind the hand.
+  REQUIRE(drain(p) == std::vector<int>({ 0, 5, 3 }));
+}
+
+
+TEST_CASE("Cost policy evicts the lightest key first", "[cachepolicy]")
+{
+  bd::CostCachePolicy<int> p;
+  p.insert(1, 100.0);
+  p.insert(2, 0.5);
+  p.insert(3, 10.0);
+  p.insert(4, 0.0);
+  p.insert(5, 0.5);
+
+  // same weight: least recently used first.
+  p.touch(2, 0.5);
+
+  int k{ -1 };
+  REQUIRE(p.evict(k));
+  REQUIRE(k == 4);
+  REQUIRE(p.evict(k));
+  REQUIRE(k == 5);
+
+  // a key that stops being relevant goes next.
+  REQUIRE(p.setWeight(1, 0.0));
+  REQUIRE(drain(p) == std::vector<int>({ 1, 2, 3 }));
+}
+
+
+TEST_CASE("Cost policy buckets are ordered by weight", "[cachepolicy]")
+{
+  using P = bd::CostCachePolicy<int>;
+  REQUIRE(P::bucketOf(0.0) == 0);
+  REQUIRE(P::bucketOf(-1.0) == 0);
+  REQUIRE(P::bucketOf(1e-300) >= 1);
+
+  size_t last{ 0 };
+  for (double w = 1e-12; w < 1e12; w *= 1.7) {
+    size_t const b{ P::bucketOf(w) };
+    REQUIRE(b >= last);
+    last = b;
+  }
+  REQUIRE(P::bucketOf(1.0) < P::bucketOf(1.5));
+  REQUIRE(P::bucketOf(1e300) == P::bucketOf(1e308));
+}
+
+
+TEST_CASE("Cache policy names are parsed", "[cachepolicy]")
+{
+  bd::CachePolicyType t;
+  REQUIRE(bd::to_cachePolicyType("lru", t));
+  REQUIRE(t == bd::CachePolicyType::Lru);
+  REQUIRE(bd::to_cachePolicyType("clock", t));
+  REQUIRE(t == bd::CachePolicyType::Clock);
+  REQUIRE(bd::to_cachePolicyType("cost", t));
+  REQUIRE(t == bd::CachePolicyType::Cost);
+  REQUIRE_FALSE(bd::to_cachePolicyType("fifo", t));
+  REQUIRE(bd::to_string(bd::CachePolicyType::Clock) == "clock");
+}
@@ -0,0 +1,92 @@
+//
+// Created by jim on 3/30/19.
+//
+
+#include <bd/datastructure/mpscqueue.h>
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST_CASE("MpscQueue capacity is rounded to a power of two", "[mpscqueue]")
+{
+  bd::MpscQueue<int> q{ 5 };
+  REQUIRE(q.capacity() == 8);
+
+  // go around the ring more than once.
+  int v{ -1 };
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 8; ++i) {
+      REQUIRE(q.tryPush(i));
+    }
+    REQUIRE_FALSE(q.tryPush(8));
+    REQUIRE(q.size() == 8);
+
+    for (int i = 0; i < 8; ++i) {
+      REQUIRE(q.tryPop(v));
+      REQUIRE(v == i);
+    }
+    REQUIRE_FALSE(q.tryPop(v));
+  }
+}
+
+
+TEST_CASE("MpscQueue keeps each producer's items in order", "[mpscqueue]")
+{
+  bd::MpscQueue<int> q{ 8 };
+  std::atomic_bool stop{ false };
+  int const producers{ 4 };
+  int const count{ 50000 };
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&q, &stop, p]() {
+      for (int i = 0; i < count; ++i) {
+        q.push(p * count + i, stop);
+      }
+    });
+  }
+
+  std::vector<int> next(producers, 0);
+  bool inOrder{ true };
+  int v{ -1 };
+  for (int i = 0; i < producers * count; ++i) {
+    q.pop(v, stop);
+    int const p{ v / count };
+    inOrder = inOrder && v % count == next[p];
+    next[p] = v % count + 1;
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  REQUIRE(inOrder);
+  for (int p = 0; p < producers; ++p) {
+    REQUIRE(next[p] == count);
+  }
+  REQUIRE(q.size() == 0);
+}
+
+
+TEST_CASE("MpscQueue push and pop return when stop is requested", "[mpscqueue]")
+{
+  bd::MpscQueue<int> q{ 1 };
+  REQUIRE(q.capacity() == 2);
+  std::atomic_bool stop{ false };
+
+  int v{ -1 };
+  bool popped{ true };
+  std::thread consumer{ [&]() { popped = q.pop(v, stop); } };
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  stop = true;
+  q.wake();
+  consumer.join();
+  REQUIRE_FALSE(popped);
+
+  REQUIRE(q.tryPush(1));
+  REQUIRE(q.tryPush(2));
+  REQUIRE_FALSE(q.push(3, stop));
+}
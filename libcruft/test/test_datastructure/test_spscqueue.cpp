@@ -0,0 +1,72 @@
+//
+// Created by jim on 3/4/19.
+//
+
+#include <bd/datastructure/spscqueue.h>
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+
+TEST_CASE("SpscQueue capacity is rounded to a power of two", "[spscqueue]")
+{
+  bd::SpscQueue<int> q{ 5 };
+  REQUIRE(q.capacity() == 8);
+
+  for (int i = 0; i < 8; ++i) {
+    REQUIRE(q.tryPush(i));
+  }
+  REQUIRE_FALSE(q.tryPush(8));
+  REQUIRE(q.size() == 8);
+
+  int v{ -1 };
+  for (int i = 0; i < 8; ++i) {
+    REQUIRE(q.tryPop(v));
+    REQUIRE(v == i);
+  }
+  REQUIRE_FALSE(q.tryPop(v));
+}
+
+
+TEST_CASE("SpscQueue delivers items in order across threads", "[spscqueue]")
+{
+  bd::SpscQueue<int> q{ 4 };
+  std::atomic_bool stop{ false };
+  int const count{ 100000 };
+
+  std::thread producer{ [&]() {
+    for (int i = 0; i < count; ++i) {
+      q.push(i, stop);
+    }
+  } };
+
+  bool inOrder{ true };
+  int v{ -1 };
+  for (int i = 0; i < count; ++i) {
+    q.pop(v, stop);
+    inOrder = inOrder && v == i;
+  }
+  producer.join();
+
+  REQUIRE(inOrder);
+  REQUIRE(q.size() == 0);
+}
+
+
+TEST_CASE("SpscQueue pop returns when stop is requested", "[spscqueue]")
+{
+  bd::SpscQueue<int> q{ 2 };
+  std::atomic_bool stop{ false };
+
+  std::thread waker{ [&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    stop = true;
+    q.wake();
+  } };
+
+  int v{ 0 };
+  REQUIRE_FALSE(q.pop(v, stop));
+  REQUIRE(q.popStalls() == 1);
+  waker.join();
+}
@@ -0,0 +1,133 @@
+//
+// Created by jim on 3/2/19.
+//
+
+#include <bd/io/bufferedreader.h>
+
+#include <catch.hpp>
+
+#include <fstream>
+#include <vector>
+
+#define RES_DIR RESOURCE_FOLDER
+
+namespace
+{
+
+std::vector<unsigned char>
+readAll(char const *path)
+{
+  std::ifstream in(path, std::ios::binary);
+  return std::vector<unsigned char>(std::istreambuf_iterator<char>(in),
+                                    std::istreambuf_iterator<char>());
+}
+
+
+/// Drain the reader, copying each buffer into its place in the result.
+template<class Reader>
+std::vector<unsigned char>
+drain(Reader &r, size_t fileSize)
+{
+  std::vector<unsigned char> result(fileSize, 0);
+  bd::Buffer<unsigned char> *buf{ nullptr };
+  while (( buf = r.waitNextFullUntilNone() ) != nullptr) {
+    REQUIRE(buf->getIndexOffset() + buf->getNumElements() <= fileSize);
+    std::copy(buf->getPtr(), buf->getPtr() + buf->getNumElements(),
+              result.begin() + buf->getIndexOffset());
+    r.waitReturnEmpty(buf);
+  }
+  return result;
+}
+
+} // namespace
+
+
+TEST_CASE("BufferedReader reads every byte of the file", "[bufferedreader]")
+{
+  char const *path = RES_DIR "/testvol_8x8x8.raw";
+  std::vector<unsigned char> expected{ readAll(path) };
+  REQUIRE(expected.size() == 512);
+
+  // 4 buffers of 16 bytes each
+  bd::BufferedReader<unsigned char> r{ 64 };
+  REQUIRE(r.open(path));
+  r.start();
+
+  REQUIRE(drain(r, expected.size()) == expected);
+}
+
+
+TEST_CASE("Memory mapped BufferedReader hands out views of the whole file",
+          "[bufferedreader][mmap]")
+{
+  char const *path = RES_DIR "/testvol_8x8x8.raw";
+  std::vector<unsigned char> expected{ readAll(path) };
+
+  bd::BufferedReader<unsigned char> r{ 64, true };
+  r.setReadAheadBuffers(2);
+  REQUIRE(r.isMemoryMapped());
+  REQUIRE(r.open(path));
+  r.start();
+
+  REQUIRE(drain(r, expected.size()) == expected);
+}
+
+
+TEST_CASE("BufferedReader with a lock-free pool reads every byte of the file",
+          "[bufferedreader][spsc]")
+{
+  char const *path = RES_DIR "/testvol_8x8x8.raw";
+  std::vector<unsigned char> expected{ readAll(path) };
+
+  // 8 buffers of 8 bytes each
+  bd::BufferedReader<unsigned char, bd::SpscBufferPool<unsigned char>> r{ 64 };
+  r.setNumBuffers(8);
+  REQUIRE(r.open(path));
+  REQUIRE(r.singleBufferElements() == 8);
+  r.start();
+
+  REQUIRE(drain(r, expected.size()) == expected);
+}
+
+
+TEST_CASE("Memory mapped BufferedReader with a lock-free pool",
+          "[bufferedreader][spsc][mmap]")
+{
+  char const *path = RES_DIR "/testvol_8x8x8.raw";
+  std::vector<unsigned char> expected{ readAll(path) };
+
+  bd::BufferedReader<unsigned char, bd::SpscBufferPool<unsigned char>> r{ 64, true };
+  r.setNumBuffers(2);
+  REQUIRE(r.open(path));
+  r.start();
+
+  REQUIRE(drain(r, expected.size()) == expected);
+}
+
+
+TEST_CASE("Striped BufferedReader delivers buffers in file order",
+          "[bufferedreader][striped]")
+{
+  char const *path = RES_DIR "/testvol_8x8x8.raw";
+  std::vector<unsigned char> expected{ readAll(path) };
+
+  // 3 readers, each with 2 buffers of 8 bytes.
+  bd::BufferedReader<unsigned char> r{ 64 };
+  r.setNumBuffers(8);
+  r.setNumReaders(3);
+  REQUIRE(r.open(path));
+  REQUIRE(r.singleBufferElements() == 8);
+  r.start();
+
+  std::vector<unsigned char> result;
+  bd::Buffer<unsigned char> *buf{ nullptr };
+  while (( buf = r.waitNextFullUntilNone() ) != nullptr) {
+    REQUIRE(buf->getIndexOffset() == result.size());
+    result.insert(result.end(),
+                  buf->getPtr(), buf->getPtr() + buf->getNumElements());
+    r.waitReturnEmpty(buf);
+  }
+
+  REQUIRE(result == expected);
+  REQUIRE(r.reset() == 512);
+}
@@ -5,9 +5,17 @@
 
 #include <bd/io/fileblock.h>
 #include <bd/io/indexfile/indexfile.h>
+#include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/io/indexfile/v3/binaryindexfile.h>
 
 #include <catch.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
 
 TEST_CASE("I don't know yet")
 {
@@ -98,3 +106,331 @@ TEST_CASE("Byte offsets are correct")
   offset = block->data_offset;
   REQUIRE(offset == (256 * 256 * 128) + (256 * 128) + 128);
 }
+
+
+TEST_CASE("Json index file round trips block stats", "[jsonindexfile]")
+{
+  bd::IndexFile index_file;
+  index_file.setVolume(bd::Volume{ { 8, 8, 8 }, { 2, 2, 2 } });
+  index_file.init(bd::DataType::UnsignedCharacter);
+
+  std::vector<bd::FileBlock> blocks{ index_file.getFileBlocks() };
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    blocks[i].rov = 0.125 * i;
+    blocks[i].min_val = i;
+    blocks[i].max_val = 2.0 * i;
+    blocks[i].avg_val = 1.5 * i;
+    blocks[i].total_val = 64 * 1.5 * i;
+    blocks[i].empty_voxels = i == 0 ? 64 : i;
+  }
+
+  bd::Volume vol{ index_file.getVolume() };
+  vol.min(0);
+  vol.max(14);
+  vol.rovMin(0);
+  vol.rovMax(0.875);
+
+  bd::indexfile::v2::JsonIndexFile out;
+  out.setRawFileName("testvol_8x8x8.raw");
+  out.setRawFilePath(".");
+  out.setTFFileName("scalar_opacity_tf.1dt");
+  out.setDatType(bd::DataType::UnsignedCharacter);
+  out.setVolume(vol);
+  out.setFileBlocks(blocks);
+  REQUIRE(out.write("test_jsonindexfile.json"));
+
+  bd::indexfile::v2::JsonIndexFile in;
+  REQUIRE(in.open("test_jsonindexfile.json"));
+  REQUIRE(in.getDatType() == bd::DataType::UnsignedCharacter);
+  REQUIRE(in.getVolume().block_count().x == 2);
+  REQUIRE(in.getVolume().rovMax() == 0.875);
+
+  std::vector<bd::FileBlock> const &read{ in.getFileBlocks() };
+  REQUIRE(read.size() == blocks.size());
+  for (size_t i = 0; i < read.size(); ++i) {
+    REQUIRE(read[i].data_offset == blocks[i].data_offset);
+    REQUIRE(read[i].rov == blocks[i].rov);
+    REQUIRE(read[i].min_val == blocks[i].min_val);
+    REQUIRE(read[i].max_val == blocks[i].max_val);
+    REQUIRE(read[i].avg_val == blocks[i].avg_val);
+    REQUIRE(read[i].empty_voxels == blocks[i].empty_voxels);
+  }
+  REQUIRE(read[0].is_empty == 1);
+  REQUIRE(read[1].is_empty == 0);
+  REQUIRE_FALSE(in.isBricked());
+
+  out.setBrickOrder("morton");
+  REQUIRE(out.write("test_jsonindexfile.json"));
+  REQUIRE(in.open("test_jsonindexfile.json"));
+  REQUIRE(in.isBricked());
+  REQUIRE(in.getBrickOrder() == "morton");
+}
+
+
+TEST_CASE("Binary index file round trips a json index", "[binaryindexfile]")
+{
+  bd::IndexFile index_file;
+  index_file.setVolume(bd::Volume{ { 8, 8, 8 }, { 2, 2, 2 } });
+  index_file.init(bd::DataType::UnsignedShort);
+
+  std::vector<bd::FileBlock> blocks{ index_file.getFileBlocks() };
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    blocks[i].rov = 0.125 * i;
+    blocks[i].min_val = i;
+    blocks[i].max_val = 2.0 * i;
+    blocks[i].avg_val = 1.5 * i;
+    blocks[i].total_val = 64 * 1.5 * i;
+    blocks[i].empty_voxels = i == 0 ? 64 : i;
+  }
+
+  bd::Volume vol{ index_file.getVolume() };
+  vol.min(0);
+  vol.max(14);
+  vol.rovMax(0.875);
+
+  bd::indexfile::v2::JsonIndexFile json;
+  json.setRawFileName("testvol_8x8x8.raw");
+  json.setRawFilePath(".");
+  json.setTFFileName("scalar_opacity_tf.1dt");
+  json.setDatType(bd::DataType::UnsignedShort);
+  json.setVolume(vol);
+  json.setFileBlocks(blocks);
+  json.setBrickOrder("morton");
+  REQUIRE(bd::indexfile::v3::BinaryIndexFile::write("test_binaryindexfile.idx", json));
+  REQUIRE(bd::indexfile::v3::BinaryIndexFile::isBinaryIndexFile("test_binaryindexfile.idx"));
+
+  bd::indexfile::v3::BinaryIndexFile bin;
+  REQUIRE(bin.open("test_binaryindexfile.idx"));
+  REQUIRE(bin.getNumBlocks() == blocks.size());
+  REQUIRE(bin.getDatType() == bd::DataType::UnsignedShort);
+  REQUIRE(bin.getRawFileName() == "testvol_8x8x8.raw");
+  REQUIRE(bin.getTFFileName() == "scalar_opacity_tf.1dt");
+  REQUIRE(bin.getBrickOrder() == "morton");
+  REQUIRE(bin.getVolume().block_count().z == 2);
+  REQUIRE(bin.getVolume().rovMax() == 0.875);
+
+  // columns are used in place.
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    REQUIRE(bin.getRov()[i] == blocks[i].rov);
+    REQUIRE(bin.getMax()[i] == blocks[i].max_val);
+    REQUIRE(bin.getDataOffsets()[i] == blocks[i].data_offset);
+    REQUIRE(bin.getDataBytes()[i] == blocks[i].data_bytes);
+    REQUIRE(bin.getIjk()[3 * i + 2] == blocks[i].ijk_index[2]);
+  }
+  REQUIRE(reinterpret_cast<uintptr_t>(bin.getRov()) % 64 == 0);
+
+  bd::indexfile::v2::JsonIndexFile copy;
+  bin.copyTo(copy);
+  REQUIRE(copy.isBricked());
+  std::vector<bd::FileBlock> const &read{ copy.getFileBlocks() };
+  REQUIRE(read.size() == blocks.size());
+  for (size_t i = 0; i < read.size(); ++i) {
+    REQUIRE(read[i].block_index == blocks[i].block_index);
+    REQUIRE(read[i].world_oigin[1] == blocks[i].world_oigin[1]);
+    REQUIRE(read[i].voxel_dims[0] == blocks[i].voxel_dims[0]);
+    REQUIRE(read[i].avg_val == blocks[i].avg_val);
+    REQUIRE(read[i].total_val == blocks[i].total_val);
+    REQUIRE(read[i].empty_voxels == blocks[i].empty_voxels);
+  }
+  REQUIRE(read[0].is_empty == 1);
+  REQUIRE(read[1].is_empty == 0);
+
+  bd::indexfile::v2::JsonIndexFile header;
+  bin.copyHeaderTo(header);
+  REQUIRE(header.isBricked());
+  REQUIRE(header.getRawFileName() == "testvol_8x8x8.raw");
+  REQUIRE(header.getVolume().block_count().z == 2);
+  REQUIRE(header.getFileBlocks().empty());
+}
+
+
+TEST_CASE("Binary index file rejects damaged files", "[binaryindexfile]")
+{
+  bd::IndexFile index_file;
+  index_file.setVolume(bd::Volume{ { 8, 8, 8 }, { 2, 2, 2 } });
+  index_file.init(bd::DataType::UnsignedCharacter);
+
+  bd::indexfile::v2::JsonIndexFile json;
+  json.setDatType(bd::DataType::UnsignedCharacter);
+  json.setVolume(index_file.getVolume());
+  json.setFileBlocks(index_file.getFileBlocks());
+  REQUIRE(bd::indexfile::v3::BinaryIndexFile::write("test_binaryindexfile.idx", json));
+
+  std::ifstream is{ "test_binaryindexfile.idx", std::ios::binary };
+  std::string const good{ std::istreambuf_iterator<char>(is),
+                          std::istreambuf_iterator<char>() };
+  is.close();
+
+  auto openDamaged = [&good](std::string const &bytes) {
+    std::ofstream os{ "test_binaryindexfile_bad.idx", std::ios::binary };
+    os.write(bytes.data(), bytes.size());
+    os.close();
+    bd::indexfile::v3::BinaryIndexFile bin;
+    return bin.open("test_binaryindexfile_bad.idx");
+  };
+
+  REQUIRE(openDamaged(good));
+
+  std::string bad{ good };
+  bad[0] = 'X';
+  REQUIRE_FALSE(openDamaged(bad));
+
+  // the other byte order.
+  bad = good;
+  std::swap(bad[8], bad[11]);
+  std::swap(bad[9], bad[10]);
+  REQUIRE_FALSE(openDamaged(bad));
+
+  bad = good;
+  bad[12] = 2;
+  REQUIRE_FALSE(openDamaged(bad));
+
+  REQUIRE_FALSE(openDamaged(good.substr(0, good.size() - 8)));
+
+  // a section table that starts past the end of the file.
+  using bd::indexfile::v3::FileHeader;
+  bad = good;
+  uint32_t const headerBytes{ 0xfffffff0 };
+  std::memcpy(&bad[offsetof(FileHeader, header_bytes)], &headerBytes, sizeof(headerBytes));
+  REQUIRE_FALSE(openDamaged(bad));
+
+  // a block count that overflows the xyz column sizes.
+  bad = good;
+  uint64_t const numBlocks{ UINT64_MAX / 3 + 1 };
+  std::memcpy(&bad[offsetof(FileHeader, num_blocks)], &numBlocks, sizeof(numBlocks));
+  REQUIRE_FALSE(openDamaged(bad));
+}
+
+
+TEST_CASE("Json index file parses keys in any order", "[jsonindexfile]")
+{
+  {
+    std::ofstream os{ "test_jsonindexfile_order.json" };
+    os << R"({
+      "num_blocks": [2, 1, 1],
+      "extra": { "blocks": [ { "index": 9 } ], "rel": [1, 2] },
+      "vol_stats": { "tot": 4, "max": 3.5, "min": -1, "avg": 0.5 },
+      "volume": { "vox_dims": [4, 2, 2], "world_dims": [1.0, 0.5, 0.5] },
+      "dtype": "f4",
+      "vol_path": "/data",
+      "vol_name": "v.raw",
+      "tr_func": "tf.1dt",
+      "blocks": [
+        { "rel": 1, "ijk": [0, 0, 0], "index": 0, "offset": 0,
+          "data_bytes": 32, "vox_dims": [2, 2, 2], "unknown": { "a": [1] },
+          "origin": [-0.25, 0, 0], "dims": [0.5, 0.5, 0.5],
+          "empty_voxels": 8 },
+        { "dims": [0.5, 0.5, 0.5], "origin": [0.25, 0, 0], "index": 1,
+          "ijk": [1, 0, 0], "offset": 8, "data_bytes": 32,
+          "vox_dims": [2, 2, 2], "rel": 0.5, "min": 1, "max": 3.5 }
+      ]
+    })";
+  }
+
+  bd::indexfile::v2::JsonIndexFile in;
+  REQUIRE(in.open("test_jsonindexfile_order.json"));
+  REQUIRE(in.getDatType() == bd::DataType::Float);
+  REQUIRE(in.getRawFilePath() == "/data");
+  REQUIRE(in.getVolume().block_count().x == 2);
+  REQUIRE(in.getVolume().voxelDims().x == 4);
+  REQUIRE(in.getVolume().worldDims().y == 0.5f);
+  REQUIRE(in.getVolume().min() == -1.0);
+  REQUIRE(in.getVolume().total() == 4.0);
+
+  std::vector<bd::FileBlock> const &read{ in.getFileBlocks() };
+  REQUIRE(read.size() == 2);
+  REQUIRE(read[0].rov == 1.0);
+  REQUIRE(read[0].world_oigin[0] == -0.25);
+  REQUIRE(read[0].is_empty == 1);
+  REQUIRE(read[1].block_index == 1);
+  REQUIRE(read[1].data_offset == 8);
+  REQUIRE(read[1].ijk_index[0] == 1);
+  REQUIRE(read[1].max_val == 3.5);
+  REQUIRE(read[1].is_empty == 0);
+}
+
+
+TEST_CASE("Json index file rejects missing keys", "[jsonindexfile]")
+{
+  {
+    std::ofstream os{ "test_jsonindexfile_bad.json" };
+    os << R"({ "num_blocks": [1, 1, 1], "dtype": "f4", "vol_path": "",
+      "vol_name": "v.raw", "tr_func": "",
+      "vol_stats": { "tot": 0, "max": 0, "min": 0, "avg": 0 },
+      "volume": { "vox_dims": [2, 2, 2], "world_dims": [1, 1, 1] },
+      "blocks": [ { "index": 0, "ijk": [0, 0, 0], "offset": 0,
+                    "data_bytes": 8, "vox_dims": [2, 2, 2],
+                    "origin": [0, 0, 0], "dims": [1, 1, 1] } ] })";
+  }
+  bd::indexfile::v2::JsonIndexFile in;
+  REQUIRE_FALSE(in.open("test_jsonindexfile_bad.json"));
+
+  {
+    std::ofstream os{ "test_jsonindexfile_bad.json" };
+    os << R"({ "blocks": [], "dtype": "f4" )";
+  }
+  REQUIRE_FALSE(in.open("test_jsonindexfile_bad.json"));
+}
+
+
+TEST_CASE("Index files round trip block histograms", "[jsonindexfile][binaryindexfile]")
+{
+  bd::IndexFile index_file;
+  index_file.setVolume(bd::Volume{ { 8, 8, 8 }, { 2, 2, 1 } });
+  index_file.init(bd::DataType::UnsignedShort);
+
+  uint32_t const bins{ 4 };
+  std::vector<uint32_t> hist;
+  for (uint32_t i = 0; i < 4 * bins; ++i) {
+    hist.push_back(i * 7 % 128);
+  }
+
+  bd::indexfile::v2::JsonIndexFile out;
+  out.setDatType(bd::DataType::UnsignedShort);
+  out.setVolume(index_file.getVolume());
+  out.setFileBlocks(index_file.getFileBlocks());
+  out.setHistograms(bins, hist);
+  REQUIRE(out.write("test_jsonindexfile_hist.json"));
+
+  bd::indexfile::v2::JsonIndexFile in;
+  REQUIRE(in.open("test_jsonindexfile_hist.json"));
+  REQUIRE(in.getHistogramBins() == bins);
+  REQUIRE(in.getHistograms() == hist);
+
+  REQUIRE(bd::indexfile::v3::BinaryIndexFile::write("test_binaryindexfile_hist.idx", in));
+  bd::indexfile::v3::BinaryIndexFile bin;
+  REQUIRE(bin.open("test_binaryindexfile_hist.idx"));
+  REQUIRE(bin.getHistogramBins() == bins);
+  REQUIRE(std::equal(hist.begin(), hist.end(), bin.getHistograms()));
+
+  bd::indexfile::v2::JsonIndexFile copy;
+  bin.copyTo(copy);
+  REQUIRE(copy.getHistogramBins() == bins);
+  REQUIRE(copy.getHistograms() == hist);
+
+  // without histograms the section is left out.
+  out.setHistograms(0, {});
+  REQUIRE(bd::indexfile::v3::BinaryIndexFile::write("test_binaryindexfile_hist.idx", out));
+  REQUIRE(bin.open("test_binaryindexfile_hist.idx"));
+  REQUIRE(bin.getHistogramBins() == 0);
+  REQUIRE(bin.getHistograms() == nullptr);
+
+  // every block must have the same number of bins.
+  hist.pop_back();
+  out.setHistograms(bins, hist);
+  REQUIRE_FALSE(out.write("test_jsonindexfile_hist.json"));
+  {
+    std::ofstream os{ "test_jsonindexfile_hist.json" };
+    os << R"({ "num_blocks": [2, 1, 1], "dtype": "f4", "vol_path": "",
+      "vol_name": "v.raw", "tr_func": "",
+      "vol_stats": { "tot": 0, "max": 0, "min": 0, "avg": 0 },
+      "volume": { "vox_dims": [4, 2, 2], "world_dims": [1, 1, 1] },
+      "blocks": [ { "index": 0, "ijk": [0, 0, 0], "offset": 0, "rel": 0,
+                    "data_bytes": 32, "vox_dims": [2, 2, 2],
+                    "origin": [0, 0, 0], "dims": [1, 1, 1], "hist": [6, 2] },
+                  { "index": 1, "ijk": [1, 0, 0], "offset": 8, "rel": 0,
+                    "data_bytes": 32, "vox_dims": [2, 2, 2],
+                    "origin": [0, 0, 0], "dims": [1, 1, 1], "hist": [8] } ] })";
+  }
+  REQUIRE_FALSE(in.open("test_jsonindexfile_hist.json"));
+}
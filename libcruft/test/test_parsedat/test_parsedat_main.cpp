@@ -6,6 +6,8 @@
 #include <bd/io/datfile.h>
 #include <bd/io/datatypes.h>
 
+#include <cstdio>
+
 
 #define RES_DIR RESOURCE_FOLDER
 
@@ -25,3 +27,27 @@ TEST_CASE("parseDat parses", "[file][parsedat]")
 }
 
 
+TEST_CASE("writeDat writes what parseDat reads", "[file][parsedat]")
+{
+    const std::string fileName{ "test_writedat.dat" };
+
+    bd::DatFileData out;
+    out.volumeFileName = "synth.raw";
+    out.rX = 1024;
+    out.rY = 512;
+    out.rZ = 2048;
+    out.dataType = bd::DataType::Short;
+    REQUIRE( bd::writeDat(fileName, out) );
+
+    bd::DatFileData in;
+    REQUIRE( bd::parseDat(fileName, in) );
+    std::remove(fileName.c_str());
+
+    REQUIRE( in.volumeFileName == "synth.raw" );
+    REQUIRE( in.dataType == bd::DataType::Short );
+    REQUIRE( in.rX == 1024 );
+    REQUIRE( in.rY == 512 );
+    REQUIRE( in.rZ == 2048 );
+}
+
+
@@ -0,0 +1,59 @@
+//
+// Created by jim on 3/24/19.
+//
+
+#include <bd/tbb/parallelfor.h>
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+
+TEST_CASE("parallelFor visits every index once", "[tbb]")
+{
+  size_t const n{ 10007 };
+  for (int threads : { 0, 1, 3, 64 }) {
+    std::vector<std::atomic<int>> seen(n);
+    for (auto &s : seen) {
+      s = 0;
+    }
+
+    bd::parallelFor(n, threads, [&seen](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        seen[i] += 1;
+      }
+    });
+
+    for (size_t i = 0; i < n; ++i) {
+      REQUIRE(seen[i] == 1);
+    }
+  }
+}
+
+
+TEST_CASE("parallelFor splits on multiples of align", "[tbb]")
+{
+  size_t const n{ 1000 };
+  std::atomic<size_t> covered{ 0 };
+  std::atomic<bool> aligned{ true };
+
+  bd::parallelFor(n, 4, [&](size_t begin, size_t end) {
+    if (begin % 64 != 0 || ( end != n && end % 64 != 0 )) {
+      aligned = false;
+    }
+    covered += end - begin;
+  }, 64);
+
+  REQUIRE(aligned);
+  REQUIRE(covered == n);
+}
+
+
+TEST_CASE("parallelFor does nothing for an empty range", "[tbb]")
+{
+  bool called{ false };
+  bd::parallelFor(0, 4, [&called](size_t, size_t) { called = true; });
+  REQUIRE_FALSE(called);
+}
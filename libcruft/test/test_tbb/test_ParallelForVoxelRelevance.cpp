@@ -0,0 +1,81 @@
+//
+// Created by jim on 3/26/19.
+//
+
+#include <bd/tbb/parallelfor_voxelrelevance.h>
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+
+auto rel = [](uint16_t val) -> bool {
+  return val % 3 == 0;
+};
+
+} // namespace
+
+
+TEST_CASE("parallelForVoxelRelevance sets a bitmap for every element",
+          "[tbb]")
+{
+  // not a multiple of 64, so the last chunk of the bitmap is partial.
+  size_t const n{ 10007 };
+  std::vector<uint16_t> data(n);
+  for (size_t i = 0; i < n; ++i) {
+    data[i] = static_cast<uint16_t>(i * 7);
+  }
+
+  bd::Buffer<uint16_t> buf{ data.data(), n };
+  buf.setNumElements(n);
+
+  std::vector<bool> map(n, false);
+  bd::parallelForVoxelRelevance(buf, rel, map, 4);
+
+  for (size_t i = 0; i < n; ++i) {
+    if (map[i] != rel(data[i])) {
+      FAIL("Map is wrong at index " + std::to_string(i));
+    }
+  }
+}
+
+
+TEST_CASE("parallelForVoxelRelevance only touches the buffer's elements",
+          "[tbb]")
+{
+  std::vector<uint16_t> data{ 3, 3, 3, 3, 3, 3 };
+  bd::Buffer<uint16_t> buf{ data.data(), data.size() };
+  buf.setNumElements(4);
+
+  std::vector<char> map(data.size(), 0);
+  bd::parallelForVoxelRelevance(buf, rel, map, 2);
+
+  REQUIRE(map == std::vector<char>({ 1, 1, 1, 1, 0, 0 }));
+}
+
+
+TEST_CASE("parallelForRelevantCounts counts relevant voxels per block",
+          "[tbb]")
+{
+  // 4 blocks of 1000 voxels, block b has b * 100 relevant voxels.
+  size_t const blockVoxels{ 1000 };
+  std::vector<uint16_t> data(4 * blockVoxels, 1);
+  for (size_t b = 0; b < 4; ++b) {
+    for (size_t i = 0; i < b * 100; ++i) {
+      data[b * blockVoxels + i * 7 % blockVoxels] = 0;
+    }
+  }
+
+  bd::Buffer<uint16_t> buf{ data.data(), data.size() };
+  buf.setNumElements(data.size());
+
+  std::vector<uint64_t> counts{
+      bd::parallelForRelevantCounts(buf, rel,
+                                    [&](size_t i) { return i / blockVoxels; },
+                                    4, 3) };
+
+  REQUIRE(counts == std::vector<uint64_t>({ 0, 100, 200, 300 }));
+}
@@ -0,0 +1,82 @@
+//
+// Created by jim on 3/28/19.
+//
+
+#include <catch.hpp>
+
+#include <bd/util/half.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+
+TEST_CASE("floatToHalf converts known values", "[util][half]")
+{
+    REQUIRE(bd::floatToHalf(0.0f) == 0x0000);
+    REQUIRE(bd::floatToHalf(-0.0f) == 0x8000);
+    REQUIRE(bd::floatToHalf(1.0f) == 0x3c00);
+    REQUIRE(bd::floatToHalf(0.5f) == 0x3800);
+    REQUIRE(bd::floatToHalf(-2.0f) == 0xc000);
+    REQUIRE(bd::floatToHalf(65504.0f) == 0x7bff);
+    REQUIRE(bd::floatToHalf(65520.0f) == 0x7c00);
+    REQUIRE(bd::floatToHalf(std::numeric_limits<float>::infinity()) == 0x7c00);
+    REQUIRE(( bd::floatToHalf(std::nanf("")) & 0x7c00 ) == 0x7c00);
+    REQUIRE(( bd::floatToHalf(std::nanf("")) & 0x03ff ) != 0);
+
+    // smallest subnormal, and half of it rounds to even (zero).
+    REQUIRE(bd::floatToHalf(std::ldexp(1.0f, -24)) == 0x0001);
+    REQUIRE(bd::floatToHalf(std::ldexp(1.0f, -25)) == 0x0000);
+
+    // 1 + 2^-11 is halfway between 1 and the next half, rounds to even.
+    REQUIRE(bd::floatToHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3c00);
+    REQUIRE(bd::floatToHalf(1.0f + 3 * std::ldexp(1.0f, -11)) == 0x3c02);
+}
+
+
+TEST_CASE("Every finite half survives a round trip", "[util][half]")
+{
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+        if (( h & 0x7c00 ) == 0x7c00) {
+            continue;  // inf and nan
+        }
+        uint16_t const back{ bd::floatToHalf(bd::halfToFloat(static_cast<uint16_t>(h))) };
+        if (back != h) {
+            FAIL("Half " + std::to_string(h) + " came back as " + std::to_string(back));
+        }
+    }
+}
+
+
+TEST_CASE("Array conversions match the scalar conversions", "[util][half]")
+{
+    // spread over all float exponents, with a tail that is not a multiple of 8.
+    std::vector<float> f;
+    for (uint32_t u = 0; u < 0xffffffffu - 40009u; u += 40009u) {
+        float v;
+        std::memcpy(&v, &u, sizeof(v));
+        if (!std::isnan(v)) {
+            f.push_back(v);
+        }
+    }
+    f.resize(f.size() / 8 * 8 + 5);
+
+    std::vector<uint16_t> h(f.size());
+    bd::floatToHalf(f.data(), h.data(), f.size());
+    for (size_t i = 0; i < f.size(); ++i) {
+        if (h[i] != bd::floatToHalf(f[i])) {
+            FAIL("floatToHalf differs at " + std::to_string(f[i]));
+        }
+    }
+
+    std::vector<float> back(h.size());
+    bd::halfToFloat(h.data(), back.data(), h.size());
+    for (size_t i = 0; i < h.size(); ++i) {
+        float const expected{ bd::halfToFloat(h[i]) };
+        if (std::memcmp(&back[i], &expected, sizeof(float)) != 0) {
+            FAIL("halfToFloat differs at " + std::to_string(h[i]));
+        }
+    }
+}
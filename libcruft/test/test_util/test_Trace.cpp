@@ -0,0 +1,138 @@
+//
+// Created by jim on 3/31/19.
+//
+
+#include <catch.hpp>
+
+#include <bd/log/trace.h>
+
+#include <nlohmann/json.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+nlohmann::json
+writeAndRead()
+{
+  std::string const path{ "test_Trace.json" };
+  REQUIRE(bd::trace::writeJson(path));
+  std::ifstream f(path);
+  nlohmann::json j;
+  f >> j;
+  std::remove(path.c_str());
+  return j;
+}
+
+} // namespace
+
+
+TEST_CASE("Scopes are recorded only while tracing is enabled", "[trace]")
+{
+  bd::trace::clear();
+  bd::trace::enable(false);
+  {
+    BD_TRACE_SCOPE("off", "test");
+  }
+
+  bd::trace::enable(true);
+  BD_TRACE_THREAD_NAME("test main");
+  {
+    BD_TRACE_SCOPE_ARG("on", "test", "block", 42);
+  }
+  BD_TRACE_COUNTER("queue", 7);
+  bd::trace::enable(false);
+
+  nlohmann::json const j = writeAndRead();
+  int spans{ 0 };
+  int counters{ 0 };
+  bool named{ false };
+  for (auto const &e : j["traceEvents"]) {
+    std::string const ph{ e["ph"].get<std::string>() };
+    if (ph == "X") {
+      ++spans;
+      REQUIRE(e["name"] == "on");
+      REQUIRE(e["args"]["block"] == 42);
+      REQUIRE(e["dur"].get<double>() >= 0.0);
+    } else if (ph == "C") {
+      ++counters;
+      REQUIRE(e["args"]["value"] == 7);
+    } else if (ph == "M") {
+      named = named || e["args"]["name"] == "test main";
+    }
+  }
+  REQUIRE(spans == 1);
+  REQUIRE(counters == 1);
+  REQUIRE(named);
+}
+
+
+TEST_CASE("Each thread gets its own row", "[trace]")
+{
+  bd::trace::clear();
+  bd::trace::enable(true);
+  {
+    BD_TRACE_SCOPE("main", "test");
+  }
+  std::thread t{ []() {
+    BD_TRACE_THREAD_NAME("worker");
+    BD_TRACE_SCOPE("worker", "test");
+  } };
+  t.join();
+  bd::trace::enable(false);
+
+  nlohmann::json const j = writeAndRead();
+  int mainTid{ -1 };
+  int workerTid{ -1 };
+  for (auto const &e : j["traceEvents"]) {
+    if (e["ph"] == "X" && e["name"] == "main") {
+      mainTid = e["tid"];
+    } else if (e["ph"] == "X" && e["name"] == "worker") {
+      workerTid = e["tid"];
+    }
+  }
+  REQUIRE(mainTid > 0);
+  REQUIRE(workerTid > 0);
+  REQUIRE(mainTid != workerTid);
+}
+
+
+TEST_CASE("Threads named while tracing is disabled get no row", "[trace]")
+{
+  bd::trace::clear();
+  bd::trace::enable(false);
+  std::thread quiet{ []() {
+    BD_TRACE_THREAD_NAME("quiet");
+    BD_TRACE_SCOPE("quiet", "test");
+  } };
+  quiet.join();
+
+  bd::trace::enable(true);
+  std::thread t{ []() {
+    BD_TRACE_THREAD_NAME("exited");
+    BD_TRACE_SCOPE("exited", "test");
+  } };
+  t.join();
+  bd::trace::enable(false);
+
+  nlohmann::json const j = writeAndRead();
+  int exitedTid{ -1 };
+  int exitedNameTid{ -2 };
+  for (auto const &e : j["traceEvents"]) {
+    REQUIRE(e["name"] != "quiet");
+    if (e["ph"] == "M") {
+      REQUIRE(e["args"]["name"] != "quiet");
+      if (e["args"]["name"] == "exited") {
+        exitedNameTid = e["tid"];
+      }
+    } else if (e["name"] == "exited") {
+      exitedTid = e["tid"];
+    }
+  }
+  REQUIRE(exitedTid > 0);
+  REQUIRE(exitedTid == exitedNameTid);
+}
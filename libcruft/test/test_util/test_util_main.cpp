@@ -29,5 +29,21 @@ TEST_CASE("to1D generates correct sequence", "[util][to1D]")
 }
 
 
-
-
+TEST_CASE("mortonEncode interleaves x, y, z bits", "[util][morton]")
+{
+    REQUIRE(bd::mortonEncode(0, 0, 0) == 0);
+    REQUIRE(bd::mortonEncode(1, 0, 0) == 1);
+    REQUIRE(bd::mortonEncode(0, 1, 0) == 2);
+    REQUIRE(bd::mortonEncode(0, 0, 1) == 4);
+    REQUIRE(bd::mortonEncode(3, 3, 3) == 63);
+    REQUIRE(bd::mortonEncode(0x1fffff, 0, 0) == 0x1249249249249249ULL);
+
+    // every code in a 4x4x4 cube is used exactly once.
+    std::vector<int> seen(64, 0);
+    for( size_t z{ 0 }; z<4; ++z)
+    for( size_t y{ 0 }; y<4; ++y)
+    for( size_t x{ 0 }; x<4; ++x) {
+        seen[bd::mortonEncode(x, y, z)] += 1;
+    }
+    REQUIRE(std::count(seen.begin(), seen.end(), 1) == 64);
+}
@@ -0,0 +1,77 @@
+//
+// Created by jim on 3/16/19.
+//
+
+#include <bd/volume/blockhistogram.h>
+#include <bd/volume/opacitylut.h>
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#define RES_DIR RESOURCE_FOLDER
+
+
+TEST_CASE("histogramBin clamps values to the end bins", "[histogram]")
+{
+  REQUIRE(bd::histogramBin(0.0, 64) == 0);
+  REQUIRE(bd::histogramBin(-0.5, 64) == 0);
+  REQUIRE(bd::histogramBin(0.5, 64) == 32);
+  REQUIRE(bd::histogramBin(0.999, 64) == 63);
+  REQUIRE(bd::histogramBin(1.0, 64) == 63);
+  REQUIRE(bd::histogramBin(7.0, 64) == 63);
+}
+
+
+TEST_CASE("Histogram ROV is close to the ROV of the voxels", "[histogram]")
+{
+  bd::OpacityTransferFunction otf{ };
+  otf.load(RES_DIR "/scalar_opacity_tf.1dt");
+
+  std::mt19937 gen{ 11 };
+  std::uniform_real_distribution<double> u{ 0.0, 1.0 };
+  std::normal_distribution<double> n{ 0.3, 0.1 };
+
+  for (uint32_t bins : { 64u, 256u }) {
+    std::vector<double> const op{ bd::binOpacities(otf, bins) };
+    REQUIRE(op.size() == bins);
+
+    for (int block = 0; block < 20; ++block) {
+      std::vector<uint32_t> hist(bins, 0);
+      double rov{ 0.0 };
+      uint64_t const voxels{ 4096 };
+      for (uint64_t i = 0; i < voxels; ++i) {
+        double v{ block % 2 ? u(gen) : n(gen) };
+        v = std::min(1.0, std::max(0.0, v));
+        rov += bd::opacityAt(otf.getKnotsVector(), v);
+        hist[bd::histogramBin(v, bins)] += 1;
+      }
+      rov /= voxels;
+
+      REQUIRE(std::abs(bd::histogramRov(hist.data(), op) - rov) < 0.01);
+    }
+  }
+}
+
+
+TEST_CASE("Histogram empty voxels are in bins with no opacity", "[histogram]")
+{
+  bd::OpacityTransferFunction otf{ };
+  otf.load(RES_DIR "/scalar_opacity_tf.1dt");
+
+  // the opacity is 0 up to 0.16.
+  std::vector<double> const op{ bd::binOpacities(otf, 64) };
+  std::vector<uint32_t> hist(64, 0);
+  hist[bd::histogramBin(0.05, 64)] = 10;
+  hist[bd::histogramBin(0.15, 64)] = 5;
+  hist[bd::histogramBin(0.5, 64)] = 7;
+
+  REQUIRE(bd::histogramEmptyVoxels(hist.data(), op) == 15);
+  REQUIRE(bd::histogramRov(hist.data(), op) == Approx(7.0 / 22.0));
+
+  std::vector<uint32_t> const none(64, 0);
+  REQUIRE(bd::histogramRov(none.data(), op) == 0.0);
+}
@@ -0,0 +1,131 @@
+//
+// Created by jim on 3/13/19.
+//
+
+#include <bd/volume/gridorder.h>
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+glm::u64vec3
+ijkOf(glm::u64vec3 const &c)
+{
+  return c;
+}
+
+} // namespace
+
+
+TEST_CASE("GridOrder walks an axis from both ends to the eye", "[gridorder]")
+{
+  bd::GridOrder order{{ 5, 1, 1 }};
+
+  order.setEyeCell({ 2, 0, 0 });
+  std::vector<uint64_t> ranks;
+  for (uint64_t i = 0; i < 5; ++i) {
+    ranks.push_back(order.rank({ i, 0, 0 }));
+  }
+  REQUIRE(ranks == std::vector<uint64_t>({ 0, 1, 4, 3, 2 }));
+
+  // outside the grid the eye is clamped to the nearest cell.
+  order.setEyeCell({ 7, -3, 9 });
+  REQUIRE(order.eyeCell() == glm::i64vec3(4, 0, 0));
+  REQUIRE(order.rank({ 0, 0, 0 }) == 0);
+  REQUIRE(order.rank({ 4, 0, 0 }) == 4);
+}
+
+
+TEST_CASE("GridOrder reports when the eye changes cell", "[gridorder]")
+{
+  bd::GridOrder order{{ 4, 4, 4 }};
+  order.setWorldBox({ -0.5f, -0.5f, -0.5f }, { 0.25f, 0.25f, 0.25f });
+
+  REQUIRE(order.setEye({ 0.1f, 0.1f, 0.1f }));
+  REQUIRE(order.eyeCell() == glm::i64vec3(2, 2, 2));
+  REQUIRE_FALSE(order.setEye({ 0.2f, 0.05f, 0.24f }));
+  REQUIRE(order.setEye({ -0.1f, 0.1f, 0.1f }));
+  REQUIRE(order.eyeCell() == glm::i64vec3(1, 2, 2));
+}
+
+
+TEST_CASE("GridOrder puts cells behind the cells that hide them", "[gridorder]")
+{
+  glm::u64vec3 const dims{ 5, 3, 4 };
+  bd::GridOrder order{ dims };
+  glm::vec3 const cell{ 0.2f, 0.3f, 0.25f };
+  glm::vec3 const min{ -0.5f, -0.45f, -0.5f };
+  order.setWorldBox(min, cell);
+  glm::vec3 const max{ min + cell * glm::vec3(dims) };
+
+  std::mt19937 gen{ 7 };
+  std::uniform_real_distribution<float> u{ 0.0f, 1.0f };
+
+  bool ok{ true };
+  for (int e = 0; e < 200; ++e) {
+    // eyes inside and outside of the grid.
+    glm::vec3 const eye{ min + ( max - min ) * ( glm::vec3(u(gen), u(gen), u(gen)) * 3.0f - 1.0f ) };
+    order.setEye(eye);
+
+    for (int r = 0; r < 20; ++r) {
+      glm::vec3 const target{ min + ( max - min ) * glm::vec3(u(gen), u(gen), u(gen)) };
+
+      // march from the eye through the target; ranks must not increase.
+      uint64_t last{ ~uint64_t(0) };
+      for (int s = 0; s <= 2000; ++s) {
+        glm::vec3 const p{ eye + ( target - eye ) * ( s / 1000.0f ) };
+        glm::vec3 const c{ ( p - min ) / cell };
+        if (c.x < 0 || c.y < 0 || c.z < 0 ||
+            c.x >= dims.x || c.y >= dims.y || c.z >= dims.z) {
+          continue;
+        }
+        uint64_t const rank{ order.rank(glm::u64vec3(c)) };
+        ok = ok && rank <= last;
+        last = rank;
+      }
+    }
+  }
+  REQUIRE(ok);
+}
+
+
+TEST_CASE("GridOrder sorts a subset of the cells", "[gridorder]")
+{
+  glm::u64vec3 const dims{ 6, 5, 7 };
+  bd::GridOrder order{ dims };
+
+  std::vector<glm::u64vec3> cells;
+  for (uint64_t k = 0; k < dims.z; ++k) {
+    for (uint64_t j = 0; j < dims.y; ++j) {
+      for (uint64_t i = 0; i < dims.x; ++i) {
+        cells.push_back({ i, j, k });
+      }
+    }
+  }
+  std::mt19937 gen{ 3 };
+  std::shuffle(cells.begin(), cells.end(), gen);
+  cells.resize(cells.size() / 3);
+
+  for (glm::i64vec3 eye : { glm::i64vec3{ 0, 0, 0 }, glm::i64vec3{ 3, 2, 4 },
+                            glm::i64vec3{ -1, 9, 2 }, glm::i64vec3{ 5, 4, 6 } }) {
+    order.setEyeCell(eye);
+    std::vector<glm::u64vec3> sorted{ cells };
+    order.sort(sorted, ijkOf);
+    REQUIRE(order.isSorted(sorted, ijkOf));
+
+    std::vector<glm::u64vec3> expected{ cells };
+    std::sort(expected.begin(), expected.end(),
+              [&order](glm::u64vec3 const &a, glm::u64vec3 const &b) {
+                return order.rank(a) < order.rank(b);
+              });
+    REQUIRE(sorted == expected);
+  }
+
+  std::shuffle(cells.begin(), cells.end(), gen);
+  REQUIRE_FALSE(order.isSorted(cells, ijkOf));
+}
@@ -0,0 +1,84 @@
+//
+// Created by jim on 3/27/19.
+//
+
+#include <bd/volume/occupancymask.h>
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/// Write a transfer function that is transparent below 0.5 and build a
+/// range table for it.
+bd::OpacityRangeTable
+makeTable()
+{
+  std::string const path{ "test_OccupancyMask.1dt" };
+  {
+    std::ofstream f(path);
+    f << "3\n0.0 0.0\n0.5 0.0\n1.0 1.0\n";
+  }
+  bd::OpacityTransferFunction otf;
+  otf.load(path);
+  std::remove(path.c_str());
+
+  return bd::OpacityRangeTable{ otf };
+}
+
+} // namespace
+
+
+TEST_CASE("A new mask is fully occupied", "[occupancymask]")
+{
+  bd::OccupancyMask mask;
+  REQUIRE(mask.count() == bd::OccupancyMask::Cells);
+  REQUIRE(mask.generation() == 0);
+}
+
+
+TEST_CASE("Only cells near visible voxels are occupied", "[occupancymask]")
+{
+  bd::OpacityRangeTable const table{ makeTable() };
+  uint64_t const dims[3]{ 32, 32, 32 };  // cells of 4^3 voxels.
+  std::vector<float> voxels(32 * 32 * 32, 0.1f);
+
+  // one visible voxel, in cell (2, 3, 4) and on the low x face of it.
+  voxels[( 17 * 32 + 13 ) * 32 + 8] = 0.9f;
+
+  bd::OccupancyMask mask;
+  mask.compute(voxels.data(), dims, table, 7);
+
+  REQUIRE(mask.generation() == 7);
+  REQUIRE(mask.cellExtent()[0] == 4);
+  REQUIRE(mask.occupied(2, 3, 4));
+  // the voxel is also in the apron of the cell before it along x.
+  REQUIRE(mask.occupied(1, 3, 4));
+  REQUIRE(mask.count() == 2);
+  REQUIRE(mask.occupiedVoxel(8, 13, 17));
+  REQUIRE_FALSE(mask.occupiedVoxel(20, 13, 17));
+}
+
+
+TEST_CASE("Cells past the edge of a small block are empty", "[occupancymask]")
+{
+  bd::OpacityRangeTable const table{ makeTable() };
+  uint64_t const dims[3]{ 4, 2, 1 };
+  std::vector<float> voxels(8, 0.9f);
+
+  bd::OccupancyMask mask;
+  mask.compute(voxels.data(), dims, table, 1);
+
+  REQUIRE(mask.count() == 8);
+  REQUIRE(mask.occupied(3, 1, 0));
+  REQUIRE_FALSE(mask.occupied(4, 0, 0));
+
+  mask.fill();
+  REQUIRE(mask.count() == bd::OccupancyMask::Cells);
+}
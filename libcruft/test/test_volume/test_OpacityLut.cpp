@@ -0,0 +1,94 @@
+//
+// Created by jim on 3/25/19.
+//
+
+#include <bd/volume/opacitylut.h>
+
+#include <catch.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+
+const std::vector<bd::OpacityKnot> func{
+    { 0.0,  0.0 },
+    { 0.10, 0.1 },
+    { 0.50, 0.8 },
+    { 0.60, 0.9 },
+    { 1.0,  1.0 }
+};
+
+} // namespace
+
+
+TEST_CASE("opacityAt is linear between uneven knots", "[opacitylut]")
+{
+  REQUIRE(std::abs(bd::opacityAt(func, 0.55) - 0.85) < 1e-12);
+  REQUIRE(std::abs(bd::opacityAt(func, 0.3) - 0.45) < 1e-12);
+  REQUIRE(bd::opacityAt(func, 0.6) == 0.9);
+  REQUIRE(bd::opacityAt(func, -1.0) == 0.0);
+  REQUIRE(bd::opacityAt(func, 2.0) == 1.0);
+  REQUIRE(bd::opacityAt({ }, 0.5) == 0.0);
+}
+
+
+TEST_CASE("8 and 16 bit tables have an exact entry per raw value", "[opacitylut]")
+{
+  bd::OpacityLut<uint8_t> const u8{ func, 0, 255 };
+  REQUIRE(u8.size() == 256);
+  for (int v = 0; v < 256; ++v) {
+    REQUIRE(u8(static_cast<uint8_t>(v)) == static_cast<float>(bd::opacityAt(func, v / 255.0)));
+  }
+
+  // normalization by a smaller data range is folded into the table.
+  bd::OpacityLut<int16_t> const s16{ func, -1000, 1000 };
+  REQUIRE(s16.size() == 65536);
+  REQUIRE(s16(-1000) == 0.0f);
+  REQUIRE(s16(-30000) == 0.0f);
+  REQUIRE(s16(30000) == 1.0f);
+  REQUIRE(s16(100) == static_cast<float>(bd::opacityAt(func, 0.55)));
+}
+
+
+TEST_CASE("Float tables are close to the transfer function", "[opacitylut]")
+{
+  bd::OpacityLut<float> const f{ func, -2.0, 2.0 };
+  REQUIRE(f.size() == 65536);
+  for (int i = 0; i <= 1000; ++i) {
+    float const v{ -2.0f + 4.0f * i / 1000.0f };
+    REQUIRE(std::abs(f(v) - bd::opacityAt(func, ( v + 2.0 ) / 4.0)) < 1e-4);
+  }
+  REQUIRE(f(-7.0f) == 0.0f);
+  REQUIRE(f(7.0f) == 1.0f);
+}
+
+
+TEST_CASE("Relevance and classify kernels use the table", "[opacitylut]")
+{
+  bd::OpacityLut<uint8_t> const lut{ func, 0, 255 };
+  std::vector<uint8_t> voxels;
+  for (int v = 0; v < 256; ++v) {
+    voxels.push_back(static_cast<uint8_t>(v));
+  }
+
+  double sum{ 0.0 };
+  uint64_t empty{ 0 };
+  uint64_t relevant{ 0 };
+  for (uint8_t v : voxels) {
+    sum += lut(v);
+    empty += lut(v) <= 0.0f ? 1 : 0;
+    relevant += lut(v) >= 0.8f && lut(v) < 1.0f ? 1 : 0;
+  }
+  REQUIRE(lut.relevance(voxels.data(), voxels.size()) == sum);
+  REQUIRE(lut.emptyVoxels(voxels.data(), voxels.size()) == empty);
+  REQUIRE(empty == 1);
+
+  std::vector<uint8_t> out(voxels.size(), 7);
+  REQUIRE(lut.classify(voxels.data(), voxels.size(), 0.8, 1.0, out.data()) == relevant);
+  REQUIRE(out[0] == 0);
+  REQUIRE(out[128] == 1);
+  REQUIRE(out[255] == 0);
+}
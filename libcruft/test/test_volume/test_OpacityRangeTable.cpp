@@ -0,0 +1,76 @@
+//
+// Created by jim on 3/24/19.
+//
+
+#include <bd/volume/opacityrangetable.h>
+
+#include <catch.hpp>
+
+#include <fstream>
+#include <string>
+
+namespace
+{
+
+/// \brief Write knots to a .1dt file and load it.
+bd::OpacityTransferFunction
+makeOtf(std::string const &knots, size_t numKnots)
+{
+  std::string const path{ "test_OpacityRangeTable.1dt" };
+  {
+    std::ofstream f(path);
+    f << numKnots << '\n' << knots;
+  }
+  bd::OpacityTransferFunction otf{ };
+  otf.load(path);
+  return otf;
+}
+
+} // namespace
+
+
+TEST_CASE("A table with no transfer function culls nothing", "[opacityrange]")
+{
+  bd::OpacityRangeTable t{ };
+  REQUIRE_FALSE(t.valid());
+  REQUIRE_FALSE(t.isTransparent(0.0, 0.0));
+  REQUIRE_FALSE(t.isTransparent(0.2, 0.8));
+}
+
+
+TEST_CASE("Ranges with zero opacity are transparent", "[opacityrange]")
+{
+  // zero below 0.25, a ramp up to 0.5, then zero again from 0.75.
+  bd::OpacityTransferFunction const otf{
+      makeOtf("0.0 0.0\n0.25 0.0\n0.5 1.0\n0.75 0.0\n1.0 0.0\n", 5) };
+  bd::OpacityRangeTable const t{ otf, 1024 };
+  REQUIRE(t.valid());
+
+  REQUIRE(t.isTransparent(0.0, 0.2));
+  REQUIRE(t.isTransparent(0.8, 1.0));
+  REQUIRE(t.isTransparent(0.9, 0.8));
+
+  REQUIRE_FALSE(t.isTransparent(0.3, 0.4));
+  REQUIRE_FALSE(t.isTransparent(0.0, 1.0));
+  REQUIRE_FALSE(t.isTransparent(0.1, 0.26));
+  REQUIRE_FALSE(t.isTransparent(0.74, 0.9));
+  REQUIRE_FALSE(t.isTransparent(0.5, 0.5));
+
+  // clamped to [0, 1].
+  REQUIRE(t.isTransparent(-3.0, 0.1));
+  REQUIRE(t.isTransparent(0.9, 7.0));
+}
+
+
+TEST_CASE("A narrow spike between entries is not culled", "[opacityrange]")
+{
+  bd::OpacityTransferFunction const otf{
+      makeOtf("0.0 0.0\n0.5003 0.0\n0.5004 0.5\n0.5005 0.0\n1.0 0.0\n", 5) };
+
+  // entries are much wider than the spike.
+  bd::OpacityRangeTable const t{ otf, 16 };
+  REQUIRE_FALSE(t.isTransparent(0.5, 0.55));
+  REQUIRE_FALSE(t.isTransparent(0.4, 0.51));
+  REQUIRE(t.isTransparent(0.0, 0.4));
+  REQUIRE(t.isTransparent(0.7, 1.0));
+}
@@ -0,0 +1,115 @@
+//
+// Created by jim on 4/1/19.
+//
+
+#include <bd/volume/synthvolume.h>
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+
+double
+emptyFraction(bd::SynthVolume const &v)
+{
+  glm::u64vec3 const d{ v.dims() };
+  std::vector<float> voxels(d.x * d.y * d.z);
+  uint64_t const empty{ v.fill(0, d.z, voxels.data()) };
+  return static_cast<double>(empty) / voxels.size();
+}
+
+} // namespace
+
+
+TEST_CASE("SynthVolume patterns are about as empty as asked for", "[synthvolume]")
+{
+  glm::u64vec3 const dims{ 64, 48, 80 };
+
+  for (double e : { 0.25, 0.5, 0.9 }) {
+    REQUIRE(emptyFraction({ dims, bd::SynthPattern::Shells, e }) == Approx(e).epsilon(0.08));
+    REQUIRE(emptyFraction({ dims, bd::SynthPattern::Noise, e }) == Approx(e).epsilon(0.08));
+    REQUIRE(emptyFraction({ dims, bd::SynthPattern::Blobs, e }) == Approx(e).epsilon(0.08));
+  }
+
+  // slabs are all or nothing, 5 of them here.
+  REQUIRE(emptyFraction({ dims, bd::SynthPattern::Slabs, 0.5 }) == Approx(0.5).epsilon(0.25));
+
+  REQUIRE(emptyFraction({ dims, bd::SynthPattern::Noise, 0.0 }) == 0.0);
+  REQUIRE(emptyFraction({ dims, bd::SynthPattern::Noise, 1.0 }) == 1.0);
+}
+
+
+TEST_CASE("SynthVolume slabs are constant in each xy slice", "[synthvolume]")
+{
+  bd::SynthVolume v{{ 8, 8, 64 }, bd::SynthPattern::Slabs, 0.3, 7 };
+  for (uint64_t z = 0; z < 64; ++z) {
+    double const first{ v.sample(0, 0, z) };
+    for (uint64_t y = 0; y < 8; ++y) {
+      for (uint64_t x = 0; x < 8; ++x) {
+        REQUIRE(v.sample(x, y, z) == first);
+      }
+    }
+  }
+}
+
+
+TEST_CASE("SynthVolume is the same for the same seed", "[synthvolume]")
+{
+  glm::u64vec3 const dims{ 32, 32, 32 };
+  bd::SynthVolume a{ dims, bd::SynthPattern::Noise, 0.5, 3 };
+  bd::SynthVolume b{ dims, bd::SynthPattern::Noise, 0.5, 3 };
+  bd::SynthVolume c{ dims, bd::SynthPattern::Noise, 0.5, 4 };
+
+  std::vector<uint16_t> va(32 * 32 * 32), vb(va.size()), vc(va.size());
+  a.fill(0, 32, va.data());
+  b.fill(0, 32, vb.data());
+  c.fill(0, 32, vc.data());
+  REQUIRE(va == vb);
+  REQUIRE(va != vc);
+
+  // slabs filled one at a time match the whole volume.
+  std::vector<uint16_t> slabs(va.size());
+  for (uint64_t z = 0; z < 32; z += 5) {
+    uint64_t const nz{ std::min<uint64_t>(5, 32 - z) };
+    a.fill(z, nz, slabs.data() + z * 32 * 32);
+  }
+  REQUIRE(slabs == va);
+}
+
+
+TEST_CASE("SynthVolume scales voxels to the type and keeps 0 empty", "[synthvolume]")
+{
+  REQUIRE(bd::SynthVolume::toVoxel<uint8_t>(0.0) == 0);
+  REQUIRE(bd::SynthVolume::toVoxel<uint8_t>(1e-9) == 1);
+  REQUIRE(bd::SynthVolume::toVoxel<uint8_t>(1.0) == 255);
+  REQUIRE(bd::SynthVolume::toVoxel<int16_t>(1.0) == 32767);
+  REQUIRE(bd::SynthVolume::toVoxel<float>(0.25) == 0.25f);
+
+  bd::SynthVolume v{{ 16, 16, 16 }, bd::SynthPattern::Blobs, 0.6 };
+  std::vector<uint8_t> voxels(16 * 16 * 16);
+  v.fill(0, 16, voxels.data());
+  for (uint64_t z = 0; z < 16; ++z) {
+    for (uint64_t y = 0; y < 16; ++y) {
+      for (uint64_t x = 0; x < 16; ++x) {
+        double const s{ v.sample(x, y, z) };
+        REQUIRE(s >= 0.0);
+        REQUIRE(s <= 1.0);
+        REQUIRE(( voxels[( z * 16 + y ) * 16 + x] == 0 ) == ( s == 0.0 ));
+      }
+    }
+  }
+}
+
+
+TEST_CASE("to_synthPattern parses pattern names", "[synthvolume]")
+{
+  bd::SynthPattern p;
+  REQUIRE(bd::to_synthPattern("blobs", p));
+  REQUIRE(p == bd::SynthPattern::Blobs);
+  REQUIRE(bd::to_synthPattern("slabs", p));
+  REQUIRE(p == bd::SynthPattern::Slabs);
+  REQUIRE_FALSE(bd::to_synthPattern("cubes", p));
+}
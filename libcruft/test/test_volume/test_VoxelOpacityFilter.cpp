@@ -78,3 +78,22 @@ TEST_CASE("Given matching irrelevant voxel, returns false", "[voxelopacityfilter
   bool r{ vof(0) };
   REQUIRE(r == false);
 }
+
+TEST_CASE("Classify agrees with the filter for every voxel", "[voxelopacityfilter][classify]")
+{
+  std::vector<unsigned char> voxels;
+  for (int v = 0; v < 256; ++v) {
+    voxels.push_back(static_cast<unsigned char>(v));
+  }
+
+  std::vector<uint8_t> out(voxels.size(), 0);
+  uint64_t const n{ vof.classify(voxels.data(), voxels.size(), out.data()) };
+
+  uint64_t passed{ 0 };
+  for (size_t i = 0; i < voxels.size(); ++i) {
+    REQUIRE(( out[i] == 1 ) == vof(voxels[i]));
+    passed += out[i];
+  }
+  REQUIRE(n == passed);
+  REQUIRE(n > 0);
+}
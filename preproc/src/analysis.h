@@ -0,0 +1,565 @@
+//
+// Created by jim on 3/6/19.
+//
+
+#ifndef preproc_analysis_h
+#define preproc_analysis_h
+
+#include <bd/io/bufferedreader.h>
+#include <bd/io/datatypes.h>
+#include <bd/io/fileblock.h>
+#include <bd/io/indexfile/indexfile.h>
+#include <bd/log/logger.h>
+#include <bd/tbb/parallelfor.h>
+#include <bd/volume/blockhistogram.h>
+#include <bd/volume/opacitylut.h>
+#include <bd/volume/transferfunction.h>
+#include <bd/volume/volume.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace preproc
+{
+
+/// \brief The index for one blocking factor and one transfer function.
+struct IndexOutput
+{
+  bd::Volume volume;
+  std::vector<bd::FileBlock> blocks;
+  uint32_t histBins;                 ///< 0 if there are no histograms.
+  std::vector<uint32_t> histograms;  ///< histBins counts per block.
+};
+
+
+/// \brief Volume and block statistics for a raw file of \c Ty, for any
+///        number of blocking factors and opacity transfer functions.
+///
+/// The raw file is streamed through a bd::BufferedReader twice, no matter
+/// how many blockings and transfer functions there are. The first pass finds
+/// the volume min/max/total and every block's min/max/total. The second pass
+/// (which needs the volume min/max to normalize voxels) looks up each
+/// voxel's opacity once in a table of each transfer function (see
+/// bd::OpacityLut) and adds it to the voxel's block in every blocking,
+/// giving each block's relevance (ROV) and number of empty voxels. The
+/// second pass also counts each block's normalized voxel values into a
+/// histogram (see bd/volume/blockhistogram.h), which does not depend on the
+/// transfer function.
+///
+/// Buffers always hold whole rows of voxels. The rows of a buffer are split
+/// between the threads, each thread summarizes every row segment that falls
+/// in a block, and the row summaries are then merged into the blocks in row
+/// order. Each block is therefore always summed in the same order and the
+/// results do not depend on the number of threads or the buffer size.
+template<class Ty>
+class VolumeAnalysis
+{
+public:
+
+  /// \param voxelDims Dimensions of the volume.
+  /// \param blockCounts Number of blocks along each axis, one per blocking.
+  /// \param tfs The transfer functions to compute relevance for.
+  VolumeAnalysis(glm::u64vec3 const &voxelDims,
+                 std::vector<glm::u64vec3> const &blockCounts,
+                 std::vector<bd::OpacityTransferFunction const *> const &tfs,
+                 bd::DataType type)
+    : m_voxelDims{ voxelDims }
+    , m_tfs{ tfs }
+    , m_threads{ static_cast<int>(std::thread::hardware_concurrency()) }
+    , m_readers{ 1 }
+    , m_bufferBytes{ 64 * 1024 * 1024 }
+    , m_histBins{ 64 }
+  {
+    uint64_t offset{ 0 };
+    for (glm::u64vec3 const &bc : blockCounts) {
+      bd::IndexFile index;
+      index.setVolume(bd::Volume{ voxelDims, bc });
+      index.init(type);
+
+      Blocking b;
+      b.volume = index.getVolume();
+      b.blocks = index.getFileBlocks();
+      b.segOffset = offset;
+      offset += b.volume.block_count().x + 1;
+      m_blockings.push_back(b);
+    }
+    m_segsPerRow = offset;
+  }
+
+
+  /// \brief Set the number of threads used for the analysis.
+  void
+  setThreads(int n)
+  {
+    m_threads = n < 1 ? 1 : n;
+  }
+
+
+  /// \brief Set the number of threads reading the raw file.
+  void
+  setReaders(int n)
+  {
+    m_readers = n < 1 ? 1 : n;
+  }
+
+
+  /// \brief Set the total size of the read buffers.
+  void
+  setBufferBytes(size_t bytes)
+  {
+    m_bufferBytes = bytes;
+  }
+
+
+  /// \brief Set the number of bins in the block histograms (at most 256,
+  ///        0 for no histograms).
+  void
+  setHistogramBins(uint32_t bins)
+  {
+    m_histBins = std::min<uint32_t>(bins, 256);
+  }
+
+
+  /// \brief Compute volume and block min/max/total/avg.
+  bool
+  volumeStats(std::string const &rawPath);
+
+
+  /// \brief Compute block ROV and empty voxels for every transfer function,
+  ///        and the block histograms.
+  /// \note volumeStats() must have been run first.
+  bool
+  blockRelevance(std::string const &rawPath);
+
+
+  size_t
+  numBlockings() const
+  {
+    return m_blockings.size();
+  }
+
+
+  size_t
+  numTransferFunctions() const
+  {
+    return m_tfs.size();
+  }
+
+
+  /// \brief The index for blocking \c b and transfer function \c t.
+  /// \note Valid after blockRelevance().
+  IndexOutput const &
+  output(size_t b, size_t t) const
+  {
+    return m_blockings[b].outputs[t];
+  }
+
+
+private:
+
+  /// \brief Summary of the voxels of one row that fall within one block.
+  struct Segment
+  {
+    double min;
+    double max;
+    double total;
+    uint64_t empty;
+  };
+
+
+  /// \brief Per thread scratch space for the rows a thread summarizes.
+  struct RowScratch
+  {
+    std::vector<double> values;   ///< A value per voxel of the row.
+    std::vector<uint8_t> bins;    ///< A histogram bin per voxel of the row.
+  };
+
+
+  /// \brief A blocking factor, its block stats and its outputs (one per tf).
+  struct Blocking
+  {
+    bd::Volume volume;
+    std::vector<bd::FileBlock> blocks;
+    std::vector<IndexOutput> outputs;
+    std::vector<uint32_t> histograms;
+    uint64_t segOffset;   ///< First of this blocking's segments in a row.
+  };
+
+
+  /// \brief Stream the file and summarize every row.
+  ///
+  /// Each row has \c segsPerRow segments. Every blocking owns one segment per
+  /// block along x, plus one for the voxels past its blocks' extent (which
+  /// may be empty), starting at Blocking::segOffset.
+  /// rowFn(i, Ty const *row, Segment *segs, RowScratch &scratch)
+  /// fills the segments of row \c i of the current buffer and is called from
+  /// many threads (each thread has its own scratch). mergeFn(row, i, segs)
+  /// is called for every row in order with that row's segments.
+  template<class RowFn, class MergeFn>
+  bool
+  forEachRow(std::string const &rawPath, uint64_t segsPerRow,
+             RowFn rowFn, MergeFn mergeFn);
+
+
+  /// \brief Number of rows of voxels in each read buffer.
+  uint64_t
+  rowsPerBuffer() const
+  {
+    uint64_t const numRows{ m_voxelDims.y * m_voxelDims.z };
+    uint64_t const rows{ m_bufferBytes / ( 4 * m_readers ) /
+                         ( m_voxelDims.x * sizeof(Ty) ) };
+    return std::max<uint64_t>(1, std::min(rows, numRows));
+  }
+
+
+  /// \brief Index of the block that segment \c bi of \c row falls in,
+  ///        or -1 if the segment is outside of the blocks' extent.
+  int64_t
+  blockFor(bd::Volume const &vol, uint64_t row, uint64_t bi) const
+  {
+    glm::u64vec3 const bd{ vol.block_dims() };
+    glm::u64vec3 const bc{ vol.block_count() };
+    uint64_t const bj{ ( row % m_voxelDims.y ) / bd.y };
+    uint64_t const bk{ ( row / m_voxelDims.y ) / bd.z };
+    if (bi >= bc.x || bj >= bc.y || bk >= bc.z) {
+      return -1;
+    }
+    return static_cast<int64_t>(bi + bc.x * ( bj + bk * bc.y ));
+  }
+
+
+  /// \brief Call fn(bi, begin, end) for each of the x segments of a row in
+  ///        blocking \c b.
+  template<class Fn>
+  void
+  forEachSegment(Blocking const &b, Fn fn) const
+  {
+    uint64_t const bcx{ b.volume.block_count().x };
+    uint64_t const bdx{ b.volume.block_dims().x };
+    for (uint64_t bi = 0; bi < bcx; ++bi) {
+      fn(bi, bi * bdx, ( bi + 1 ) * bdx);
+    }
+    fn(bcx, bcx * bdx, m_voxelDims.x);
+  }
+
+
+  glm::u64vec3 m_voxelDims;
+  std::vector<bd::OpacityTransferFunction const *> m_tfs;
+  std::vector<Blocking> m_blockings;
+  uint64_t m_segsPerRow;   ///< Segments in a row over all the blockings.
+
+  bd::Volume m_stats;      ///< Volume wide stats from volumeStats().
+
+  int m_threads;
+  int m_readers;
+  size_t m_bufferBytes;
+  uint32_t m_histBins;
+
+}; // class VolumeAnalysis
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+template<class RowFn, class MergeFn>
+bool
+VolumeAnalysis<Ty>::forEachRow(std::string const &rawPath, uint64_t segsPerRow,
+                               RowFn rowFn, MergeFn mergeFn)
+{
+  uint64_t const rowElems{ m_voxelDims.x };
+  uint64_t const numRows{ m_voxelDims.y * m_voxelDims.z };
+  int const numBuffers{ 4 * m_readers };
+
+  // Size the buffers to hold whole rows.
+  uint64_t const rowsPerBuf{ rowsPerBuffer() };
+
+  bd::BufferedReader<Ty> r{ numBuffers * rowsPerBuf * rowElems * sizeof(Ty) };
+  r.setNumBuffers(numBuffers);
+  r.setNumReaders(m_readers);
+  if (!r.open(rawPath)) {
+    return false;
+  }
+  r.start();
+
+  std::vector<Segment> segs(rowsPerBuf * segsPerRow);
+
+  uint64_t rowsSeen{ 0 };
+  bd::Buffer<Ty> *buf{ nullptr };
+  while (( buf = r.waitNextFullUntilNone() ) != nullptr) {
+    uint64_t const firstRow{ buf->getIndexOffset() / rowElems };
+    uint64_t const rows{ std::min<uint64_t>(buf->getNumElements() / rowElems,
+                                            numRows - firstRow) };
+    Ty const *data{ buf->getPtr() };
+
+    bd::parallelFor(rows, m_threads, [&](size_t begin, size_t end) {
+      RowScratch scratch;
+      for (size_t i = begin; i < end; ++i) {
+        rowFn(i, data + i * rowElems, &segs[i * segsPerRow], scratch);
+      }
+    });
+
+    for (uint64_t i = 0; i < rows; ++i) {
+      mergeFn(firstRow + i, i, &segs[i * segsPerRow]);
+    }
+
+    rowsSeen += rows;
+    r.waitReturnEmpty(buf);
+  }
+
+  if (rowsSeen != numRows) {
+    bd::Err() << "Expected " << numRows << " rows of voxels but read "
+              << rowsSeen << " from " << rawPath;
+    return false;
+  }
+
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+VolumeAnalysis<Ty>::volumeStats(std::string const &rawPath)
+{
+  for (Blocking &b : m_blockings) {
+    for (bd::FileBlock &fb : b.blocks) {
+      fb.min_val = std::numeric_limits<double>::max();
+      fb.max_val = std::numeric_limits<double>::lowest();
+      fb.total_val = 0;
+    }
+  }
+
+  double volMin{ std::numeric_limits<double>::max() };
+  double volMax{ std::numeric_limits<double>::lowest() };
+  double volTot{ 0 };
+
+  auto rowFn = [&](uint64_t, Ty const *row, Segment *segs, RowScratch &) {
+    for (Blocking const &b : m_blockings) {
+      forEachSegment(b, [&](uint64_t bi, uint64_t begin, uint64_t end) {
+        Segment s{ std::numeric_limits<double>::max(),
+                   std::numeric_limits<double>::lowest(), 0, 0 };
+        for (uint64_t x = begin; x < end; ++x) {
+          double const v{ static_cast<double>(row[x]) };
+          s.min = std::min(s.min, v);
+          s.max = std::max(s.max, v);
+          s.total += v;
+        }
+        segs[b.segOffset + bi] = s;
+      });
+    }
+  };
+
+  auto mergeFn = [&](uint64_t row, uint64_t, Segment const *segs) {
+    for (size_t bIdx = 0; bIdx < m_blockings.size(); ++bIdx) {
+      Blocking &b = m_blockings[bIdx];
+      uint64_t const bcx{ b.volume.block_count().x };
+      for (uint64_t bi = 0; bi <= bcx; ++bi) {
+        Segment const &s = segs[b.segOffset + bi];
+
+        // Every blocking covers the whole row, take the volume stats
+        // from the first one.
+        if (bIdx == 0) {
+          volMin = std::min(volMin, s.min);
+          volMax = std::max(volMax, s.max);
+          volTot += s.total;
+        }
+
+        int64_t const idx{ blockFor(b.volume, row, bi) };
+        if (idx >= 0) {
+          bd::FileBlock &fb = b.blocks[idx];
+          fb.min_val = std::min(fb.min_val, s.min);
+          fb.max_val = std::max(fb.max_val, s.max);
+          fb.total_val += s.total;
+        }
+      }
+    }
+  };
+
+  if (!forEachRow(rawPath, m_segsPerRow, rowFn, mergeFn)) {
+    return false;
+  }
+
+  double const volVoxels{
+      static_cast<double>(m_voxelDims.x * m_voxelDims.y * m_voxelDims.z) };
+
+  for (Blocking &b : m_blockings) {
+    glm::u64vec3 const bd{ b.volume.block_dims() };
+    double const blockVoxels{ static_cast<double>(bd.x * bd.y * bd.z) };
+    for (bd::FileBlock &fb : b.blocks) {
+      fb.avg_val = fb.total_val / blockVoxels;
+    }
+
+    b.volume.min(volMin);
+    b.volume.max(volMax);
+    b.volume.total(volTot);
+    b.volume.avg(volTot / volVoxels);
+  }
+
+  m_stats.min(volMin);
+  m_stats.max(volMax);
+
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+VolumeAnalysis<Ty>::blockRelevance(std::string const &rawPath)
+{
+  size_t const numTfs{ m_tfs.size() };
+  uint32_t const bins{ m_histBins };
+  uint64_t const rowElems{ m_voxelDims.x };
+  double const vmin{ m_stats.min() };
+  double const diff{ m_stats.max() - m_stats.min() };
+  auto normalize = [vmin, diff](Ty v) {
+    double const n{ diff > 0 ? ( static_cast<double>(v) - vmin ) / diff : 0.0 };
+    return std::min(1.0, std::max(0.0, n));
+  };
+
+  // Each transfer function baked into a table indexed by voxel value.
+  std::vector<bd::OpacityLut<Ty>> luts;
+  for (bd::OpacityTransferFunction const *tf : m_tfs) {
+    luts.emplace_back(*tf, m_stats.min(), m_stats.max());
+  }
+
+  // Histogram counts of the voxels of each segment of the rows of the
+  // current buffer, \c bins per segment. Only the blockings' segments are
+  // counted, so these are shared by all transfer functions.
+  std::vector<uint32_t> segBins(rowsPerBuffer() * m_segsPerRow * bins);
+
+  for (Blocking &b : m_blockings) {
+    b.histograms.assign(b.blocks.size() * bins, 0);
+    b.outputs.assign(numTfs, IndexOutput{ b.volume, b.blocks, 0, { } });
+    for (IndexOutput &out : b.outputs) {
+      for (bd::FileBlock &fb : out.blocks) {
+        fb.rov = 0;
+        fb.empty_voxels = 0;
+      }
+    }
+  }
+  std::vector<uint64_t> volEmpty(numTfs, 0);
+
+  // Segment t * m_segsPerRow + Blocking::segOffset + bi holds the opacity
+  // sum (in Segment::total) of segment bi for transfer function t.
+  auto rowFn = [&](uint64_t i, Ty const *row, Segment *segs, RowScratch &scratch) {
+    if (bins > 0) {
+      // bin each voxel once and count the bins of every blocking's segments.
+      std::vector<uint8_t> &vb = scratch.bins;
+      vb.resize(rowElems);
+      for (uint64_t x = 0; x < rowElems; ++x) {
+        vb[x] = static_cast<uint8_t>(bd::histogramBin(normalize(row[x]), bins));
+      }
+      uint32_t *rowBins{ &segBins[i * m_segsPerRow * bins] };
+      for (Blocking const &b : m_blockings) {
+        uint64_t const bcx{ b.volume.block_count().x };
+        forEachSegment(b, [&](uint64_t bi, uint64_t begin, uint64_t end) {
+          if (bi == bcx) {
+            return;   // past the blocks' extent, in no block.
+          }
+          uint32_t *sb{ rowBins + ( b.segOffset + bi ) * bins };
+          std::fill(sb, sb + bins, 0);
+          for (uint64_t x = begin; x < end; ++x) {
+            sb[vb[x]] += 1;
+          }
+        });
+      }
+    }
+
+    std::vector<double> &rels = scratch.values;
+    rels.resize(rowElems);
+    for (size_t t = 0; t < numTfs; ++t) {
+      // look up each voxel's opacity once...
+      bd::OpacityLut<Ty> const &lut = luts[t];
+      for (uint64_t x = 0; x < rowElems; ++x) {
+        rels[x] = lut(row[x]);
+      }
+
+      // ...and share it between the blockings.
+      Segment *tfSegs{ segs + t * m_segsPerRow };
+      for (Blocking const &b : m_blockings) {
+        forEachSegment(b, [&](uint64_t bi, uint64_t begin, uint64_t end) {
+          Segment s{ 0, 0, 0, 0 };
+          for (uint64_t x = begin; x < end; ++x) {
+            s.total += rels[x];
+            s.empty += rels[x] <= 0.0 ? 1 : 0;
+          }
+          tfSegs[b.segOffset + bi] = s;
+        });
+      }
+    }
+  };
+
+  auto mergeFn = [&](uint64_t row, uint64_t i, Segment const *segs) {
+    if (bins > 0) {
+      uint32_t const *rowBins{ &segBins[i * m_segsPerRow * bins] };
+      for (Blocking &b : m_blockings) {
+        uint64_t const bcx{ b.volume.block_count().x };
+        for (uint64_t bi = 0; bi < bcx; ++bi) {
+          int64_t const idx{ blockFor(b.volume, row, bi) };
+          if (idx >= 0) {
+            uint32_t const *sb{ rowBins + ( b.segOffset + bi ) * bins };
+            uint32_t *hist{ &b.histograms[idx * bins] };
+            for (uint32_t k = 0; k < bins; ++k) {
+              hist[k] += sb[k];
+            }
+          }
+        }
+      }
+    }
+
+    for (size_t t = 0; t < numTfs; ++t) {
+      Segment const *tfSegs{ segs + t * m_segsPerRow };
+      for (size_t bIdx = 0; bIdx < m_blockings.size(); ++bIdx) {
+        Blocking &b = m_blockings[bIdx];
+        IndexOutput &out = b.outputs[t];
+        uint64_t const bcx{ b.volume.block_count().x };
+        for (uint64_t bi = 0; bi <= bcx; ++bi) {
+          Segment const &s = tfSegs[b.segOffset + bi];
+          if (bIdx == 0) {
+            volEmpty[t] += s.empty;
+          }
+          int64_t const idx{ blockFor(b.volume, row, bi) };
+          if (idx >= 0) {
+            out.blocks[idx].rov += s.total;
+            out.blocks[idx].empty_voxels += s.empty;
+          }
+        }
+      }
+    }
+  };
+
+  if (!forEachRow(rawPath, m_segsPerRow * numTfs, rowFn, mergeFn)) {
+    return false;
+  }
+
+  for (Blocking &b : m_blockings) {
+    glm::u64vec3 const bd{ b.volume.block_dims() };
+    uint64_t const blockVoxels{ bd.x * bd.y * bd.z };
+    for (size_t t = 0; t < numTfs; ++t) {
+      IndexOutput &out = b.outputs[t];
+      double rovMin{ std::numeric_limits<double>::max() };
+      double rovMax{ std::numeric_limits<double>::lowest() };
+      for (bd::FileBlock &fb : out.blocks) {
+        fb.rov /= static_cast<double>(blockVoxels);
+        fb.is_empty = fb.empty_voxels == blockVoxels ? 1 : 0;
+        rovMin = std::min(rovMin, fb.rov);
+        rovMax = std::max(rovMax, fb.rov);
+      }
+      out.volume.rovMin(rovMin);
+      out.volume.rovMax(rovMax);
+      out.volume.numEmptyVoxels(volEmpty[t]);
+      out.histBins = bins;
+      out.histograms = b.histograms;
+    }
+  }
+
+  return true;
+}
+
+} // namespace preproc
+
+#endif // ! preproc_analysis_h
@@ -0,0 +1,257 @@
+//
+// Created by jim on 3/6/19.
+//
+
+#include "cmdline.h"
+
+#include <tclap/CmdLine.h>
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace preproc
+{
+
+int
+parseThem(int argc, const char *argv[], CommandLineOptions &opts)
+try
+{
+  TCLAP::CmdLine cmd("Compute block relevance and write a json index file.", ' ');
+
+  TCLAP::ValueArg<std::string> rawArg("r", "raw", "Path to raw data file.",
+                                      true, "", "string");
+  cmd.add(rawArg);
+
+  TCLAP::ValueArg<std::string> outArg("o", "out",
+                                      "Index file to write (only one blocking and "
+                                      "transfer function).",
+                                      false, "", "string");
+  cmd.add(outArg);
+
+  TCLAP::ValueArg<std::string> outDirArg("", "out-dir",
+                                         "Directory to write index files into. Files are "
+                                         "named <prefix>-<X>x<Y>x<Z>-<tf name>.json",
+                                         false, ".", "string");
+  cmd.add(outDirArg);
+
+  TCLAP::ValueArg<std::string> prefixArg("", "prefix", "Index file name prefix.",
+                                         false, "index", "string");
+  cmd.add(prefixArg);
+
+  TCLAP::MultiArg<std::string> tfArg("t", "tf",
+                                     "Opacity transfer function (may be repeated).",
+                                     true, "string");
+  cmd.add(tfArg);
+
+  TCLAP::MultiArg<std::string> blocksArg("", "blocks",
+                                         "Block counts, \"N\" or \"XxYxZ\" (may be repeated, "
+                                         "or comma separated). Overrides bx, by, bz.",
+                                         false, "string");
+  cmd.add(blocksArg);
+
+  TCLAP::ValueArg<std::string> dtypeArg("", "dtype",
+                                        "Data type (uchar, ushort, float, u1, f4, ...).",
+                                        true, "", "string");
+  cmd.add(dtypeArg);
+
+  // volume dims
+  TCLAP::ValueArg<uint64_t> xdimArg("", "vx", "Volume x dim.", true, 1, "uint");
+  cmd.add(xdimArg);
+
+  TCLAP::ValueArg<uint64_t> ydimArg("", "vy", "Volume y dim.", true, 1, "uint");
+  cmd.add(ydimArg);
+
+  TCLAP::ValueArg<uint64_t> zdimArg("", "vz", "Volume z dim.", true, 1, "uint");
+  cmd.add(zdimArg);
+
+  // block counts
+  TCLAP::ValueArg<uint64_t> xBlocksArg("", "bx", "Blocks along x.", false, 1, "uint");
+  cmd.add(xBlocksArg);
+
+  TCLAP::ValueArg<uint64_t> yBlocksArg("", "by", "Blocks along y.", false, 1, "uint");
+  cmd.add(yBlocksArg);
+
+  TCLAP::ValueArg<uint64_t> zBlocksArg("", "bz", "Blocks along z.", false, 1, "uint");
+  cmd.add(zBlocksArg);
+
+  // buffer size
+  std::string const sixty_four_megs = "64M";
+  TCLAP::ValueArg<std::string> bufferSizeArg("b", "buffer-size",
+                                             "Buffer size bytes. Format is a numeric value followed by "
+                                             "K, M, or G.\n"
+                                             "Values: [0-9]+[KMG].\n"
+                                             "Default: 64M",
+                                             false, sixty_four_megs, "string");
+  cmd.add(bufferSizeArg);
+
+  TCLAP::ValueArg<int> threadsArg("", "threads",
+                                  "Analysis threads (default: all cores).",
+                                  false,
+                                  static_cast<int>(std::thread::hardware_concurrency()),
+                                  "int");
+  cmd.add(threadsArg);
+
+  TCLAP::ValueArg<int> readersArg("", "readers", "Threads reading the raw file.",
+                                  false, 1, "int");
+  cmd.add(readersArg);
+
+  TCLAP::ValueArg<uint32_t> histBinsArg("", "hist-bins",
+                                        "Bins in each block's value histogram, "
+                                        "at most 256 (0 for no histograms).",
+                                        false, 64, "uint");
+  cmd.add(histBinsArg);
+
+  cmd.parse(argc, argv);
+
+  opts.rawFilePath = rawArg.getValue();
+  opts.outFilePath = outArg.getValue();
+  opts.outDir = outDirArg.getValue();
+  opts.outPrefix = prefixArg.getValue();
+  opts.tfFilePaths = tfArg.getValue();
+  opts.dataType = bd::to_dataType(dtypeArg.getValue());
+  opts.vol_dims[0] = xdimArg.getValue();
+  opts.vol_dims[1] = ydimArg.getValue();
+  opts.vol_dims[2] = zdimArg.getValue();
+
+  opts.num_blks.clear();
+  for (std::string const &arg : blocksArg.getValue()) {
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      std::array<uint64_t, 3> count;
+      if (!parseBlockCount(item, count)) {
+        std::cerr << "Invalid block count: " << item << std::endl;
+        return 0;
+      }
+      opts.num_blks.push_back(count);
+    }
+  }
+  if (opts.num_blks.empty()) {
+    opts.num_blks.push_back({ xBlocksArg.getValue(),
+                              yBlocksArg.getValue(),
+                              zBlocksArg.getValue() });
+  }
+
+  if (!opts.outFilePath.empty() &&
+      ( opts.num_blks.size() > 1 || opts.tfFilePaths.size() > 1 )) {
+    std::cerr << "--out can only be used with one blocking and one transfer "
+                 "function, use --out-dir instead." << std::endl;
+    return 0;
+  }
+  opts.bufferSize = convertToBytes(bufferSizeArg.getValue());
+  opts.threads = threadsArg.getValue();
+  opts.readers = readersArg.getValue();
+  opts.histBins = histBinsArg.getValue();
+  if (opts.histBins > 256) {
+    std::cerr << "--hist-bins can be at most 256." << std::endl;
+    return 0;
+  }
+
+  return static_cast<int>(cmd.getArgList().size());
+
+} catch (TCLAP::ArgException &e) {
+
+  std::cerr << "Error parsing command line args: " << e.error() << " for argument "
+            << e.argId() << std::endl;
+  return 0;
+}
+
+
+size_t
+convertToBytes(std::string s)
+{
+  size_t multiplier{ 1 };
+  std::string last{ *( s.end() - 1 ) };
+
+  if (last == "K") {
+    multiplier = 1024;
+  } else if (last == "M") {
+    multiplier = 1024 * 1024;
+  } else if (last == "G") {
+    multiplier = 1024 * 1024 * 1024;
+  } else {
+    return stoull(s);
+  }
+
+  std::string numPart(s.begin(), s.end() - 1);
+  auto num = stoull(numPart);
+
+  return num * multiplier;
+}
+
+
+bool
+parseBlockCount(std::string const &s, std::array<uint64_t, 3> &count)
+{
+  std::stringstream ss(s);
+  std::string dim;
+  size_t n{ 0 };
+  try {
+    while (std::getline(ss, dim, 'x')) {
+      if (n == 3) {
+        return false;
+      }
+      count[n++] = std::stoull(dim);
+    }
+  } catch (std::exception &) {
+    return false;
+  }
+
+  if (n == 1) {
+    count[1] = count[2] = count[0];
+  } else if (n != 3) {
+    return false;
+  }
+
+  return count[0] > 0 && count[1] > 0 && count[2] > 0;
+}
+
+
+void
+printThem(const CommandLineOptions &opts)
+{
+  std::cout << opts << std::endl;
+}
+
+
+std::ostream &
+operator<<(std::ostream &os, const CommandLineOptions &opts)
+{
+  os << "\n" "Raw file path: "
+     << opts.rawFilePath
+     << "\n" "Output file path: "
+     << opts.outFilePath
+     << "\n" "Output dir: "
+     << opts.outDir
+     << "\n" "Output prefix: "
+     << opts.outPrefix
+     << "\n" "Transfer functions:";
+  for (auto const &tf : opts.tfFilePaths) {
+    os << " " << tf;
+  }
+  os
+     << "\n" "Data type: "
+     << bd::to_string(opts.dataType)
+     << "\n" "Vol dims (w X h X d): "
+     << opts.vol_dims[0] << " X "
+     << opts.vol_dims[1] << " X "
+     << opts.vol_dims[2]
+     << "\n" "Num blocks (x X y X z):";
+  for (auto const &nb : opts.num_blks) {
+    os << " " << nb[0] << "x" << nb[1] << "x" << nb[2];
+  }
+  os
+     << "\n" "Buffer Size: "
+     << opts.bufferSize << " bytes."
+     << "\n" "Threads: "
+     << opts.threads
+     << "\n" "Readers: "
+     << opts.readers
+     << "\n" "Histogram bins: "
+     << opts.histBins;
+
+  return os;
+}
+
+} // namespace preproc
@@ -0,0 +1,80 @@
+//
+// Created by jim on 3/6/19.
+//
+
+#ifndef preproc_cmdline_h
+#define preproc_cmdline_h
+
+#include <bd/io/datatypes.h>
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace preproc
+{
+
+struct CommandLineOptions
+{
+  // raw file path
+  std::string rawFilePath;
+  // output index file path (when there is only one output)
+  std::string outFilePath;
+  // output directory and file name prefix (when there are many outputs)
+  std::string outDir;
+  std::string outPrefix;
+  // opacity transfer function paths
+  std::vector<std::string> tfFilePaths;
+  // volume dimensions
+  uint64_t vol_dims[3];
+  // number of blocks along each axis, one entry per blocking
+  std::vector<std::array<uint64_t, 3>> num_blks;
+  // data type
+  bd::DataType dataType;
+  // total size of the read buffers in bytes
+  uint64_t bufferSize;
+  // analysis threads
+  int threads;
+  // reader threads
+  int readers;
+  // bins in each block's value histogram (0 for none)
+  uint32_t histBins;
+};
+
+
+size_t
+convertToBytes(std::string s);
+
+
+/// \brief Parse a block count of the form "N" (N blocks along each axis)
+///        or "XxYxZ".
+/// \returns false if \c s is not a valid block count.
+bool
+parseBlockCount(std::string const &s, std::array<uint64_t, 3> &count);
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Parses command line args and populates \c opts.
+///
+/// If non-zero arg was returned, then the parse was successful, but it does
+/// not mean that valid or all of the required args were provided on the
+/// command line.
+///
+/// \returns 0 on parse failure, non-zero if the parse was successful.
+///////////////////////////////////////////////////////////////////////////////
+int
+parseThem(int argc, const char *argv[], CommandLineOptions &opts);
+
+
+void
+printThem(const CommandLineOptions &);
+
+
+std::ostream &
+operator<<(std::ostream &, const CommandLineOptions &);
+
+} // namespace preproc
+
+#endif // ! preproc_cmdline_h
@@ -0,0 +1,188 @@
+//
+// Created by jim on 3/6/19.
+//
+
+#include "analysis.h"
+#include "cmdline.h"
+
+#include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/log/logger.h>
+#include <bd/volume/transferfunction.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/// \brief Split \c path into its directory and file name.
+void
+splitPath(std::string const &path, std::string &dir, std::string &name)
+{
+  size_t const slash{ path.find_last_of("/\\") };
+  if (slash == std::string::npos) {
+    dir = "";
+    name = path;
+  } else {
+    dir = path.substr(0, slash);
+    name = path.substr(slash + 1);
+  }
+}
+
+
+double
+secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+
+/// \brief File name of \c path without its directory or extension.
+std::string
+stem(std::string const &path)
+{
+  std::string dir, name;
+  splitPath(path, dir, name);
+  return name.substr(0, name.find_last_of('.'));
+}
+
+
+template<class Ty>
+bool
+go(preproc::CommandLineOptions const &opts,
+   std::vector<bd::OpacityTransferFunction const *> const &tfs)
+{
+  std::vector<glm::u64vec3> blockCounts;
+  for (auto const &nb : opts.num_blks) {
+    blockCounts.push_back({ nb[0], nb[1], nb[2] });
+  }
+
+  preproc::VolumeAnalysis<Ty> analysis{
+      { opts.vol_dims[0], opts.vol_dims[1], opts.vol_dims[2] },
+      blockCounts, tfs, opts.dataType };
+  analysis.setThreads(opts.threads);
+  analysis.setReaders(opts.readers);
+  analysis.setBufferBytes(opts.bufferSize);
+  analysis.setHistogramBins(opts.histBins);
+
+  auto start = std::chrono::steady_clock::now();
+  bd::Info() << "Running volume analysis";
+  if (!analysis.volumeStats(opts.rawFilePath)) {
+    return false;
+  }
+  bd::Info() << "Volume level elapsed time: " << secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  bd::Info() << "Running relevance analysis for " << blockCounts.size()
+             << " blockings and " << tfs.size() << " transfer functions";
+  if (!analysis.blockRelevance(opts.rawFilePath)) {
+    return false;
+  }
+  bd::Info() << "Block level elapsed time: " << secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  std::string rawDir, rawName;
+  splitPath(opts.rawFilePath, rawDir, rawName);
+  for (size_t b = 0; b < analysis.numBlockings(); ++b) {
+    for (size_t t = 0; t < analysis.numTransferFunctions(); ++t) {
+      std::string tfDir, tfName;
+      splitPath(opts.tfFilePaths[t], tfDir, tfName);
+
+      preproc::IndexOutput const &out = analysis.output(b, t);
+      bd::indexfile::v2::JsonIndexFile json;
+      json.setRawFilePath(rawDir);
+      json.setRawFileName(rawName);
+      json.setTFFileName(tfName);
+      json.setDatType(opts.dataType);
+      json.setVolume(out.volume);
+      json.setFileBlocks(out.blocks);
+      json.setHistograms(out.histBins, out.histograms);
+
+      std::string path{ opts.outFilePath };
+      if (path.empty()) {
+        glm::u64vec3 const nb{ blockCounts[b] };
+        std::stringstream ss;
+        ss << opts.outDir << '/' << opts.outPrefix << '-'
+           << nb.x << 'x' << nb.y << 'x' << nb.z << '-'
+           << stem(opts.tfFilePaths[t]) << ".json";
+        path = ss.str();
+      }
+
+      if (!json.write(path)) {
+        return false;
+      }
+      bd::Info() << "Wrote " << path;
+    }
+  }
+  bd::Info() << "Index file time: " << secondsSince(start);
+
+  return true;
+}
+
+} // namespace
+
+
+int
+main(int argc, char const *argv[])
+{
+  preproc::CommandLineOptions opts;
+  if (preproc::parseThem(argc, argv, opts) == 0) {
+    std::cerr << "Please use -h for usage." << std::endl;
+    return 1;
+  }
+  preproc::printThem(opts);
+
+  std::vector<std::unique_ptr<bd::OpacityTransferFunction>> otfs;
+  std::vector<bd::OpacityTransferFunction const *> tfs;
+  for (std::string const &path : opts.tfFilePaths) {
+    otfs.emplace_back(new bd::OpacityTransferFunction);
+    if (otfs.back()->load(path) <= 0) {
+      bd::Err() << "Could not load transfer function: " << path;
+      return 1;
+    }
+    tfs.push_back(otfs.back().get());
+  }
+
+  bool ok{ false };
+  switch (opts.dataType) {
+    case bd::DataType::Character:
+      ok = go<int8_t>(opts, tfs);
+      break;
+    case bd::DataType::UnsignedCharacter:
+      ok = go<uint8_t>(opts, tfs);
+      break;
+    case bd::DataType::Short:
+      ok = go<int16_t>(opts, tfs);
+      break;
+    case bd::DataType::UnsignedShort:
+      ok = go<uint16_t>(opts, tfs);
+      break;
+    case bd::DataType::Integer:
+      ok = go<int32_t>(opts, tfs);
+      break;
+    case bd::DataType::UnsignedInteger:
+      ok = go<uint32_t>(opts, tfs);
+      break;
+    case bd::DataType::Float:
+      ok = go<float>(opts, tfs);
+      break;
+    case bd::DataType::Double:
+      ok = go<double>(opts, tfs);
+      break;
+    default:
+      bd::Err() << "Unsupported data type.";
+      break;
+  }
+
+  if (!ok) {
+    bd::Err() << "Preprocessing failed.";
+    return 1;
+  }
+
+  return 0;
+}
@@ -6,7 +6,9 @@
 
 #include <tclap/CmdLine.h>
 
+#include <algorithm>
 #include <iostream>
+#include <thread>
 
 namespace resample
 {
@@ -76,20 +78,26 @@ try
   TCLAP::ValueArg<size_t> z_dimTargetArg("", "tz", "Target z dim.", false, 1, "uint");
   cmd.add(z_dimTargetArg);
 
-  cmd.parse(argc, argv);
-
   // buffer size
-//  std::string const sixty_four_megs = "64M";
-//  TCLAP::ValueArg<std::string>
-//      bufferSizeArg("b", "buffer-size",
-//                    "Buffer size bytes. Format is a numeric value followed by "
-//                        "K, M, or G.\n"
-//                        "Values: [0-9]+[KMG].\n"
-//                        "Default: 64M",
-//                    false,
-//                    sixty_four_megs, "uint");
-//  cmd.add(bufferSizeArg);
-//
+  std::string const sixty_four_megs = "64M";
+  TCLAP::ValueArg<std::string>
+      bufferSizeArg("b", "buffer-size",
+                    "Buffer size bytes. Format is a numeric value followed by "
+                        "K, M, or G.\n"
+                        "Values: [0-9]+[KMG].\n"
+                        "Default: 64M",
+                    false,
+                    sixty_four_megs, "string");
+  cmd.add(bufferSizeArg);
+
+  int const cores{ static_cast<int>(std::thread::hardware_concurrency()) };
+  TCLAP::ValueArg<int> threadsArg("", "threads",
+                                  "Threads interpolating voxels (default: one "
+                                  "per core).",
+                                  false, cores > 0 ? cores : 1, "int");
+  cmd.add(threadsArg);
+
+  cmd.parse(argc, argv);
 
   opts.inFilePath = inFilePAthArg.getValue();
   opts.outFilePath = outFilePath.getValue();
@@ -101,6 +109,8 @@ try
   opts.new_vol_dims[0] = x_dimTargetArg.getValue();
   opts.new_vol_dims[1] = y_dimTargetArg.getValue();
   opts.new_vol_dims[2] = z_dimTargetArg.getValue();
+  opts.bufferSize = convertToBytes(bufferSizeArg.getValue());
+  opts.threads = std::max(1, threadsArg.getValue());
 
   return static_cast<int>(cmd.getArgList().size());
 
@@ -123,6 +133,8 @@ convertToBytes(std::string s)
     multiplier = 1024 * 1024;
   } else if (last == "G") {
     multiplier = 1024 * 1024 * 1024;
+  } else {
+    return stoull(s);
   }
 
   std::string numPart(s.begin(), s.end() - 1);
@@ -156,7 +168,9 @@ operator<<(std::ostream &os, const CommandLineOptions &opts)
       << opts.new_vol_dims[1] << " X "
       << opts.new_vol_dims[2]
       << "\n" "Buffer Size: "
-      << opts.bufferSize << " bytes.";
+      << opts.bufferSize << " bytes."
+      << "\n" "Threads: "
+      << opts.threads;
 
   return os;
 }
@@ -29,6 +29,8 @@ namespace resample
     uint64_t new_vol_dims[3];
     // buffer size bytes
     uint64_t bufferSize;
+    // interpolating threads
+    int threads;
     // data type
     bd::DataType dataType;
 
@@ -1,6 +1,6 @@
 //
 // Created by Jim Pelton on 2/28/16.
-// Note: this code is based on the code found at scratchapixel. 
+// Note: this code is based on the code found at scratchapixel.
 // Link:
 //   http://www.scratchapixel.com/old/lessons/3d-advanced-lessons/interpolation/trilinear-interpolation/
 //
@@ -9,110 +9,137 @@
 #ifndef resample_grid_h
 #define resample_grid_h
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <type_traits>
+#include <vector>
 
 namespace resample
 {
-struct vec3f
+
+/// \brief Where each output voxel along one axis falls in the input grid.
+///
+/// Output voxel i is at input coordinate g = i * in / out, between input
+/// voxels lo[i] and hi[i] with weight t[i] on hi[i]. Coordinates past the
+/// last input voxel are clamped to it.
+struct Axis
 {
-  float x, y, z;
+  Axis(size_t in, size_t out)
+      : lo(out)
+      , hi(out)
+      , t(out)
+  {
+    double const scale{ double(in) / double(out) };
+    for (size_t i{ 0 }; i < out; ++i) {
+      double const g{ i * scale };
+      size_t const gi{ static_cast<size_t>(g) };
+      lo[i] = std::min(gi, in - 1);
+      hi[i] = std::min(gi + 1, in - 1);
+      t[i] = g - gi;
+    }
+  }
+
+  std::vector<size_t> lo;
+  std::vector<size_t> hi;
+  std::vector<double> t;
 };
 
+
+/// \brief Trilinear resampling of a volume to new dimensions.
+///
+/// The input is given one xy slice at a time, so only the two input slices
+/// around an output slice (see slices()) need to be in memory to make it.
 template<typename T>
 class Grid
 {
 public:
-  size_t nx, ny, nz; // number of vertices
-  size_t nvoxels; // number of voxels (cube)
-  const T *data;
+  size_t nx, ny, nz; // number of input vertices
+  size_t tx, ty, tz; // number of output vertices
 
 
   ///
   /// \param nvx Number of verts along x
   /// \param nvy Number of verts along y
   /// \param nvz Number of verts along z
-  /// \param data The data to resample.
-  Grid(size_t nvx, size_t nvy, size_t nvz, const T *data)
+  /// \param ntx Number of output verts along x
+  /// \param nty Number of output verts along y
+  /// \param ntz Number of output verts along z
+  Grid(size_t nvx, size_t nvy, size_t nvz, size_t ntx, size_t nty, size_t ntz)
       : nx(nvx)
       , ny(nvy)
       , nz(nvz)
-      , nvoxels(nvx * nvy * nvz)
-      , data(data)
+      , tx(ntx)
+      , ty(nty)
+      , tz(ntz)
+      , m_x(nvx, ntx)
+      , m_y(nvy, nty)
+      , m_z(nvz, ntz)
   {
   }
 
 
-  ~Grid()
+  /// \brief The two input slices output slice \c s is interpolated from.
+  void
+  slices(size_t s, size_t &z0, size_t &z1) const
   {
+    z0 = m_z.lo[s];
+    z1 = m_z.hi[s];
   }
 
 
-  /// Convert to 1d index
-  size_t
-  IX(size_t x, size_t y, size_t z)
+  /// \brief Interpolate row \c r of output slice \c s into \c out (tx values).
+  /// \param s0 Input slice slices() gives as z0 for \c s.
+  /// \param s1 Input slice slices() gives as z1 for \c s.
+  template<typename Out>
+  void
+  interpolateRow(const T *s0, const T *s1, size_t r, size_t s, Out *out) const
   {
-    if ( x >= nx ) {
-      x -= 1;
+    double const fy{ m_y.t[r] };
+    double const fz{ m_z.t[s] };
+    const T *r00{ s0 + m_y.lo[r] * nx };
+    const T *r10{ s0 + m_y.hi[r] * nx };
+    const T *r01{ s1 + m_y.lo[r] * nx };
+    const T *r11{ s1 + m_y.hi[r] * nx };
+
+    for (size_t c{ 0 }; c < tx; ++c) {
+      size_t const x0{ m_x.lo[c] };
+      size_t const x1{ m_x.hi[c] };
+      double const fx{ m_x.t[c] };
+
+      double e = bilinear(fx, fy, r00[x0], r00[x1], r10[x0], r10[x1]);
+      double f = bilinear(fx, fy, r01[x0], r01[x1], r11[x0], r11[x1]);
+      out[c] = toOut<Out>(e * ( 1 - fz ) + f * fz);
     }
+  }
 
-    if ( y >= ny ) {
-      y -= 1;
-    }
 
-    if ( z >= nz ) {
-      z -= 1;
-    }
+private:
 
-    return x + nx * ( y + ny * z );
-    //return x * nx * ny + y * nx + z;
+  static double
+  bilinear(double tx, double ty,
+           double c00, double c10,
+           double c01, double c11)
+  {
+    double a = c00 * ( 1 - tx ) + c10 * tx;
+    double b = c01 * ( 1 - tx ) + c11 * tx;
+    return a * ( 1 - ty ) + b * ty;
   }
 
 
-  T
-  bilinear(const T &tx, const T &ty,
-           const T &c00, const T &c10,
-           const T &c01, const T &c11)
+  /// \brief Integer types are rounded to nearest.
+  template<typename Out>
+  static Out
+  toOut(double v)
   {
-    T a = c00 * ( T(1) - tx ) + c10 * tx;
-    T b = c01 * ( T(1) - tx ) + c11 * tx;
-    return a * ( T(1) - ty ) + b * ty;
+    return std::is_integral<Out>::value ? static_cast<Out>(std::round(v))
+                                        : static_cast<Out>(v);
   }
 
 
-  T
-  interpolate(const vec3f &location)
-  {
-    float gx, gy, gz;
-    size_t gxi, gyi, gzi;
-
-    T tx, ty, tz;
-
-    // remap point coordinates to grid coordinates
-    gx = location.x * nx;
-    gxi = static_cast<size_t>(gx);
-    tx = gx - gxi;
-
-    gy = location.y * ny;
-    gyi = static_cast<size_t>(gy);
-    ty = gy - gyi;
-
-    gz = location.z * nz;
-    gzi = static_cast<size_t>(gz);
-    tz = gz - gzi;
-
-    const T c000 = data[IX(gxi, gyi, gzi)];
-    const T c100 = data[IX(gxi + 1, gyi, gzi)];
-    const T c010 = data[IX(gxi, gyi + 1, gzi)];
-    const T c110 = data[IX(gxi + 1, gyi + 1, gzi)];
-    const T c001 = data[IX(gxi, gyi, gzi + 1)];
-    const T c101 = data[IX(gxi + 1, gyi, gzi + 1)];
-    const T c011 = data[IX(gxi, gyi + 1, gzi + 1)];
-    const T c111 = data[IX(gxi + 1, gyi + 1, gzi + 1)];
-
-    T e = bilinear(tx, ty, c000, c100, c010, c110);
-    T f = bilinear(tx, ty, c001, c101, c011, c111);
-    return e * ( 1 - tz ) + f * tz;
-  }
+  Axis m_x;
+  Axis m_y;
+  Axis m_z;
 };
 
 }
@@ -4,71 +4,213 @@
 
 #include "cmdline.h"
 #include "grid.h"
+#include "slicewindow.h"
 
 #include <bd/log/logger.h>
 #include <bd/io/datfile.h>
+#include <bd/util/half.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <iostream>
 #include <fstream>
-#include <cstring>
+#include <thread>
+#include <vector>
 
+namespace
+{
+
+/// \brief Input slices needed by output slices [s0, s1), in increasing order.
+template<class Ty>
+std::vector<uint64_t>
+neededSlices(resample::Grid<Ty> const &grid, uint64_t s0, uint64_t s1)
+{
+  std::vector<uint64_t> zs;
+  for (uint64_t s{ s0 }; s < s1; ++s) {
+    size_t z0, z1;
+    grid.slices(s, z0, z1);
+    if (zs.empty() || zs.back() < z0) {
+      zs.push_back(z0);
+    }
+    if (zs.back() < z1) {
+      zs.push_back(z1);
+    }
+  }
+  return zs;
+}
+
+
+/// \brief Most input slices any slab of \c slabSlices output slices needs.
+template<class Ty>
+uint64_t
+windowSlices(resample::Grid<Ty> const &grid, uint64_t slabSlices)
+{
+  uint64_t most{ 0 };
+  for (uint64_t s{ 0 }; s < grid.tz; s += slabSlices) {
+    uint64_t const n{ neededSlices(grid, s, std::min(s + slabSlices, grid.tz)).size() };
+    most = std::max(most, n);
+  }
+  return most;
+}
+
+
+/// \brief Interpolate output slices [s0, s1) into \c slab with \c threads
+///        threads, each taking a few rows at a time.
 template<class Ty>
 void
-go(resample::CommandLineOptions &cmdOpts, std::ifstream *inFile, std::ofstream *outFile)
+interpolateSlab(resample::Grid<Ty> const &grid, resample::SliceWindow<Ty> const &window,
+                uint64_t s0, uint64_t s1, int threads, bool half, char *slab)
 {
-    size_t orig_c{ cmdOpts.vol_dims[0] }, new_c{ cmdOpts.new_vol_dims[0] }; // col
-    size_t orig_r{ cmdOpts.vol_dims[1] }, new_r{ cmdOpts.new_vol_dims[1] }; // row
-    size_t orig_s{ cmdOpts.vol_dims[2] }, new_s{ cmdOpts.new_vol_dims[2] }; // slab
+  uint64_t const rows{ ( s1 - s0 ) * grid.ty };
+  uint64_t const rowsPerTake{ 16 };
+  size_t const outElemSize{ half ? sizeof(uint16_t) : sizeof(Ty) };
+  std::atomic<uint64_t> nextRow{ 0 };
+
+  auto work = [&] {
+    std::vector<float> row(half ? grid.tx : 0);
+    uint64_t r0;
+    while (( r0 = nextRow.fetch_add(rowsPerTake) ) < rows) {
+      uint64_t const r1{ std::min(r0 + rowsPerTake, rows) };
+      for (uint64_t i{ r0 }; i < r1; ++i) {
+        uint64_t const s{ s0 + i / grid.ty };
+        uint64_t const r{ i % grid.ty };
+        size_t z0, z1;
+        grid.slices(s, z0, z1);
+        char *dest{ slab + i * grid.tx * outElemSize };
+        if (half) {
+          grid.interpolateRow(window.slice(z0), window.slice(z1), r, s, row.data());
+          bd::floatToHalf(row.data(), reinterpret_cast<uint16_t *>(dest), grid.tx);
+        } else {
+          grid.interpolateRow(window.slice(z0), window.slice(z1), r, s,
+                              reinterpret_cast<Ty *>(dest));
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int i{ 1 }; i < threads; ++i) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (std::thread &t : workers) {
+    t.join();
+  }
+}
 
-    // read original data into memory
-//    inFile->seekg(0, std::ios::end);
-//    std::ifstream::pos_type fileSize{ inFile->tellg() };
-//    inFile->seekg(0, std::ios::beg);
-    size_t fileSize{ orig_c * orig_r * orig_s * sizeof(Ty) };
-    char *image{ new char[fileSize] };
-    inFile->read(image, fileSize);
-    inFile->close();
 
+/// \brief Resample the raw volume in \c inFile to \c outFile.
+///
+/// Output slices are made a slab at a time. Only the input slices the slab
+/// interpolates from are in memory (see resample::SliceWindow), the slab is
+/// interpolated on all threads, and it is written on another thread while
+/// the next slab is made, so volumes much larger than memory can be resampled
+/// within about cmdOpts.bufferSize bytes.
+///
+/// \param half The files hold halves, and Ty is float.
+template<class Ty>
+bool
+go(resample::CommandLineOptions &cmdOpts, std::ifstream *inFile, std::ofstream *outFile,
+   bool half = false)
+{
+  uint64_t orig_c{ cmdOpts.vol_dims[0] }, new_c{ cmdOpts.new_vol_dims[0] }; // col
+  uint64_t orig_r{ cmdOpts.vol_dims[1] }, new_r{ cmdOpts.new_vol_dims[1] }; // row
+  uint64_t orig_s{ cmdOpts.vol_dims[2] }, new_s{ cmdOpts.new_vol_dims[2] }; // slab
 
-    resample::Grid<Ty> grid{ 
-      orig_c, orig_r, orig_s, reinterpret_cast<Ty*>(image) };
+  if (orig_c * orig_r * orig_s == 0 || new_c * new_r * new_s == 0) {
+    bd::Err() << "Volume dimensions must not be zero.";
+    return false;
+  }
 
-    size_t slabSize{ new_c * new_r };
-    Ty *slab{ new Ty[slabSize] };
-    std::memset(slab, 0, slabSize * sizeof(Ty));
+  resample::Grid<Ty> grid{ orig_c, orig_r, orig_s, new_c, new_r, new_s };
 
+  size_t const elemSize{ half ? sizeof(uint16_t) : sizeof(Ty) };
+  uint64_t const inSliceElems{ orig_c * orig_r };
+  uint64_t const inSliceBytes{ inSliceElems * sizeof(Ty) };
+  uint64_t const outSliceBytes{ new_c * new_r * elemSize };
 
-    for (size_t s{ 0 }; s < new_s; ++s) {
-      for (size_t r{ 0 }; r < new_r; r++) {
-        for (size_t c{ 0 }; c < new_c; c++) {
+  // the most output slices per slab that, with the two output slabs and the
+  // input slices they need, fit in the buffer size.
+  auto bytesFor = [&](uint64_t n) {
+    return 2 * n * outSliceBytes + windowSlices(grid, n) * inSliceBytes;
+  };
+  uint64_t lo{ 1 }, hi{ new_s };
+  while (lo < hi) {
+    uint64_t const mid{ lo + ( hi - lo + 1 ) / 2 };
+    if (bytesFor(mid) <= cmdOpts.bufferSize) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  uint64_t const slabSlices{ lo };
+  uint64_t const capacity{ windowSlices(grid, slabSlices) };
+  if (bytesFor(slabSlices) > cmdOpts.bufferSize) {
+    bd::Warn() << "Buffer size is too small, using " << bytesFor(slabSlices) << " bytes.";
+  }
+  bd::Info() << "Output slab: " << slabSlices << " slices, input window: "
+             << capacity << " slices.";
 
-          Ty ival{
-              grid.interpolate({ s / float(new_s), r / float(new_r), c / float(new_c) }) };
+  resample::SliceWindow<Ty> window{ *inFile, inSliceElems, orig_s, capacity, half };
+  std::vector<char> slabs[2];
+  slabs[0].resize(slabSlices * outSliceBytes);
+  slabs[1].resize(slabSlices * outSliceBytes);
 
-          slab[c + r * new_c] = ival;
+  auto start = std::chrono::steady_clock::now();
+  std::future<bool> writing;
+  bool ok{ true };
+  uint64_t b{ 0 };
+  for (uint64_t s0{ 0 }; s0 < new_s; s0 += slabSlices, ++b) {
+    uint64_t const s1{ std::min(s0 + slabSlices, new_s) };
+    if (!window.load(neededSlices(grid, s0, s1))) {
+      ok = false;
+      break;
+    }
 
-        } //for c
-      } // for r
+    // slabs[b % 2] was written by the write before the last one, which
+    // has been waited for below.
+    std::vector<char> &slab = slabs[b % 2];
+    interpolateSlab(grid, window, s0, s1, cmdOpts.threads, half, slab.data());
 
-      outFile->write(reinterpret_cast<char *>(slab), slabSize * sizeof(Ty));
-      if (s % 10 == 0) {
-        std::cout << "\r Wrote slab: " << s << std::flush;
-      }
+    if (writing.valid() && !writing.get()) {
+      ok = false;
+      break;
+    }
+    uint64_t const bytes{ ( s1 - s0 ) * outSliceBytes };
+    writing = std::async(std::launch::async, [outFile, &slab, bytes] {
+      outFile->write(slab.data(), bytes);
+      return outFile->good();
+    });
 
-      memset(slab, 0, slabSize * sizeof(Ty));
+    std::cout << "\r Wrote slab: " << s1 << "/" << new_s << std::flush;
+  }
+  if (writing.valid() && !writing.get()) {
+    ok = false;
+  }
+  std::cout << std::endl;
 
-    } // for(s
+  if (!ok) {
+    bd::Err() << "Resampling failed.";
+    return false;
+  }
 
-    std::cout << std::endl;
+  outFile->flush();
+  outFile->close();
+  inFile->close();
 
-    outFile->flush();
-    outFile->close();
+  double const secs{ std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count() };
+  double const mb{ new_s * outSliceBytes / ( 1024.0 * 1024.0 ) };
+  bd::Info() << "Wrote " << mb << " MB in " << secs << " seconds, "
+             << mb / secs << " MB/s";
 
-    delete[] image;
-    delete[] slab;
-  
+  return true;
 }
 
+} // namespace
+
 int main(int argc, char const **argv)
 {
   resample::CommandLineOptions cmdOpts;
@@ -108,18 +250,44 @@ int main(int argc, char const **argv)
     cmdOpts.vol_dims[2] = dfd.rZ;
     cmdOpts.dataType = dfd.dataType;
 
+    bool ok{ false };
     switch (dfd.dataType) {
+    case bd::DataType::Character:
+      ok = go<int8_t>(cmdOpts, &inFile, &outFile);
+      break;
     case bd::DataType::UnsignedCharacter:
-      go<uint8_t>(cmdOpts, &inFile, &outFile);
+      ok = go<uint8_t>(cmdOpts, &inFile, &outFile);
+      break;
+    case bd::DataType::Short:
+      ok = go<int16_t>(cmdOpts, &inFile, &outFile);
       break;
     case bd::DataType::UnsignedShort:
-      go<uint16_t>(cmdOpts, &inFile, &outFile);
+      ok = go<uint16_t>(cmdOpts, &inFile, &outFile);
+      break;
+    case bd::DataType::Integer:
+      ok = go<int32_t>(cmdOpts, &inFile, &outFile);
+      break;
+    case bd::DataType::UnsignedInteger:
+      ok = go<uint32_t>(cmdOpts, &inFile, &outFile);
+      break;
+    case bd::DataType::HalfFloat:
+      ok = go<float>(cmdOpts, &inFile, &outFile, true);
+      break;
+    case bd::DataType::Float:
+      ok = go<float>(cmdOpts, &inFile, &outFile);
+      break;
+    case bd::DataType::Double:
+      ok = go<double>(cmdOpts, &inFile, &outFile);
       break;
     default:
       std::cerr << "Not a data type I am willing to deal with yet." << std::endl;
       return 1;
     }
 
+    if (!ok) {
+      return 1;
+    }
+
   }
   else {
     std::cerr << "Give a dat file." << std::endl;
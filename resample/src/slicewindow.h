@@ -0,0 +1,141 @@
+//
+// Created by jim on 4/8/19.
+//
+
+#ifndef resample_slicewindow_h
+#define resample_slicewindow_h
+
+#include <bd/log/logger.h>
+#include <bd/util/half.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+namespace resample
+{
+
+/// \brief The input slices that are in memory, read from a raw file.
+///
+/// load() is given the slices the next output slab needs, in increasing
+/// order. Slices it already has are kept, slices no longer needed are
+/// dropped, and the rest are read front to back, skipping slices no output
+/// slab needs, so the file is read at most once and only \c capacity slices
+/// are ever in memory.
+template<class Ty>
+class SliceWindow
+{
+public:
+
+  /// \param in The raw file, positioned at its start.
+  /// \param sliceElems Voxels in one xy slice.
+  /// \param numSlices Slices in the file.
+  /// \param capacity Most slices one load() call will ask for.
+  /// \param half The file holds halves (Ty must be float).
+  SliceWindow(std::ifstream &in, uint64_t sliceElems, uint64_t numSlices,
+              uint64_t capacity, bool half)
+      : m_in{ in }
+      , m_sliceElems{ sliceElems }
+      , m_half{ half }
+      , m_filePos{ 0 }
+      , m_data(capacity * sliceElems)
+      , m_slotOf(numSlices, -1)
+      , m_zOf(capacity, -1)
+      , m_scratch(half ? sliceElems : 0)
+  {
+  }
+
+
+  /// \brief Make slices \c zs (increasing, no repeats) available to slice().
+  bool
+  load(std::vector<uint64_t> const &zs)
+  {
+    if (zs.size() > m_zOf.size()) {
+      bd::Err() << "Slice window asked for " << zs.size() << " slices, it holds "
+                << m_zOf.size();
+      return false;
+    }
+
+    // free the slots of slices that are not needed anymore.
+    std::vector<size_t> freeSlots;
+    for (size_t slot{ 0 }; slot < m_zOf.size(); ++slot) {
+      int64_t const z{ m_zOf[slot] };
+      if (z >= 0 && std::binary_search(zs.begin(), zs.end(), static_cast<uint64_t>(z))) {
+        continue;
+      }
+      if (z >= 0) {
+        m_slotOf[z] = -1;
+        m_zOf[slot] = -1;
+      }
+      freeSlots.push_back(slot);
+    }
+
+    for (uint64_t z : zs) {
+      if (m_slotOf[z] >= 0) {
+        continue;
+      }
+      size_t const slot{ freeSlots.back() };
+      freeSlots.pop_back();
+      if (!read(z, m_data.data() + slot * m_sliceElems)) {
+        return false;
+      }
+      m_slotOf[z] = static_cast<int64_t>(slot);
+      m_zOf[slot] = static_cast<int64_t>(z);
+    }
+
+    return true;
+  }
+
+
+  /// \brief Slice \c z, which must have been given to the last load().
+  Ty const *
+  slice(uint64_t z) const
+  {
+    return m_data.data() + m_slotOf[z] * m_sliceElems;
+  }
+
+
+private:
+
+  bool
+  read(uint64_t z, Ty *dest)
+  {
+    uint64_t const sliceBytes{ m_sliceElems * ( m_half ? sizeof(uint16_t) : sizeof(Ty) ) };
+    uint64_t const pos{ z * sliceBytes };
+    if (pos != m_filePos) {
+      m_in.seekg(pos, std::ios::beg);
+    }
+
+    char *buf{ m_half ? reinterpret_cast<char *>(m_scratch.data())
+                      : reinterpret_cast<char *>(dest) };
+    m_in.read(buf, sliceBytes);
+    if (static_cast<uint64_t>(m_in.gcount()) != sliceBytes) {
+      bd::Err() << "Could not read slice " << z << " of the input file.";
+      return false;
+    }
+    m_filePos = pos + sliceBytes;
+
+    if (m_half) {
+      bd::halfToFloat(m_scratch.data(), reinterpret_cast<float *>(dest), m_sliceElems);
+    }
+
+    return true;
+  }
+
+
+  std::ifstream &m_in;
+  uint64_t m_sliceElems;
+  bool m_half;
+  uint64_t m_filePos;             ///< where the next read starts.
+
+  std::vector<Ty> m_data;         ///< capacity slices.
+  std::vector<int64_t> m_slotOf;  ///< slot of each input slice, -1 if not loaded.
+  std::vector<int64_t> m_zOf;     ///< input slice in each slot, -1 if empty.
+  std::vector<uint16_t> m_scratch;
+
+}; // class SliceWindow
+
+} // namespace resample
+
+#endif // ! resample_slicewindow_h
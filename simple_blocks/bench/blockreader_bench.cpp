@@ -0,0 +1,193 @@
+//
+// Created by jim on 3/10/19.
+//
+// Time the BlockReader implementations on the blocks of an index file.
+//
+// Every reader loads the same blocks into float buffers, the checksum of the
+// buffers is printed so the readers can be checked against each other. Run
+// with a cold page cache (e.g. after echo 3 > /proc/sys/vm/drop_caches) to
+// measure the disk, or twice to measure the per row overhead.
+//
+
+#include "io/blockreader.h"
+
+#include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/log/logger.h>
+
+#include <tclap/CmdLine.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Result
+{
+  double seconds;
+  double checksum;
+};
+
+
+/// \brief Load \c blocks with \c threads threads.
+/// If \c shared is true all threads use one reader, otherwise each thread
+/// has its own reader and stream.
+Result
+run(subvol::BlockReaderType rt, bool shared, int threads,
+    bd::indexfile::v2::JsonIndexFile const &index, std::string const &raw,
+    std::vector<bd::FileBlock const *> const &blocks)
+{
+  bd::Volume const &vol{ index.getVolume() };
+  glm::u64vec3 const bdims{ vol.block_dims() };
+  uint64_t const ve[2]{ vol.voxelDims().x, vol.voxelDims().y };
+  double const vMin{ vol.min() };
+  double const vDiff{ vol.max() - vol.min() };
+  size_t const blockElems{ bdims.x * bdims.y * bdims.z };
+
+  std::unique_ptr<subvol::BlockReader> sharedReader;
+  if (shared) {
+    sharedReader.reset(subvol::BlockReaderFactory::New(index.getDatType(), rt));
+    sharedReader->open(raw);
+  }
+
+  std::vector<double> sums(threads, 0.0);
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      std::unique_ptr<subvol::BlockReader> own;
+      subvol::BlockReader *reader{ sharedReader.get() };
+      if (!reader) {
+        own.reset(subvol::BlockReaderFactory::New(index.getDatType(), rt));
+        own->open(raw);
+        reader = own.get();
+      }
+      std::ifstream is(raw, std::ios::binary);
+      std::vector<float> pixels(blockElems);
+
+      for (size_t i = t; i < blocks.size(); i += threads) {
+        bd::FileBlock const *fb{ blocks[i] };
+        reader->fillBlockData(reinterpret_cast<char *>(pixels.data()), &is,
+                              fb->data_offset, fb->voxel_dims, fb->ijk_index,
+                              ve, vMin, vDiff);
+        sums[t] += std::accumulate(pixels.begin(), pixels.end(), 0.0);
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+
+  double const secs{ std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count() };
+  return { secs, std::accumulate(sums.begin(), sums.end(), 0.0) };
+}
+
+} // namespace
+
+
+int
+main(int argc, char const *argv[])
+{
+  std::string indexPath, rawPath, readers;
+  int threads, count, repeat;
+  bool shuffle;
+  try {
+    TCLAP::CmdLine cmd("Benchmark the block readers.", ' ');
+    TCLAP::ValueArg<std::string> indexArg("i", "index", "Index file.", true, "",
+                                          "string");
+    cmd.add(indexArg);
+    TCLAP::ValueArg<std::string> rawArg("f", "file", "Raw file (default: from index).",
+                                        false, "", "string");
+    cmd.add(rawArg);
+    TCLAP::ValueArg<std::string> readersArg("", "readers",
+                                            "Comma separated readers to run "
+                                            "(stream, gather, brick).",
+                                            false, "stream,gather", "string");
+    cmd.add(readersArg);
+    TCLAP::ValueArg<int> threadsArg("", "threads", "Loader threads.", false, 1,
+                                    "int");
+    cmd.add(threadsArg);
+    TCLAP::ValueArg<int> countArg("n", "count", "Blocks to load (0 for all).",
+                                  false, 0, "int");
+    cmd.add(countArg);
+    TCLAP::ValueArg<int> repeatArg("", "repeat", "Times to run each reader.",
+                                   false, 3, "int");
+    cmd.add(repeatArg);
+    TCLAP::SwitchArg shuffleArg("", "shuffle", "Load blocks in random order.",
+                                cmd, false);
+    cmd.parse(argc, argv);
+
+    indexPath = indexArg.getValue();
+    rawPath = rawArg.getValue();
+    readers = readersArg.getValue();
+    threads = std::max(1, threadsArg.getValue());
+    count = countArg.getValue();
+    repeat = std::max(1, repeatArg.getValue());
+    shuffle = shuffleArg.getValue();
+  } catch (TCLAP::ArgException &e) {
+    std::cerr << "Error parsing command line args: " << e.error()
+              << " for argument " << e.argId() << std::endl;
+    return 1;
+  }
+
+  bd::indexfile::v2::JsonIndexFile index;
+  if (!index.open(indexPath)) {
+    return 1;
+  }
+  if (rawPath.empty()) {
+    rawPath = index.getRawFilePath() + "/" + index.getRawFileName();
+  }
+
+  std::vector<bd::FileBlock const *> blocks;
+  for (bd::FileBlock const &fb : index.getFileBlocks()) {
+    blocks.push_back(&fb);
+  }
+  if (shuffle) {
+    std::shuffle(blocks.begin(), blocks.end(), std::mt19937{ 1 });
+  }
+  if (count > 0 && static_cast<size_t>(count) < blocks.size()) {
+    blocks.resize(count);
+  }
+
+  uint64_t bytes{ 0 };
+  for (bd::FileBlock const *fb : blocks) {
+    bytes += fb->data_bytes;
+  }
+
+  std::cout << "reader,shared,threads,run,blocks,seconds,MB/s,checksum\n";
+  std::stringstream ss(readers);
+  std::string name;
+  while (std::getline(ss, name, ',')) {
+    subvol::BlockReaderType rt;
+    if (!subvol::to_blockReaderType(name, rt)) {
+      bd::Err() << "Unknown reader: " << name;
+      return 1;
+    }
+    if (( rt == subvol::BlockReaderType::Brick ) != index.isBricked()) {
+      bd::Warn() << "Skipping " << name << ", it does not match the raw file layout.";
+      continue;
+    }
+
+    // only the gather reader is safe to share between threads.
+    bool const shared{ rt == subvol::BlockReaderType::RowGather };
+    for (int r = 0; r < repeat; ++r) {
+      Result const res{ run(rt, shared, threads, index, rawPath, blocks) };
+      std::cout << name << ',' << shared << ',' << threads << ',' << r << ','
+                << blocks.size() << ',' << res.seconds << ','
+                << bytes / res.seconds / ( 1024.0 * 1024.0 ) << ','
+                << res.checksum << '\n';
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,184 @@
+//
+// Created by jim on 3/13/19.
+//
+// Time the per frame back to front sort of the visible blocks.
+//
+// A grid of blocks is built and a fraction of them are picked as visible,
+// then the eye orbits the volume and the visible list is re-sorted every
+// frame, first with std::sort on the distance to the block centres (the old
+// renderer sort), then with bd::GridOrder. The list is kept between frames,
+// like the renderers do, so the sorts see nearly sorted input.
+//
+
+#include <bd/volume/gridorder.h>
+
+#include <tclap/CmdLine.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+
+/// Just the parts of a bd::Block that the sorts look at.
+struct SortBlock
+{
+  glm::u64vec3 ijk;
+  glm::vec3 origin;
+};
+
+
+/// \brief The eye on frame \c f: a circle around the volume, tilted and
+///        bobbing so all three axes change.
+glm::vec3
+eyeAt(int f, int frames, float radius)
+{
+  float const t{ 6.2831853f * f / frames };
+  return { radius * std::cos(t), 0.3f * radius * std::sin(3.0f * t),
+           radius * std::sin(t) };
+}
+
+
+struct Result
+{
+  double usPerFrame;
+  int sorted;  ///< frames where the list was actually re-sorted.
+  int bad;     ///< frames where the list was not in grid order (-1 if unchecked).
+};
+
+
+template<class SortFn>
+Result
+run(std::vector<SortBlock *> blocks, bd::GridOrder *check, int frames,
+    float radius, SortFn sortFn)
+{
+  auto ijkOf = [](SortBlock const *b) { return b->ijk; };
+  Result res{ 0.0, 0, check ? 0 : -1 };
+  double total{ 0.0 };
+  for (int f = 0; f < frames; ++f) {
+    glm::vec3 const eye{ eyeAt(f, frames, radius) };
+
+    auto start = std::chrono::steady_clock::now();
+    res.sorted += sortFn(blocks, eye) ? 1 : 0;
+    total += std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count();
+
+    if (check) {
+      check->setEye(eye);
+      res.bad += check->isSorted(blocks, ijkOf) ? 0 : 1;
+    }
+  }
+  res.usPerFrame = total / frames;
+  return res;
+}
+
+} // namespace
+
+
+int
+main(int argc, char const *argv[])
+{
+  uint64_t n;
+  int frames;
+  std::string fractions;
+  try {
+    TCLAP::CmdLine cmd("Benchmark the back to front block sort.", ' ');
+    TCLAP::ValueArg<uint64_t> nArg("n", "blocks", "Blocks along each axis.",
+                                   false, 64, "uint");
+    cmd.add(nArg);
+    TCLAP::ValueArg<int> framesArg("", "frames", "Frames per orbit.", false,
+                                   720, "int");
+    cmd.add(framesArg);
+    TCLAP::ValueArg<std::string> fracArg("", "fractions",
+                                         "Comma separated fractions of "
+                                         "visible blocks.",
+                                         false, "0.05,0.25,1.0", "string");
+    cmd.add(fracArg);
+    cmd.parse(argc, argv);
+
+    n = std::max<uint64_t>(1, nArg.getValue());
+    frames = std::max(1, framesArg.getValue());
+    fractions = fracArg.getValue();
+  } catch (TCLAP::ArgException &e) {
+    std::cerr << "Error parsing command line args: " << e.error()
+              << " for argument " << e.argId() << std::endl;
+    return 1;
+  }
+
+  // unit cube volume centred on the origin, like the renderers.
+  glm::u64vec3 const dims{ n, n, n };
+  glm::vec3 const cell{ 1.0f / n };
+  glm::vec3 const min{ -0.5f };
+  std::vector<SortBlock> all;
+  all.reserve(n * n * n);
+  for (uint64_t k = 0; k < n; ++k) {
+    for (uint64_t j = 0; j < n; ++j) {
+      for (uint64_t i = 0; i < n; ++i) {
+        glm::vec3 const c{ min + ( glm::vec3(i, j, k) + 0.5f ) * cell };
+        all.push_back({ { i, j, k }, c });
+      }
+    }
+  }
+
+  std::cout << "sort,blocks,visible,frames,us/frame,resorted,bad\n";
+  std::stringstream ss(fractions);
+  std::string tok;
+  while (std::getline(ss, tok, ',')) {
+    double const frac{ std::min(1.0, std::max(0.0, std::stod(tok))) };
+
+    std::vector<SortBlock *> visible;
+    for (SortBlock &b : all) {
+      visible.push_back(&b);
+    }
+    std::shuffle(visible.begin(), visible.end(), std::mt19937{ 1 });
+    visible.resize(static_cast<size_t>(frac * visible.size()));
+
+    bd::GridOrder check{ dims };
+    check.setWorldBox(min, cell);
+
+    // orbit passes through the volume as well as around it.
+    for (float radius : { 2.0f, 0.3f }) {
+      Result const dist{
+          run(visible, nullptr, frames, radius,
+              [](std::vector<SortBlock *> &v, glm::vec3 const &eye) {
+                std::sort(v.begin(), v.end(),
+                          [&eye](SortBlock *a, SortBlock *b) {
+                            return glm::distance(eye, a->origin) >
+                                   glm::distance(eye, b->origin);
+                          });
+                return true;
+              }) };
+
+      bd::GridOrder order{ dims };
+      order.setWorldBox(min, cell);
+      Result const grid{
+          run(visible, &check, frames, radius,
+              [&order](std::vector<SortBlock *> &v, glm::vec3 const &eye) {
+                auto ijkOf = [](SortBlock const *b) { return b->ijk; };
+                bool const moved{ order.setEye(eye) };
+                if (!moved && order.isSorted(v, ijkOf)) {
+                  return false;
+                }
+                order.sort(v, ijkOf);
+                return true;
+              }) };
+
+      std::string const where{ radius > 1.0f ? "outside" : "inside" };
+      for (auto const &r : { std::make_pair("distance-" + where, dist),
+                             std::make_pair("grid-" + where, grid) }) {
+        std::cout << r.first << ',' << all.size() << ',' << visible.size()
+                  << ',' << frames << ',' << r.second.usPerFrame << ','
+                  << r.second.sorted << ',' << r.second.bad << '\n';
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+//
+// Created by jim on 3/15/19.
+//
+// Time how long it takes to open an index file at startup.
+//
+// With --generate a synthetic index of n^3 blocks (100^3 is a million) is
+// written first, as json and as a binary (v3) index next to it. Each run
+// opens one of them and prints the time and the peak resident memory of the
+// process, so run it once per format to compare them (peak memory is per
+// process). Drop the page cache first to include the disk.
+//
+
+#include <bd/io/indexfile/indexfile.h>
+#include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/io/indexfile/v3/binaryindexfile.h>
+#include <bd/log/logger.h>
+
+#include <tclap/CmdLine.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+
+/// \brief Peak resident memory of this process in MB (0 if unknown).
+double
+peakMegabytes()
+{
+#ifndef _WIN32
+  rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) == 0) {
+    return ru.ru_maxrss / 1024.0;
+  }
+#endif
+  return 0.0;
+}
+
+
+/// \brief Write a json and a binary index of n^3 blocks of 8^3 voxels.
+bool
+generate(std::string const &path, uint64_t n)
+{
+  bd::IndexFile index;
+  index.setVolume(bd::Volume{ { n * 8, n * 8, n * 8 }, { n, n, n } });
+  index.init(bd::DataType::UnsignedShort);
+
+  std::vector<bd::FileBlock> blocks{ index.getFileBlocks() };
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    bd::FileBlock &b = blocks[i];
+    b.rov = ( i % 97 ) / 97.0;
+    b.min_val = i % 13;
+    b.max_val = b.min_val + i % 31;
+    b.avg_val = ( b.min_val + b.max_val ) * 0.5;
+    b.total_val = b.avg_val * 512;
+    b.empty_voxels = i % 513;
+  }
+
+  bd::indexfile::v2::JsonIndexFile json;
+  json.setRawFileName("synthetic.raw");
+  json.setRawFilePath(".");
+  json.setTFFileName("synthetic.1dt");
+  json.setDatType(bd::DataType::UnsignedShort);
+  json.setVolume(index.getVolume());
+  json.setFileBlocks(std::move(blocks));
+  return json.write(path) &&
+         bd::indexfile::v3::BinaryIndexFile::write(path + ".idx", json);
+}
+
+} // namespace
+
+
+int
+main(int argc, char const *argv[])
+{
+  std::string path, format;
+  uint64_t generateN;
+  try {
+    TCLAP::CmdLine cmd("Benchmark opening an index file.", ' ');
+    TCLAP::ValueArg<std::string> pathArg("i", "index",
+                                         "Json index file (the binary index is "
+                                         "<index>.idx).",
+                                         true, "", "string");
+    cmd.add(pathArg);
+    std::vector<std::string> formats{ "json", "binary" };
+    TCLAP::ValuesConstraint<std::string> formatConstraint(formats);
+    TCLAP::ValueArg<std::string> formatArg("", "format", "Index file to open.",
+                                           false, "json", &formatConstraint);
+    cmd.add(formatArg);
+    TCLAP::ValueArg<uint64_t> generateArg("", "generate",
+                                          "Write a synthetic index of n^3 blocks "
+                                          "first (0 to use an existing one).",
+                                          false, 0, "uint");
+    cmd.add(generateArg);
+    cmd.parse(argc, argv);
+
+    path = pathArg.getValue();
+    format = formatArg.getValue();
+    generateN = generateArg.getValue();
+  } catch (TCLAP::ArgException &e) {
+    std::cerr << "Error parsing command line args: " << e.error()
+              << " for argument " << e.argId() << std::endl;
+    return 1;
+  }
+
+  if (generateN > 0) {
+    if (!generate(path, generateN)) {
+      return 1;
+    }
+    bd::Info() << "Wrote " << path << " and " << path << ".idx";
+    return 0;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  bd::indexfile::v2::JsonIndexFile index;
+  if (format == "binary") {
+    bd::indexfile::v3::BinaryIndexFile bin;
+    if (!bin.open(path + ".idx")) {
+      return 1;
+    }
+    bin.copyTo(index);
+  } else if (!index.open(path)) {
+    return 1;
+  }
+  double const secs{ std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count() };
+
+  std::cout << "format,blocks,seconds,peak MB\n"
+            << format << ',' << index.getFileBlocks().size() << ',' << secs
+            << ',' << peakMegabytes() << '\n';
+
+  return 0;
+}
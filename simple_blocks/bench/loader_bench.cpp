@@ -0,0 +1,407 @@
+//
+// Created by jim on 3/31/19.
+//
+// Replay a recorded session against the block loader, without a gl context.
+//
+// The session (see io/session.h, simple_blocks writes one with
+// --record-session) is a list of ROV range changes, transfer functions,
+// classification changes and camera moves. Each command that changes the
+// visible blocks is timed from the call that queues them in the loader until
+// every visible block that fits on the "gpu" is resident: the loader stages
+// are idle and its gpu ready queue is drained. Uploads go to a staging buffer
+// with a memcpy instead of a texture, and there are as many stand-in
+// textures as --gpu-mem would hold.
+//
+// For each step it prints the time, the blocks and bytes read from the raw
+// file and the main memory and gpu hit rates, then the p50, p95 and p99 of
+// the step times. Camera moves only re-sort the visible blocks, that time is
+// reported separately. Drop the page cache first to include the disk.
+//
+
+#include "cmdline.h"
+#include "io/blockcollection.h"
+#include "io/blockloader.h"
+#include "io/session.h"
+#include "messages/messagebroker.h"
+
+#include <bd/graphics/texture.h>
+#include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/io/indexfile/v3/binaryindexfile.h>
+#include <bd/log/logger.h>
+#include <bd/volume/gridorder.h>
+#include <bd/volume/transferfunction.h>
+
+#include <tclap/CmdLine.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+
+/// \brief The value below which \c p percent of \c v fall (nearest rank).
+double
+percentile(std::vector<double> v, double p)
+{
+  if (v.empty()) {
+    return 0.0;
+  }
+  std::sort(v.begin(), v.end());
+  size_t rank{ static_cast<size_t>(p / 100.0 * v.size() + 0.5) };
+  rank = rank < 1 ? 1 : rank;
+  return v[std::min(rank, v.size()) - 1];
+}
+
+
+double
+hitPercent(size_t hits, size_t misses)
+{
+  size_t const n{ hits + misses };
+  return n == 0 ? 100.0 : 100.0 * hits / n;
+}
+
+
+/// \brief Upload blocks until the loader is idle and nothing is left to
+///        upload, like the render loop would.
+/// \return false if it took longer than \c timeout seconds.
+bool
+settle(subvol::BlockCollection &bc, subvol::BlockLoader &loader,
+       Clock::time_point start, double timeout)
+{
+  while (std::chrono::duration<double>(Clock::now() - start).count() < timeout) {
+    if (bc.loadSomeBlocks() > 0) {
+      continue;
+    }
+    // nothing new reaches the gpu ready queue once the loader is idle, so
+    // one more pass drains it.
+    if (loader.idle() && bc.loadSomeBlocks() == 0) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  return false;
+}
+
+
+size_t
+countResident(std::vector<bd::Block *> const &blocks)
+{
+  size_t n{ 0 };
+  for (bd::Block const *b : blocks) {
+    n += ( b->status() & bd::Block::GPU_RES ) ? 1 : 0;
+  }
+  return n;
+}
+
+
+/// \brief Open a json index into \c index, or map a binary one into \c bin
+///        and copy only its header into \c index.
+bool
+openIndex(std::string const &path, bd::indexfile::v2::JsonIndexFile &index,
+          bd::indexfile::v3::BinaryIndexFile &bin, bool &binary)
+{
+  binary = bd::indexfile::v3::BinaryIndexFile::isBinaryIndexFile(path);
+  if (!binary) {
+    return index.open(path);
+  }
+  if (!bin.open(path)) {
+    return false;
+  }
+  bin.copyHeaderTo(index);
+  return true;
+}
+
+} // namespace
+
+
+int
+main(int argc, char const *argv[])
+{
+  std::string rawPath, indexPath, sessionPath, mainMem, gpuMem, reader, format,
+      policy;
+  bool nativeCache;
+  int ioThreads, convertThreads, derivedThreads, queueDepth;
+  double timeout;
+  try {
+    TCLAP::CmdLine cmd("Replay a session against the block loader.", ' ');
+    TCLAP::ValueArg<std::string> rawArg("f", "file", "Raw volume file.",
+                                        true, "", "string");
+    cmd.add(rawArg);
+    TCLAP::ValueArg<std::string> indexArg("d", "index-file",
+                                          "Index file (json or binary).",
+                                          true, "", "string");
+    cmd.add(indexArg);
+    TCLAP::ValueArg<std::string> sessionArg("s", "session",
+                                            "Session file to replay.",
+                                            true, "", "string");
+    cmd.add(sessionArg);
+    TCLAP::ValueArg<std::string> mainMemArg("", "main-mem", "Cpu memory to use.",
+                                            false, "1G", "string");
+    cmd.add(mainMemArg);
+    TCLAP::ValueArg<std::string> gpuMemArg("", "gpu-mem", "Gpu memory to use.",
+                                           false, "512M", "string");
+    cmd.add(gpuMemArg);
+    std::vector<std::string> readers{ "stream", "gather" };
+    TCLAP::ValuesConstraint<std::string> readerConstraint(readers);
+    TCLAP::ValueArg<std::string> readerArg("", "block-reader",
+                                           "How blocks are read.",
+                                           false, "stream", &readerConstraint);
+    cmd.add(readerArg);
+    std::vector<std::string> formats{ "float", "half" };
+    TCLAP::ValuesConstraint<std::string> formatConstraint(formats);
+    TCLAP::ValueArg<std::string> formatArg("", "block-format",
+                                           "Block pixel format.",
+                                           false, "float", &formatConstraint);
+    cmd.add(formatArg);
+    TCLAP::SwitchArg nativeArg("", "native-cache",
+                               "Cache blocks in the raw file's type.", cmd,
+                               false);
+    TCLAP::ValueArg<int> ioArg("", "io-threads", "Threads reading blocks.",
+                               false, 1, "int");
+    cmd.add(ioArg);
+    TCLAP::ValueArg<int> convertArg("", "convert-threads",
+                                    "Threads normalizing blocks.",
+                                    false, 1, "int");
+    cmd.add(convertArg);
+    TCLAP::ValueArg<int> derivedArg("", "derived-threads",
+                                    "Threads computing derived data.",
+                                    false, 0, "int");
+    cmd.add(derivedArg);
+    TCLAP::ValueArg<int> depthArg("", "load-queue-depth",
+                                  "Blocks waiting between loader stages.",
+                                  false, 8, "int");
+    cmd.add(depthArg);
+    std::vector<std::string> policies{ "lru", "clock", "cost" };
+    TCLAP::ValuesConstraint<std::string> policyConstraint(policies);
+    TCLAP::ValueArg<std::string> policyArg("", "cache-policy",
+                                           "Block cache eviction policy.",
+                                           false, "lru", &policyConstraint);
+    cmd.add(policyArg);
+    TCLAP::ValueArg<double> timeoutArg("", "timeout",
+                                       "Seconds to wait for one step.",
+                                       false, 120.0, "seconds");
+    cmd.add(timeoutArg);
+    cmd.parse(argc, argv);
+
+    rawPath = rawArg.getValue();
+    indexPath = indexArg.getValue();
+    sessionPath = sessionArg.getValue();
+    mainMem = mainMemArg.getValue();
+    gpuMem = gpuMemArg.getValue();
+    reader = readerArg.getValue();
+    format = formatArg.getValue();
+    nativeCache = nativeArg.getValue();
+    ioThreads = ioArg.getValue();
+    convertThreads = convertArg.getValue();
+    derivedThreads = derivedArg.getValue();
+    queueDepth = depthArg.getValue();
+    policy = policyArg.getValue();
+    timeout = timeoutArg.getValue();
+  } catch (TCLAP::ArgException &e) {
+    std::cerr << "Error parsing command line args: " << e.error()
+              << " for argument " << e.argId() << std::endl;
+    return 1;
+  }
+
+  std::vector<subvol::SessionCommand> session;
+  if (!subvol::readSession(sessionPath, session)) {
+    return 1;
+  }
+
+  bd::indexfile::v3::BinaryIndexFile bin;
+  bool binary{ false };
+  bd::indexfile::v2::JsonIndexFile index;
+  if (!openIndex(indexPath, index, bin, binary)) {
+    return 1;
+  }
+  bd::Volume const &volume{ index.getVolume() };
+  glm::u64vec3 const dims{ volume.block_dims() };
+  size_t const numBlocks{ volume.total_block_count() };
+
+  subvol::BLThreadData *tdata{ new subvol::BLThreadData() };
+  tdata->type = index.getDatType();
+  tdata->slabDims[0] = volume.voxelDims().x;
+  tdata->slabDims[1] = volume.voxelDims().y;
+  tdata->filename = rawPath;
+  if (index.isBricked()) {
+    tdata->readerType = subvol::BlockReaderType::Brick;
+  } else {
+    subvol::to_blockReaderType(reader, tdata->readerType);
+  }
+  subvol::to_blockPixelFormat(format, tdata->pixelFormat);
+  tdata->nativeCache =
+      nativeCache &&
+      bd::to_sizeType(tdata->type) <= subvol::to_sizeType(tdata->pixelFormat);
+  tdata->ioThreads = ioThreads;
+  tdata->convertThreads = convertThreads;
+  tdata->derivedThreads = derivedThreads;
+  tdata->queueDepth = queueDepth;
+  bd::to_cachePolicyType(policy, tdata->cachePolicy);
+
+  size_t const voxels{ dims.x * dims.y * dims.z };
+  size_t const blockBytes{ voxels * subvol::to_sizeType(tdata->pixelFormat) };
+  size_t const cpuBlockBytes{ tdata->nativeCache
+                              ? voxels * bd::to_sizeType(tdata->type)
+                              : blockBytes };
+  if (blockBytes == 0) {
+    bd::Err() << "Blocks have a dimension that is 0.";
+    return 1;
+  }
+  tdata->maxCpuBlocks =
+      std::min<size_t>(subvol::convertToBytes(mainMem) / cpuBlockBytes, numBlocks);
+  tdata->maxGpuBlocks =
+      std::min<size_t>(subvol::convertToBytes(gpuMem) / blockBytes, numBlocks);
+
+  // stand-in textures, the upload function below never touches them.
+  tdata->texs = new std::vector<bd::Texture *>();
+  for (size_t i = 0; i < tdata->maxGpuBlocks; ++i) {
+    tdata->texs->push_back(new bd::Texture(bd::Texture::Target::Tex3D));
+  }
+  std::vector<char> mainMemory(tdata->maxCpuBlocks * cpuBlockBytes);
+  tdata->buffers = new std::vector<char *>();
+  for (size_t i = 0; i < tdata->maxCpuBlocks; ++i) {
+    tdata->buffers->push_back(mainMemory.data() + i * cpuBlockBytes);
+  }
+
+  std::cout << "blocks: " << numBlocks << ", cpu blocks: " << tdata->maxCpuBlocks
+            << ", gpu blocks: " << tdata->maxGpuBlocks << ", block bytes: "
+            << cpuBlockBytes << " main, " << blockBytes << " gpu\n";
+
+  subvol::Broker::start();
+
+  subvol::BlockLoader *loader{ new subvol::BlockLoader(tdata, volume) };
+  std::vector<char> staging(blockBytes);
+  loader->setUploadFunction([&staging](bd::Block *, void const *pixels) {
+    std::memcpy(staging.data(), pixels, staging.size());
+  });
+
+  subvol::BlockCollection *bc{ binary ? new subvol::BlockCollection(loader, bin)
+                                      : new subvol::BlockCollection(loader, index) };
+  bc->setRangeMin(0);
+  bc->setRangeMax(0);
+
+  bd::GridOrder order{ volume.block_count() };
+  {
+    bd::Block const *first{ bc->getBlocks().front() };
+    order.setWorldBox(first->origin() - first->worldDims() * 0.5f,
+                      first->worldDims());
+  }
+  auto ijkOf = [](bd::Block const *b) { return b->ijk(); };
+
+  std::vector<double> stepMs;
+  std::vector<double> sortUs;
+  bool ok{ true };
+  std::cout << "step,command,visible,resident,ms,blocks read,MB read,"
+               "cpu hit %,gpu hit %\n";
+
+  for (size_t i = 0; i < session.size() && ok; ++i) {
+    subvol::SessionCommand const &c = session[i];
+
+    if (c.kind == subvol::SessionCommand::Kind::Camera) {
+      auto start = Clock::now();
+      order.setEye({ c.values[0], c.values[1], c.values[2] });
+      order.sort(bc->getNonEmptyBlocks(), ijkOf);
+      sortUs.push_back(std::chrono::duration<double, std::micro>(
+          Clock::now() - start).count());
+      continue;
+    }
+
+    // load the tf before starting the clock, it is not the loader's time.
+    bd::OpacityTransferFunction otf;
+    if (c.kind == subvol::SessionCommand::Kind::Tf && otf.load(c.arg) < 0) {
+      bd::Err() << "Could not load transfer function " << c.arg;
+      ok = false;
+      break;
+    }
+
+    subvol::BlockLoader::Counters const before{ loader->counters() };
+    auto start = Clock::now();
+
+    std::string what;
+    switch (c.kind) {
+      case subvol::SessionCommand::Kind::Classify: {
+        subvol::ClassificationType type{ subvol::ClassificationType::Rov };
+        if (!subvol::to_classificationType(c.arg, type)) {
+          bd::Err() << "Unknown classification type " << c.arg;
+          ok = false;
+          continue;
+        }
+        bc->changeClassificationType(type);
+        bc->updateBlockCache();
+        what = "classify " + c.arg;
+        break;
+      }
+      case subvol::SessionCommand::Kind::Rov:
+        bc->setRangeMin(c.values[0]);
+        bc->setRangeMax(c.values[1]);
+        bc->filterBlocks();
+        bc->updateBlockCache();
+        what = "rov " + std::to_string(c.values[0]) + " " +
+            std::to_string(c.values[1]);
+        break;
+      case subvol::SessionCommand::Kind::Tf: {
+        // what the broker would deliver to the collection.
+        subvol::TransferFunctionChangedMessage m;
+        m.Otf = otf;
+        m.FileName = c.arg;
+        bc->handle_TransferFunctionChangedMessage(m);
+        bc->reclassify();
+        what = "tf " + c.arg;
+        break;
+      }
+      default:
+        break;
+    }
+
+    if (!settle(*bc, *loader, start, timeout)) {
+      bd::Err() << "Step " << i << " (" << what << ") did not finish in "
+                << timeout << "s.";
+      ok = false;
+    }
+    double const ms{ std::chrono::duration<double, std::milli>(
+        Clock::now() - start).count() };
+    stepMs.push_back(ms);
+
+    subvol::BlockLoader::Counters const after{ loader->counters() };
+    std::vector<bd::Block *> const &visible = bc->getNonEmptyBlocks();
+    std::cout << i << ',' << what << ',' << visible.size() << ','
+              << countResident(visible) << ',' << ms << ','
+              << after.blocksRead - before.blocksRead << ','
+              << ( after.bytesRead - before.bytesRead ) / ( 1024.0 * 1024.0 ) << ','
+              << hitPercent(after.cpuHits - before.cpuHits,
+                            after.cpuMisses - before.cpuMisses) << ','
+              << hitPercent(after.gpuHits - before.gpuHits,
+                            after.gpuMisses - before.gpuMisses) << '\n';
+  }
+
+  subvol::BlockLoader::Counters const total{ loader->counters() };
+  std::cout << "\nsteps: " << stepMs.size()
+            << "\np50 ms: " << percentile(stepMs, 50)
+            << "\np95 ms: " << percentile(stepMs, 95)
+            << "\np99 ms: " << percentile(stepMs, 99)
+            << "\nblocks read: " << total.blocksRead
+            << "\nMB read: " << total.bytesRead / ( 1024.0 * 1024.0 )
+            << "\ncpu hit %: " << hitPercent(total.cpuHits, total.cpuMisses)
+            << " (" << total.cpuEvictions << " evictions)"
+            << "\ngpu hit %: " << hitPercent(total.gpuHits, total.gpuMisses)
+            << " (" << total.gpuEvictions << " evictions)"
+            << "\ncamera moves: " << sortUs.size()
+            << ", sort p50 us: " << percentile(sortUs, 50)
+            << ", p99 us: " << percentile(sortUs, 99) << '\n';
+
+  subvol::Broker::stop();
+  delete bc;
+  for (bd::Texture *t : *tdata->texs) {
+    delete t;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -5,16 +5,37 @@
 #ifndef SUBVOL_CLASSIFICATIONTYPE_H
 #define SUBVOL_CLASSIFICATIONTYPE_H
 
+#include <string>
+
 namespace subvol
 {
 enum ClassificationType
     : int
 {
   Avg,
-  Rov
+  Rov,
+  TfRange   ///< blocks with values that all have zero opacity are culled.
 };
 
 
+/// \brief Parse "avg", "rov" or "tf".
+/// \return false if \c s is not a classification type.
+inline bool
+to_classificationType(std::string const &s, ClassificationType &ct)
+{
+  if (s == "avg") {
+    ct = ClassificationType::Avg;
+  } else if (s == "rov") {
+    ct = ClassificationType::Rov;
+  } else if (s == "tf") {
+    ct = ClassificationType::TfRange;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+
 } //namespace subvol
 
 
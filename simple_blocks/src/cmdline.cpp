@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 namespace subvol
 {
@@ -51,7 +52,7 @@ try
 
   // index file path
   TCLAP::ValueArg<std::string>
-      indexFilePath("", "index-file", "Path to index file.", false, "", "string");
+      indexFilePath("", "index-file", "Path to index file (json or binary).", false, "", "string");
   cmd.add(indexFilePath);
 
   TCLAP::ValueArg<unsigned int>
@@ -108,6 +109,99 @@ try
       samplingModifierZArg("", "smod-z", "Sampling modifier", false, 0, "float");
   cmd.add(samplingModifierZArg);
 
+  std::vector<std::string> readers{ "stream", "gather" };
+  TCLAP::ValuesConstraint<std::string> readerConstraint(readers);
+  TCLAP::ValueArg<std::string>
+      blockReaderArg("", "block-reader",
+                     "How blocks are read from a row-major raw file: stream "
+                     "(seek/read per row) or gather (preadv runs of rows). "
+                     "Bricked raw files are always read a block at a time.",
+                     false, "stream", &readerConstraint);
+  cmd.add(blockReaderArg);
+
+  std::vector<std::string> formats{ "float", "half" };
+  TCLAP::ValuesConstraint<std::string> formatConstraint(formats);
+  TCLAP::ValueArg<std::string>
+      blockFormatArg("", "block-format",
+                     "How voxels are stored in main memory and textures: float "
+                     "(32 bit) or half (16 bit, twice as many blocks fit in "
+                     "the same memory).",
+                     false, "float", &formatConstraint);
+  cmd.add(blockFormatArg);
+
+  TCLAP::SwitchArg nativeCacheArg("", "native-cache",
+                                  "Keep blocks in main memory in the raw file's "
+                                  "data type and normalize them when they are "
+                                  "uploaded to the gpu.",
+                                  cmd, false);
+
+  TCLAP::ValueArg<int>
+      ioThreadsArg("", "io-threads", "Threads reading blocks from disk.", false, 1,
+                   "int");
+  cmd.add(ioThreadsArg);
+
+  TCLAP::ValueArg<int>
+      convertThreadsArg("", "convert-threads", "Threads normalizing loaded blocks.",
+                        false, 1, "int");
+  cmd.add(convertThreadsArg);
+
+  TCLAP::ValueArg<int>
+      derivedThreadsArg("", "derived-threads",
+                        "Threads computing derived block data (0: use the "
+                        "convert threads).",
+                        false, 0, "int");
+  cmd.add(derivedThreadsArg);
+
+  TCLAP::ValueArg<int>
+      loadQueueDepthArg("", "load-queue-depth",
+                        "Blocks that may wait between two loader stages.",
+                        false, 8, "int");
+  cmd.add(loadQueueDepthArg);
+
+  std::vector<std::string> policies{ "lru", "clock", "cost" };
+  TCLAP::ValuesConstraint<std::string> policyConstraint(policies);
+  TCLAP::ValueArg<std::string>
+      cachePolicyArg("", "cache-policy",
+                     "Blocks evicted first from the cpu and gpu caches: lru "
+                     "(least recently used), clock (second chance) or cost "
+                     "(least ROV times reload cost).",
+                     false, "lru", &policyConstraint);
+  cmd.add(cachePolicyArg);
+
+  std::vector<std::string> classifications{ "rov", "avg", "tf" };
+  TCLAP::ValuesConstraint<std::string> classificationConstraint(classifications);
+  TCLAP::ValueArg<std::string>
+      classificationArg("", "classification",
+                        "Blocks shown: rov (ROV in the ROV range), avg (average "
+                        "value in the range) or tf (some value in the block has "
+                        "opacity in the transfer function).",
+                        false, "rov", &classificationConstraint);
+  cmd.add(classificationArg);
+
+  TCLAP::ValueArg<int>
+      rovThreadsArg("", "rov-threads",
+                    "Threads recomputing block ROVs from the raw file when the "
+                    "transfer function changes (0: use the index file's "
+                    "histograms only).",
+                    false, 2, "int");
+  cmd.add(rovThreadsArg);
+
+  TCLAP::ValueArg<std::string>
+      tracePathArg("", "trace",
+                   "Record a timeline of the render, loader and broker threads "
+                   "and write it to this file when the program exits (open it "
+                   "in chrome://tracing or ui.perfetto.dev).",
+                   false, "", "string");
+  cmd.add(tracePathArg);
+
+  TCLAP::ValueArg<std::string>
+      sessionPathArg("", "record-session",
+                     "Record the ROV ranges, transfer functions and camera "
+                     "moves of this session to a file that loader_bench can "
+                     "replay.",
+                     false, "", "string");
+  cmd.add(sessionPathArg);
+
   cmd.parse(argc, argv);
 
   opts.rawFilePath = fileArg.getValue();
@@ -125,6 +219,18 @@ try
   opts.smod_x = samplingModifierXArg.getValue();
   opts.smod_y = samplingModifierYArg.getValue();
   opts.smod_z = samplingModifierZArg.getValue();
+  opts.blockReader = blockReaderArg.getValue();
+  opts.blockFormat = blockFormatArg.getValue();
+  opts.nativeCache = nativeCacheArg.getValue();
+  opts.ioThreads = ioThreadsArg.getValue();
+  opts.convertThreads = convertThreadsArg.getValue();
+  opts.derivedThreads = derivedThreadsArg.getValue();
+  opts.loadQueueDepth = loadQueueDepthArg.getValue();
+  opts.cachePolicy = cachePolicyArg.getValue();
+  opts.classification = classificationArg.getValue();
+  opts.rovThreads = rovThreadsArg.getValue();
+  opts.tracePath = tracePathArg.getValue();
+  opts.sessionPath = sessionPathArg.getValue();
 
   return static_cast<int>(cmd.getArgList().size());
 
@@ -173,6 +279,17 @@ printThem(CommandLineOptions &opts)
       << "\nWindow dims: " << opts.windowWidth << " X " << opts.windowHeight
       << "\nCpu memory: " << opts.mainMemoryBytes
       << "\nGpu memory: " << opts.gpuMemoryBytes
+      << "\nBlock reader: " << opts.blockReader
+      << "\nBlock format: " << opts.blockFormat
+      << "\nNative cache: " << opts.nativeCache
+      << "\nLoader threads (I/O, convert, derived): " << opts.ioThreads << ", "
+      << opts.convertThreads << ", " << opts.derivedThreads
+      << "\nLoad queue depth: " << opts.loadQueueDepth
+      << "\nCache policy: " << opts.cachePolicy
+      << "\nClassification: " << opts.classification
+      << "\nROV threads: " << opts.rovThreads
+      << "\nTrace file: " << opts.tracePath
+      << "\nSession file: " << opts.sessionPath
       << std::endl;
 }
 
@@ -50,6 +50,28 @@ struct CommandLineOptions
   float smod_x;
   float smod_y;
   float smod_z;
+  /// block reader for row-major raw files ("stream" or "gather")
+  std::string blockReader;
+  /// how normalized voxels are stored in the cpu and gpu caches ("float" or "half")
+  std::string blockFormat;
+  /// keep blocks in main memory in the raw file's data type, normalize on upload
+  bool nativeCache;
+  /// block loader threads for each stage
+  int ioThreads;
+  int convertThreads;
+  int derivedThreads;
+  /// blocks waiting between two block loader stages
+  int loadQueueDepth;
+  /// eviction policy of the cpu and gpu block caches ("lru", "clock" or "cost")
+  std::string cachePolicy;
+  /// how blocks are classified at startup ("rov", "avg" or "tf")
+  std::string classification;
+  /// threads recomputing block ROVs from the raw file when the tf changes (0: don't)
+  int rovThreads;
+  /// write a chrome trace event timeline of the session here (empty: don't trace)
+  std::string tracePath;
+  /// record the rov ranges, transfer functions and camera moves here for loader_bench
+  std::string sessionPath;
 };
 
 
@@ -4,6 +4,7 @@
 
 
 #include "colormap.h"
+#include "messages/messagebroker.h"
 
 #include <bd/log/logger.h>
 
@@ -30,6 +31,7 @@ namespace subvol
 ColorMap::ColorMap()
     : m_ctf{ }
     , m_otf{ }
+    , m_otfFileName{ }
     , m_texture{ bd::Texture::Target::Tex1D }
     , m_name{ "default-name" }
 {
@@ -48,6 +50,7 @@ ColorMap::ColorMap()
 ColorMap::ColorMap(std::string const &name, std::vector<glm::vec4> const &knots)
     : m_ctf{ }
     , m_otf{ }
+    , m_otfFileName{ }
     , m_texture{ bd::Texture::Target::Tex1D }
     , m_name{ name }
 {
@@ -123,6 +126,7 @@ ColorMap::loadFromTFFiles(std::string const &funcName,
 
     m_ctf = ctf;
     m_otf = otf;
+    m_otfFileName = opacityTF;
     m_knots = knots;
     m_name = funcName;
 
@@ -166,6 +170,13 @@ ColorMap::setOtf(bd::OpacityTransferFunction const &otf)
 }
 
 
+std::string const &
+ColorMap::getOtfFileName() const
+{
+  return m_otfFileName;
+}
+
+
 bd::Texture const &
 ColorMap::getTexture() const
 {
@@ -510,6 +521,13 @@ ColorMapManager::loadColorMap(std::string const &funcName,
 
   s_colorMapNames.push_back(&s_maps.find("USER")->first);
 
+  if (!c.getOtf().getKnotsVector().empty()) {
+    TransferFunctionChangedMessage *m{ Broker::acquire<TransferFunctionChangedMessage>() };
+    m->Otf = c.getOtf();
+    m->FileName = c.getOtfFileName();
+    Broker::send(m);
+  }
+
   return success;
 }
 
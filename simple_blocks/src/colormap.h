@@ -69,6 +69,12 @@ public:
   setOtf(bd::OpacityTransferFunction const &otf);
 
 
+  /// \brief The file the opacity transfer function was loaded from (empty
+  ///        if it was not loaded from a file).
+  std::string const &
+  getOtfFileName() const;
+
+
   bd::Texture const &
   getTexture() const;
 
@@ -100,6 +106,7 @@ private:
 
   bd::ColorTransferFunction m_ctf;
   bd::OpacityTransferFunction m_otf;
+  std::string m_otfFileName;
   std::vector<glm::vec4> m_knots;
   bd::Texture m_texture;
   std::string m_name;
@@ -170,6 +177,9 @@ public:
 //  loadOpacity1D(std::string const &funcName, std::string const &filename); //TODO: error handling in load_1dt
 
 
+  /// \brief Load a colormap from a color and an opacity transfer function
+  ///        file. If an opacity tf was loaded a TransferFunctionChangedMessage
+  ///        is sent, so the blocks are classified for it.
   static
   bool
   loadColorMap(std::string const &funcName,
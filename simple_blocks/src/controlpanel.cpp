@@ -41,12 +41,14 @@ ClassificationPanel::ClassificationPanel(QWidget *parent = nullptr)
   m_groupBox = new QGroupBox("Classification Type");
   QRadioButton *averageRadio = new QRadioButton("Average");
   QRadioButton *rovRadio = new QRadioButton("ROV");
+  QRadioButton *tfRangeRadio = new QRadioButton("Transfer function");
 
   rovRadio->setChecked(true);
 
   QVBoxLayout *vboxLayout = new QVBoxLayout;
   vboxLayout->addWidget(averageRadio);
   vboxLayout->addWidget(rovRadio);
+  vboxLayout->addWidget(tfRangeRadio);
   vboxLayout->addStretch(1);
 
   m_groupBox->setLayout(vboxLayout);
@@ -100,6 +102,9 @@ ClassificationPanel::ClassificationPanel(QWidget *parent = nullptr)
 
   connect(rovRadio, SIGNAL(clicked(bool)),
           this, SLOT(slot_rovRadioClicked(bool)));
+
+  connect(tfRangeRadio, SIGNAL(clicked(bool)),
+          this, SLOT(slot_tfRangeRadioClicked(bool)));
 }
 
 
@@ -147,7 +152,7 @@ ClassificationPanel::slot_minSliderChanged(int minSliderValue)
 
   m_currentMin_Label->setText(QString::number(m_currentMinROVFloat));
 
-  MinRangeChangedMessage *m{ new MinRangeChangedMessage };
+  MinRangeChangedMessage *m{ Broker::acquire<MinRangeChangedMessage>() };
   m->Min = m_currentMinROVFloat;
   Broker::send(m);
 
@@ -166,7 +171,7 @@ ClassificationPanel::slot_maxSliderChanged(int maxSliderValue)
 
   m_currentMax_Label->setText(QString::number(m_currentMaxROVFloat));
 
-  MaxRangeChangedMessage *m{ new MaxRangeChangedMessage };
+  MaxRangeChangedMessage *m{ Broker::acquire<MaxRangeChangedMessage>() };
   m->Max = m_currentMaxROVFloat;
   Broker::send(m);
 
@@ -177,7 +182,7 @@ ClassificationPanel::slot_maxSliderChanged(int maxSliderValue)
 void
 ClassificationPanel::slot_sliderPressed()
 {
-  ROVChangingMessage *m{ new ROVChangingMessage };
+  ROVChangingMessage *m{ Broker::acquire<ROVChangingMessage>() };
   m->IsChanging = true;
   Broker::send(m);
 }
@@ -187,7 +192,7 @@ ClassificationPanel::slot_sliderPressed()
 void
 ClassificationPanel::slot_sliderReleased()
 {
-  ROVChangingMessage *m{ new ROVChangingMessage };
+  ROVChangingMessage *m{ Broker::acquire<ROVChangingMessage>() };
   m->IsChanging = false;
   Broker::send(m);
 }
@@ -209,6 +214,14 @@ ClassificationPanel::slot_rovRadioClicked(bool)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+void
+ClassificationPanel::slot_tfRangeRadioClicked(bool)
+{
+  emit classificationTypeChanged(ClassificationType::TfRange);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 //   StatsPanel Impl
 ///////////////////////////////////////////////////////////////////////////////
@@ -222,6 +235,7 @@ StatsPanel::StatsPanel(bd::Volume const &vol,
     : Recipient{ "StatsPanel" }
     , m_visibleBlocks{ 0 }
     , m_currentGpuLoadQSize{ 0 }
+    , m_rovProgress{ 100 }
     , m_totalMainBlocks{ cpuCacheSize }
     , m_totalGPUBlocks{ gpuCacheSize }
     , m_totalBlocks{ vol.total_block_count() }
@@ -300,6 +314,22 @@ StatsPanel::StatsPanel(bd::Volume const &vol,
   gridLayout->addWidget(m_gpuTexturesAvailValueLabel, 7, 1);
   gridLayout->addWidget(m_gpuTexturesAvailValueBar, 7, 2);
 
+  QLabel *cpuHitRateLabel = new QLabel("Cpu hits/misses/evictions:");
+  m_cpuHitRateValueLabel = new QLabel();
+  gridLayout->addWidget(cpuHitRateLabel, 8, 0);
+  gridLayout->addWidget(m_cpuHitRateValueLabel, 8, 1, 1, 2);
+
+  QLabel *gpuHitRateLabel = new QLabel("Gpu hits/misses/evictions:");
+  m_gpuHitRateValueLabel = new QLabel();
+  gridLayout->addWidget(gpuHitRateLabel, 9, 0);
+  gridLayout->addWidget(m_gpuHitRateValueLabel, 9, 1, 1, 2);
+
+  QLabel *rovProgressLabel = new QLabel("ROV recompute:");
+  m_rovProgressBar = new QProgressBar();
+  m_rovProgressBar->setValue(m_rovProgress);
+  gridLayout->addWidget(rovProgressLabel, 10, 0);
+  gridLayout->addWidget(m_rovProgressBar, 10, 1, 1, 2);
+
   this->setLayout(gridLayout);
 
   connect(this, SIGNAL(updateStatsValues()),
@@ -308,7 +338,11 @@ StatsPanel::StatsPanel(bd::Volume const &vol,
   connect(this, SIGNAL(updateRenderStatsValues()),
           this, SLOT(setRenderStatsValues()), Qt::QueuedConnection);
 
-  Broker::subscribeRecipient(this);
+  Broker::subscribeRecipient(this, { MessageType::SHOWN_BLOCKS_MESSAGE,
+                                     MessageType::BLOCK_CACHE_STATS_MESSAGE,
+                                     MessageType::SLICESET_CHANGED_MESSAGE,
+                                     MessageType::BLOCK_LOADED_MESSAGE,
+                                     MessageType::ROV_PROGRESS_MESSAGE });
 
 }
 
@@ -389,6 +423,16 @@ StatsPanel::handle_BlockLoadedMessage(BlockLoadedMessage &m)
   emit updateStatsValues();
 }
 
+
+void
+StatsPanel::handle_ROVProgressMessage(ROVProgressMessage &m)
+{
+  m_blockCacheStatsRWLock.lockForWrite();
+  m_rovProgress = m.Done ? 100 : int(100*m.Progress);
+  m_blockCacheStatsRWLock.unlock();
+  emit updateStatsValues();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //void 
 //StatsPanel::handle_RenderStatsMessage(RenderStatsMessage &m)
@@ -405,6 +449,7 @@ StatsPanel::setStatsValues()
   m_blockCacheStatsRWLock.lockForRead();
   BlockCacheStatsMessage m = m_blockCacheStats;
   size_t const gpuQSize{ m_currentGpuLoadQSize };
+  int const rovProgress{ m_rovProgress };
   m_blockCacheStatsRWLock.unlock();
 
 //  m_totalBlocks = m.MaxCpuCacheSize;
@@ -424,6 +469,16 @@ StatsPanel::setStatsValues()
   m_cpuLoadQueueValueLabel->setText(QString::number(m.CpuLoadQueueSize));
   m_gpuLoadQueueValueLabel->setText(QString::number(gpuQSize));
 
+  m_cpuHitRateValueLabel->setText(QString("%1/%2/%3")
+                                      .arg(m.CpuHits)
+                                      .arg(m.CpuMisses)
+                                      .arg(m.CpuEvictions));
+  m_gpuHitRateValueLabel->setText(QString("%1/%2/%3")
+                                      .arg(m.GpuHits)
+                                      .arg(m.GpuMisses)
+                                      .arg(m.GpuEvictions));
+
+  m_rovProgressBar->setValue(rovProgress);
 
 //  m_cpuBuffersAvailValueLabel->setText(QString::number(m.CpuBuffersAvailable));
 //  m_cpuBuffersAvailValueBar->setValue(100 - cpuCashFilledPerc);
@@ -126,6 +126,10 @@ public slots:
   slot_rovRadioClicked(bool);
 
 
+  void
+  slot_tfRangeRadioClicked(bool);
+
+
   void
   slot_globalRangeChanged(double rmax, double rmin);
 
@@ -191,6 +195,10 @@ public:
   handle_BlockLoadedMessage(BlockLoadedMessage &) override;
 
 
+  void
+  handle_ROVProgressMessage(ROVProgressMessage &) override;
+
+
 signals:
 
 
@@ -240,8 +248,14 @@ private:
   QLabel *m_gpuTexturesAvailValueLabel;
   QProgressBar *m_gpuTexturesAvailValueBar;
 
+  QLabel *m_cpuHitRateValueLabel;
+  QLabel *m_gpuHitRateValueLabel;
+
+  QProgressBar *m_rovProgressBar;
+
   size_t m_visibleBlocks;
   size_t m_currentGpuLoadQSize;
+  int m_rovProgress;  ///< percent of the ROV recompute done.
 
   size_t const m_totalBlocks;
   size_t const m_totalMainBlocks;
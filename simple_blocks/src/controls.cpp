@@ -5,10 +5,33 @@
 #include "controls.h"
 #include "renderhelp.h"
 #include "colormap.h"
+#include "messages/messagebroker.h"
 
 namespace subvol
 {
 
+namespace
+{
+
+/// \brief Show colormap \c map, and have the blocks reclassified for its
+///        opacity transfer function if it has one.
+void
+useColorMap(renderer::BlockRenderer &renderer, ColorMap const &map)
+{
+  renderer.setColorMapTexture(map.getTexture());
+  std::cout << "\nColormap: " << ColorMapManager::getCurrentMapName() << '\n';
+
+  if (!map.getOtf().getKnotsVector().empty()) {
+    TransferFunctionChangedMessage *m{ Broker::acquire<TransferFunctionChangedMessage>() };
+    m->Otf = map.getOtf();
+    m->FileName = map.getOtfFileName();
+    Broker::send(m);
+  }
+}
+
+} // namespace
+
+
 Controls *Controls::s_instance{ nullptr };
 
 
@@ -191,8 +214,7 @@ Controls::keyboard_callback(int key, int scancode, int action, int mods)
 
       case GLFW_KEY_T:
         if (mods & GLFW_MOD_SHIFT) {
-          m_renderer->setColorMapTexture(ColorMapManager::getPrevMap().getTexture());
-          std::cout << "\nColormap: " << ColorMapManager::getCurrentMapName() << '\n';
+          useColorMap(*m_renderer, ColorMapManager::getPrevMap());
         } else if (mods & GLFW_MOD_ALT) {
           std::cout << "\n Current map: \n\t Scaling value: "
                     << m_scaleValue
@@ -200,8 +222,7 @@ Controls::keyboard_callback(int key, int scancode, int action, int mods)
                     << ColorMapManager::getMapByName(
                         ColorMapManager::getCurrentMapName()).to_string() << std::endl;
         } else {
-          m_renderer->setColorMapTexture(ColorMapManager::getNextMap().getTexture());
-          std::cout << "\nColormap: " << ColorMapManager::getCurrentMapName() << '\n';
+          useColorMap(*m_renderer, ColorMapManager::getNextMap());
         }
 
       default:
@@ -1,14 +1,16 @@
-#include <GLFW/glfw3.h>
-
 #include "blockcollection.h"
 #include "blockloader.h"
 #include "messages/messagebroker.h"
 
 #include <bd/log/gl_log.h>
 #include <bd/log/logger.h>
+#include <bd/log/trace.h>
 #include <bd/util/util.h>
 #include <bd/io/indexfile/indexfile.h>
 #include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/volume/blockhistogram.h>
+
+#include <chrono>
 
 namespace subvol
 {
@@ -17,6 +19,19 @@ using bd::Block;
 using bd::IndexFile;
 using bd::FileBlock;
 
+namespace
+{
+
+/// \brief The file name part of \c path.
+std::string
+baseName(std::string const &path)
+{
+  size_t const slash{ path.find_last_of("/\\") };
+  return slash==std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
 
 ///////////////////////////////////////////////////////////////////////////////
 //BlockCollection::BlockCollection()
@@ -27,34 +42,86 @@ using bd::FileBlock;
 
 BlockCollection::BlockCollection(BlockLoader *loader,
                                  bd::indexfile::v2::JsonIndexFile const &index)
+    : BlockCollection(loader, index.getVolume(), index.getTFFileName(),
+                      index.getHistogramBins(), index.getHistograms().data())
+{
+  initBlocksFromFileBlocks(index.getFileBlocks(),
+                           m_volume.block_count());
+  subscribe();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+BlockCollection::BlockCollection(BlockLoader *loader,
+                                 bd::indexfile::v3::BinaryIndexFile const &index)
+    : BlockCollection(loader, index.getVolume(), index.getTFFileName(),
+                      index.getHistogramBins(), index.getHistograms())
+{
+  if (index.getNumBlocks() == 0) {
+    bd::Warn() << "No blocks in the index file to initialize.";
+  } else {
+    createBlocks(m_volume.block_count(),
+                 [&index](uint64_t i) { return index.getFileBlock(i); });
+  }
+  subscribe();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+BlockCollection::BlockCollection(BlockLoader *loader, bd::Volume const &volume,
+                                 std::string const &tfFileName, uint32_t histBins,
+                                 uint32_t const *histograms)
     : Recipient{ "BlockCollection" }
     , m_blocks()
     , m_nonEmptyBlocks()
     , m_emptyBlocks()
-    , m_volume{ index.getVolume() }
+    , m_volume{ volume }
     , m_loader{ loader }
     , m_classificationType{ ClassificationType::Rov }
     , m_rangeLow{ 0 }
     , m_rangeHigh{ 0 }
     , m_rangeChanged{ false }
+    , m_histBins{ histograms ? histBins : 0 }
+    , m_histograms{ histograms }
+    , m_opacityRanges{ }
+    , m_indexRovs{ }
+    , m_indexTFFileName{ tfFileName }
+    , m_rovEngine{ nullptr }
+    , m_otfMutex{ }
+    , m_otf{ }
+    , m_otfFileName{ }
+    , m_otfChanged{ false }
 {
   // This is probably a bad place for this, I know.
   // Launch the block loading thread.
   m_loaderFuture =
       std::async(std::launch::async,
                  [loader]() -> int { return ( *loader )(); });
+}
 
-  initBlocksFromFileBlocks(index.getFileBlocks(),
-                           m_volume.block_count());
 
-  Broker::subscribeRecipient(this);
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockCollection::subscribe()
+{
+  Broker::subscribeRecipient(this,
+                             { MessageType::MIN_RANGE_CHANGED_MESSAGE,
+                               MessageType::MAX_RANGE_CHANGED_MESSAGE,
+                               MessageType::TRANSFER_FUNCTION_CHANGED_MESSAGE });
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
 BlockCollection::~BlockCollection()
 {
+  if (m_rovEngine) {
+    delete m_rovEngine;
+  }
   if (m_loader) {
+    m_loader->stop();
+    if (m_loaderFuture.valid()) {
+      m_loaderFuture.wait();
+    }
     delete m_loader;
   }
   Broker::unsubscribeRecipient(this);
@@ -96,11 +163,24 @@ BlockCollection::initBlocksFromFileBlocks(std::vector<FileBlock> const &fileBloc
     return;
   }
 
-  m_blocks.reserve(fileBlocks.size());
-  m_emptyBlocks.reserve(fileBlocks.size());
-  m_nonEmptyBlocks.reserve(fileBlocks.size());
+  createBlocks(nb, [&fileBlocks](uint64_t i) -> FileBlock const & {
+    return fileBlocks[i];
+  });
+}
 
-  int every = static_cast<int>( 0.1f*fileBlocks.size());
+
+///////////////////////////////////////////////////////////////////////////////
+template<class FileBlockAt>
+void
+BlockCollection::createBlocks(glm::u64vec3 const &nb, FileBlockAt fileBlockAt)
+{
+  uint64_t const numBlocks{ nb.x * nb.y * nb.z };
+  m_blocks.reserve(numBlocks);
+  m_emptyBlocks.reserve(numBlocks);
+  m_nonEmptyBlocks.reserve(numBlocks);
+  m_indexRovs.reserve(numBlocks);
+
+  int every = static_cast<int>( 0.1f*numBlocks);
   every = every==0 ? 1 : every;
 
   auto idx = 0ull;
@@ -112,8 +192,9 @@ BlockCollection::initBlocksFromFileBlocks(std::vector<FileBlock> const &fileBloc
           std::cout << "\rCreating block " << idx;
         }
 
-        Block *block{ new Block{{ i, j, k }, fileBlocks[idx] }};
+        Block *block{ new Block{{ i, j, k }, fileBlockAt(idx) }};
         m_blocks.push_back(block);
+        m_indexRovs.push_back(block->fileBlock().rov);
 
         idx++;
       }
@@ -135,6 +216,9 @@ BlockCollection::filterBlocks()
     case ClassificationType::Avg:
       filterBlocksByAverage();
       break;
+    case ClassificationType::TfRange:
+      filterBlocksByTransferFunction();
+      break;
     default:
       break;
   }
@@ -150,24 +234,22 @@ BlockCollection::updateBlockCache()
 
 
 ///////////////////////////////////////////////////////////////////////////////
-void
+int
 BlockCollection::loadSomeBlocks()
 {
+  BD_TRACE_SCOPE("BlockCollection::loadSomeBlocks", "render");
   // we are on the render thread in here.
-  uint64_t t{ 0 };
-  uint64_t const MAX_JOB_LENGTH_MS =
-      10000000;  // <-- this isn't really going to be millis without glfwGetTimerFreq().
+  auto const MAX_JOB_LENGTH = std::chrono::milliseconds(10);
+  auto const start = std::chrono::steady_clock::now();
   bd::Block *b{ nullptr };
   int i{ 0 };
-  while (t<MAX_JOB_LENGTH_MS && ( b = m_loader->getNextGpuReadyBlock())) {
-    //TODO: use glfwGetTimerFreq() for more accurate timing in loadSomeBlocks().
-    uint64_t start{ glfwGetTimerValue() };
-    b->sendToGpu();
+  while (std::chrono::steady_clock::now()-start<MAX_JOB_LENGTH &&
+      ( b = m_loader->getNextGpuReadyBlock())) {
+    m_loader->uploadBlock(b);
     m_loader->pushGpuResidentBlock(b);
-    uint64_t timeToLoadBlock{ glfwGetTimerValue()-start };
-    t += timeToLoadBlock;
     ++i;
   }
+  return i;
 }
 
 
@@ -269,6 +351,7 @@ BlockCollection::changeClassificationType(ClassificationType type)
 void
 BlockCollection::filterBlocksByROV()
 {
+  BD_TRACE_SCOPE("BlockCollection::filterBlocksByROV", "render");
   m_nonEmptyBlocks.clear();
   m_emptyBlocks.clear();
 
@@ -288,7 +371,7 @@ BlockCollection::filterBlocksByROV()
 
   } // for
 
-  ShownBlocksMessage *m{ new ShownBlocksMessage };
+  ShownBlocksMessage *m{ Broker::acquire<ShownBlocksMessage>() };
   m->ShownBlocks = m_nonEmptyBlocks.size();
   Broker::send(m);
 
@@ -300,6 +383,7 @@ BlockCollection::filterBlocksByROV()
 void
 BlockCollection::filterBlocksByAverage()
 {
+  BD_TRACE_SCOPE("BlockCollection::filterBlocksByAverage", "render");
   m_nonEmptyBlocks.clear();
   m_emptyBlocks.clear();
 
@@ -319,12 +403,156 @@ BlockCollection::filterBlocksByAverage()
 
   } // for
 
-  ShownBlocksMessage *m{ new ShownBlocksMessage };
+  ShownBlocksMessage *m{ Broker::acquire<ShownBlocksMessage>() };
+  m->ShownBlocks = m_nonEmptyBlocks.size();
+  Broker::send(m);
+
+  m_rangeChanged = false;
+
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockCollection::filterBlocksByTransferFunction()
+{
+  BD_TRACE_SCOPE("BlockCollection::filterBlocksByTransferFunction", "render");
+  m_nonEmptyBlocks.clear();
+  m_emptyBlocks.clear();
+
+  double const vmin{ m_volume.min() };
+  double const diff{ m_volume.max()-m_volume.min() };
+
+  size_t nBlk{ m_blocks.size() };
+  for (size_t i{ 0 }; i<nBlk; ++i) {
+
+    bd::Block *b{ m_blocks[i] };
+    bd::FileBlock const &fb = b->fileBlock();
+    double const lo{ diff>0 ? ( fb.min_val-vmin )/diff : 0.0 };
+    double const hi{ diff>0 ? ( fb.max_val-vmin )/diff : 0.0 };
+
+    if (!m_opacityRanges.isTransparent(lo, hi)) {
+      b->empty(false);
+      m_nonEmptyBlocks.push_back(b);
+    } else {
+      b->empty(true);
+      m_emptyBlocks.push_back(b);
+    }
+
+  } // for
+
+  ShownBlocksMessage *m{ Broker::acquire<ShownBlocksMessage>() };
   m->ShownBlocks = m_nonEmptyBlocks.size();
   Broker::send(m);
 
   m_rangeChanged = false;
+}
+
 
+///////////////////////////////////////////////////////////////////////////////
+bool
+BlockCollection::getTransferFunctionChanged() const
+{
+  return m_otfChanged;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BlockCollection::reclassify()
+{
+  bd::OpacityTransferFunction otf;
+  std::string otfFileName;
+  {
+    std::unique_lock<std::mutex> lock(m_otfMutex);
+    if (!m_otfChanged.exchange(false)) {
+      return false;
+    }
+    otf = m_otf;
+    otfFileName = m_otfFileName;
+  }
+  if (otf.getKnotsVector().empty()) {
+    return false;
+  }
+
+  m_opacityRanges.build(otf);
+  m_loader->setOccupancyTable(m_opacityRanges);
+
+  std::vector<double> rovs;
+  if (!otfFileName.empty() && !m_indexTFFileName.empty() &&
+      baseName(otfFileName)==baseName(m_indexTFFileName)) {
+
+    // the index file's ROVs are already exact for this tf.
+    if (m_rovEngine) {
+      m_rovEngine->cancel();
+    }
+    rovs = m_indexRovs;
+
+  } else {
+
+    if (m_rovEngine) {
+      m_rovEngine->start(otf);
+    }
+    if (m_histBins>0) {
+      std::vector<double> const binOpacity{ bd::binOpacities(otf, m_histBins) };
+      rovs.resize(m_blocks.size());
+      for (size_t i{ 0 }; i<m_blocks.size(); ++i) {
+        rovs[i] = bd::histogramRov(&m_histograms[i*m_histBins], binOpacity);
+      }
+    } else if (!m_rovEngine && m_classificationType!=ClassificationType::TfRange) {
+      bd::Warn() << "The index file has no block histograms, blocks are not "
+                    "reclassified for the new transfer function.";
+      return false;
+    }
+
+  }
+
+  if (!rovs.empty()) {
+    m_loader->setBlockRovs(m_blocks, rovs);
+  }
+
+  filterBlocks();
+  updateBlockCache();
+
+  bd::Info() << "Reclassified " << m_blocks.size() << " blocks, "
+             << m_nonEmptyBlocks.size() << " are visible.";
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockCollection::setRovEngine(RovEngine *engine)
+{
+  if (m_rovEngine) {
+    delete m_rovEngine;
+  }
+  m_rovEngine = engine;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BlockCollection::applyRecomputedRovs()
+{
+  std::vector<double> rovs;
+  if (!m_rovEngine || !m_rovEngine->takeResult(rovs)) {
+    return false;
+  }
+  if (rovs.size()!=m_blocks.size()) {
+    bd::Err() << "Recomputed " << rovs.size() << " ROVs for "
+              << m_blocks.size() << " blocks.";
+    return false;
+  }
+
+  m_loader->setBlockRovs(m_blocks, rovs);
+
+  filterBlocks();
+  updateBlockCache();
+
+  bd::Info() << "Applied recomputed ROVs, " << m_nonEmptyBlocks.size()
+             << " blocks are visible.";
+  return true;
 }
 
 
@@ -344,6 +572,20 @@ BlockCollection::handle_MinRangeChangedMessage(MinRangeChangedMessage &m)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockCollection::handle_TransferFunctionChangedMessage(
+    TransferFunctionChangedMessage &m)
+{
+  // we are on the delivery thread here, the render thread reclassifies the
+  // blocks in reclassify().
+  std::unique_lock<std::mutex> lock(m_otfMutex);
+  m_otf = m.Otf;
+  m_otfFileName = m.FileName;
+  m_otfChanged = true;
+}
+
+
 
 //IndexFile const &
 //BlockCollection::indexFile() const
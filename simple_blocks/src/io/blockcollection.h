@@ -2,20 +2,25 @@
 #define block_collection_h__
 
 #include "blockloader.h"
+#include "rovengine.h"
 #include "classificationtype.h"
 #include "messages/recipient.h"
 
 #include <bd/volume/block.h>
+#include <bd/volume/opacityrangetable.h>
 #include <bd/io/indexfile/indexfile.h>
 #include <bd/io/buffer.h>
 #include <bd/util/util.h>
 #include <bd/io/bufferpool.h>
 
+#include <atomic>
 #include <functional>
 #include <list>
+#include <mutex>
 #include <vector>
 #include <future>
 #include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/io/indexfile/v3/binaryindexfile.h>
 
 namespace subvol
 {
@@ -26,9 +31,18 @@ class BlockCollection
 public:
 //  BlockCollection();
 
+  /// \note \c index must outlive the BlockCollection, its histograms are
+  ///       used in place.
   BlockCollection(BlockLoader *loader, bd::indexfile::v2::JsonIndexFile const &index);
 
 
+  /// \brief Make the blocks straight from the mapped columns of a binary
+  ///        index, without building a list of FileBlocks first.
+  /// \note \c index must stay open for the life of the BlockCollection,
+  ///       its histograms are used in place.
+  BlockCollection(BlockLoader *loader, bd::indexfile::v3::BinaryIndexFile const &index);
+
+
   virtual ~BlockCollection();
 
 
@@ -50,7 +64,10 @@ public:
   updateBlockCache();
 
 
-  void
+  /// \brief Upload blocks from the loader's gpu ready queue, for up to
+  ///        about 10ms.
+  /// \return The number of blocks uploaded.
+  int
   loadSomeBlocks();
 
 
@@ -114,7 +131,70 @@ public:
   filterBlocksByAverage();
 
 
+  /// \brief Show the blocks whose [min, max] value range has some opacity
+  ///        in the latest transfer function.
+  ///
+  /// Each block is tested in constant time against an OpacityRangeTable of
+  /// the transfer function, so no voxels are read. All blocks are shown
+  /// until a transfer function is received.
+  void
+  filterBlocksByTransferFunction();
+
+
+  /// \brief True if a new transfer function was received that the blocks
+  ///        have not been reclassified for yet.
+  bool
+  getTransferFunctionChanged() const;
+
+
+  /// \brief Recompute every block's ROV for the latest transfer function,
+  ///        then filter the blocks and update the block cache.
+  ///
+  /// Each block's ROV is first estimated from its value histogram in the
+  /// index file, without reading the volume (nothing changes if the index
+  /// file has no histograms). Then, if there is a RovEngine, the exact ROVs
+  /// are recomputed from the raw file in the background and applied by
+  /// applyRecomputedRovs(). If the transfer function is the one the index
+  /// file was built with, the index file's ROVs are used instead. The
+  /// opacity range table used by filterBlocksByTransferFunction() is rebuilt
+  /// too.
+  /// \return true if the blocks were reclassified.
+  bool
+  reclassify();
+
+
+  /// \brief Use \c engine to recompute block ROVs from the raw file when
+  ///        the transfer function changes. The collection deletes it.
+  void
+  setRovEngine(RovEngine *engine);
+
+
+  /// \brief If the RovEngine finished a job, give its ROVs to the blocks,
+  ///        then filter the blocks and update the block cache.
+  /// \return true if the blocks were reclassified.
+  bool
+  applyRecomputedRovs();
+
+
 private:
+  /// \brief Everything but the blocks, which the public constructors make.
+  BlockCollection(BlockLoader *loader, bd::Volume const &volume,
+                  std::string const &tfFileName, uint32_t histBins,
+                  uint32_t const *histograms);
+
+
+  /// \brief Subscribe to messages, once the blocks are made.
+  void
+  subscribe();
+
+
+  /// \brief Make the blocks in index order, fileBlockAt(i) giving block i's
+  ///        FileBlock, and keep their index file ROVs.
+  template<class FileBlockAt>
+  void
+  createBlocks(glm::u64vec3 const &nb, FileBlockAt fileBlockAt);
+
+
   std::vector<bd::Block *> m_blocks;
 
   std::vector<bd::Block *> m_nonEmptyBlocks;
@@ -134,6 +214,21 @@ private:
 
   bool m_rangeChanged;
 
+  uint32_t m_histBins;               ///< 0 if the index has no histograms.
+  uint32_t const *m_histograms;      ///< the index's, m_histBins per block.
+
+  bd::OpacityRangeTable m_opacityRanges;  ///< for the latest tf.
+
+  std::vector<double> m_indexRovs;   ///< ROVs for the index file's tf.
+  std::string m_indexTFFileName;
+
+  RovEngine *m_rovEngine;
+
+  std::mutex m_otfMutex;
+  bd::OpacityTransferFunction m_otf;  ///< latest tf, guarded by m_otfMutex.
+  std::string m_otfFileName;          ///< guarded by m_otfMutex.
+  std::atomic_bool m_otfChanged;
+
   std::function<void(size_t)> m_visibleBlocksCb;
 
 public:   /* public message bus handlers */
@@ -145,6 +240,10 @@ public:   /* public message bus handlers */
   void
   handle_MinRangeChangedMessage(MinRangeChangedMessage &m) override;
 
+
+  void
+  handle_TransferFunctionChangedMessage(TransferFunctionChangedMessage &m) override;
+
   //  BlockMemoryManager *m_man;
 
 }; // BlockCollection
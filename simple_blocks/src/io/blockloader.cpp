@@ -8,6 +8,8 @@
 
 #include <bd/graphics/texture.h>
 #include <bd/log/logger.h>
+#include <bd/log/trace.h>
+#include <bd/util/half.h>
 #include <bd/util/util.h>
 #include <bd/volume/block.h>
 
@@ -25,23 +27,62 @@ BlockLoader::BlockLoader(BLThreadData *threadParams, bd::Volume const &volume)
     , m_buffs()
     , m_loadQueue{ }
     , m_gpuReadyQueue{ }
+    , m_inFlight{ }
+    , m_mainPolicy{ bd::CachePolicyFactory<uint64_t>::New(threadParams->cachePolicy) }
+    , m_gpuPolicy{ bd::CachePolicyFactory<uint64_t>::New(threadParams->cachePolicy) }
+    , m_cpuHits{ 0 }
+    , m_cpuMisses{ 0 }
+    , m_cpuEvictions{ 0 }
+    , m_gpuHits{ 0 }
+    , m_gpuMisses{ 0 }
+    , m_gpuEvictions{ 0 }
     , m_maxGpuBlocks{ threadParams->maxGpuBlocks }
     , m_maxMainBlocks{ threadParams->maxCpuBlocks }
     , m_sizeType{ bd::to_sizeType(threadParams->type) }
+    , m_pixelFormat{ threadParams->pixelFormat }
+    , m_nativeCache{ threadParams->nativeCache }
+    , m_uploadScratch{ }
     , m_slabDims{ threadParams->slabDims[0], threadParams->slabDims[1] }
     , m_volMin{ volume.min() }
     , m_volDiff{ volume.max()-volume.min() }
     , m_fileName{ threadParams->filename }
     , m_reader{ nullptr }
+    , m_ioThreads{ std::max(1, threadParams->ioThreads) }
+    , m_convertThreads{ std::max(1, threadParams->convertThreads) }
+    , m_derivedThreads{ std::max(0, threadParams->derivedThreads) }
+    , m_jobs{ }
+    , m_freeJobs{ }
+    , m_convertQueue{ static_cast<size_t>(std::max(1, threadParams->queueDepth)) }
+    , m_derivedQueue{ static_cast<size_t>(std::max(1, threadParams->queueDepth)) }
+    , m_derived{ }
+    , m_upload{ }
+    , m_blocksRead{ 0 }
+    , m_bytesRead{ 0 }
+    , m_occupancyMutex{ }
+    , m_occupancyTable{ }
+    , m_occupancyGeneration{ 0 }
+    , m_queuedAt{ }
+    , m_queuedCount{ 0 }
 {
-  m_reader = BlockReaderFactory::New(threadParams->type);
+  m_reader = BlockReaderFactory::New(threadParams->type, threadParams->readerType);
+  m_reader->setPixelFormat(m_pixelFormat);
   m_texs = *( threadParams->texs );
   m_buffs = *( threadParams->buffers );
+
+  // enough scratch to keep every I/O and convert thread busy and fill the
+  // queue in between.
+  m_jobs.resize(m_ioThreads + m_convertThreads + std::max(1, threadParams->queueDepth));
+  for (LoadJob &job : m_jobs) {
+    job.block = nullptr;
+    m_freeJobs.push(&job);
+  }
 }
 
 
 BlockLoader::~BlockLoader()
 {
+  delete m_mainPolicy;
+  delete m_gpuPolicy;
   //  if (dptr)
   //  {
   //    if (dptr->buffers)
@@ -56,30 +97,117 @@ BlockLoader::~BlockLoader()
 int
 BlockLoader::operator()()
 {
-  bd::Info() << "Load thread started.";
+  bd::Info() << "Load thread started (" << m_ioThreads << " I/O, "
+             << m_convertThreads << " convert, " << m_derivedThreads
+             << " derived threads).";
+  if (!m_reader->open(m_fileName)) {
+    bd::Err() << "The block reader could not open " << m_fileName
+              << ". Exiting loader loop.";
+    return -1;
+  }
+
+  std::vector<std::thread> io;
+  for (int i = 1; i < m_ioThreads; ++i) {
+    io.emplace_back([this]() { ioStage(); });
+  }
+  std::vector<std::thread> convert;
+  for (int i = 0; i < m_convertThreads; ++i) {
+    convert.emplace_back([this]() { convertStage(); });
+  }
+  std::vector<std::thread> derived;
+  for (int i = 0; i < m_derivedThreads; ++i) {
+    derived.emplace_back([this]() { derivedStage(); });
+  }
+
+  // this thread is one of the I/O threads.
+  ioStage();
+
+  // Shut the stages down front to back so the blocks in flight are finished.
+  for (auto &t : io) {
+    t.join();
+  }
+  m_convertQueue.close();
+  for (auto &t : convert) {
+    t.join();
+  }
+  m_derivedQueue.close();
+  for (auto &t : derived) {
+    t.join();
+  }
+
+  m_reader->close();
+  bd::Dbg() << "Exiting block loader thread.";
+  return 0;
+} // operator()
+
+
+void
+BlockLoader::stop()
+{
+  m_stopThread = true;
+  m_freeJobs.close();
+  {
+    // a loader thread between checking m_stopThread and waiting would miss
+    // the notify.
+    std::unique_lock<std::mutex> lock(m_loadQueueMutex);
+  }
+  m_wait.notify_all();
+}
+
+
+void
+BlockLoader::setDerivedFunction(DerivedFunction fn)
+{
+  m_derived = fn;
+}
+
+
+void
+BlockLoader::setUploadFunction(UploadFunction fn)
+{
+  m_upload = fn;
+}
+
+
+void
+BlockLoader::setOccupancyTable(bd::OpacityRangeTable const &table)
+{
+  std::unique_lock<std::mutex> lock(m_occupancyMutex);
+  m_occupancyTable = std::make_shared<bd::OpacityRangeTable const>(table);
+  ++m_occupancyGeneration;
+}
+
+
+uint32_t
+BlockLoader::occupancyGeneration() const
+{
+  return m_occupancyGeneration;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::ioStage()
+{
+  std::ifstream raw;
   raw.open(m_fileName, std::ios::binary);
   if (!raw.is_open()) {
     bd::Err() << "The raw file " << m_fileName
               << " could not be opened. Exiting loader loop.";
-    return -1;
+    return;
   }
+  BD_TRACE_THREAD_NAME("loader io");
 
+  LoadJob *job{ nullptr };
   while (!m_stopThread) {
 
-    BlockCacheStatsMessage *m{ new BlockCacheStatsMessage };
-    m->CpuCacheSize = m_main.size();
-
-    m_gpuMutex.lock();
-    m->GpuCacheSize = m_gpu.size();
-    m_gpuMutex.unlock();
+    sendStats();
 
-    m_loadQueueMutex.lock();
-    m->CpuLoadQueueSize = m_loadQueue.size();
-    m_loadQueueMutex.unlock();
-
-    m->CpuBuffersAvailable = m_buffs.size();
-    m->GpuTexturesAvailable = m_texs.size();
-    Broker::send(m);
+    // wait for scratch before taking a block, so that a block is never
+    // held back while the convert stage catches up.
+    if (!m_freeJobs.pop(job)) {
+      break;
+    }
 
     // get a block marked as visible
     bd::Block *b{ waitPopLoadQueue() };
@@ -88,37 +216,218 @@ BlockLoader::operator()()
       break;
     }
 
-    b->pixelData(m_buffs.back());
-    m_buffs.pop_back();
-    m_reader->fillBlockData(b->pixelData(),
-                            &raw,
-                            b->fileBlock().data_offset,
-                            b->fileBlock().voxel_dims,
-                            b->fileBlock().ijk_index,
-                            m_slabDims,
-                            m_volMin,
-                            m_volDiff);
+    {
+      std::unique_lock<std::mutex> lock(m_cacheMutex);
+      if (m_buffs.empty()) {
+        bd::Warn() << "No main memory buffer for block " << b->index();
+        m_inFlight.erase(b->index());
+        lock.unlock();
+        m_freeJobs.push(job);
+        continue;
+      }
+      b->pixelData(m_buffs.back());
+      m_buffs.pop_back();
+    }
+
+    bd::FileBlock const &fb{ b->fileBlock() };
+    size_t const bytes{ fb.voxel_dims[0] * fb.voxel_dims[1] * fb.voxel_dims[2] *
+                        m_reader->typeSize() };
+    if (!m_nativeCache && job->scratch.size() < bytes) {
+      job->scratch.resize(bytes);
+    }
+
+    // native voxels are read straight into the pixel buffer.
+    char *dest{ m_nativeCache ? b->pixelData() : job->scratch.data() };
+    bool read;
+    {
+      BD_TRACE_SCOPE_ARG("readBlock", "loader", "block", b->index());
+      read = m_reader->readBlock(dest, &raw, fb.data_offset,
+                                 fb.voxel_dims, fb.ijk_index, m_slabDims);
+    }
+    if (!read) {
+      bd::Err() << "Could not read block " << b->index() << " from " << m_fileName;
+      raw.clear();
+      abandonBlock(b);
+      m_freeJobs.push(job);
+      continue;
+    }
+
+    ++m_blocksRead;
+    m_bytesRead += bytes;
+
+    job->block = b;
+    if (!m_convertQueue.push(job)) {
+      break;
+    }
+
+  } // while
+
+  raw.close();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::convertStage()
+{
+  BD_TRACE_THREAD_NAME("loader convert");
+  LoadJob *job{ nullptr };
+  while (m_convertQueue.pop(job)) {
+    bd::Block *b{ job->block };
+    bd::FileBlock const &fb{ b->fileBlock() };
+    if (!m_nativeCache) {
+      BD_TRACE_SCOPE_ARG("convertBlock", "loader", "block", b->index());
+      m_reader->convertBlock(job->scratch.data(), b->pixelData(),
+                             fb.voxel_dims[0] * fb.voxel_dims[1] * fb.voxel_dims[2],
+                             m_volMin, m_volDiff);
+    }
+    job->block = nullptr;
+    m_freeJobs.push(job);
+
+    if (m_derivedThreads == 0) {
+      derive(b);
+      finishBlock(b);
+    } else {
+      m_derivedQueue.push(b);
+    }
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::derivedStage()
+{
+  BD_TRACE_THREAD_NAME("loader derived");
+  bd::Block *b{ nullptr };
+  while (m_derivedQueue.pop(b)) {
+    derive(b);
+    finishBlock(b);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::derive(bd::Block *b)
+{
+  BD_TRACE_SCOPE_ARG("derive", "loader", "block", b->index());
+  std::shared_ptr<bd::OpacityRangeTable const> table;
+  uint32_t generation{ 0 };
+  {
+    std::unique_lock<std::mutex> lock(m_occupancyMutex);
+    table = m_occupancyTable;
+    generation = m_occupancyGeneration;
+  }
+
+  if (table) {
+    thread_local std::vector<char> scratch;
+    b->occupancy().compute(normalizedVoxels(b, scratch),
+                           b->fileBlock().voxel_dims, *table, generation);
+  }
+
+  if (m_derived) {
+    m_derived(b);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+float const *
+BlockLoader::normalizedVoxels(bd::Block *b, std::vector<char> &scratch) const
+{
+  uint64_t const *dims{ b->fileBlock().voxel_dims };
+  size_t const elems{ dims[0] * dims[1] * dims[2] };
+
+  char const *pixels{ b->pixelData() };
+  if (m_nativeCache) {
+    scratch.resize(elems * to_sizeType(m_pixelFormat));
+    m_reader->convertBlock(pixels, scratch.data(), elems, m_volMin, m_volDiff);
+    pixels = scratch.data();
+  }
+  if (m_pixelFormat == BlockPixelFormat::Half) {
+    thread_local std::vector<float> expanded;
+    expanded.resize(elems);
+    bd::halfToFloat(reinterpret_cast<uint16_t const *>(pixels),
+                    expanded.data(), elems);
+    return expanded.data();
+  }
+  return reinterpret_cast<float const *>(pixels);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::finishBlock(bd::Block *b)
+{
+  {
+    std::unique_lock<std::mutex> lock(m_cacheMutex);
+    m_inFlight.erase(b->index());
     m_main.insert(std::make_pair(b->index(), b));
+    m_mainPolicy->insert(b->index(), blockWeight(b));
 
     if (!m_texs.empty()) {
       b->texture(m_texs.back());
       m_texs.pop_back();
       pushGPUReadyQueue(b);
     }
+  }
+
+  // report once everything that was queued is in main memory.
+  std::unique_lock<std::mutex> lock(m_loadQueueMutex);
+  if (m_queuedCount > 0 && m_loadQueue.empty()) {
+    std::unique_lock<std::mutex> cacheLock(m_cacheMutex);
+    if (m_inFlight.empty()) {
+      bd::Info() << "Loaded " << m_queuedCount << " blocks in "
+                 << std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - m_queuedAt).count()
+                 << "ms.";
+      m_queuedCount = 0;
+    }
+  }
+}
 
 
-  } // while
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::abandonBlock(bd::Block *b)
+{
+  std::unique_lock<std::mutex> lock(m_cacheMutex);
+  m_inFlight.erase(b->index());
+  m_buffs.push_back(b->removePixelData());
+}
 
-  raw.close();
-  bd::Dbg() << "Exiting block loader thread.";
-  return 0;
-} // operator()
 
+///////////////////////////////////////////////////////////////////////////////
 void
-BlockLoader::stop()
+BlockLoader::sendStats()
 {
-  m_stopThread = true;
-  m_wait.notify_one();
+  BlockCacheStatsMessage *m{ Broker::acquire<BlockCacheStatsMessage>() };
+
+  m_cacheMutex.lock();
+  m->CpuCacheSize = m_main.size();
+  m->CpuBuffersAvailable = m_buffs.size();
+  m->GpuTexturesAvailable = m_texs.size();
+  m->CpuHits = m_cpuHits;
+  m->CpuMisses = m_cpuMisses;
+  m->CpuEvictions = m_cpuEvictions;
+  m->GpuHits = m_gpuHits;
+  m->GpuMisses = m_gpuMisses;
+  m->GpuEvictions = m_gpuEvictions;
+  m_cacheMutex.unlock();
+
+  m_gpuMutex.lock();
+  m->GpuCacheSize = m_gpu.size();
+  m_gpuMutex.unlock();
+
+  m_loadQueueMutex.lock();
+  m->CpuLoadQueueSize = m_loadQueue.size();
+  m_loadQueueMutex.unlock();
+
+  BD_TRACE_COUNTER("load queue", m->CpuLoadQueueSize);
+  BD_TRACE_COUNTER("main cache", m->CpuCacheSize);
+
+  Broker::sendLatest(m);
 }
 
 
@@ -137,6 +446,9 @@ BlockLoader::waitPopLoadQueue()
   assert(b!=nullptr && "A null block was found in the load queue");
   m_loadQueue.pop_back();
 
+  std::unique_lock<std::mutex> cacheLock(m_cacheMutex);
+  m_inFlight.insert(b->index());
+
   return b;
 }
 
@@ -146,102 +458,212 @@ void
 BlockLoader::queueClassified(std::vector<bd::Block *> const &visible,
                              std::vector<bd::Block *> const &empty)
 {
+  BD_TRACE_SCOPE("BlockLoader::queueClassified", "render");
   bd::Dbg() << "Visible: " << visible.size() << ", empty: " << empty.size();
   // we hold the load queue mutex here because the load thread shouldn't be doing
   // any work while we sort (literally) things out.
   std::unique_lock<std::mutex> lock(m_loadQueueMutex);
   m_loadQueue.clear();
 
+  // and the cache mutex because the loader stages update main memory and
+  // take buffers and textures as they finish blocks.
+  std::unique_lock<std::mutex> cacheLock(m_cacheMutex);
+  std::unique_lock<std::mutex> gpuLock(m_gpuMutex);
+
   {
-    // clear the gpu ready queue.
+    // clear the gpu ready queue, blocks that are no longer visible give
+    // their texture back. Visible blocks keep theirs and are queued again
+    // below.
     std::unique_lock<std::mutex> lock_gpuReady(m_gpuReadyMutex);
-    std::queue<bd::Block *> empty_q;
-    m_gpuReadyQueue.swap(empty_q);
+    while (!m_gpuReadyQueue.empty()) {
+      bd::Block *b{ m_gpuReadyQueue.front() };
+      m_gpuReadyQueue.pop();
+      if (b->empty()) {
+        m_texs.push_back(b->removeTexture());
+      }
+    }
   }
 
-  // remove only empty blocks from the GPU and put the textures 
-  // back in the list of available textures.
-  removeEmptyBlocksFromGpu();
+  // blocks that are no longer visible are the first to be evicted by the
+  // cost policy.
+  for (bd::Block *b : empty) {
+    m_mainPolicy->setWeight(b->index(), 0.0);
+    m_gpuPolicy->setWeight(b->index(), 0.0);
+  }
 
-  // figure out if we must evict blocks from main memory.
-  // queue all blocks not in main memory for loading by the loader thread.
-  // if the block is already in main, then assign it a texture.
+  // Visible blocks in main memory are hits. Those not in main (or on their
+  // way there) are queued for the loader stages, which push them to main
+  // memory and then to the gpu ready queue. The render thread uploads the
+  // blocks in the gpu ready queue and pushes them to the gpu resident list.
+  std::vector<bd::Block *> needTexture;
   for (size_t i{ 0 }; i<visible.size(); ++i) {
     bd::Block *vis{ visible[i] };
     assert(vis!=nullptr && "Block was null when iterating visible blocks.");
-    if (m_main.find(vis->index())==m_main.end()) {
-      // The block is not in main, so it needs to be loaded from disk, pushed to main,
-      // and finally pushed to the gpu ready queue.
-      // The load thread (running in operator()) pushes to the
-      // gpu ready queue and the render thread pops from the gpu ready queue and uploads
-      // to the gpu, then pushes the block pointer to the gpu resident queue.
+    double const weight{ blockWeight(vis) };
+
+    if (m_inFlight.find(vis->index())!=m_inFlight.end()) {
+      // Already being loaded, the loader puts it in the gpu ready queue.
+      continue;
+    }
+
+    if (!m_mainPolicy->touch(vis->index(), weight)) {
       assert(m_gpu.find(vis->index())==m_gpu.end() &&
                  "Block is not in main, but is in gpu!");
+      ++m_cpuMisses;
+      ++m_gpuMisses;
       m_loadQueue.push_back(vis);
-    } else if (m_gpu.find(vis->index())==m_gpu.end()) {
-      // The block is not on the gpu yet, but it is in main,
-      // so push to the gpu queue. If it has a texture, it is ready to go, 
-      // but if it needs a texture, give it one.
-      if (vis->texture()!=nullptr) {
-        pushGPUReadyQueue(vis);
-      } else if (m_texs.size()>0) {
-        vis->texture(m_texs.back());
-        m_texs.pop_back();
-        pushGPUReadyQueue(vis);
-      }
+      continue;
     }
-  } // for
-
+    ++m_cpuHits;
 
+    if (m_gpuPolicy->touch(vis->index(), weight)) {
+      ++m_gpuHits;
+    } else {
+      ++m_gpuMisses;
+      needTexture.push_back(vis);
+    }
+  } // for
 
-  // if the load queue is larger than the number of available textures,
-  // this means we won't be able to load them all to the gpu. Scan the
-  // main for empties with textures (there probably won't be any)
-  // we we must evict empty blocks from main and recover their texture and pixel buffers.
+  // Load the most relevant blocks first. Make room in main memory for as
+  // many of them as the policy lets us, and drop the rest.
+  std::sort(m_loadQueue.begin(), m_loadQueue.end(),
+            [](bd::Block *lhs, bd::Block *rhs) -> bool {
+              return lhs->fileBlock().rov>rhs->fileBlock().rov;
+            });
 
-  long long num_to_evict{ static_cast<long long>(m_loadQueue.size())-
-                              static_cast<long long>(m_texs.size()) };
-  if (num_to_evict>0) {
-    bd::Dbg() << "Need to evict " << num_to_evict
-              << " blocks (LQ Size: " << m_loadQueue.size()
-              << ", Texs avail: " << m_texs.size() << ").";
+  size_t fits{ 0 };
+  while (fits<m_loadQueue.size() &&
+         ( fits<m_buffs.size() || evictMain(blockWeight(m_loadQueue[fits])))) {
+    ++fits;
+  }
+  if (fits<m_loadQueue.size()) {
+    bd::Dbg() << "Main memory is full, dropped " << m_loadQueue.size()-fits
+              << " blocks from the load queue.";
+    m_loadQueue.resize(fits);
+  }
 
-    // We have more blocks than there are available memory slots, so we need to
-    // evict some empties.
-    auto it = m_main.begin();
-    auto end = m_main.end();
-    while (num_to_evict>0 && it!=end) {
-      bd::Block *b{ it->second };
-      assert(b!=nullptr && "Block was null when iterating main to evict empty blocks.");
-      if (b->empty()) {
-        char *buff{ b->removePixelData() };
-        m_buffs.push_back(buff);
-        it = m_main.erase(it);
-        --num_to_evict;
-      } else {
-        ++it;
+  // Blocks in main memory that are not on the gpu get a texture, if there is
+  // one or the gpu policy gives one up.
+  for (bd::Block *b : needTexture) {
+    if (b->pixelData()==nullptr) {
+      // evicted to make room for the load queue.
+      continue;
+    }
+    if (b->texture()==nullptr) {
+      if (m_texs.empty() && !evictGpu(blockWeight(b))) {
+        continue;
       }
+      b->texture(m_texs.back());
+      m_texs.pop_back();
     }
+    pushGPUReadyQueue(b);
+  }
 
-    // If we did not evict enough blocks from main to fit the entire load queue
-    // into memory, then pop all the blocks out of the load queue that are
-    // remaining.
-    while (num_to_evict>0) {
-      m_loadQueue.pop_back();
-      num_to_evict--;
+  // Keep textures for the blocks being loaded, they are given out as the
+  // blocks are finished.
+  for (size_t i{ m_texs.size() }; i<m_loadQueue.size(); ++i) {
+    if (!evictGpu(blockWeight(m_loadQueue[i]))) {
+      break;
     }
   }
 
-  // sort blocks in ROV descending order
-  std::sort(m_loadQueue.begin(), m_loadQueue.end(),
-            [](bd::Block *lhs, bd::Block *rhs) -> bool {
-              return lhs->fileBlock().rov>rhs->fileBlock().rov;
-            });
+  // the loader pops from the back.
+  std::reverse(m_loadQueue.begin(), m_loadQueue.end());
+
+  m_queuedAt = std::chrono::steady_clock::now();
+  m_queuedCount = m_loadQueue.size();
+
+  bd::Dbg() << "Cpu hits/misses/evictions: " << m_cpuHits << "/" << m_cpuMisses
+            << "/" << m_cpuEvictions << ", gpu: " << m_gpuHits << "/"
+            << m_gpuMisses << "/" << m_gpuEvictions;
 
   m_wait.notify_all();
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+double
+BlockLoader::blockWeight(bd::Block *b) const
+{
+  // only reads the file block, so that the loader threads can call this
+  // while the render thread classifies blocks.
+  bd::FileBlock const &fb{ b->fileBlock() };
+  return fb.rov * static_cast<double>(fb.data_bytes);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BlockLoader::evictMain(double weight)
+{
+  uint64_t key;
+  if (!m_mainPolicy->evict(key)) {
+    return false;
+  }
+
+  auto it = m_main.find(key);
+  assert(it!=m_main.end() && "Main memory policy had a block not in main.");
+  bd::Block *b{ it->second };
+
+  double const victimWeight{ blockWeight(b) };
+  if (!b->empty() && victimWeight>=weight) {
+    // don't trade a visible block for one that is worth no more.
+    m_mainPolicy->insert(key, victimWeight);
+    return false;
+  }
+
+  // the gpu only holds blocks that are in main memory.
+  if (m_gpuPolicy->erase(key)) {
+    m_gpu.erase(key);
+    ++m_gpuEvictions;
+  }
+  if (b->texture()!=nullptr) {
+    m_texs.push_back(b->removeTexture());
+  }
+
+  m_buffs.push_back(b->removePixelData());
+  m_main.erase(it);
+  ++m_cpuEvictions;
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BlockLoader::evictGpu(double weight)
+{
+  uint64_t key;
+  if (!m_gpuPolicy->evict(key)) {
+    return false;
+  }
+
+  auto it = m_gpu.find(key);
+  assert(it!=m_gpu.end() && "Gpu policy had a block not on the gpu.");
+  bd::Block *b{ it->second };
+
+  double const victimWeight{ blockWeight(b) };
+  if (!b->empty() && victimWeight>=weight) {
+    m_gpuPolicy->insert(key, victimWeight);
+    return false;
+  }
+
+  releaseTexture(b);
+  m_gpu.erase(it);
+  ++m_gpuEvictions;
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::releaseTexture(bd::Block *b)
+{
+  bd::Texture *t{ b->removeTexture() };
+  assert(t!=nullptr && "A block in the GPU list had a null texture.");
+  m_texs.push_back(t);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 bd::Block *
 BlockLoader::getNextGpuReadyBlock()
@@ -260,6 +682,29 @@ BlockLoader::getNextGpuReadyBlock()
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::uploadBlock(bd::Block *b)
+{
+  char const *pixels{ b->pixelData() };
+  if (m_nativeCache) {
+    bd::FileBlock const &fb{ b->fileBlock() };
+    size_t const elems{ fb.voxel_dims[0] * fb.voxel_dims[1] * fb.voxel_dims[2] };
+    m_uploadScratch.resize(elems * to_sizeType(m_pixelFormat));
+    m_reader->convertBlock(b->pixelData(), m_uploadScratch.data(), elems,
+                           m_volMin, m_volDiff);
+    pixels = m_uploadScratch.data();
+  }
+
+  if (m_upload) {
+    m_upload(b, pixels);
+    b->setGpuResident();
+  } else {
+    b->sendToGpu(pixels);
+  }
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 void
 BlockLoader::pushGpuResidentBlock(bd::Block *b)
@@ -269,6 +714,7 @@ BlockLoader::pushGpuResidentBlock(bd::Block *b)
 
   std::unique_lock<std::mutex> lock(m_gpuMutex);
   m_gpu.insert(std::make_pair(b->index(), b));
+  m_gpuPolicy->insert(b->index(), blockWeight(b));
 }
 
 
@@ -282,40 +728,65 @@ BlockLoader::clearLoadQueue()
 
 
 ///////////////////////////////////////////////////////////////////////////////
-size_t
-BlockLoader::maxMainBlocks()
+bool
+BlockLoader::idle()
 {
-  return m_maxMainBlocks;
+  std::unique_lock<std::mutex> lock(m_loadQueueMutex);
+  std::unique_lock<std::mutex> cacheLock(m_cacheMutex);
+  return m_loadQueue.empty() && m_inFlight.empty();
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
-size_t
-BlockLoader::maxGpuBlocks()
+BlockLoader::Counters
+BlockLoader::counters()
 {
-  return m_maxGpuBlocks;
+  Counters c;
+  {
+    std::unique_lock<std::mutex> lock(m_cacheMutex);
+    c.cpuHits = m_cpuHits;
+    c.cpuMisses = m_cpuMisses;
+    c.cpuEvictions = m_cpuEvictions;
+    c.gpuHits = m_gpuHits;
+    c.gpuMisses = m_gpuMisses;
+    c.gpuEvictions = m_gpuEvictions;
+  }
+  c.blocksRead = m_blocksRead;
+  c.bytesRead = m_bytesRead;
+  return c;
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
 void
-BlockLoader::removeEmptyBlocksFromGpu()
-{
-  for (auto it = m_gpu.begin(); it!=m_gpu.end();) {
-    bd::Block *b{ it->second };
-    assert(b!=nullptr && "Block was null when iterating gpu blocks.");
-    if (b->empty()) {
-      bd::Texture *e{ b->removeTexture() };
-      assert(e!=nullptr && "A block in the GPU list had a null texture.");
-      m_texs.push_back(e);
-      it = m_gpu.erase(it);
-    } else {
-      ++it;
-    }
+BlockLoader::setBlockRovs(std::vector<bd::Block *> const &blocks,
+                          std::vector<double> const &rovs)
+{
+  // the loader stages only read block ROVs (in blockWeight()) while they
+  // hold the cache mutex.
+  std::unique_lock<std::mutex> lock(m_cacheMutex);
+  for (size_t i{ 0 }; i<blocks.size(); ++i) {
+    blocks[i]->rov(rovs[i]);
   }
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockLoader::maxMainBlocks()
+{
+  return m_maxMainBlocks;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockLoader::maxGpuBlocks()
+{
+  return m_maxGpuBlocks;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 void
 BlockLoader::pushGPUReadyQueue(bd::Block *b)
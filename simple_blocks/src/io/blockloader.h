@@ -5,14 +5,24 @@
 #ifndef bd_blockloader_h
 #define bd_blockloader_h
 
+#include "blockreader.h"
+
+#include <bd/datastructure/blockingqueue.h>
+#include <bd/datastructure/cachepolicy.h>
 #include <bd/volume/block.h>
+#include <bd/volume/opacityrangetable.h>
 #include <bd/volume/volume.h>
 #include <bd/util/util.h>
 
 #include <string>
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 #include <list>
+#include <memory>
 #include <unordered_map>
 #include <queue>
 #include <condition_variable>
@@ -31,6 +41,14 @@ struct BLThreadData
       , type{ bd::DataType::UnsignedCharacter }
       , slabDims{ 0, 0 }
       , filename{ }
+      , readerType{ BlockReaderType::Stream }
+      , pixelFormat{ BlockPixelFormat::Float }
+      , nativeCache{ false }
+      , ioThreads{ 1 }
+      , convertThreads{ 1 }
+      , derivedThreads{ 0 }
+      , queueDepth{ 8 }
+      , cachePolicy{ bd::CachePolicyType::Lru }
       , texs{ nullptr }
       , buffers{ nullptr }
   {
@@ -45,271 +63,117 @@ struct BLThreadData
   size_t slabDims[2];
 
   std::string filename;
+  // how blocks are read from filename.
+  BlockReaderType readerType;
+  // how normalized voxels are stored in the pixel buffers and textures.
+  BlockPixelFormat pixelFormat;
+  // pixel buffers hold voxels in the raw file's type, normalized on upload
+  // (buffers are then voxels * sizeof(type) bytes).
+  bool nativeCache;
+  // threads reading blocks from disk.
+  int ioThreads;
+  // threads normalizing blocks.
+  int convertThreads;
+  // threads computing derived data (0 to do it on the convert threads).
+  int derivedThreads;
+  // blocks waiting between two stages.
+  int queueDepth;
+  // chooses the blocks evicted from main memory and the gpu.
+  bd::CachePolicyType cachePolicy;
   std::vector<bd::Texture *> *texs;
   std::vector<char *> *buffers;
 
 };
 
-//template <class Key, class Value>
-//class lru_cache
-//{
-//public:
-//  using value_type = typename std::pair<Key, Value>;
-//  using value_it = typename std::list<value_type>::iterator;
-//  using operation_guard = typename std::lock_guard<std::mutex>;
-//
-//  lru_cache(size_t max_size) : max_cache_size{max_size} {
-//    if (max_size == 0) {
-//      max_cache_size = std::numeric_limits<size_t>::max();
-//    }
-//  }
-//
-//  void put(const Key& key, const Value& value) {
-//    operation_guard og{safe_op};
-//    auto it = cache_items_map.find(key);
-//
-//    if (it == cache_items_map.end()) {
-//      if (cache_items_map.size() + 1 > max_cache_size) {
-//        // remove the last element from cache
-//        auto last = cache_items_list.crbegin();
-//
-//        cache_items_map.erase(last->first);
-//        cache_items_list.pop_back();
-//      }
-//
-//      cache_items_list.push_front(std::make_pair(key, value));
-//      cache_items_map[key] = cache_items_list.begin();
-//    }
-//    else {
-//      it->second->second = value;
-//      cache_items_list.splice(cache_items_list.cbegin(), cache_items_list,
-//                              it->second);
-//    }
-//  }
-//
-//  const Value& get(const Key& key) const {
-//    operation_guard og{safe_op};
-//    auto it = cache_items_map.find(key);
-//
-//    if (it == cache_items_map.end()) {
-//      throw std::range_error("No such key in the cache");
-//    }
-//    else {
-//      cache_items_list.splice(cache_items_list.begin(), cache_items_list,
-//                              it->second);
-//
-//      return it->second->second;
-//    }
-//  }
-//
-//  bool exists(const Key& key) const noexcept {
-//    operation_guard og{safe_op};
-//
-//    return cache_items_map.find(key) != cache_items_map.end();
-//  }
-//
-//  size_t size() const noexcept {
-//    operation_guard og{safe_op};
-//
-//    return cache_items_map.size();
-//  }
-//
-//private:
-//  mutable std::list<value_type> cache_items_list;
-//  std::unordered_map<Key, value_it> cache_items_map;
-//  size_t max_cache_size;
-//  mutable std::mutex safe_op;
-//
-//};
-
-class BlockReader
+/// Threaded load block data from disk. Blocks to load are put into a queue by
+/// a thread.
+///
+/// Loading is split into stages that each run on their own threads:
+///   - I/O: pop a block from the load queue and read its voxels into scratch.
+///   - convert: normalize the scratch into the block's pixel buffer.
+///     With a native cache, the I/O stage reads straight into the pixel
+///     buffer and the voxels are normalized by uploadBlock() instead.
+///   - derived: compute the block's occupancy mask (once an occupancy table
+///     has been set) and run the derived function (if any) on the block.
+/// The stages are connected by bounded queues. A fixed number of scratch
+/// buffers is handed from the I/O stage to the convert stage and back, so
+/// the I/O threads stop reading ahead when the convert threads fall behind.
+/// Finished blocks go into main memory and, if there is a free texture, the
+/// gpu ready queue.
+///
+/// Main memory and the gpu are caches of blocks; the gpu holds a subset of
+/// main memory. When a cache is full, its policy (see BLThreadData) chooses
+/// the block to evict. Blocks that are not visible are evicted before
+/// visible blocks, and a visible block is only evicted to make room for a
+/// block with a larger weight (ROV times reload cost).
+class BlockLoader
 {
 public:
-  BlockReader()
-  {
-  }
 
+  /// \brief Work done on a block after its pixel data has been normalized.
+  using DerivedFunction = std::function<void(bd::Block *)>;
 
-  virtual ~BlockReader()
-  {
-  }
 
+  /// \brief Takes the place of Block::sendToGpu() in uploadBlock(), given
+  ///        the block and its normalized pixels. The block is marked gpu
+  ///        resident after it returns.
+  using UploadFunction = std::function<void(bd::Block *, void const *)>;
 
-  /**
-   * @param buffer The pixel buffer
-   * @param infile The file to read from
-   * @param offset The byte offset into the file to start reading at
-   * @param be The block extent in voxels
-   * @param ijk The block index
-   * @param ve The extent of a slab in the volume
-   * @param vMin The min value in the volume
-   * @param vDiff The difference of volume max and volume min.
-   */
-  virtual void
-  fillBlockData(char *buffer,
-                std::istream *infile,
-                uint64_t offset,
-                uint64_t const be[3],
-                uint64_t const ijk[3],
-                uint64_t const ve[2],
-                double vMin, double vDiff) = 0;
 
-};
-
-//
-//
-template<class VTy>
-class BlockReaderSpec
-    : public BlockReader
-{
-public:
-  BlockReaderSpec()
-      : disk_buf{ nullptr }, buf_elems{ 0 }
+  /// \brief Cache and I/O counts since the loader was created.
+  struct Counters
   {
-  }
+    size_t cpuHits;
+    size_t cpuMisses;
+    size_t cpuEvictions;
+    size_t gpuHits;
+    size_t gpuMisses;
+    size_t gpuEvictions;
+    uint64_t blocksRead;
+    uint64_t bytesRead;     ///< Bytes of voxels read from the raw file.
+  };
 
 
-  virtual ~BlockReaderSpec()
-  {
-    if (disk_buf) {
-      delete[] disk_buf;
-    }
-  }
-
-
-  void
-  fillBlockData(char *b,                        // buffer to fill
-                std::istream *infile,           // the raw data stream
-                uint64_t offset,                // byte offset into infile of block
-                uint64_t const be[3],           // block dims (in voxels)
-                uint64_t const ijk[3],          // block ijk index
-                uint64_t const ve[2],           // slab dims of the entire volume
-                double vMin, double vDiff) override
-  {
-    if (!disk_buf) {
-      // allocate temp space for the block (the entire block is brought into mem).
-      buf_elems = be[0]*be[1]*be[2];
-      disk_buf = new VTy[buf_elems];
-    }
-
-    size_t const typeSize = sizeof(VTy);
-//    memset(disk_buf, 0, buf_elems*typeSize);
-
-    // Start and end voxel coordinates are used to compute the byte offset into 
-    // the file that we should start/stop reading at.
-    //
-    // start voxel coord = block index w/in volume * block size
-    // (this works because all blocks are the same size).
-    glm::u64vec3 const start{ ijk[0]*be[0],
-                              ijk[1]*be[1],
-                              ijk[2]*be[2] };
-
-    // block end voxel coord = block voxel start + block size
-    glm::u64vec3 const end{ start[0]+be[0],
-                            start[1]+be[1],
-                            start[2]+be[2] };
-
-    // the row length of each block is the extent in the X dimension
-    size_t const blockRowLength{ be[0] };
-    size_t const rowBytes{ blockRowLength*typeSize };
-
-    // Loop through rows and slabs of volume reading rows of voxels into memory.
-    char *temp = reinterpret_cast<char *>(disk_buf);
-    for (uint64_t slab = start.z; slab<end.z; ++slab) {
-      for (uint64_t row = start.y; row<end.y; ++row) {
-
-        // seek to start of row
-        infile->seekg(offset);
-
-        // read the bytes of current row
-        infile->read(temp, rowBytes);
-        temp += rowBytes;
-
-        // offset of next row in voxels
-        offset = bd::to1D(start.x, row+1, slab, ve[0], ve[1]);
-//        offset = bd::to1D(start.x, row, slab, ve[0], ve[1]);
-
-        // convert voxel offset to bytes
-        offset *= typeSize;
-      } // for row
-
-//      std::stringstream filename;
-//      filename << "C:\\Users\\jim\\Desktop\\slabs\\slab-" << ijk[0] << "_" << ijk[1] << "_" << ijk[2] << "-" << slab << ".pgm";
-//      std::ofstream of(filename.str());
-//      
-//      // header
-//      of << "P2\n"
-//        << be[0] << ' ' << be[1] << '\n'
-//        << *std::max_element(disk_buf, disk_buf + (be[0]*be[1])) << '\n';
-//
-//      for (int i = 0; i < be[0]*be[1]; ++i) {
-//        of << disk_buf[i] << ' ';
-//      }
-//
-//      of.flush();
-//      of.close();
-
-    } // for slab
-
-    float *const pixelData = reinterpret_cast<float *>(b);
-    //Normalize the data prior to generating the texture.
-    for (size_t idx{ 0 }; idx<buf_elems; ++idx) {
-      pixelData[idx] = static_cast<float>(( disk_buf[idx]-vMin )/vDiff );
-    }
-
-  }
+  BlockLoader(BLThreadData *, bd::Volume const &);
 
 
-private:
-  VTy *disk_buf;
-  size_t buf_elems;
+  ~BlockLoader();
 
-};
 
-class BlockReaderFactory
-{
-public:
-  using T = bd::DataType;
+  /// \brief Run the loader stages until stop() is called.
+  int
+  operator()();
 
 
-  static
-  BlockReader *
-  New(bd::DataType ty)
-  {
-    switch (ty) {
-      case T::UnsignedCharacter:
-        return new BlockReaderSpec<uint8_t>();
-      case T::Character:
-        return new BlockReaderSpec<int8_t>();
-      case T::UnsignedShort:
-        return new BlockReaderSpec<uint16_t>();
-      case T::Short:
-        return new BlockReaderSpec<int16_t>();
-      case T::Float:
-      default:
-        return new BlockReaderSpec<float>();
-    }
-  }
-};
+  void
+  stop();
 
-/// Threaded load block data from disk. Blocks to load are put into a queue by
-/// a thread.
-class BlockLoader
-{
-public:
 
-  BlockLoader(BLThreadData *, bd::Volume const &);
+  /// \brief Set the work done by the derived stage.
+  /// \note Must be called before operator()().
+  void
+  setDerivedFunction(DerivedFunction fn);
 
 
-  ~BlockLoader();
+  /// \brief Upload blocks with \c fn instead of to their textures (to run
+  ///        the loader without a gl context). An empty function restores
+  ///        the texture upload.
+  void
+  setUploadFunction(UploadFunction fn);
 
 
-  int
-  operator()();
+  /// \brief Set the opacity ranges of the current transfer function, used
+  ///        to compute the occupancy masks of blocks loaded from now on.
+  /// The occupancy generation is incremented, so masks computed for an
+  /// earlier transfer function can be told apart. Thread safe.
+  void
+  setOccupancyTable(bd::OpacityRangeTable const &table);
 
 
-  void
-  stop();
+  /// \brief The generation of the latest occupancy table, 0 if no table was
+  ///        set. A block's mask is current if its generation matches.
+  uint32_t
+  occupancyGeneration() const;
 
 
   /// \brief Enqueue the provided blocks for loading.
@@ -326,6 +190,13 @@ public:
   getNextGpuReadyBlock();
 
 
+  /// \brief Upload the pixel data of a block from the gpu ready queue to its
+  ///        texture, normalizing it first if the cache holds native voxels.
+  /// \note Must be called on the render thread.
+  void
+  uploadBlock(bd::Block *b);
+
+
   void
   pushGpuResidentBlock(bd::Block *);
 
@@ -334,6 +205,24 @@ public:
   clearLoadQueue();
 
 
+  /// \brief True if no block is queued for or going through the loader
+  ///        stages. Blocks already loaded may still wait in the gpu ready
+  ///        queue (see getNextGpuReadyBlock()).
+  bool
+  idle();
+
+
+  Counters
+  counters();
+
+
+  /// \brief Set the ROV of each of \c blocks to the matching value in
+  ///        \c rovs, while the loader stages are not weighing blocks.
+  void
+  setBlockRovs(std::vector<bd::Block *> const &blocks,
+               std::vector<double> const &rovs);
+
+
   size_t
   maxMainBlocks();
 
@@ -344,14 +233,84 @@ public:
 
 private:
 
-  bd::Block *
-  waitPopLoadQueue();
+  /// \brief A block on its way from the I/O stage to the convert stage.
+  struct LoadJob
+  {
+    bd::Block *block;
+    std::vector<char> scratch;   ///< Voxels in the raw file's data type.
+  };
+
+
+  /// \brief Read blocks from the load queue into scratch.
+  void
+  ioStage();
 
 
-  /// \brief Loop through gpu blocks (m_gpu) and remove any that are empty.
-  /// Place textures back into m_texs array.
+  /// \brief Normalize scratch into the blocks' pixel buffers.
   void
-  removeEmptyBlocksFromGpu();
+  convertStage();
+
+
+  /// \brief Run derive() on normalized blocks.
+  void
+  derivedStage();
+
+
+  /// \brief Compute the occupancy mask of \c b and run m_derived on it.
+  void
+  derive(bd::Block *b);
+
+
+  /// \brief The voxels of \c b normalized to floats, either its pixel data
+  ///        or a copy of it converted into \c scratch.
+  float const *
+  normalizedVoxels(bd::Block *b, std::vector<char> &scratch) const;
+
+
+  /// \brief Put a loaded block in main memory and, if there is a texture for
+  ///        it, in the gpu ready queue.
+  void
+  finishBlock(bd::Block *b);
+
+
+  /// \brief Give back the pixel buffer of a block that could not be loaded.
+  void
+  abandonBlock(bd::Block *b);
+
+
+  /// \brief The weight of a visible block for the cost policy and for
+  ///        deciding if it may be evicted: ROV times bytes read to reload it.
+  /// Blocks that are not visible have a weight of zero in the policies.
+  double
+  blockWeight(bd::Block *b) const;
+
+
+  /// \brief Evict one block from main memory (and the gpu), returning its
+  ///        pixel buffer to m_buffs.
+  /// \param weight The weight of the block the room is for.
+  /// \return false if no block could be evicted.
+  bool
+  evictMain(double weight);
+
+
+  /// \brief Evict one block from the gpu, returning its texture to m_texs.
+  /// \param weight The weight of the block the texture is for.
+  /// \return false if no block could be evicted.
+  bool
+  evictGpu(double weight);
+
+
+  /// \brief Take away the texture of \c b and give it back to m_texs.
+  void
+  releaseTexture(bd::Block *b);
+
+
+  void
+  sendStats();
+
+
+  bd::Block *
+  waitPopLoadQueue();
 
 
   /// Push a block that is ready for loading to the GPU.
@@ -381,9 +340,30 @@ private:
   ///< Blocks with GPU_WAIT status.
   std::queue<bd::Block *> m_gpuReadyQueue;
 
+  /// Blocks between the I/O stage and main memory.
+  std::unordered_set<uint64_t> m_inFlight;
+
+  /// Orders the blocks in m_main for eviction.
+  bd::CachePolicy<uint64_t> *m_mainPolicy;
+
+  /// Orders the blocks in m_gpu for eviction (guarded by m_gpuMutex).
+  bd::CachePolicy<uint64_t> *m_gpuPolicy;
+
+  /// Hits and misses of the visible blocks passed to queueClassified(), and
+  /// evictions, since the loader was created (guarded by m_cacheMutex).
+  size_t m_cpuHits;
+  size_t m_cpuMisses;
+  size_t m_cpuEvictions;
+  size_t m_gpuHits;
+  size_t m_gpuMisses;
+  size_t m_gpuEvictions;
+
   std::mutex m_gpuMutex;
   std::mutex m_gpuReadyMutex;
   std::mutex m_loadQueueMutex;
+  /// Guards m_main, m_mainPolicy, m_inFlight, m_buffs and m_texs.
+  /// Lock order: m_loadQueueMutex, m_cacheMutex, m_gpuMutex, m_gpuReadyMutex.
+  std::mutex m_cacheMutex;
 
   std::condition_variable_any m_wait;
 
@@ -391,6 +371,12 @@ private:
   size_t const m_maxMainBlocks;
   size_t const m_sizeType;
 
+  BlockPixelFormat const m_pixelFormat;
+  bool const m_nativeCache;
+
+  /// Normalized pixels of the block being uploaded (render thread only).
+  std::vector<char> m_uploadScratch;
+
   ///< Dimensions of the volume slabs (x and y dims of volume)
   uint64_t m_slabDims[2];
 
@@ -398,10 +384,33 @@ private:
   double const m_volDiff;                  ///< diff = volMax - volMin
 
   std::string m_fileName;
-  std::ifstream raw;
 
   BlockReader *m_reader;
 
+  int const m_ioThreads;
+  int const m_convertThreads;
+  int const m_derivedThreads;
+
+  std::vector<LoadJob> m_jobs;
+  bd::BlockingQueue<LoadJob *> m_freeJobs;      ///< Scratch not in use.
+  bd::BlockingQueue<LoadJob *> m_convertQueue;  ///< Read, waiting to be normalized.
+  bd::BlockingQueue<bd::Block *> m_derivedQueue;
+  DerivedFunction m_derived;
+  UploadFunction m_upload;      ///< Render thread only.
+
+  std::atomic<uint64_t> m_blocksRead;
+  std::atomic<uint64_t> m_bytesRead;
+
+  std::mutex m_occupancyMutex;
+  /// Opacity ranges for the occupancy masks (guarded by m_occupancyMutex).
+  std::shared_ptr<bd::OpacityRangeTable const> m_occupancyTable;
+  std::atomic<uint32_t> m_occupancyGeneration;
+
+  /// When the blocks in the load queue were queued (to report how long it
+  /// took for all of them to be loaded).
+  std::chrono::steady_clock::time_point m_queuedAt;
+  size_t m_queuedCount;
+
 }; // class BlockLoader
 
 } // namespace subvol
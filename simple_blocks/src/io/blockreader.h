@@ -0,0 +1,604 @@
+//
+// Created by jim on 3/10/19.
+//
+
+#ifndef subvol_blockreader_h
+#define subvol_blockreader_h
+
+#include <bd/io/datatypes.h>
+#include <bd/log/logger.h>
+#include <bd/util/half.h>
+#include <bd/util/util.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace subvol
+{
+
+/// \brief How a BlockReader gets a block out of the raw file.
+enum class BlockReaderType
+{
+  Stream,     ///< seekg and read each block row (row-major raw file).
+  RowGather,  ///< preadv runs of block rows (row-major raw file).
+  Brick       ///< one read per block (brick-major raw file).
+};
+
+
+/// \brief Parse "stream", "gather" or "brick".
+/// \return false if \c s is not a reader type.
+inline bool
+to_blockReaderType(std::string const &s, BlockReaderType &rt)
+{
+  if (s == "stream") {
+    rt = BlockReaderType::Stream;
+  } else if (s == "gather") {
+    rt = BlockReaderType::RowGather;
+  } else if (s == "brick") {
+    rt = BlockReaderType::Brick;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+
+/// \brief How the normalized voxels of a block are stored in its pixel buffer
+///        (and its texture).
+enum class BlockPixelFormat
+{
+  Float,  ///< 32 bit float (R32F textures).
+  Half    ///< 16 bit IEEE half (R16F textures).
+};
+
+
+/// \brief Parse "float" or "half".
+/// \return false if \c s is not a pixel format.
+inline bool
+to_blockPixelFormat(std::string const &s, BlockPixelFormat &pf)
+{
+  if (s == "float") {
+    pf = BlockPixelFormat::Float;
+  } else if (s == "half") {
+    pf = BlockPixelFormat::Half;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+
+/// \brief Bytes of one voxel in a pixel buffer of format \c pf.
+inline size_t
+to_sizeType(BlockPixelFormat pf)
+{
+  return pf == BlockPixelFormat::Half ? sizeof(uint16_t) : sizeof(float);
+}
+
+
+/// \brief Reads a block's voxels out of the raw file.
+///
+/// A block is loaded in two steps: readBlock() copies the voxels, still in
+/// the raw file's data type, into scratch memory, and convertBlock()
+/// normalizes them into the pixel buffer, as floats or halves (see
+/// setPixelFormat()). Both are reentrant as long
+/// as each thread passes its own stream and scratch, so the two steps can run
+/// on different threads (see BlockLoader). fillBlockData() does both using
+/// scratch owned by the reader.
+class BlockReader
+{
+public:
+  BlockReader()
+      : m_pixelFormat{ BlockPixelFormat::Float }
+  {
+  }
+
+
+  virtual ~BlockReader()
+  {
+  }
+
+
+  /// \brief Open the raw file at \c path if the reader reads it directly
+  ///        (and not through the stream given to readBlock()).
+  /// \return false if the file could not be opened.
+  virtual bool
+  open(std::string const &path)
+  {
+    return true;
+  }
+
+
+  virtual void
+  close()
+  {
+  }
+
+
+  /// \brief Set the format convertBlock() writes (default Float).
+  void
+  setPixelFormat(BlockPixelFormat pf)
+  {
+    m_pixelFormat = pf;
+  }
+
+
+  BlockPixelFormat
+  pixelFormat() const
+  {
+    return m_pixelFormat;
+  }
+
+
+  /// \brief Size of the raw file's data type in bytes.
+  virtual size_t
+  typeSize() const = 0;
+
+
+  /**
+   * Read the voxels of a block, in the raw file's data type, into scratch.
+   * @param scratch At least be[0]*be[1]*be[2]*typeSize() bytes.
+   * @param infile The file to read from
+   * @param offset The byte offset into the file to start reading at
+   * @param be The block extent in voxels
+   * @param ijk The block index
+   * @param ve The extent of a slab in the volume
+   * @return false if the block could not be read.
+   */
+  virtual bool
+  readBlock(char *scratch,
+            std::istream *infile,
+            uint64_t offset,
+            uint64_t const be[3],
+            uint64_t const ijk[3],
+            uint64_t const ve[2]) const = 0;
+
+
+  /**
+   * Normalize the voxels read by readBlock() into the pixel buffer.
+   * @param scratch The voxels filled in by readBlock()
+   * @param buffer The pixel buffer, elems*to_sizeType(pixelFormat()) bytes
+   * @param elems Number of voxels in the block
+   * @param vMin The min value in the volume
+   * @param vDiff The difference of volume max and volume min.
+   */
+  virtual void
+  convertBlock(char const *scratch, char *buffer, size_t elems,
+               double vMin, double vDiff) const = 0;
+
+
+  /**
+   * readBlock() then convertBlock() with scratch owned by this reader.
+   * @param buffer The pixel buffer
+   * @param infile The file to read from
+   * @param offset The byte offset into the file to start reading at
+   * @param be The block extent in voxels
+   * @param ijk The block index
+   * @param ve The extent of a slab in the volume
+   * @param vMin The min value in the volume
+   * @param vDiff The difference of volume max and volume min.
+   */
+  virtual void
+  fillBlockData(char *buffer,
+                std::istream *infile,
+                uint64_t offset,
+                uint64_t const be[3],
+                uint64_t const ijk[3],
+                uint64_t const ve[2],
+                double vMin, double vDiff)
+  {
+    size_t const elems{ be[0]*be[1]*be[2] };
+    if (m_scratch.size() < elems*typeSize()) {
+      m_scratch.resize(elems*typeSize());
+    }
+    readBlock(m_scratch.data(), infile, offset, be, ijk, ve);
+    convertBlock(m_scratch.data(), buffer, elems, vMin, vDiff);
+  }
+
+
+private:
+  std::vector<char> m_scratch;
+  BlockPixelFormat m_pixelFormat;
+
+};
+
+//
+//
+template<class VTy>
+class BlockReaderSpec
+    : public BlockReader
+{
+public:
+
+  size_t
+  typeSize() const override
+  {
+    return sizeof(VTy);
+  }
+
+
+  bool
+  readBlock(char *scratch,                  // block voxels
+            std::istream *infile,           // the raw data stream
+            uint64_t offset,                // byte offset into infile of block
+            uint64_t const be[3],           // block dims (in voxels)
+            uint64_t const ijk[3],          // block ijk index
+            uint64_t const ve[2]) const override   // slab dims of the entire volume
+  {
+    size_t const typeSize = sizeof(VTy);
+
+    // Start and end voxel coordinates are used to compute the byte offset into 
+    // the file that we should start/stop reading at.
+    //
+    // start voxel coord = block index w/in volume * block size
+    // (this works because all blocks are the same size).
+    glm::u64vec3 const start{ ijk[0]*be[0],
+                              ijk[1]*be[1],
+                              ijk[2]*be[2] };
+
+    // block end voxel coord = block voxel start + block size
+    glm::u64vec3 const end{ start[0]+be[0],
+                            start[1]+be[1],
+                            start[2]+be[2] };
+
+    // the row length of each block is the extent in the X dimension
+    size_t const blockRowLength{ be[0] };
+    size_t const rowBytes{ blockRowLength*typeSize };
+
+    // Loop through rows and slabs of volume reading rows of voxels into memory.
+    char *temp = scratch;
+    for (uint64_t slab = start.z; slab<end.z; ++slab) {
+      for (uint64_t row = start.y; row<end.y; ++row) {
+
+        // offset of this row in voxels
+        offset = bd::to1D(start.x, row, slab, ve[0], ve[1]);
+
+        // convert voxel offset to bytes
+        offset *= typeSize;
+
+        // seek to start of row
+        infile->seekg(offset);
+
+        // read the bytes of current row
+        infile->read(temp, rowBytes);
+        temp += rowBytes;
+      } // for row
+    } // for slab
+
+    return infile->good();
+  }
+
+
+  void
+  convertBlock(char const *scratch, char *b, size_t elems,
+               double vMin, double vDiff) const override
+  {
+    VTy const *const diskData = reinterpret_cast<VTy const *>(scratch);
+    if (this->pixelFormat() == BlockPixelFormat::Half) {
+      // Normalize a chunk at a time to floats, then convert the chunk to
+      // halves. A chunk is read before any of it is written, so this works
+      // in place as long as sizeof(VTy) >= 2.
+      uint16_t *const pixelData = reinterpret_cast<uint16_t *>(b);
+      float chunk[256];
+      for (size_t idx{ 0 }; idx<elems; idx += 256) {
+        size_t const n{ std::min<size_t>(256, elems-idx) };
+        for (size_t i{ 0 }; i<n; ++i) {
+          chunk[i] = static_cast<float>(( diskData[idx+i]-vMin )/vDiff );
+        }
+        bd::floatToHalf(chunk, pixelData+idx, n);
+      }
+      return;
+    }
+
+    float *const pixelData = reinterpret_cast<float *>(b);
+    //Normalize the data prior to generating the texture.
+    for (size_t idx{ 0 }; idx<elems; ++idx) {
+      pixelData[idx] = static_cast<float>(( diskData[idx]-vMin )/vDiff );
+    }
+  }
+
+};
+
+
+/// \brief Reads blocks from a brick-major raw file (see the brick tool).
+///
+/// Each block's voxels are stored contiguously at the block's data offset,
+/// so the whole block is read with a single seek and read instead of one per
+/// block row.
+template<class VTy>
+class BrickReaderSpec
+    : public BlockReaderSpec<VTy>
+{
+public:
+
+  bool
+  readBlock(char *scratch,                  // block voxels
+            std::istream *infile,           // the bricked raw data stream
+            uint64_t offset,                // byte offset into infile of brick
+            uint64_t const be[3],           // block dims (in voxels)
+            uint64_t const ijk[3],          // block ijk index (unused)
+            uint64_t const ve[2]) const override   // slab dims (unused)
+  {
+    infile->seekg(offset);
+    infile->read(scratch, be[0]*be[1]*be[2]*sizeof(VTy));
+    return infile->good();
+  }
+
+};
+
+
+#ifndef _WIN32
+
+/// \brief Reads the rows of a block from a row-major raw file with preadv.
+///
+/// Rows are read straight into the block's pixel buffer and converted to
+/// float in place, so the reader keeps no per block state and a single
+/// reader (and its file descriptor) can be shared by several loader threads.
+/// The stream passed to fillBlockData() is not used, see open().
+///
+/// Rows that are close together in the file are read by one preadv, with the
+/// bytes between them read into a throw away buffer. Gaps of a few pages cost
+/// little since the kernel reads the pages that hold the rows anyway.
+template<class VTy>
+class RowGatherReaderSpec
+    : public BlockReaderSpec<VTy>
+{
+  static_assert(sizeof(VTy) <= sizeof(float),
+                "Rows are read into the float pixel buffer");
+
+public:
+  RowGatherReaderSpec()
+      : m_fd{ -1 }
+      , m_maxGapBytes{ 16 * 1024 }
+  {
+  }
+
+
+  ~RowGatherReaderSpec()
+  {
+    close();
+  }
+
+
+  bool
+  open(std::string const &path) override
+  {
+    close();
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    return m_fd >= 0;
+  }
+
+
+  void
+  close() override
+  {
+    if (m_fd >= 0) {
+      ::close(m_fd);
+      m_fd = -1;
+    }
+  }
+
+
+  /// \brief Largest gap between two rows that is read through instead of
+  ///        starting a new preadv (default 16K).
+  void
+  setMaxGapBytes(uint64_t bytes)
+  {
+    m_maxGapBytes = bytes;
+  }
+
+
+  bool
+  readBlock(char *scratch,                  // block voxels
+            std::istream *,                 // unused, see open()
+            uint64_t offset,                // byte offset into file of block
+            uint64_t const be[3],           // block dims (in voxels)
+            uint64_t const ijk[3],          // block ijk index
+            uint64_t const ve[2]) const override   // slab dims of the entire volume
+  {
+    // scratch is per thread, so the reader can be shared.
+    thread_local std::vector<char> gap;
+    thread_local std::vector<iovec> iov;
+
+    uint64_t const rows{ be[1]*be[2] };
+    size_t const rowBytes{ be[0]*sizeof(VTy) };
+    char *dest{ scratch };
+    if (gap.size() < m_maxGapBytes) {
+      gap.resize(m_maxGapBytes);
+    }
+
+    uint64_t r{ 0 };
+    while (r < rows) {
+      // gather rows into one preadv until a gap is too large.
+      uint64_t const batchOffset{ rowOffset(r, offset, be, ve) };
+      uint64_t pos{ batchOffset };
+      iov.clear();
+      while (r < rows && iov.size() + 2 <= IOV_MAX) {
+        uint64_t const off{ rowOffset(r, offset, be, ve) };
+        if (off == pos && !iov.empty() &&
+            static_cast<char *>(iov.back().iov_base) + iov.back().iov_len == dest) {
+          // adjacent in the file and in the buffer (block is as wide as the volume).
+          iov.back().iov_len += rowBytes;
+        } else {
+          if (off != pos) {
+            uint64_t const skip{ off - pos };
+            if (skip > m_maxGapBytes) {
+              break;
+            }
+            iov.push_back({ gap.data(), skip });
+          }
+          iov.push_back({ dest, rowBytes });
+        }
+        dest += rowBytes;
+        pos = off + rowBytes;
+        ++r;
+      }
+
+      if (!readAll(iov, batchOffset)) {
+        bd::Err() << "Could not read block " << ijk[0] << ", " << ijk[1] << ", "
+                  << ijk[2] << " at offset " << batchOffset;
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+
+  /// \brief Reads the rows straight into \c b and normalizes in place, so
+  ///        no scratch is used.
+  /// \note \c b must hold elems*max(sizeof(VTy), to_sizeType(pixelFormat()))
+  ///       bytes.
+  void
+  fillBlockData(char *b,                        // buffer to fill
+                std::istream *infile,           // unused, see open()
+                uint64_t offset,                // byte offset into file of block
+                uint64_t const be[3],           // block dims (in voxels)
+                uint64_t const ijk[3],          // block ijk index
+                uint64_t const ve[2],           // slab dims of the entire volume
+                double vMin, double vDiff) override
+  {
+    if (!readBlock(b, infile, offset, be, ijk, ve)) {
+      return;
+    }
+
+    size_t const elems{ be[0]*be[1]*be[2] };
+    VTy const *const diskData = reinterpret_cast<VTy const *>(b);
+    if (this->pixelFormat() == BlockPixelFormat::Half) {
+      if (sizeof(VTy) >= sizeof(uint16_t)) {
+        // halves are no wider than the voxels, so convert forwards.
+        this->convertBlock(b, b, elems, vMin, vDiff);
+      } else {
+        uint16_t *const pixelData = reinterpret_cast<uint16_t *>(b);
+        for (size_t idx{ elems }; idx-- > 0;) {
+          pixelData[idx] =
+              bd::floatToHalf(static_cast<float>(( diskData[idx]-vMin )/vDiff ));
+        }
+      }
+      return;
+    }
+
+    // Normalize in place. Walking backwards never overwrites a voxel that
+    // has not been converted yet because sizeof(VTy) <= sizeof(float).
+    float *const pixelData = reinterpret_cast<float *>(b);
+    for (size_t idx{ elems }; idx-- > 0;) {
+      pixelData[idx] = static_cast<float>(( diskData[idx]-vMin )/vDiff );
+    }
+  }
+
+
+private:
+
+  /// \brief Byte offset in the file of row \c r of a block at \c offset.
+  static uint64_t
+  rowOffset(uint64_t r, uint64_t offset, uint64_t const be[3], uint64_t const ve[2])
+  {
+    uint64_t const row{ r % be[1] };
+    uint64_t const slab{ r / be[1] };
+    return offset + ( row*ve[0] + slab*ve[0]*ve[1] )*sizeof(VTy);
+  }
+
+
+  /// \brief preadv all of \c iov at \c offset, retrying short reads.
+  bool
+  readAll(std::vector<iovec> &iov, uint64_t offset) const
+  {
+    iovec *v{ iov.data() };
+    size_t n{ iov.size() };
+    while (n > 0) {
+      ssize_t const r{ ::preadv(m_fd, v, static_cast<int>(n), offset) };
+      if (r <= 0) {
+        return false;
+      }
+      offset += r;
+
+      size_t left{ static_cast<size_t>(r) };
+      while (n > 0 && left >= v->iov_len) {
+        left -= v->iov_len;
+        ++v;
+        --n;
+      }
+      if (n > 0) {
+        v->iov_base = static_cast<char *>(v->iov_base) + left;
+        v->iov_len -= left;
+      }
+    }
+    return true;
+  }
+
+
+  int m_fd;
+  uint64_t m_maxGapBytes;
+
+};
+
+#endif // ! _WIN32
+
+
+class BlockReaderFactory
+{
+public:
+  using T = bd::DataType;
+
+
+  /// \brief Create a reader of type \c rt for a raw file of type \c ty.
+  /// \note RowGather is not available on Windows, a Stream reader is
+  ///       returned instead.
+  static
+  BlockReader *
+  New(bd::DataType ty, BlockReaderType rt = BlockReaderType::Stream)
+  {
+    switch (rt) {
+      case BlockReaderType::Brick:
+        return NewSpec<BrickReaderSpec>(ty);
+      case BlockReaderType::RowGather:
+#ifndef _WIN32
+        return NewSpec<RowGatherReaderSpec>(ty);
+#else
+        bd::Warn() << "Row gather reader not available, using stream reader.";
+#endif
+      case BlockReaderType::Stream:
+      default:
+        return NewSpec<BlockReaderSpec>(ty);
+    }
+  }
+
+
+private:
+
+  template<template<class> class Spec>
+  static
+  BlockReader *
+  NewSpec(bd::DataType ty)
+  {
+    switch (ty) {
+      case T::UnsignedCharacter:
+        return new Spec<uint8_t>();
+      case T::Character:
+        return new Spec<int8_t>();
+      case T::UnsignedShort:
+        return new Spec<uint16_t>();
+      case T::Short:
+        return new Spec<int16_t>();
+      case T::Float:
+      default:
+        return new Spec<float>();
+    }
+  }
+};
+
+} // namespace subvol
+
+#endif // ! subvol_blockreader_h
@@ -0,0 +1,368 @@
+//
+// Created by jim on 3/22/19.
+//
+
+#include "rovengine.h"
+#include "messages/messagebroker.h"
+
+#include <bd/log/logger.h>
+#include <bd/log/trace.h>
+#include <bd/tbb/parallelfor.h>
+#include <bd/volume/opacitylut.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <numeric>
+
+namespace subvol
+{
+
+namespace
+{
+
+///////////////////////////////////////////////////////////////////////////////
+void
+sendProgress(double progress, bool done)
+{
+  ROVProgressMessage *m{ Broker::acquire<ROVProgressMessage>() };
+  m->Progress = progress;
+  m->Done = done;
+  Broker::sendLatest(m);
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+RovEngine::RovEngine(std::string const &rawPath,
+                     bd::indexfile::v2::JsonIndexFile const &index)
+    : RovEngine(rawPath, index.getVolume(), index.getDatType(), index.isBricked())
+{
+  if (m_bricked) {
+    m_brickOffsets.reserve(index.getFileBlocks().size());
+    for (bd::FileBlock const &fb : index.getFileBlocks()) {
+      m_brickOffsets.push_back(fb.data_offset);
+    }
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+RovEngine::RovEngine(std::string const &rawPath,
+                     bd::indexfile::v3::BinaryIndexFile const &index)
+    : RovEngine(rawPath, index.getVolume(), index.getDatType(), index.isBricked())
+{
+  if (m_bricked) {
+    uint64_t const *offsets{ index.getDataOffsets() };
+    m_brickOffsets.assign(offsets, offsets + index.getNumBlocks());
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+RovEngine::RovEngine(std::string const &rawPath, bd::Volume const &volume,
+                     bd::DataType type, bool bricked)
+    : m_rawPath{ rawPath }
+    , m_type{ type }
+    , m_voxelDims{ volume.voxelDims() }
+    , m_blockDims{ volume.block_dims() }
+    , m_blockCount{ volume.block_count() }
+    , m_volMin{ volume.min() }
+    , m_volMax{ volume.max() }
+    , m_bricked{ bricked }
+    , m_brickOffsets{ }
+    , m_threads{ 1 }
+    , m_slabBytes{ 64 * 1024 * 1024 }
+    , m_worker{ }
+    , m_cancel{ false }
+    , m_running{ false }
+    , m_resultMutex{ }
+    , m_result{ }
+    , m_hasResult{ false }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+RovEngine::~RovEngine()
+{
+  cancel();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+RovEngine::setThreads(int threads)
+{
+  m_threads = std::max(1, threads);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+RovEngine::setSlabBytes(uint64_t bytes)
+{
+  m_slabBytes = bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+RovEngine::start(bd::OpacityTransferFunction const &otf)
+{
+  cancel();
+
+  m_cancel = false;
+  m_running = true;
+  m_worker = std::thread(&RovEngine::work, this, otf);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+RovEngine::cancel()
+{
+  m_cancel = true;
+  if (m_worker.joinable()) {
+    m_worker.join();
+  }
+
+  std::unique_lock<std::mutex> lock(m_resultMutex);
+  m_hasResult = false;
+  m_result.clear();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+RovEngine::isRunning() const
+{
+  return m_running;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+RovEngine::takeResult(std::vector<double> &rovs)
+{
+  std::unique_lock<std::mutex> lock(m_resultMutex);
+  if (!m_hasResult) {
+    return false;
+  }
+  rovs = std::move(m_result);
+  m_hasResult = false;
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+RovEngine::work(bd::OpacityTransferFunction otf)
+{
+  BD_TRACE_THREAD_NAME("rov engine");
+  BD_TRACE_SCOPE("RovEngine::work", "rov");
+  bd::Info() << "Recomputing block ROVs from " << m_rawPath << " with "
+             << m_threads << " threads.";
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<double> sums(m_blockCount.x * m_blockCount.y * m_blockCount.z, 0.0);
+  bool ok{ false };
+  switch (m_type) {
+    case bd::DataType::UnsignedCharacter:
+      ok = m_bricked ? runBricks<uint8_t>(otf, sums) : runSlabs<uint8_t>(otf, sums);
+      break;
+    case bd::DataType::Character:
+      ok = m_bricked ? runBricks<int8_t>(otf, sums) : runSlabs<int8_t>(otf, sums);
+      break;
+    case bd::DataType::UnsignedShort:
+      ok = m_bricked ? runBricks<uint16_t>(otf, sums) : runSlabs<uint16_t>(otf, sums);
+      break;
+    case bd::DataType::Short:
+      ok = m_bricked ? runBricks<int16_t>(otf, sums) : runSlabs<int16_t>(otf, sums);
+      break;
+    case bd::DataType::Float:
+      ok = m_bricked ? runBricks<float>(otf, sums) : runSlabs<float>(otf, sums);
+      break;
+    default:
+      bd::Err() << "Can't recompute ROVs for data type " << bd::to_string(m_type);
+      break;
+  }
+
+  if (ok && !m_cancel) {
+    double const blockVoxels{
+        static_cast<double>(m_blockDims.x * m_blockDims.y * m_blockDims.z) };
+    for (double &s : sums) {
+      s /= blockVoxels;
+    }
+
+    std::unique_lock<std::mutex> lock(m_resultMutex);
+    m_result = std::move(sums);
+    m_hasResult = true;
+    lock.unlock();
+
+    bd::Info() << "Recomputed block ROVs in "
+               << std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - start).count() << "s.";
+  } else if (m_cancel) {
+    bd::Dbg() << "ROV recompute cancelled.";
+  }
+
+  m_running = false;
+  sendProgress(ok ? 1.0 : 0.0, true);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+RovEngine::runSlabs(bd::OpacityTransferFunction const &otf,
+                    std::vector<double> &sums)
+{
+  glm::u64vec3 const &vd = m_voxelDims;
+  glm::u64vec3 const &bdims = m_blockDims;
+  glm::u64vec3 const &bc = m_blockCount;
+  uint64_t const planeElems{ vd.x * vd.y };
+  uint64_t const zEnd{ bc.z * bdims.z };  // planes past the last block are skipped.
+  uint64_t const planes{ std::max<uint64_t>(
+      1, std::min<uint64_t>(zEnd, m_slabBytes / ( planeElems * sizeof(Ty) ))) };
+
+  std::ifstream is(m_rawPath, std::ios::binary);
+  if (!is.is_open()) {
+    bd::Err() << "Could not open raw file " << m_rawPath;
+    return false;
+  }
+
+  std::vector<Ty> slabs[2]{ std::vector<Ty>(planes * planeElems),
+                            std::vector<Ty>(planes * planeElems) };
+
+  // read up to planes planes starting at plane z0 into slabs[s].
+  auto readSlab = [&](int s, uint64_t z0) -> uint64_t {
+    uint64_t const n{ std::min(planes, zEnd - z0) };
+    is.seekg(z0 * planeElems * sizeof(Ty), std::ios::beg);
+    is.read(reinterpret_cast<char *>(slabs[s].data()), n * planeElems * sizeof(Ty));
+    return is ? n : 0;
+  };
+
+  bd::OpacityLut<Ty> const lut{ otf, m_volMin, m_volMax };
+
+  std::future<uint64_t> next{ std::async(std::launch::async, readSlab, 0, 0) };
+  int cur{ 0 };
+  for (uint64_t z0 = 0; z0 < zEnd; z0 += planes, cur = 1 - cur) {
+    uint64_t const n{ next.get() };
+    if (n == 0) {
+      bd::Err() << "Could not read planes " << z0 << " to " << z0 + planes
+                << " of " << m_rawPath;
+      return false;
+    }
+    if (z0 + n < zEnd) {
+      next = std::async(std::launch::async, readSlab, 1 - cur, z0 + n);
+    }
+    if (m_cancel) {
+      return false;
+    }
+
+    // Split the slab by rows of blocks, so each block is summed by one thread.
+    Ty const *slab{ slabs[cur].data() };
+    bd::parallelFor(bc.y, m_threads, [&](size_t begin, size_t end) {
+      for (uint64_t z = 0; z < n; ++z) {
+        uint64_t const bk{ ( z0 + z ) / bdims.z };
+        for (uint64_t bj = begin; bj < end; ++bj) {
+          double *blockSums{ &sums[bc.x * ( bj + bk * bc.y )] };
+          for (uint64_t y = bj * bdims.y; y < ( bj + 1 ) * bdims.y; ++y) {
+            Ty const *row{ slab + ( z * vd.y + y ) * vd.x };
+            for (uint64_t bi = 0; bi < bc.x; ++bi) {
+              blockSums[bi] += lut.relevance(row + bi * bdims.x, bdims.x);
+            }
+          }
+        }
+      }
+    });
+
+    sendProgress(static_cast<double>(z0 + n) / zEnd, false);
+  }
+
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+RovEngine::runBricks(bd::OpacityTransferFunction const &otf,
+                     std::vector<double> &sums)
+{
+  uint64_t const brickElems{ m_blockDims.x * m_blockDims.y * m_blockDims.z };
+  uint64_t const brickBytes{ brickElems * sizeof(Ty) };
+  uint64_t const perRun{ std::max<uint64_t>(1, m_slabBytes / brickBytes) };
+
+  std::ifstream is(m_rawPath, std::ios::binary);
+  if (!is.is_open()) {
+    bd::Err() << "Could not open raw file " << m_rawPath;
+    return false;
+  }
+
+  // Visit the bricks in file order so each run is one sequential read.
+  std::vector<size_t> order(m_brickOffsets.size());
+  std::iota(order.begin(), order.end(), size_t{ 0 });
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return m_brickOffsets[a] < m_brickOffsets[b];
+  });
+
+  std::vector<Ty> runs[2]{ std::vector<Ty>(perRun * brickElems),
+                           std::vector<Ty>(perRun * brickElems) };
+
+  // read the bricks order[first, first + n) into runs[s], one read for
+  // each stretch of adjacent bricks.
+  auto readRun = [&](int s, size_t first) -> size_t {
+    size_t const n{ std::min<size_t>(perRun, order.size() - first) };
+    size_t i{ 0 };
+    while (i < n) {
+      size_t j{ i + 1 };
+      while (j < n && m_brickOffsets[order[first + j]] ==
+                      m_brickOffsets[order[first + j - 1]] + brickBytes) {
+        ++j;
+      }
+      is.seekg(m_brickOffsets[order[first + i]], std::ios::beg);
+      is.read(reinterpret_cast<char *>(&runs[s][i * brickElems]),
+              ( j - i ) * brickBytes);
+      if (!is) {
+        return 0;
+      }
+      i = j;
+    }
+    return n;
+  };
+
+  bd::OpacityLut<Ty> const lut{ otf, m_volMin, m_volMax };
+
+  std::future<size_t> next{ std::async(std::launch::async, readRun, 0, 0) };
+  int cur{ 0 };
+  for (size_t first = 0; first < order.size(); first += perRun, cur = 1 - cur) {
+    size_t const n{ next.get() };
+    if (n == 0) {
+      bd::Err() << "Could not read bricks from " << m_rawPath;
+      return false;
+    }
+    if (first + n < order.size()) {
+      next = std::async(std::launch::async, readRun, 1 - cur, first + n);
+    }
+    if (m_cancel) {
+      return false;
+    }
+
+    Ty const *run{ runs[cur].data() };
+    bd::parallelFor(n, m_threads, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        sums[order[first + i]] = lut.relevance(run + i * brickElems, brickElems);
+      }
+    });
+
+    sendProgress(static_cast<double>(first + n) / order.size(), false);
+  }
+
+  return true;
+}
+
+} // namespace subvol
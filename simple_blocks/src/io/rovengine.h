@@ -0,0 +1,132 @@
+//
+// Created by jim on 3/22/19.
+//
+
+#ifndef subvol_rovengine_h
+#define subvol_rovengine_h
+
+#include <bd/io/datatypes.h>
+#include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/io/indexfile/v3/binaryindexfile.h>
+#include <bd/volume/transferfunction.h>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace subvol
+{
+
+/// \brief Recomputes the ROV of every block from the raw file for an opacity
+///        transfer function, on a background thread.
+///
+/// The raw file is streamed in slabs of whole z planes (or, for a bricked
+/// raw file, runs of bricks) no larger than the slab budget. The next slab
+/// is read while the voxels of the current one are evaluated by a pool of
+/// threads. A ROVProgressMessage is sent through the Broker after each slab
+/// and when the job finishes.
+///
+/// Blocks' ROVs are computed the same way as by the preprocessor: the mean
+/// opacity of the voxels in the block, voxels normalized by the volume
+/// min/max. Voxels outside of the blocks' extent are ignored.
+class RovEngine
+{
+public:
+  RovEngine(std::string const &rawPath,
+            bd::indexfile::v2::JsonIndexFile const &index);
+
+
+  /// \brief Brick offsets are taken from the index's data offset column.
+  RovEngine(std::string const &rawPath,
+            bd::indexfile::v3::BinaryIndexFile const &index);
+
+
+  /// \brief Cancels a running job and waits for it to exit.
+  ~RovEngine();
+
+
+  /// \brief Threads evaluating the transfer function (at least 1).
+  void
+  setThreads(int threads);
+
+
+  /// \brief Bytes of raw data read at a time (two slabs are in memory).
+  void
+  setSlabBytes(uint64_t bytes);
+
+
+  /// \brief Start recomputing the ROVs for \c otf. A job already running is
+  ///        cancelled first, and its result is discarded.
+  void
+  start(bd::OpacityTransferFunction const &otf);
+
+
+  /// \brief Cancel the running job (if any) and wait for it to exit. A
+  ///        result that was not taken yet is discarded.
+  void
+  cancel();
+
+
+  /// \brief True while a job is running.
+  bool
+  isRunning() const;
+
+
+  /// \brief If a job finished since the last call, move its ROVs (one per
+  ///        block, in block index order) into \c rovs.
+  /// \return true if \c rovs was set.
+  bool
+  takeResult(std::vector<double> &rovs);
+
+
+private:
+  RovEngine(std::string const &rawPath, bd::Volume const &volume,
+            bd::DataType type, bool bricked);
+
+
+  void
+  work(bd::OpacityTransferFunction otf);
+
+
+  template<class Ty>
+  bool
+  runSlabs(bd::OpacityTransferFunction const &otf, std::vector<double> &sums);
+
+
+  template<class Ty>
+  bool
+  runBricks(bd::OpacityTransferFunction const &otf, std::vector<double> &sums);
+
+
+  std::string m_rawPath;
+  bd::DataType m_type;
+  glm::u64vec3 m_voxelDims;
+  glm::u64vec3 m_blockDims;
+  glm::u64vec3 m_blockCount;
+  double m_volMin;
+  double m_volMax;
+
+  bool m_bricked;
+  std::vector<uint64_t> m_brickOffsets;  ///< only if m_bricked.
+
+  int m_threads;
+  uint64_t m_slabBytes;
+
+  std::thread m_worker;
+  std::atomic_bool m_cancel;
+  std::atomic_bool m_running;
+
+  std::mutex m_resultMutex;
+  std::vector<double> m_result;  ///< guarded by m_resultMutex.
+  bool m_hasResult;              ///< guarded by m_resultMutex.
+
+}; // class RovEngine
+
+} // namespace subvol
+
+#endif // ! subvol_rovengine_h
@@ -0,0 +1,183 @@
+//
+// Created by jim on 3/31/19.
+//
+
+#include "session.h"
+#include "messages/messagebroker.h"
+
+#include <bd/log/logger.h>
+
+#include <sstream>
+
+namespace subvol
+{
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+readSession(std::string const &path, std::vector<SessionCommand> &commands)
+{
+  std::ifstream in(path);
+  if (!in.is_open()) {
+    bd::Err() << "Could not open session file " << path;
+    return false;
+  }
+
+  std::string line;
+  int lineNumber{ 0 };
+  while (std::getline(in, line)) {
+    ++lineNumber;
+    size_t const hash{ line.find('#') };
+    if (hash != std::string::npos) {
+      line.resize(hash);
+    }
+
+    std::istringstream ss(line);
+    std::string word;
+    if (!( ss >> word )) {
+      continue;
+    }
+
+    SessionCommand c{ SessionCommand::Kind::Classify, "", { 0, 0, 0 } };
+    bool ok{ true };
+    if (word == "classify") {
+      ok = static_cast<bool>(ss >> c.arg);
+    } else if (word == "rov") {
+      c.kind = SessionCommand::Kind::Rov;
+      ok = static_cast<bool>(ss >> c.values[0] >> c.values[1]);
+    } else if (word == "tf") {
+      c.kind = SessionCommand::Kind::Tf;
+      ok = static_cast<bool>(ss >> c.arg);
+    } else if (word == "camera") {
+      c.kind = SessionCommand::Kind::Camera;
+      ok = static_cast<bool>(ss >> c.values[0] >> c.values[1] >> c.values[2]);
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      bd::Err() << path << ":" << lineNumber << ": can not parse \"" << line
+                << "\"";
+      return false;
+    }
+    commands.push_back(c);
+  }
+
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SessionRecorder::SessionRecorder()
+    : Recipient{ "SessionRecorder" }
+    , m_mutex{ }
+    , m_out{ }
+    , m_rovMin{ 0 }
+    , m_rovMax{ 0 }
+    , m_eye{ 0, 0, 0 }
+    , m_lastCamera{ }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SessionRecorder::~SessionRecorder()
+{
+  Broker::unsubscribeRecipient(this);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+SessionRecorder::open(std::string const &path)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_out.open(path, std::ios::trunc);
+  if (!m_out.is_open()) {
+    bd::Err() << "Could not open session file " << path << " for writing.";
+    return false;
+  }
+  m_out.precision(9);
+  m_out << "# simple_blocks session, replay with loader_bench.\n";
+  lock.unlock();
+
+  Broker::subscribeRecipient(this,
+                             { MessageType::ROV_CHANGING_MESSAGE,
+                               MessageType::MIN_RANGE_CHANGED_MESSAGE,
+                               MessageType::MAX_RANGE_CHANGED_MESSAGE,
+                               MessageType::TRANSFER_FUNCTION_CHANGED_MESSAGE });
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SessionRecorder::classify(std::string const &type)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_out.is_open()) {
+    m_out << "classify " << type << '\n';
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SessionRecorder::camera(glm::vec3 const &eye)
+{
+  auto const now = std::chrono::steady_clock::now();
+  if (eye == m_eye || now - m_lastCamera < std::chrono::milliseconds(250)) {
+    return;
+  }
+  m_eye = eye;
+  m_lastCamera = now;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_out.is_open()) {
+    m_out << "camera " << eye.x << ' ' << eye.y << ' ' << eye.z << '\n';
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SessionRecorder::handle_ROVChangingMessage(ROVChangingMessage &m)
+{
+  if (m.IsChanging) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_out << "rov " << m_rovMin << ' ' << m_rovMax << '\n';
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SessionRecorder::handle_MinRangeChangedMessage(MinRangeChangedMessage &m)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_rovMin = m.Min;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SessionRecorder::handle_MaxRangeChangedMessage(MaxRangeChangedMessage &m)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_rovMax = m.Max;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+SessionRecorder::handle_TransferFunctionChangedMessage(
+    TransferFunctionChangedMessage &m)
+{
+  if (m.FileName.empty()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_out << "tf " << m.FileName << '\n';
+}
+
+} // namespace subvol
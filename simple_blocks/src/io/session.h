@@ -0,0 +1,113 @@
+//
+// Created by jim on 3/31/19.
+//
+
+#ifndef subvol_session_h
+#define subvol_session_h
+
+#include "messages/recipient.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace subvol
+{
+
+/// \brief One step of a recorded session.
+///
+/// A session file has one command per line ('#' starts a comment):
+///
+///     classify rov|avg|tf     change the classification type
+///     rov <min> <max>         set the ROV range and update the visible blocks
+///     tf <file.1dt>           load an opacity transfer function and reclassify
+///     camera <x> <y> <z>      move the eye (world coordinates)
+///
+/// simple_blocks writes one with --record-session, and loader_bench replays
+/// it without a gl context.
+struct SessionCommand
+{
+  enum class Kind
+  {
+    Classify,
+    Rov,
+    Tf,
+    Camera
+  };
+
+  Kind kind;
+  std::string arg;      ///< classification type or tf file.
+  double values[3];     ///< rov min and max, or eye x, y, z.
+};
+
+
+/// \brief Read the commands in session file \c path.
+/// \return false if the file could not be read or has a bad line.
+bool
+readSession(std::string const &path, std::vector<SessionCommand> &commands);
+
+
+/// \brief Records the user's ROV range changes, transfer functions and
+///        camera moves to a session file.
+///
+/// The ROV range is recorded when the user lets go of the slider, which is
+/// when the visible blocks are updated. Camera moves are recorded at most a
+/// few times a second.
+class SessionRecorder
+    : public Recipient
+{
+public:
+  SessionRecorder();
+
+
+  ~SessionRecorder();
+
+
+  /// \brief Start writing to \c path (truncating it).
+  bool
+  open(std::string const &path);
+
+
+  void
+  classify(std::string const &type);
+
+
+  /// \brief Record the eye position, if it moved since the last one and
+  ///        enough time has passed. Called from the render thread.
+  void
+  camera(glm::vec3 const &eye);
+
+
+  void
+  handle_ROVChangingMessage(ROVChangingMessage &) override;
+
+
+  void
+  handle_MinRangeChangedMessage(MinRangeChangedMessage &) override;
+
+
+  void
+  handle_MaxRangeChangedMessage(MaxRangeChangedMessage &) override;
+
+
+  void
+  handle_TransferFunctionChangedMessage(TransferFunctionChangedMessage &) override;
+
+
+private:
+  std::mutex m_mutex;
+  std::ofstream m_out;
+  double m_rovMin;
+  double m_rovMax;
+  glm::vec3 m_eye;
+  std::chrono::steady_clock::time_point m_lastCamera;
+
+};
+
+} // namespace subvol
+
+#endif // ! subvol_session_h
@@ -6,6 +6,7 @@
 #include "renderhelp.h"
 
 #include <bd/log/gl_log.h>
+#include <bd/log/trace.h>
 
 #define MAX_SECONDS_SINCE_LAST_JOB 1.0 //0000000
 
@@ -22,6 +23,7 @@ Loop::Loop(GLFWwindow *window, std::shared_ptr<bd::Renderer> r,
     , _collection{ std::move(c) }
     , m_timeOfLastJob{ 0 }
     , m_tf{ 1.0/glfwGetTimerFrequency() }
+    , m_recorder{ nullptr }
 {
 }
 
@@ -39,6 +41,7 @@ Loop::loop()
 {
   assert(_window!=nullptr && "window was passed as nullptr in loop()");
   bd::Info() << "About to enter render loop.";
+  BD_TRACE_THREAD_NAME("render");
 
   do {
     _frameCount++;
@@ -52,9 +55,18 @@ Loop::loop()
 }
 
 
+void
+Loop::setSessionRecorder(SessionRecorder *recorder)
+{
+  m_recorder = recorder;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
 void
 Loop::tick(float now)
 {
+  BD_TRACE_SCOPE("Loop::tick", "render");
   m_numFrames++;
   if (now-m_timeOfLastJob>MAX_SECONDS_SINCE_LAST_JOB) {
     // load some blocks to the m_gpu if any available.
@@ -63,12 +75,27 @@ Loop::tick(float now)
     m_timeOfLastJob = timeNow();
   }
 
+  if (_collection->getTransferFunctionChanged()) {
+    _collection->reclassify();
+  }
+
+  // ROVs recomputed from the raw file in the background (see RovEngine).
+  _collection->applyRecomputedRovs();
+
   if (_collection->getRangeChanged()) {
     _collection->filterBlocks();
   }
 
-  _renderer->draw();
+  {
+    BD_TRACE_SCOPE("draw", "render");
+    _renderer->draw();
+  }
+
+  if (m_recorder) {
+    m_recorder->camera(_renderer->getCamera().getEye());
+  }
 
+  BD_TRACE_SCOPE("glfwSwapBuffers", "render");
   glfwSwapBuffers(_window);
   glfwPollEvents();
 }
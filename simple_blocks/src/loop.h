@@ -10,6 +10,7 @@
 #include "timing.h"
 #include "axis_enum.h"
 #include "io/blockcollection.h"
+#include "io/session.h"
 
 #include <bd/graphics/renderer.h>
 #include <memory>
@@ -33,6 +34,11 @@ public:
   loop();
 
 
+  /// \brief Record the camera to \c recorder each frame (null to stop).
+  void
+  setSessionRecorder(SessionRecorder *recorder);
+
+
 protected:
 
   virtual void
@@ -52,6 +58,7 @@ private:
   float m_timeOfLastJob;
   double const m_tf;
   uint32_t m_numFrames;
+  SessionRecorder *m_recorder;
 
 };
 
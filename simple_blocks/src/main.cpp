@@ -16,8 +16,10 @@
 #include <bd/graphics/shader.h>
 #include <bd/graphics/vertexarrayobject.h>
 #include <bd/log/logger.h>
+#include <bd/log/trace.h>
 #include <bd/io/indexfile/indexfile.h>
 #include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/io/indexfile/v3/binaryindexfile.h>
 
 #include <QApplication>
 
@@ -88,25 +90,55 @@ printBlocks(subvol::BlockCollection *bcol)
 //}
 
 
+/////////////////////////////////////////////////////////////////////////////////
+// Read a json (v2) index file into indexFile, or map a binary (v3) index
+// file into binIndex and copy only its header into indexFile. The blocks of a
+// binary index are made straight from its mapped columns, so it is the quick
+// one to start up from.
+bool
+openIndexFile(std::string const &path, bd::indexfile::v2::JsonIndexFile &indexFile,
+              bd::indexfile::v3::BinaryIndexFile &binIndex, bool &binary)
+{
+  binary = bd::indexfile::v3::BinaryIndexFile::isBinaryIndexFile(path);
+  if (!binary) {
+    return indexFile.open(path);
+  }
+
+  if (!binIndex.open(path)) {
+    return false;
+  }
+  binIndex.copyHeaderTo(indexFile);
+  return true;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////
 // Since the IndexFileHeader contains most of the options needed to
 // render the volume, we copy those over into the CommandLineOptions struct.
 // Without an index file these options are provided via argv anyway.
 void
 updateCommandLineOptionsFromIndexFile(subvol::CommandLineOptions &clo,
-                                      bd::indexfile::v2::JsonIndexFile const &indexFile)
+                                      bd::indexfile::v2::JsonIndexFile const &indexFile,
+                                      bd::indexfile::v3::BinaryIndexFile const *binIndex)
 {
   bd::Dbg() << "Updating command line options from index file.";
-  auto minmaxE =
-      std::minmax_element(indexFile.getFileBlocks().begin(),
-                          indexFile.getFileBlocks().end(),
-                          [](bd::FileBlock const &lhs, bd::FileBlock const &rhs)
-                              -> bool {
-                            return lhs.rov<rhs.rov;
-                          });
-
-  renderhelp::g_rovMin = ( *minmaxE.first ).rov;
-  renderhelp::g_rovMax = ( *minmaxE.second ).rov;
+  if (binIndex) {
+    double const *rov{ binIndex->getRov() };
+    auto minmaxE = std::minmax_element(rov, rov + binIndex->getNumBlocks());
+    renderhelp::g_rovMin = *minmaxE.first;
+    renderhelp::g_rovMax = *minmaxE.second;
+  } else {
+    auto minmaxE =
+        std::minmax_element(indexFile.getFileBlocks().begin(),
+                            indexFile.getFileBlocks().end(),
+                            [](bd::FileBlock const &lhs, bd::FileBlock const &rhs)
+                                -> bool {
+                              return lhs.rov<rhs.rov;
+                            });
+
+    renderhelp::g_rovMin = ( *minmaxE.first ).rov;
+    renderhelp::g_rovMax = ( *minmaxE.second ).rov;
+  }
 
   clo.vol_w = indexFile.getVolume().voxelDims().x;
   clo.vol_h = indexFile.getVolume().voxelDims().y;
@@ -169,15 +201,24 @@ try
   // Open the index file if possible, then setup the BlockCollection
   // and give away ownership of the index file to the BlockCollection.
   //std::shared_ptr<bd::IndexFile> indexFile{ std::make_shared<bd::IndexFile>() };
+  // A binary index stays mapped for as long as the BlockCollection made
+  // from it, so it is declared first and destroyed last.
+  bd::indexfile::v3::BinaryIndexFile binIndex;
+  bool binary{ false };
   bd::indexfile::v2::JsonIndexFile indexFile;
   if (!clo.indexFilePath.empty()) {
-    if (!indexFile.open(clo.indexFilePath)) {
+    if (!subvol::openIndexFile(clo.indexFilePath, indexFile, binIndex, binary)) {
       bd::Err() << "Could not read index file " << clo.indexFilePath;
       return 1;
     }
     // there are some CL opts that can be specified in the index file, so we 
     // read those into our CommandLineOptions struct.
-    updateCommandLineOptionsFromIndexFile(clo, indexFile);
+    updateCommandLineOptionsFromIndexFile(clo, indexFile,
+                                          binary ? &binIndex : nullptr);
+  }
+
+  if (!clo.tracePath.empty()) {
+    bd::trace::enable(true);
   }
 
   bd::Info() << "Initializing subvol...";
@@ -191,7 +232,9 @@ try
       subvol::renderhelp::initializeBlockLoader(indexFile, clo) };
 
   std::shared_ptr<subvol::BlockCollection> bc{
-      subvol::renderhelp::initializeBlockCollection(loader, indexFile, clo) };
+      subvol::renderhelp::initializeBlockCollection(loader, indexFile,
+                                                    binary ? &binIndex : nullptr,
+                                                    clo) };
 
 
   std::shared_ptr<subvol::renderer::BlockRenderer> br{
@@ -201,6 +244,12 @@ try
 //  subvol::renderhelp::BenchmarkLoop loop(window, br, bc, glm::vec3{ 1,0,0 });
   subvol::renderhelp::Loop loop(window, br, bc);
 
+  subvol::SessionRecorder recorder;
+  if (!clo.sessionPath.empty() && recorder.open(clo.sessionPath)) {
+    recorder.classify(clo.classification);
+    loop.setSessionRecorder(&recorder);
+  }
+
   subvol::Semathing s(1);
 
   // Start the qt event stuff on a separate thread (this gui is totally kludged in here...).
@@ -228,6 +277,12 @@ try
 //  subvol::timing::printTimes(std::cout);
   //  printNvPmApiCounters(clo.perfOutPath.c_str());
   subvol::cleanup();
+  subvol::Broker::stop();
+
+  if (!clo.tracePath.empty()) {
+    bd::trace::enable(false);
+    bd::trace::writeJson(clo.tracePath);
+  }
 
   return 0;
 } catch (std::exception e)
@@ -17,15 +17,23 @@ enum class MessageType
   RENDER_STATS_MESSAGE,
   SLICESET_CHANGED_MESSAGE,
   BLOCK_LOADED_MESSAGE,
+  TRANSFER_FUNCTION_CHANGED_MESSAGE,
+  ROV_PROGRESS_MESSAGE,
+
+  NUM_MESSAGE_TYPES  ///< Not a message, the number of message types.
 };
 
 class Recipient;
 
+template<class T>
+class MessagePool;
+
 class Message
 {
 public:
   Message(MessageType t)
       : type{ t }
+      , m_release{ nullptr }
   {
   }
 
@@ -41,7 +49,26 @@ public:
   }
 
 
+  /// \brief Give the message back to the pool it came from, or delete it
+  ///        if it was allocated with new.
+  void
+  release()
+  {
+    if (m_release) {
+      m_release(this);
+    } else {
+      delete this;
+    }
+  }
+
+
   MessageType type;
+
+private:
+  template<class T>
+  friend class MessagePool;
+
+  void (*m_release)(Message *);  ///< Set by the pool the message came from.
 };
 
 
@@ -2,46 +2,103 @@
 #define subvol_messagebroker_h__
 
 #include "message.h"
+#include "messagepool.h"
 #include "recipient.h"
 
+#include <bd/datastructure/mpscqueue.h>
 #include <bd/log/logger.h>
+#include <bd/log/trace.h>
 
+#include <array>
+#include <atomic>
 #include <mutex>
-#include <condition_variable>
-#include <queue>
 #include <future>
+#include <initializer_list>
 #include <iostream>
 #include <algorithm>
+#include <vector>
 
 namespace subvol
 {
 
+/// \brief Delivers messages to recipients on the broker's thread.
+///
+/// Senders push onto a lock-free multi-producer queue, and the broker's
+/// worker delivers each message only to the recipients subscribed to its
+/// type. Messages from acquire() come from a per-type pool and are returned
+/// to it after delivery.
+///
+/// sendLatest() is for high-rate messages, like cache stats, where only the
+/// newest value matters: the message goes into a per-type slot, replacing
+/// (and releasing) one that has not been delivered yet, so at most one
+/// message per type is waiting at any time.
 class Broker
 {
 
 public:
 
+  /// \brief A pooled message of type T to fill in and send.
+  template<class T>
+  static T *
+  acquire()
+  {
+    return MessagePool<T>::acquire();
+  }
+
+
+  /// \brief Queue m for delivery, the broker releases it when done.
   static void
   send(Message *m)
   {
-    std::unique_lock<std::mutex> lock(m_myself->m_waitMessageMutex);
-    m_myself->m_messages.push(m);
-    lock.unlock();
-    m_myself->m_waitMessage.notify_all();
+    if (!m_myself->m_messages.push(Envelope{ m, m->type }, m_myself->m_stop)) {
+      m->release();
+    }
+  }
+
+
+  /// \brief Deliver m, unless a newer message of the same type is sent
+  ///        before the broker gets to it.
+  static void
+  sendLatest(Message *m)
+  {
+    MessageType const t{ m->type };
+    Message *old{ m_myself->m_latest[index(t)].exchange(m) };
+    if (old != nullptr) {
+      // the worker has not taken old yet, so it is still queued and the
+      // worker will take m in its place.
+      old->release();
+      return;
+    }
+    if (!m_myself->m_messages.push(Envelope{ nullptr, t }, m_myself->m_stop)) {
+      Message *mine{ m_myself->m_latest[index(t)].exchange(nullptr) };
+      if (mine) {
+        mine->release();
+      }
+    }
   }
 
 
+  /// \brief Deliver every type of message to r.
   static void
   subscribeRecipient(Recipient *r)
   {
     std::unique_lock<std::mutex> lock(m_myself->m_recipientsMutex);
-    auto found = std::find(m_myself->m_recipients.begin(),
-                           m_myself->m_recipients.end(), r);
+    for (int t = 0; t < NUM_TYPES; ++t) {
+      m_myself->add(r, static_cast<MessageType>(t));
+    }
+    bd::Dbg() << "Added recipient " << r->name();
+  }
+
 
-    if (found==m_myself->m_recipients.end()) {
-      m_myself->m_recipients.push_back(r);
-      bd::Dbg() << "Added recipient " << r->name();
+  /// \brief Deliver only the given types of message to r.
+  static void
+  subscribeRecipient(Recipient *r, std::initializer_list<MessageType> types)
+  {
+    std::unique_lock<std::mutex> lock(m_myself->m_recipientsMutex);
+    for (MessageType t : types) {
+      m_myself->add(r, t);
     }
+    bd::Dbg() << "Added recipient " << r->name();
   }
 
 
@@ -49,11 +106,16 @@ public:
   unsubscribeRecipient(Recipient *r)
   {
     std::unique_lock<std::mutex> lock(m_myself->m_recipientsMutex);
-    auto found = std::find(m_myself->m_recipients.begin(),
-                           m_myself->m_recipients.end(), r);
+    bool removed{ false };
+    for (auto &rs : m_myself->m_recipients) {
+      auto found = std::find(rs.begin(), rs.end(), r);
+      if (found != rs.end()) {
+        rs.erase(found);
+        removed = true;
+      }
+    }
 
-    if (found!=m_myself->m_recipients.end()) {
-      m_myself->m_recipients.erase(found);
+    if (removed) {
       bd::Dbg() << "Removed recipient " << r->name();
     }
   }
@@ -71,58 +133,128 @@ public:
   }
 
 
-private:
-  void
-  work()
+  /// \brief Deliver the messages already sent, then stop the worker.
+  static void
+  stop()
   {
-    while (true) {
-      Message *m{ getNextMessage() };
+    if (m_myself==nullptr || !m_myself->m_workFuture.valid()) {
+      return;
+    }
 
-      m_recipientsMutex.lock();
-      for (auto &r : m_recipients) {
-        r->deliver(m);
+    send(new Message{ MessageType::EMPTY_MESSAGE });
+    m_myself->m_workFuture.wait();
+
+    // release whatever was sent after the empty message.
+    m_myself->m_stop = true;
+    m_myself->m_messages.wake();
+    Envelope e;
+    while (m_myself->m_messages.tryPop(e)) {
+      if (e.m) {
+        e.m->release();
+      }
+    }
+    for (auto &slot : m_myself->m_latest) {
+      Message *m{ slot.exchange(nullptr) };
+      if (m) {
+        m->release();
       }
-      m_recipientsMutex.unlock();
+    }
+  }
 
-      delete m;
 
-      if (m->type==MessageType::EMPTY_MESSAGE) {
-        break;
-      }
+private:
 
-    } // while
-    bd::Info() << "Message worker exiting.";
+  static int const NUM_TYPES =
+      static_cast<int>(MessageType::NUM_MESSAGE_TYPES);
+
+
+  /// \brief Queued item: a message, or, if m is null, a note to deliver
+  ///        the message in the latest slot for type.
+  struct Envelope
+  {
+    Message *m;
+    MessageType type;
+  };
+
+
+  Broker()
+      : m_recipientsMutex{ }
+      , m_recipients{ }
+      , m_messages{ 1024 }
+      , m_latest{ }
+      , m_stop{ false }
+      , m_workFuture{ }
+  {
+    for (auto &slot : m_latest) {
+      slot = nullptr;
+    }
+  }
+
+
+  static size_t
+  index(MessageType t)
+  {
+    return static_cast<size_t>(t);
   }
 
 
-  Message *
-  getNextMessage()
+  void
+  add(Recipient *r, MessageType t)
   {
-    std::unique_lock<std::mutex> lock(m_waitMessageMutex);
-    while (m_messages.empty()) {
-      m_waitMessage.wait(m_waitMessageMutex);
+    std::vector<Recipient *> &rs = m_recipients[index(t)];
+    if (std::find(rs.begin(), rs.end(), r)==rs.end()) {
+      rs.push_back(r);
     }
+  }
+
 
-    Message *m{ m_messages.front() };
-    m_messages.pop();
-    return m;
+  void
+  work()
+  {
+    BD_TRACE_THREAD_NAME("broker");
+    Envelope e;
+    while (m_messages.pop(e, m_stop)) {
+      Message *m{ e.m };
+      if (m==nullptr) {
+        m = m_latest[index(e.type)].exchange(nullptr);
+        if (m==nullptr) {
+          continue;
+        }
+      }
+
+      MessageType const type{ m->type };
+      if (type==MessageType::EMPTY_MESSAGE) {
+        m->release();
+        break;
+      }
+
+      {
+        BD_TRACE_SCOPE_ARG("Broker::deliver", "broker", "type", type);
+        // held while delivering so a recipient can not unsubscribe (and go
+        // away) in the middle of handling a message.
+        std::lock_guard<std::mutex> lock(m_recipientsMutex);
+        for (auto &r : m_recipients[index(type)]) {
+          r->deliver(m);
+        }
+      }
+
+      m->release();
+
+    } // while
+    bd::Info() << "Message worker exiting.";
   }
 
 
   std::mutex m_recipientsMutex;
-  std::vector<Recipient *> m_recipients;
-
-//    std::mutex m_messagesMutex;
-  std::queue<Message *> m_messages;
+  std::array<std::vector<Recipient *>, NUM_TYPES> m_recipients;
 
-  std::mutex m_waitMessageMutex;
-  std::condition_variable_any m_waitMessage;
+  bd::MpscQueue<Envelope> m_messages;
+  std::array<std::atomic<Message *>, NUM_TYPES> m_latest;
+  std::atomic_bool m_stop;
 
   std::future<void> m_workFuture;
 
   static Broker *m_myself;
-  //    std::map<Recipient, std::list<MessageType>> m_receipients;
-
 
 };
 }
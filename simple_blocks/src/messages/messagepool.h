@@ -0,0 +1,97 @@
+#ifndef subvol_messagepool_h__
+#define subvol_messagepool_h__
+
+#include "message.h"
+
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace subvol
+{
+
+/// \brief Recycles the storage of messages of type T.
+///
+/// Messages are constructed in place in storage that is kept on a free list
+/// when the broker releases them, so after warm up sending a message does
+/// not touch the heap. The free list is guarded by a mutex that is only held
+/// for a push or a pop.
+template<class T>
+class MessagePool
+{
+public:
+
+  /// \brief A default constructed T from the pool.
+  static T *
+  acquire()
+  {
+    MessagePool &p = instance();
+
+    void *mem{ nullptr };
+    {
+      std::lock_guard<std::mutex> lock(p.m_mutex);
+      if (!p.m_free.empty()) {
+        mem = p.m_free.back();
+        p.m_free.pop_back();
+      }
+    }
+    if (mem == nullptr) {
+      mem = ::operator new(sizeof(T));
+    }
+
+    T *m{ new(mem) T() };
+    m->m_release = &MessagePool::release;
+    return m;
+  }
+
+
+private:
+
+  /// \brief Most free messages kept per type, any more are deleted.
+  static size_t const MAX_FREE = 64;
+
+
+  MessagePool() = default;
+
+
+  ~MessagePool()
+  {
+    for (void *mem : m_free) {
+      ::operator delete(mem);
+    }
+  }
+
+
+  static MessagePool &
+  instance()
+  {
+    static MessagePool pool;
+    return pool;
+  }
+
+
+  static void
+  release(Message *m)
+  {
+    T *t{ static_cast<T *>(m) };
+    t->~T();
+
+    MessagePool &p = instance();
+    {
+      std::lock_guard<std::mutex> lock(p.m_mutex);
+      if (p.m_free.size() < MAX_FREE) {
+        p.m_free.push_back(t);
+        return;
+      }
+    }
+    ::operator delete(t);
+  }
+
+
+  std::mutex m_mutex;
+  std::vector<void *> m_free;
+};
+
+} // namespace subvol
+
+#endif // ! subvol_messagepool_h__
@@ -4,6 +4,8 @@
 #include "message.h"
 #include "sliceset.h"
 
+#include <bd/volume/transferfunction.h>
+
 #include <iostream>
 
 namespace subvol
@@ -24,6 +26,10 @@ class SliceSetChangedMessage;
 
 class BlockLoadedMessage;
 
+class TransferFunctionChangedMessage;
+
+class ROVProgressMessage;
+
 class Recipient
 {
 public:
@@ -87,6 +93,18 @@ public:
   }
 
 
+  virtual void
+  handle_TransferFunctionChangedMessage(TransferFunctionChangedMessage &)
+  {
+  }
+
+
+  virtual void
+  handle_ROVProgressMessage(ROVProgressMessage &)
+  {
+  }
+
+
   std::string const &
   name() const
   {
@@ -214,6 +232,18 @@ class BlockCacheStatsMessage
 public:
   BlockCacheStatsMessage()
       : Message{ MessageType::BLOCK_CACHE_STATS_MESSAGE }
+      , CpuCacheSize{ 0 }
+      , GpuCacheSize{ 0 }
+      , CpuLoadQueueSize{ 0 }
+      , GpuLoadQueueSize{ 0 }
+      , CpuBuffersAvailable{ 0 }
+      , GpuTexturesAvailable{ 0 }
+      , CpuHits{ 0 }
+      , CpuMisses{ 0 }
+      , CpuEvictions{ 0 }
+      , GpuHits{ 0 }
+      , GpuMisses{ 0 }
+      , GpuEvictions{ 0 }
   {
   }
 
@@ -236,6 +266,13 @@ public:
   size_t GpuLoadQueueSize;
   size_t CpuBuffersAvailable;
   size_t GpuTexturesAvailable;
+  // visible blocks found (or not) in each cache since the loader started.
+  size_t CpuHits;
+  size_t CpuMisses;
+  size_t CpuEvictions;
+  size_t GpuHits;
+  size_t GpuMisses;
+  size_t GpuEvictions;
 };
 
 class SliceSetChangedMessage
@@ -291,5 +328,64 @@ public:
   size_t GpuLoadQueueSize;
 };
 
+/// \brief The opacity transfer function used to classify blocks changed.
+class TransferFunctionChangedMessage
+    : public Message
+{
+public:
+
+  TransferFunctionChangedMessage()
+      : Message{ MessageType::TRANSFER_FUNCTION_CHANGED_MESSAGE }
+      , Otf{ }
+  {
+  }
+
+
+  virtual ~TransferFunctionChangedMessage()
+  {
+  }
+
+
+  void
+  operator()(Recipient &r) override
+  {
+    r.handle_TransferFunctionChangedMessage(*this);
+  }
+
+
+  bd::OpacityTransferFunction Otf;
+  std::string FileName;  ///< opacity tf file Otf was loaded from, if any.
+};
+
+/// \brief Progress of recomputing the block ROVs from the raw file.
+class ROVProgressMessage
+    : public Message
+{
+public:
+
+  ROVProgressMessage()
+      : Message{ MessageType::ROV_PROGRESS_MESSAGE }
+      , Progress{ 0 }
+      , Done{ false }
+  {
+  }
+
+
+  virtual ~ROVProgressMessage()
+  {
+  }
+
+
+  void
+  operator()(Recipient &r) override
+  {
+    r.handle_ROVProgressMessage(*this);
+  }
+
+
+  double Progress;  ///< fraction of the raw file done.
+  bool Done;        ///< the job finished (or failed, or was cancelled).
+};
+
 } // namespace subvol
 #endif // RECIPIENT_H
@@ -10,6 +10,7 @@
 #include <bd/graphics/vertexarrayobject.h>
 #include <bd/geo/mesh.h>
 #include <bd/log/gl_log.h>
+#include <bd/log/trace.h>
 
 #include <GL/glew.h>
 
@@ -67,6 +68,7 @@ BlockingRaycaster::BlockingRaycaster(std::shared_ptr<subvol::BlockCollection> bc
   , m_cube{ cube_verts, cube_indices }
   , m_axis{ }
   , m_volume{ v }
+  , m_gridOrder{ v.block_count() }
 {
 }
 
@@ -82,7 +84,7 @@ BlockingRaycaster::~BlockingRaycaster() noexcept
 bool
 BlockingRaycaster::initialize()
 {
-  Broker::subscribeRecipient(this);
+  Broker::subscribeRecipient(this, { MessageType::ROV_CHANGING_MESSAGE });
   initShaders();
   return true;
 }
@@ -190,17 +192,25 @@ BlockingRaycaster::setUniforms(bd::Block const &b)
 void
 BlockingRaycaster::sortBlocks()
 {
-  glm::vec3 const eye{ getCamera().getEye() };
+  BD_TRACE_SCOPE("sortBlocks", "render");
+  std::vector<bd::Block*> const &blocks{ m_blockCollection->getBlocks() };
+  if (blocks.empty()) {
+    return;
+  }
+
+  // Blocks are a regular grid, so the back to front order only depends on
+  // which block the eye is in.
+  bd::Block const *first{ blocks.front() };
+  m_gridOrder.setWorldBox(first->origin() - first->worldDims() * 0.5f,
+                          first->worldDims());
+  bool const moved{ m_gridOrder.setEye(getCamera().getEye()) };
 
-  // Sort the blocks by their distance from the camera.
-  // The origin of each block is used.
   std::vector<bd::Block*> &non_empties{ m_blockCollection->getNonEmptyBlocks() };
-  std::sort(non_empties.begin(), non_empties.end(),
-            [&eye](bd::Block *a, bd::Block *b) {
-              float a_dist = glm::distance(eye, a->origin());
-              float b_dist = glm::distance(eye, b->origin());
-              return a_dist > b_dist;
-            });
+  auto ijkOf = [](bd::Block const *b) { return b->ijk(); };
+  if (!moved && m_gridOrder.isSorted(non_empties, ijkOf)) {
+    return;
+  }
+  m_gridOrder.sort(non_empties, ijkOf);
 }
 
 
@@ -13,6 +13,7 @@
 #include <bd/geo/axis.h>
 #include <bd/geo/mesh.h>
 #include <bd/volume/volume.h>
+#include <bd/volume/gridorder.h>
 #include <bd/geo/wireframebox.h>
 #include <bd/geo/axis.h>
 
@@ -97,6 +98,7 @@ private:
   bd::CoordinateAxis m_axis;
   bd::WireframeBox m_box;
   bd::Volume m_volume;
+  bd::GridOrder m_gridOrder;
   unsigned int m_volumeSampler;
   bool m_rangeChanging;
 };
@@ -18,6 +18,7 @@
 
 #include <glm/gtx/string_cast.hpp>
 #include <bd/log/gl_log.h>
+#include <bd/log/trace.h>
 
 #ifdef USE_NV_TOOLS
 #include <nvToolsExt.h>
@@ -63,6 +64,7 @@ SlicingBlockRenderer::SlicingBlockRenderer(glm::vec3 smod,
     , m_collection{ std::move(blockCollection) }
     , m_nonEmptyBlocks{ nullptr }
     , m_blocks{ nullptr }
+    , m_gridOrder{ v.block_count() }
 {
   m_blocks = &( m_collection->getBlocks());
   m_nonEmptyBlocks = &( m_collection->getNonEmptyBlocks());
@@ -79,7 +81,7 @@ SlicingBlockRenderer::~SlicingBlockRenderer()
 bool
 SlicingBlockRenderer::initialize()
 {
-  Broker::subscribeRecipient(this);
+  Broker::subscribeRecipient(this, { MessageType::ROV_CHANGING_MESSAGE });
 
   bd::Info() << "Initializing gl state.";
   gl_check(glClearColor(0.15f, 0.15f, 0.15f, 0.0f));
@@ -238,7 +240,6 @@ SlicingBlockRenderer::draw()
   // We need to draw in reverse-visibility order (painters algorithm!)
   // so the transparency looks correct.
   sortBlocks();
-  //TODO: only sort if rotated beyond a limit.
 
 
   // Side effect: recalculation of world-view-projection matrix.
@@ -454,16 +455,23 @@ SlicingBlockRenderer::computeBaseVertexFromViewDir(glm::vec3 const &viewdir)
 void
 SlicingBlockRenderer::sortBlocks()
 {
-  glm::vec3 const eye{ getCamera().getEye() };
-
-  // Sort the blocks by their distance from the camera.
-  // The origin of each block is used.
-  std::sort(m_nonEmptyBlocks->begin(), m_nonEmptyBlocks->end(),
-            [&eye](bd::Block *a, bd::Block *b) {
-              float a_dist = glm::distance(eye, a->origin());
-              float b_dist = glm::distance(eye, b->origin());
-              return a_dist > b_dist;
-            });
+  BD_TRACE_SCOPE("sortBlocks", "render");
+  if (m_blocks->empty()) {
+    return;
+  }
+
+  // Blocks are a regular grid, so the back to front order only depends on
+  // which block the eye is in.
+  bd::Block const *first{ m_blocks->front() };
+  m_gridOrder.setWorldBox(first->origin() - first->worldDims() * 0.5f,
+                          first->worldDims());
+  bool const moved{ m_gridOrder.setEye(getCamera().getEye()) };
+
+  auto ijkOf = [](bd::Block const *b) { return b->ijk(); };
+  if (!moved && m_gridOrder.isSorted(*m_nonEmptyBlocks, ijkOf)) {
+    return;
+  }
+  m_gridOrder.sort(*m_nonEmptyBlocks, ijkOf);
 }
 
 
@@ -16,6 +16,7 @@
 #include <bd/graphics/shader.h>
 #include <bd/graphics/texture.h>
 #include <bd/volume/volume.h>
+#include <bd/volume/gridorder.h>
 #include <bd/graphics/vertexarrayobject.h>
 
 #include <memory>
@@ -137,8 +138,8 @@ private:
   computeBaseVertexFromViewDir(glm::vec3 const &viewdir);
 
 
-  /// \brief Sort visible blocks by distance from the camera (for painter's algorithm)
-  /// Distance is from camera to center of each block. Order is decending.
+  /// \brief Sort visible blocks back to front from the camera (for painter's
+  ///        algorithm), using the blocks' positions in the block grid.
   void
   sortBlocks();
 
@@ -174,6 +175,7 @@ private:
 
   std::vector<bd::Block *> *m_nonEmptyBlocks;  ///< Non-empty blocks to draw.
   std::vector<bd::Block *> *m_blocks;       ///< All the blocks!
+  bd::GridOrder m_gridOrder;                ///< Back to front block order.
 
 public:
 
@@ -124,11 +124,28 @@ initializeBlockLoader(bd::indexfile::v2::JsonIndexFile const &indexFile,
   glm::u64vec3 dims = indexFile.getVolume().block_dims();
   bd::DataType type = indexFile.getDatType();
 
-  // Number of bytes on the GPU for each block (sizeof(float)).
-  uint64_t blockBytes = dims.x * dims.y * dims.z * sizeof(float);
+  BlockPixelFormat pixelFormat{ BlockPixelFormat::Float };
+  if (!to_blockPixelFormat(clo.blockFormat, pixelFormat)) {
+    pixelFormat = BlockPixelFormat::Float;
+  }
+
+  // Number of bytes on the GPU for each block.
+  uint64_t blockBytes = dims.x * dims.y * dims.z * to_sizeType(pixelFormat);
+
+  // Number of bytes in main memory for each block, smaller than on the gpu
+  // if blocks are cached in the raw file's type.
+  bool nativeCache{ clo.nativeCache };
+  if (nativeCache && bd::to_sizeType(type) > to_sizeType(pixelFormat)) {
+    bd::Info() << "Raw file type " << bd::to_string(type) << " is larger than "
+               << "the block format, blocks are cached normalized.";
+    nativeCache = false;
+  }
+  uint64_t cpuBlockBytes = nativeCache
+                           ? dims.x * dims.y * dims.z * bd::to_sizeType(type)
+                           : blockBytes;
 
   BLThreadData *tdata{ new BLThreadData() };
-  size_t numBlocks{ indexFile.getFileBlocks().size() };
+  size_t numBlocks{ indexFile.getVolume().total_block_count() };
 
   // Provided block dimensions were such that we got 0 for the block bytes,
   // so lets not allow rendering of any blocks at all.
@@ -138,9 +155,10 @@ initializeBlockLoader(bd::indexfile::v2::JsonIndexFile const &indexFile,
     bd::Warn() << "Blocks have a dimension that is 0."; //, so I can't go on.";
   } else {
     bd::Info() << "Block texture size (bytes): " << blockBytes;
+    bd::Info() << "Block main memory size (bytes): " << cpuBlockBytes;
 
     // Find max cpu blocks (assert no larger than actual number of blocks).
-    tdata->maxCpuBlocks = clo.mainMemoryBytes / blockBytes;
+    tdata->maxCpuBlocks = clo.mainMemoryBytes / cpuBlockBytes;
     tdata->maxCpuBlocks = tdata->maxCpuBlocks > numBlocks
                           ? numBlocks
                           : tdata->maxCpuBlocks;
@@ -156,6 +174,21 @@ initializeBlockLoader(bd::indexfile::v2::JsonIndexFile const &indexFile,
   tdata->slabDims[0] = indexFile.getVolume().voxelDims().x;
   tdata->slabDims[1] = indexFile.getVolume().voxelDims().y;
   tdata->filename = clo.rawFilePath;
+  if (indexFile.isBricked()) {
+    bd::Info() << "Raw file is bricked (" << indexFile.getBrickOrder() << " order).";
+    tdata->readerType = BlockReaderType::Brick;
+  } else if (!to_blockReaderType(clo.blockReader, tdata->readerType)) {
+    tdata->readerType = BlockReaderType::Stream;
+  }
+  tdata->pixelFormat = pixelFormat;
+  tdata->nativeCache = nativeCache;
+  tdata->ioThreads = clo.ioThreads;
+  tdata->convertThreads = clo.convertThreads;
+  tdata->derivedThreads = clo.derivedThreads;
+  tdata->queueDepth = clo.loadQueueDepth;
+  if (!bd::to_cachePolicyType(clo.cachePolicy, tdata->cachePolicy)) {
+    tdata->cachePolicy = bd::CachePolicyType::Lru;
+  }
 
   tdata->texs = new std::vector<bd::Texture *>();
   tdata->buffers = new std::vector<char *>();
@@ -166,16 +199,25 @@ initializeBlockLoader(bd::indexfile::v2::JsonIndexFile const &indexFile,
   bd::Info() << "Max cpu blocks: " << tdata->maxCpuBlocks;
   bd::Info() << "Max GPU blocks: " << tdata->maxGpuBlocks;
 
-  bd::Texture::GenTextures3d(tdata->maxGpuBlocks,
-                             bd::DataType::Float,
-                             bd::Texture::Format::R32F,
-                             bd::Texture::Format::RED,
-                             dims.x, dims.y, dims.z,
-                             tdata->texs);
+  if (pixelFormat == BlockPixelFormat::Half) {
+    bd::Texture::GenTextures3d(tdata->maxGpuBlocks,
+                               bd::DataType::HalfFloat,
+                               bd::Texture::Format::R16F,
+                               bd::Texture::Format::RED,
+                               dims.x, dims.y, dims.z,
+                               tdata->texs);
+  } else {
+    bd::Texture::GenTextures3d(tdata->maxGpuBlocks,
+                               bd::DataType::Float,
+                               bd::Texture::Format::R32F,
+                               bd::Texture::Format::RED,
+                               dims.x, dims.y, dims.z,
+                               tdata->texs);
+  }
 
   bd::Info() << "Generated " << tdata->texs->size() << " textures.";
 
-  initializeMemoryBuffers(tdata->buffers, tdata->maxCpuBlocks, blockBytes);
+  initializeMemoryBuffers(tdata->buffers, tdata->maxCpuBlocks, cpuBlockBytes);
   bd::Info() << "Generated " << tdata->buffers->size() << " main memory buffers.";
 
   BlockLoader *loader{ new BlockLoader(tdata, indexFile.getVolume()) };
@@ -187,12 +229,24 @@ initializeBlockLoader(bd::indexfile::v2::JsonIndexFile const &indexFile,
 BlockCollection *
 initializeBlockCollection(BlockLoader *loader,
                           bd::indexfile::v2::JsonIndexFile const &indexFile,
+                          bd::indexfile::v3::BinaryIndexFile const *binIndex,
                           subvol::CommandLineOptions const &clo)
 {
-  BlockCollection *bc{ new BlockCollection(loader, indexFile) };
+  BlockCollection *bc{ binIndex ? new BlockCollection(loader, *binIndex)
+                                : new BlockCollection(loader, indexFile) };
   bc->setRangeMin(0);
   bc->setRangeMax(0);
-  bc->changeClassificationType(ClassificationType::Rov);
+  ClassificationType type{ ClassificationType::Rov };
+  if (!to_classificationType(clo.classification, type)) {
+    type = ClassificationType::Rov;
+  }
+  bc->changeClassificationType(type);
+  if (clo.rovThreads > 0) {
+    RovEngine *engine{ binIndex ? new RovEngine(clo.rawFilePath, *binIndex)
+                                : new RovEngine(clo.rawFilePath, indexFile) };
+    engine->setThreads(clo.rovThreads);
+    bc->setRovEngine(engine);
+  }
   //  g_blockCollection = std::shared_ptr<BlockCollection>(bc);
 
   bd::Info() << bc->getBlocks().size() << " blocks in index file.";
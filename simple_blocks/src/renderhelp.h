@@ -13,6 +13,7 @@
 
 #include <bd/graphics/vertexarrayobject.h>
 #include <bd/io/indexfile/v2/jsonindexfile.h>
+#include <bd/io/indexfile/v3/binaryindexfile.h>
 
 #include <glm/glm.hpp>
 #include <memory>
@@ -61,9 +62,15 @@ initializeBlockLoader(bd::indexfile::v2::JsonIndexFile const &indexFile,
                       subvol::CommandLineOptions const &clo);
 
 
+/// \brief Make the BlockCollection (and its RovEngine) for \c indexFile.
+///
+/// If \c binIndex is given, \c indexFile only holds its header and the
+/// blocks are made from \c binIndex's mapped columns, which must stay open
+/// for the life of the BlockCollection.
 BlockCollection *
 initializeBlockCollection(BlockLoader *loader,
                           bd::indexfile::v2::JsonIndexFile const &indexFile,
+                          bd::indexfile::v3::BinaryIndexFile const *binIndex,
                           subvol::CommandLineOptions const &clo);
 
 
@@ -0,0 +1,171 @@
+//
+// Created by jim on 4/1/19.
+//
+
+#include "cmdline.h"
+
+#include <tclap/CmdLine.h>
+
+#include <iostream>
+#include <thread>
+
+namespace synth
+{
+
+int
+parseThem(int argc, const char *argv[], CommandLineOptions &opts)
+try
+{
+  TCLAP::CmdLine cmd("Write a procedural raw volume of any size and data type, "
+                     "and a .dat file for it.", ' ');
+
+  TCLAP::ValueArg<std::string> outArg("o", "out", "Raw file to write.",
+                                      true, "", "string");
+  cmd.add(outArg);
+
+  TCLAP::ValueArg<std::string> datArg("d", "dat-file",
+                                      "Dat file to write (default: the raw file "
+                                      "with a .dat extension).",
+                                      false, "", "string");
+  cmd.add(datArg);
+
+  TCLAP::ValueArg<uint64_t> xArg("", "vx", "Volume x dim.", false, 256, "uint");
+  cmd.add(xArg);
+
+  TCLAP::ValueArg<uint64_t> yArg("", "vy", "Volume y dim.", false, 256, "uint");
+  cmd.add(yArg);
+
+  TCLAP::ValueArg<uint64_t> zArg("", "vz", "Volume z dim.", false, 256, "uint");
+  cmd.add(zArg);
+
+  TCLAP::ValueArg<std::string> typeArg("t", "type",
+                                       "Voxel data type (uchar, char, ushort, "
+                                       "short, uint, int, half, float, double).",
+                                       false, "ushort", "string");
+  cmd.add(typeArg);
+
+  std::vector<std::string> patterns{ "shells", "noise", "blobs", "slabs" };
+  TCLAP::ValuesConstraint<std::string> patternConstraint(patterns);
+  TCLAP::ValueArg<std::string> patternArg("p", "pattern",
+                                          "shells: concentric spherical shells, "
+                                          "noise: fractal noise, "
+                                          "blobs: sparse round blobs, "
+                                          "slabs: z slabs of constant value.",
+                                          false, "noise", &patternConstraint);
+  cmd.add(patternArg);
+
+  TCLAP::ValueArg<double> emptyArg("e", "empty",
+                                   "Fraction of the voxels that are empty "
+                                   "(zero), 0 to 1.",
+                                   false, 0.5, "float");
+  cmd.add(emptyArg);
+
+  TCLAP::ValueArg<uint32_t> seedArg("", "seed", "Seed of the pattern.",
+                                    false, 1, "uint");
+  cmd.add(seedArg);
+
+  // buffer size
+  std::string const sixty_four_megs = "64M";
+  TCLAP::ValueArg<std::string> bufferSizeArg("b", "buffer-size",
+                                             "Buffer size bytes. Format is a numeric value followed by "
+                                             "K, M, or G.\n"
+                                             "Values: [0-9]+[KMG].\n"
+                                             "Default: 64M",
+                                             false, sixty_four_megs, "string");
+  cmd.add(bufferSizeArg);
+
+  int const cores{ static_cast<int>(std::thread::hardware_concurrency()) };
+  TCLAP::ValueArg<int> threadsArg("", "threads",
+                                  "Threads generating voxels (default: one "
+                                  "per core).",
+                                  false, cores > 0 ? cores : 1, "int");
+  cmd.add(threadsArg);
+
+  cmd.parse(argc, argv);
+
+  opts.outRawFilePath = outArg.getValue();
+  opts.datFilePath = datArg.getValue();
+  if (opts.datFilePath.empty()) {
+    std::string base{ opts.outRawFilePath };
+    size_t const dot{ base.rfind(".raw") };
+    if (dot != std::string::npos && dot + 4 == base.size()) {
+      base.resize(dot);
+    }
+    opts.datFilePath = base + ".dat";
+  }
+  opts.vx = xArg.getValue();
+  opts.vy = yArg.getValue();
+  opts.vz = zArg.getValue();
+  opts.dataType = typeArg.getValue();
+  opts.pattern = patternArg.getValue();
+  opts.emptyFraction = emptyArg.getValue();
+  opts.seed = seedArg.getValue();
+  opts.bufferSize = convertToBytes(bufferSizeArg.getValue());
+  opts.threads = threadsArg.getValue();
+
+  return static_cast<int>(cmd.getArgList().size());
+
+} catch (TCLAP::ArgException &e) {
+
+  std::cerr << "Error parsing command line args: " << e.error() << " for argument "
+            << e.argId() << std::endl;
+  return 0;
+}
+
+
+size_t
+convertToBytes(std::string s)
+{
+  size_t multiplier{ 1 };
+  std::string last{ *( s.end() - 1 ) };
+
+  if (last == "K") {
+    multiplier = 1024;
+  } else if (last == "M") {
+    multiplier = 1024 * 1024;
+  } else if (last == "G") {
+    multiplier = 1024 * 1024 * 1024;
+  } else {
+    return stoull(s);
+  }
+
+  std::string numPart(s.begin(), s.end() - 1);
+  auto num = stoull(numPart);
+
+  return num * multiplier;
+}
+
+
+void
+printThem(const CommandLineOptions &opts)
+{
+  std::cout << opts << std::endl;
+}
+
+
+std::ostream &
+operator<<(std::ostream &os, const CommandLineOptions &opts)
+{
+  os << "\n" "Output raw file path: "
+     << opts.outRawFilePath
+     << "\n" "Dat file path: "
+     << opts.datFilePath
+     << "\n" "Dimensions: "
+     << opts.vx << " x " << opts.vy << " x " << opts.vz
+     << "\n" "Data type: "
+     << opts.dataType
+     << "\n" "Pattern: "
+     << opts.pattern
+     << "\n" "Empty fraction: "
+     << opts.emptyFraction
+     << "\n" "Seed: "
+     << opts.seed
+     << "\n" "Buffer Size: "
+     << opts.bufferSize << " bytes."
+     << "\n" "Threads: "
+     << opts.threads;
+
+  return os;
+}
+
+} // namespace synth
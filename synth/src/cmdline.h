@@ -0,0 +1,65 @@
+//
+// Created by jim on 4/1/19.
+//
+
+#ifndef synth_cmdline_h
+#define synth_cmdline_h
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace synth
+{
+
+struct CommandLineOptions
+{
+  // raw file to write
+  std::string outRawFilePath;
+  // dat file to write (default: the raw file with a .dat extension)
+  std::string datFilePath;
+  // volume dimensions in voxels
+  uint64_t vx;
+  uint64_t vy;
+  uint64_t vz;
+  // voxel data type, any name bd::to_dataType() knows
+  std::string dataType;
+  // "shells", "noise", "blobs" or "slabs"
+  std::string pattern;
+  // fraction of the voxels that are empty (zero)
+  double emptyFraction;
+  uint32_t seed;
+  // total size of the slab buffers in bytes
+  uint64_t bufferSize;
+  // generator threads
+  int threads;
+};
+
+
+size_t
+convertToBytes(std::string s);
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Parses command line args and populates \c opts.
+///
+/// If non-zero arg was returned, then the parse was successful, but it does
+/// not mean that valid or all of the required args were provided on the
+/// command line.
+///
+/// \returns 0 on parse failure, non-zero if the parse was successful.
+///////////////////////////////////////////////////////////////////////////////
+int
+parseThem(int argc, const char *argv[], CommandLineOptions &opts);
+
+
+void
+printThem(const CommandLineOptions &);
+
+
+std::ostream &
+operator<<(std::ostream &, const CommandLineOptions &);
+
+} // namespace synth
+
+#endif // ! synth_cmdline_h
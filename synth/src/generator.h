@@ -0,0 +1,236 @@
+//
+// Created by jim on 4/1/19.
+//
+
+#ifndef synth_generator_h
+#define synth_generator_h
+
+#include <bd/log/logger.h>
+#include <bd/util/half.h>
+#include <bd/volume/synthvolume.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace synth
+{
+
+/// \brief Writes a SynthVolume to a raw file, front to back.
+///
+/// The volume is cut into slabs of whole xy slices. Worker threads take
+/// slabs in order and fill them into a ring of buffers, and the calling
+/// thread writes the filled buffers to the file in order, so the file is
+/// written sequentially and only the ring is ever in memory, no matter how
+/// large the volume is. A worker waits for its buffer to be written before
+/// filling it again.
+template<class Ty>
+class Generator
+{
+public:
+
+  explicit Generator(bd::SynthVolume const &volume)
+    : m_volume{ volume }
+    , m_half{ false }
+    , m_bufferBytes{ 64 * 1024 * 1024 }
+    , m_threads{ 1 }
+    , m_slabs{ }
+    , m_nextSlab{ 0 }
+    , m_emptyVoxels{ 0 }
+    , m_mutex{ }
+    , m_filledCv{ }
+    , m_writtenCv{ }
+    , m_written{ 0 }
+    , m_stop{ false }
+  {
+  }
+
+
+  /// \brief Store voxels as halves (Ty must be uint16_t).
+  void
+  setHalf(bool half)
+  {
+    m_half = half;
+  }
+
+
+  /// \brief Total size of the slab buffers.
+  void
+  setBufferBytes(uint64_t bytes)
+  {
+    m_bufferBytes = bytes;
+  }
+
+
+  void
+  setThreads(int threads)
+  {
+    m_threads = threads < 1 ? 1 : threads;
+  }
+
+
+  /// \brief Generate the volume and write it to \c outPath.
+  bool
+  write(std::string const &outPath)
+  {
+    glm::u64vec3 const dims{ m_volume.dims() };
+    uint64_t const sliceElems{ dims.x * dims.y };
+    if (sliceElems * dims.z == 0) {
+      bd::Err() << "The volume is empty, nothing to write.";
+      return false;
+    }
+
+    std::ofstream out;
+    out.open(outPath, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+      bd::Err() << "Could not open: " << outPath;
+      return false;
+    }
+
+    // two buffers per thread, so a thread can fill one while the other
+    // is being written.
+    size_t const numBuffers{ 2 * static_cast<size_t>(m_threads) };
+    uint64_t slicesPerSlab{ m_bufferBytes / numBuffers / ( sliceElems * sizeof(Ty) ) };
+    slicesPerSlab = std::max<uint64_t>(slicesPerSlab, 1);
+    uint64_t const numSlabs{ ( dims.z + slicesPerSlab - 1 ) / slicesPerSlab };
+
+    m_slabs.clear();
+    m_slabs.resize(numBuffers);
+    for (Slab &s : m_slabs) {
+      s.voxels.resize(slicesPerSlab * sliceElems);
+      s.filled = -1;
+    }
+    m_nextSlab = 0;
+    m_written = 0;
+    m_stop = false;
+    m_emptyVoxels = 0;
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < m_threads; ++i) {
+      workers.emplace_back([this, numSlabs, slicesPerSlab] {
+        work(numSlabs, slicesPerSlab);
+      });
+    }
+
+    bool ok{ true };
+    for (uint64_t s = 0; s < numSlabs; ++s) {
+      Slab &slab = m_slabs[s % numBuffers];
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_filledCv.wait(lock, [&slab, s] { return slab.filled == static_cast<int64_t>(s); });
+      }
+
+      uint64_t const nz{ std::min(slicesPerSlab, dims.z - s * slicesPerSlab) };
+      out.write(reinterpret_cast<char const *>(slab.voxels.data()),
+                nz * sliceElems * sizeof(Ty));
+      if (!out.good()) {
+        bd::Err() << "Error writing " << outPath;
+        ok = false;
+      }
+
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_written = s + 1;
+        m_stop = !ok;
+      }
+      m_writtenCv.notify_all();
+      if (!ok) {
+        break;
+      }
+    }
+
+    for (std::thread &t : workers) {
+      t.join();
+    }
+    out.close();
+    m_slabs.clear();
+
+    return ok;
+  }
+
+
+  /// \brief Empty voxels in the last volume written.
+  uint64_t
+  emptyVoxels() const
+  {
+    return m_emptyVoxels;
+  }
+
+
+private:
+
+  struct Slab
+  {
+    std::vector<Ty> voxels;
+    int64_t filled;       ///< index of the slab in voxels, -1 if none yet.
+  };
+
+
+  void
+  work(uint64_t numSlabs, uint64_t slicesPerSlab)
+  {
+    glm::u64vec3 const dims{ m_volume.dims() };
+    uint64_t const numBuffers{ m_slabs.size() };
+    std::vector<float> scratch;
+
+    uint64_t s;
+    while (( s = m_nextSlab++ ) < numSlabs) {
+      // wait until the slab that used this buffer last has been written.
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_writtenCv.wait(lock, [this, s, numBuffers] {
+          return m_stop || s < m_written + numBuffers;
+        });
+        if (m_stop) {
+          return;
+        }
+      }
+
+      Slab &slab = m_slabs[s % numBuffers];
+      uint64_t const z0{ s * slicesPerSlab };
+      uint64_t const nz{ std::min(slicesPerSlab, dims.z - z0) };
+      uint64_t empty;
+      if (m_half) {
+        scratch.resize(nz * dims.x * dims.y);
+        empty = m_volume.fill(z0, nz, scratch.data());
+        bd::floatToHalf(scratch.data(), reinterpret_cast<uint16_t *>(slab.voxels.data()),
+                        scratch.size());
+      } else {
+        empty = m_volume.fill(z0, nz, slab.voxels.data());
+      }
+      m_emptyVoxels += empty;
+
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        slab.filled = static_cast<int64_t>(s);
+      }
+      m_filledCv.notify_all();
+    }
+  }
+
+
+  bd::SynthVolume const &m_volume;
+  bool m_half;
+  uint64_t m_bufferBytes;
+  int m_threads;
+
+  std::vector<Slab> m_slabs;
+  std::atomic<uint64_t> m_nextSlab;
+  std::atomic<uint64_t> m_emptyVoxels;
+
+  std::mutex m_mutex;
+  std::condition_variable m_filledCv;   ///< a slab was filled.
+  std::condition_variable m_writtenCv;  ///< a slab was written.
+  uint64_t m_written;                   ///< slabs written (guarded by m_mutex).
+  bool m_stop;                          ///< guarded by m_mutex.
+
+}; // class Generator
+
+} // namespace synth
+
+#endif // ! synth_generator_h
@@ -0,0 +1,136 @@
+//
+// Created by jim on 4/1/19.
+//
+
+#include "cmdline.h"
+#include "generator.h"
+
+#include <bd/io/datatypes.h>
+#include <bd/io/datfile.h>
+#include <bd/log/logger.h>
+#include <bd/volume/synthvolume.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+/// \brief The file name part of \c path.
+std::string
+fileName(std::string const &path)
+{
+  size_t const slash{ path.find_last_of("/\\") };
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+
+template<class Ty>
+bool
+go(synth::CommandLineOptions const &opts, bd::SynthVolume const &volume,
+   bool half = false)
+{
+  synth::Generator<Ty> gen{ volume };
+  gen.setHalf(half);
+  gen.setBufferBytes(opts.bufferSize);
+  gen.setThreads(opts.threads);
+
+  auto start = std::chrono::steady_clock::now();
+  if (!gen.write(opts.outRawFilePath)) {
+    return false;
+  }
+  double const secs{ std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count() };
+
+  glm::u64vec3 const d{ volume.dims() };
+  uint64_t const voxels{ d.x * d.y * d.z };
+  double const mb{ voxels * sizeof(Ty) / ( 1024.0 * 1024.0 ) };
+  bd::Info() << "Wrote " << opts.outRawFilePath << " (" << mb << " MB) in "
+             << secs << " seconds, " << mb / secs << " MB/s";
+  bd::Info() << "Empty voxels: " << gen.emptyVoxels() << " ("
+             << 100.0 * gen.emptyVoxels() / voxels << "%)";
+
+  return true;
+}
+
+} // namespace
+
+
+int
+main(int argc, char const *argv[])
+{
+  synth::CommandLineOptions opts;
+  if (synth::parseThem(argc, argv, opts) == 0) {
+    std::cerr << "Please use -h for usage." << std::endl;
+    return 1;
+  }
+  synth::printThem(opts);
+
+  std::string typeName{ opts.dataType };
+  std::transform(typeName.begin(), typeName.end(), typeName.begin(), ::tolower);
+  bd::DataType const type{ bd::to_dataType(typeName) };
+
+  bd::SynthPattern pattern;
+  if (!bd::to_synthPattern(opts.pattern, pattern)) {
+    bd::Err() << "Unknown pattern " << opts.pattern;
+    return 1;
+  }
+
+  bd::SynthVolume const volume{ { opts.vx, opts.vy, opts.vz }, pattern,
+                                opts.emptyFraction, opts.seed };
+
+  bool ok{ false };
+  switch (type) {
+    case bd::DataType::Character:
+      ok = go<int8_t>(opts, volume);
+      break;
+    case bd::DataType::UnsignedCharacter:
+      ok = go<uint8_t>(opts, volume);
+      break;
+    case bd::DataType::Short:
+      ok = go<int16_t>(opts, volume);
+      break;
+    case bd::DataType::UnsignedShort:
+      ok = go<uint16_t>(opts, volume);
+      break;
+    case bd::DataType::Integer:
+      ok = go<int32_t>(opts, volume);
+      break;
+    case bd::DataType::UnsignedInteger:
+      ok = go<uint32_t>(opts, volume);
+      break;
+    case bd::DataType::HalfFloat:
+      ok = go<uint16_t>(opts, volume, true);
+      break;
+    case bd::DataType::Float:
+      ok = go<float>(opts, volume);
+      break;
+    case bd::DataType::Double:
+      ok = go<double>(opts, volume);
+      break;
+    default:
+      bd::Err() << "Unsupported data type " << opts.dataType;
+      break;
+  }
+
+  if (!ok) {
+    bd::Err() << "Generating the volume failed.";
+    return 1;
+  }
+
+  bd::DatFileData dat;
+  dat.rX = static_cast<unsigned int>(opts.vx);
+  dat.rY = static_cast<unsigned int>(opts.vy);
+  dat.rZ = static_cast<unsigned int>(opts.vz);
+  dat.volumeFileName = fileName(opts.outRawFilePath);
+  dat.dataType = type;
+  if (!bd::writeDat(opts.datFilePath, dat)) {
+    return 1;
+  }
+  bd::Info() << "Wrote " << opts.datFilePath;
+
+  return 0;
+}